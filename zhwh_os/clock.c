@@ -0,0 +1,210 @@
+/**
+ * @file clock.c
+ * @brief 单调毫秒时钟
+ *
+ * LAPIC 周期定时器目前被屏蔽（见 lapic.c），ticks 不会增长，
+ * 因此时间源改用 TSC：启动时用 PIT 通道 2 的 10ms 单次计数
+ * 同时校准 TSC 和 LAPIC 定时器的每毫秒计数。
+ *
+ * clock_ms() 不依赖任何中断；需要睡眠时，用 LAPIC 单次定时器
+ * 在截止时间产生一次 IRQ_TIMER 把 CPU 从 hlt 中唤醒。
+ *
+ * 内核定时器（timer.c）通过 clock_set_alarm() 登记最早的到期时间，
+ * 同一个 LAPIC 单次定时器在到期时产生 IRQ_TIMER；clock_sleep_until()
+ * 会取睡眠截止时间和闹钟中较早的一个，睡完再把闹钟装回去。
+ */
+
+#include "types.h"
+#include "time.h"
+#include "lapic.h"
+#include "printf.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+// types.h 中的 u64 在 -m32 下只有 32 位，这里必须用 unsigned long long
+typedef unsigned long long u64;
+
+#define PIT_HZ            1193182
+#define PIT_CH2_DATA      0x42
+#define PIT_CMD           0x43
+#define PIT_GATE_PORT     0x61
+#define CALIBRATE_MS      10
+
+static uint32_t tsc_per_ms;      // 每毫秒 TSC 计数
+static uint32_t lapic_per_ms;    // 每毫秒 LAPIC 定时器计数（分频 1）
+static u64 tsc_base;        // clock_init 时的 TSC
+static volatile uint32_t alarm_ms;   // 内核定时器最早到期时间
+static volatile int alarm_set;       // alarm_ms 是否有效
+
+static inline u64 rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((u64)hi << 32) | lo;
+}
+
+// 64 位 / 32 位除法（内核不链接 libgcc，没有 __udivdi3）
+static u64 div64_32(u64 n, uint32_t d) {
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t lo = (uint32_t)n;
+    uint32_t q_hi = hi / d;
+    uint32_t r = hi % d;
+    uint32_t q_lo;
+
+    // r < d，保证 divl 不溢出
+    __asm__("divl %2" : "=a"(q_lo), "=d"(r) : "rm"(d), "a"(lo), "d"(r));
+    return ((u64)q_hi << 32) | q_lo;
+}
+
+/**
+ * @brief 用 PIT 通道 2 校准 TSC 与 LAPIC 定时器
+ */
+void clock_init(void) {
+    uint16_t count = PIT_HZ / (1000 / CALIBRATE_MS);
+    uint8_t gate;
+
+    // 通道 2 门控打开、扬声器关闭
+    gate = inb(PIT_GATE_PORT);
+    outb(PIT_GATE_PORT, (gate & ~0x02) | 0x01);
+
+    // 通道 2，先低后高字节，模式 0（计数结束时 OUT 变高）
+    outb(PIT_CMD, 0xB0);
+    outb(PIT_CH2_DATA, count & 0xFF);
+    outb(PIT_CH2_DATA, count >> 8);
+
+    // 重新触发门控，开始计数
+    gate = inb(PIT_GATE_PORT) & ~0x01;
+    outb(PIT_GATE_PORT, gate);
+    outb(PIT_GATE_PORT, gate | 0x01);
+
+    lapic_timer_oneshot(0xFFFFFFFF, 1);
+    u64 t0 = rdtsc();
+
+    while (!(inb(PIT_GATE_PORT) & 0x20))
+        ;
+
+    u64 t1 = rdtsc();
+    uint32_t lapic_elapsed = 0xFFFFFFFF - lapic_timer_current();
+    lapic_timer_oneshot(0, 1);
+
+    tsc_per_ms = (uint32_t)div64_32(t1 - t0, CALIBRATE_MS);
+    lapic_per_ms = lapic_elapsed / CALIBRATE_MS;
+    if (tsc_per_ms == 0)
+        tsc_per_ms = 1;
+    tsc_base = rdtsc();
+
+    printf("[clock] TSC %d kHz, LAPIC timer %d kHz\n", tsc_per_ms, lapic_per_ms);
+}
+
+/**
+ * @brief 启动以来的毫秒数（单调递增，约 49 天回绕）
+ */
+uint32_t clock_ms(void) {
+    if (tsc_per_ms == 0)
+        return 0;
+    return (uint32_t)div64_32(rdtsc() - tsc_base, tsc_per_ms);
+}
+
+/**
+ * @brief 启动以来的时间，拆成秒和微秒（抓包时间戳用）
+ */
+void clock_timestamp(uint32_t *sec, uint32_t *usec) {
+    if (tsc_per_ms == 0) {
+        *sec = 0;
+        *usec = 0;
+        return;
+    }
+    u64 delta = rdtsc() - tsc_base;
+    u64 ms = div64_32(delta, tsc_per_ms);
+    // 不足 1ms 的余数 < tsc_per_ms，乘 1000 不会溢出 64 位
+    uint32_t rem = (uint32_t)(delta - ms * tsc_per_ms);
+    uint32_t ms32 = (uint32_t)ms;
+
+    *sec = ms32 / 1000;
+    *usec = (ms32 % 1000) * 1000 + (uint32_t)div64_32((u64)rem * 1000, tsc_per_ms);
+}
+
+// 让 LAPIC 单次定时器在 deadline_ms 触发（已过期则尽快触发），调用者已关中断
+static void clock_program(uint32_t deadline_ms) {
+    int32_t remain = (int32_t)(deadline_ms - clock_ms());
+
+    if (remain < 1)
+        remain = 1;
+    // 防止计数溢出 32 位
+    uint32_t max_ms = 0xFFFFFFFF / lapic_per_ms;
+    if ((uint32_t)remain > max_ms)
+        remain = max_ms;
+    lapic_timer_oneshot((uint32_t)remain * lapic_per_ms, 0);
+}
+
+/**
+ * @brief 设置（enable=1）或取消（enable=0）闹钟：到 deadline_ms 时产生一次 IRQ_TIMER
+ */
+void clock_set_alarm(uint32_t deadline_ms, int enable) {
+    uint32_t eflags = readeflags();
+    cli();
+
+    alarm_ms = deadline_ms;
+    alarm_set = enable;
+    if (lapic_per_ms) {
+        if (enable)
+            clock_program(deadline_ms);
+        else
+            lapic_timer_oneshot(0, 1);
+    }
+
+    if (eflags & FL_IF)
+        sti();
+}
+
+/**
+ * @brief 睡眠直到 deadline_ms 或 cond(arg) 返回非零
+ *
+ * 每轮在关中断状态下检查条件，再用 "sti; hlt" 原子地开中断并停机，
+ * 避免检查之后、hlt 之前到达的中断被错过。条件在关中断状态下调用。
+ *
+ * @return 1 被事件唤醒，0 超时
+ */
+int clock_wait_event(uint32_t deadline_ms, int (*cond)(void *arg), void *arg) {
+    int woken = 0;
+
+    for (;;) {
+        __asm__ volatile("cli");
+
+        if (cond && cond(arg)) {
+            woken = 1;
+            break;
+        }
+
+        int32_t remain = (int32_t)(deadline_ms - clock_ms());
+        if (remain <= 0 || lapic_per_ms == 0)
+            break;
+
+        // 闹钟更早时先被闹钟叫醒，定时器跑完后回到这里重新计算
+        uint32_t wake_ms = deadline_ms;
+        if (alarm_set && (int32_t)(alarm_ms - deadline_ms) < 0)
+            wake_ms = alarm_ms;
+        clock_program(wake_ms);
+
+        __asm__ volatile("sti; hlt");
+    }
+
+    if (alarm_set)
+        clock_program(alarm_ms);
+    else
+        lapic_timer_oneshot(0, 1);
+    __asm__ volatile("sti");
+    return woken;
+}
+
+static int call_wake_pending(void *fn) {
+    return ((int (*)(void))fn)();
+}
+
+/**
+ * @brief 睡眠直到 deadline_ms 或 wake_pending() 返回非零
+ * @return 1 被事件唤醒，0 超时
+ */
+int clock_sleep_until(uint32_t deadline_ms, int (*wake_pending)(void)) {
+    return clock_wait_event(deadline_ms, wake_pending ? call_wake_pending : NULL,
+                            (void *)wake_pending);
+}
@@ -8,6 +8,7 @@
 
 #include "types.h"
 #include "vbe.h"
+#include "time.h"
 
 // LVGL 头文件
 #include "../lvgl/lv_conf.h"
@@ -139,13 +140,13 @@ void lv_log_print(lv_log_level_t level, const char *buf) {
  * @brief 获取当前滴答数（毫秒）
  */
 uint32_t lv_tick_get(void) {
-    // TODO: 从系统获取当前时间（毫秒）
-    static uint32_t tick = 0;
-    return tick;
+    return clock_ms();
 }
 
 /**
  * @brief 增加滴答数
+ *
+ * 时间直接取自 clock_ms()，无需外部累加
  */
 void lv_tick_inc(uint32_t tick_period) {
     (void)tick_period;
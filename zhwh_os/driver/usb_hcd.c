@@ -14,6 +14,8 @@
 #include "page.h"
 #include "usb.h"
 #include "usb_hcd.h"
+#include "softirq.h"
+#include "x86/mmu.h"
 
 // 外部声明 DMA 分配函数
 extern void *dma_alloc_coherent(size_t size, uint32_t *dma_handle);
@@ -143,6 +145,8 @@ typedef struct uhci_controller {
 static uhci_controller_t uhci_controllers[USB_MAX_CONTROLLERS];
 int num_uhci_controllers = 0;
 
+static void uhci_softirq(void);
+
 /**
  * @brief Read UHCI register
  */
@@ -372,6 +376,8 @@ static int uhci_init_controller(pci_dev_t *pci_dev, int controller_id) {
 int usb_hcd_init(void) {
     printf("[USB] Scanning for USB controllers...\n");
 
+    open_softirq(USB_SOFTIRQ, uhci_softirq);
+
     pci_dev_t **devices = pci_get_devices();
     if (!devices) {
         printf("[USB] ERROR: No PCI devices found\n");
@@ -429,11 +435,15 @@ int usb_hcd_init(void) {
     return 0;
 }
 
+// USBSTS bits acknowledged in hard IRQ context, consumed by uhci_softirq()
+static volatile uint16_t uhci_irq_status;
+
 /**
- * @brief UHCI IRQ handler
+ * @brief UHCI IRQ handler (hard IRQ half)
  *
- * Called when UHCI controller generates an interrupt (USBINT or ERROR)
- * Processes completed transfer descriptors, especially for periodic mouse transfers
+ * Called when UHCI controller generates an interrupt (USBINT or ERROR).
+ * Only acknowledges the controller and records the status; completed
+ * transfer descriptors are processed in USB_SOFTIRQ (uhci_softirq).
  */
 void uhci_irq_handler(void) {
     // Find the UHCI controller (assuming only one for now)
@@ -454,6 +464,25 @@ void uhci_irq_handler(void) {
     // Clear the interrupt by writing to status register
     uhci_write_reg(ctrl, UHCI_USBSTS, status);
 
+    uhci_irq_status |= status;
+    raise_softirq(USB_SOFTIRQ);
+}
+
+/**
+ * @brief UHCI bottom half: processes completed transfer descriptors,
+ *        especially for periodic mouse transfers (interrupts enabled)
+ */
+static void uhci_softirq(void) {
+    uhci_controller_t *ctrl = &uhci_controllers[0];
+
+    uint32_t eflags = readeflags();
+    cli();
+    uint16_t status = uhci_irq_status;
+    uhci_irq_status = 0;
+    if (eflags & FL_IF) {
+        sti();
+    }
+
     // Process completed periodic transfers (mouse data)
     // The interrupt QH's TD should have completed
     if (ctrl->intr_qh_active && ctrl->intr_qh) {
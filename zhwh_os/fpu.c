@@ -0,0 +1,148 @@
+/**
+ * @file fpu.c
+ * @brief x87/SSE 状态管理
+ *
+ * 用户态的 LVGL 软件渲染器使用 SSE2 混合内核（lv_draw_sw_blend_sse2.c），
+ * 因此内核需要：
+ *   1. 置 CR4.OSFXSR / CR4.OSXMMEXCPT，允许用户态执行 SSE 指令；
+ *   2. 在任务切换时用 FXSAVE/FXRSTOR 保存/恢复 x87 + XMM 寄存器，
+ *      否则两个使用 SSE 的任务会互相破坏寄存器内容。
+ *
+ * 采用立即保存（eager）策略：每次切换都保存 prev、恢复 next，
+ * 不依赖 CR0.TS + #NM 异常，和现有调度路径的改动最小。
+ * 状态区在第一次切换出去时按需分配；从未保存过的任务恢复初始镜像。
+ *
+ * 内核自身以 -mno-sse -mgeneral-regs-only 编译，不会触碰 XMM 寄存器。
+ */
+
+#include "types.h"
+#include "fpu.h"
+#include "task.h"
+#include "kmalloc.h"
+#include "string.h"
+#include "printf.h"
+
+#define CPUID_EDX_FXSR  (1u << 24)
+#define CPUID_EDX_SSE   (1u << 25)
+#define CPUID_EDX_SSE2  (1u << 26)
+
+#define CR0_MP          (1u << 1)
+#define CR0_EM          (1u << 2)
+#define CR0_TS          (1u << 3)
+#define CR4_OSFXSR      (1u << 9)
+#define CR4_OSXMMEXCPT  (1u << 10)
+
+static int fxsr_enabled;
+
+// fninit 之后的干净状态（MXCSR = 0x1F80，所有异常屏蔽），新任务从这里开始
+static uint8_t fpu_init_state[FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+static inline void fxsave(void *buf) {
+    __asm__ volatile("fxsave (%0)" : : "r"(buf) : "memory");
+}
+
+static inline void fxrstor(const void *buf) {
+    __asm__ volatile("fxrstor (%0)" : : "r"(buf) : "memory");
+}
+
+static void cpuid1(uint32_t *ecx, uint32_t *edx) {
+    uint32_t a = 1, b;
+    __asm__ volatile("cpuid" : "+a"(a), "=b"(b), "=c"(*ecx), "=d"(*edx));
+}
+
+/**
+ * @brief 初始化 FPU，CPU 支持 FXSR/SSE 时打开 OSFXSR
+ */
+void fpu_init(void) {
+    uint32_t ecx, edx, cr0, cr4;
+
+    cpuid1(&ecx, &edx);
+
+    __asm__ volatile("movl %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP;
+    __asm__ volatile("movl %0, %%cr0" : : "r"(cr0));
+
+    if ((edx & (CPUID_EDX_FXSR | CPUID_EDX_SSE)) == (CPUID_EDX_FXSR | CPUID_EDX_SSE)) {
+        __asm__ volatile("movl %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+        __asm__ volatile("movl %0, %%cr4" : : "r"(cr4));
+        fxsr_enabled = 1;
+    }
+
+    __asm__ volatile("fninit");
+    __asm__ volatile("fnclex");
+
+    if (fxsr_enabled) {
+        fxsave(fpu_init_state);
+    }
+
+    printf("[FPU] FXSR=%d SSE=%d SSE2=%d, OSFXSR %s\n",
+           !!(edx & CPUID_EDX_FXSR), !!(edx & CPUID_EDX_SSE), !!(edx & CPUID_EDX_SSE2),
+           fxsr_enabled ? "enabled" : "not available");
+}
+
+/**
+ * @brief 用户态是否可以使用 SSE 指令
+ */
+int fpu_sse_enabled(void) {
+    return fxsr_enabled;
+}
+
+// t->fpu_state 保存 kmalloc 返回的原始地址（fpu_exit 释放用），FXSAVE 区是其中 16 字节对齐的部分
+static inline void *fpu_area(void *raw) {
+    return (void *)(((uint32_t)raw + 15) & ~15u);
+}
+
+// 任务的 FXSAVE 区，首次使用时分配
+static void *fpu_state_of(struct task_t *t) {
+    if (!t->fpu_state) {
+        t->fpu_state = kmalloc(FPU_STATE_SIZE + 16);
+        if (!t->fpu_state) return NULL;
+    }
+    return fpu_area(t->fpu_state);
+}
+
+/**
+ * @brief 任务切换时保存 prev 的 FPU/SSE 状态并恢复 next 的状态
+ *
+ * 必须在 switch_to / 首次进入用户态之前、关中断的情况下调用。
+ */
+void fpu_switch(struct task_t *prev, struct task_t *next) {
+    if (!fxsr_enabled || prev == next) return;
+
+    // 已退出的任务不会再被调度，状态不用保存（状态区已由 fpu_exit 释放）
+    if (prev && !task_terminated(prev)) {
+        void *st = fpu_state_of(prev);
+        if (st) fxsave(st);
+    }
+
+    if (next->fpu_state) {
+        fxrstor(fpu_area(next->fpu_state));
+    } else {
+        fxrstor(fpu_init_state);
+    }
+}
+
+/**
+ * @brief fork 时把当前任务的 FPU/SSE 状态复制给子进程
+ *
+ * 在父进程上下文中调用，寄存器里就是父进程的最新状态，直接保存到子进程的状态区。
+ */
+void fpu_fork(struct task_t *child) {
+    if (!fxsr_enabled) return;
+
+    child->fpu_state = NULL;
+    void *st = fpu_state_of(child);
+    if (st) fxsave(st);
+}
+
+/**
+ * @brief 任务退出时释放 FPU/SSE 状态区（do_exit 在置 PS_TERMNAT 之后调用）
+ */
+void fpu_exit(struct task_t *t) {
+    if (t->fpu_state) {
+        kfree(t->fpu_state);
+        t->fpu_state = NULL;
+    }
+}
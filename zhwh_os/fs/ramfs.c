@@ -24,7 +24,7 @@
 /**
  * @brief 简单的 realloc 实现
  */
-static void *krealloc(void *ptr, uint32_t new_size) {
+static void *krealloc(void *ptr, uint32_t old_size, uint32_t new_size) {
     if (!ptr) {
         return kmalloc(new_size);
     }
@@ -40,9 +40,8 @@ static void *krealloc(void *ptr, uint32_t new_size) {
         return NULL;
     }
 
-    // 拷贝旧数据（假设旧大小不超过新大小）
-    // ⚠️ 简化版：不追踪旧大小，只是拷贝最多新大小的数据
-    memcpy(new_ptr, ptr, new_size);
+    // 拷贝旧数据（只拷旧缓冲区里有的部分）
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
 
     // 释放旧内存
     kfree(ptr);
@@ -280,6 +279,13 @@ int ramfs_mkdir(inode_t *dir, const char *name, int mode) {
 int ramfs_open(inode_t *inode, file_t *file) {
     printf("[ramfs] open: inode=%d\n", inode->i_ino);
     file->f_pos = 0;  // 重置读写位置
+
+    // O_TRUNC：丢掉原有内容
+    if ((file->f_flags & O_TRUNC) && S_ISREG(inode->i_mode) && inode->i_data) {
+        kfree(inode->i_data);
+        inode->i_data = NULL;
+        inode->i_size = 0;
+    }
     return 0;
 }
 
@@ -348,7 +354,7 @@ int ramfs_write(file_t *file, const char *buffer, uint32_t size) {
     uint64_t new_size = file->f_pos + size;
     if (new_size > inode->i_size) {
         // 需要扩展数据缓冲区
-        void *new_data = krealloc(inode->i_data, new_size);
+        void *new_data = krealloc(inode->i_data, inode->i_size, new_size);
         if (!new_data) {
             printf("[ramfs] write: failed to expand buffer\n");
             return -1;
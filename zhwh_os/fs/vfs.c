@@ -7,10 +7,11 @@
  */
 
 #include "fs.h"
-#include "mm.h"
+#include "mm.h"      // 含 task.h
 #include "printf.h"
 #include "string.h"
 #include "syscall.h"  // for copy_from_user
+#include "lapic.h"
 
 // 外部声明
 extern int copy_from_user(char *dst, const char *src, uint32_t n);
@@ -210,6 +211,46 @@ inode_t *path_lookup(const char *path) {
     return current;
 }
 
+/**
+ * @brief 在父目录里创建普通文件（O_CREAT），返回新文件的 inode
+ */
+static inode_t *vfs_create(const char *path) {
+    char parent[256];
+    strncpy(parent, path, sizeof(parent) - 1);
+    parent[sizeof(parent) - 1] = '\0';
+
+    // 拆成父目录和文件名
+    char *name = parent;
+    char *slash = NULL;
+    for (char *p = parent; *p; p++) {
+        if (*p == '/') {
+            slash = p;
+        }
+    }
+    inode_t *dir;
+    if (slash) {
+        *slash = '\0';
+        name = slash + 1;
+        dir = parent[0] ? path_lookup(parent) : root_sb->s_root;
+    } else {
+        dir = root_sb->s_root;
+    }
+    if (!dir || !name[0]) {
+        printf("[vfs] create: bad path '%s'\n", path);
+        return NULL;
+    }
+    if (!dir->i_op || !dir->i_op->create) {
+        printf("[vfs] create: no create operation\n");
+        return NULL;
+    }
+
+    dentry_t *dentry;
+    if (dir->i_op->create(dir, name, S_IFREG | 0644, &dentry) != 0) {
+        return NULL;
+    }
+    return dentry->d_inode;
+}
+
 // ================================
 // 文件操作（VFS 层）
 // ================================
@@ -230,13 +271,17 @@ file_t *filp_open(const char *filename, int flags) {
     if (!inode) {
         // 文件不存在，检查是否需要创建
         if (flags & O_CREAT) {
-            printf("[vfs] filp_open: file not found, O_CREAT not implemented yet\n");
-            return NULL;
+            inode = vfs_create(filename);
+            if (!inode) {
+                return NULL;
+            }
         } else {
             printf("[vfs] filp_open: file not found\n");
             return NULL;
         }
     }
+    // 和 iget 一样持有一个引用，由 filp_close 里的 iput 释放
+    inode->i_nlink++;
 
     // 分配 file 结构
     file_t *file = (file_t *)kmalloc(sizeof(file_t));
@@ -249,6 +294,7 @@ file_t *filp_open(const char *filename, int flags) {
     file->f_inode = inode;
     file->f_flags = flags;
     file->f_pos = 0;
+    file->f_count = 1;
     file->f_op = inode->i_fop;
 
     // 调用文件系统的 open 方法
@@ -265,25 +311,34 @@ file_t *filp_open(const char *filename, int flags) {
 }
 
 /**
- * @brief 关闭文件
+ * @brief 关闭文件（减引用计数，最后一个引用才真正释放）
+ *
+ * 套接字等非文件系统对象没有 inode，只走 f_op->close。
  */
 int filp_close(file_t *file) {
     if (!file) {
         return -1;
     }
 
-    printf("[vfs] filp_close: inode=%d\n", file->f_inode->i_ino);
+    if (file->f_count > 1) {
+        file->f_count--;
+        return 0;
+    }
+
+    if (file->f_inode) {
+        printf("[vfs] filp_close: inode=%d\n", file->f_inode->i_ino);
+    }
 
     // 调用文件系统的 close 方法
     if (file->f_op && file->f_op->close) {
         file->f_op->close(file);
     }
 
-    // 释放 inode
-    iput(file->f_inode);
-
-    // 释放 file 结构
-    kfree(file);
+    // 释放 inode 和 file 结构（没有 inode 的 file 嵌在所属对象里，由 close 回收）
+    if (file->f_inode) {
+        iput(file->f_inode);
+        kfree(file);
+    }
 
     return 0;
 }
@@ -296,7 +351,9 @@ int filp_read(file_t *file, char *buffer, uint32_t size) {
         return -1;
     }
 
-    printf("[vfs] filp_read: inode=%d, size=%u\n", file->f_inode->i_ino, size);
+    if (file->f_inode) {
+        printf("[vfs] filp_read: inode=%d, size=%u\n", file->f_inode->i_ino, size);
+    }
 
     // 检查权限
     if ((file->f_flags & O_RDWR) == 0 && (file->f_flags & O_RDONLY) == 0) {
@@ -321,7 +378,9 @@ int filp_write(file_t *file, const char *buffer, uint32_t size) {
         return -1;
     }
 
-    printf("[vfs] filp_write: inode=%d, size=%u\n", file->f_inode->i_ino, size);
+    if (file->f_inode) {
+        printf("[vfs] filp_write: inode=%d, size=%u\n", file->f_inode->i_ino, size);
+    }
 
     // 检查权限
     if ((file->f_flags & O_RDWR) == 0 && (file->f_flags & O_WRONLY) == 0) {
@@ -346,8 +405,10 @@ int filp_lseek(file_t *file, int64_t offset, int whence) {
         return -1;
     }
 
-    printf("[vfs] filp_lseek: inode=%d, offset=%lld, whence=%d\n",
-           file->f_inode->i_ino, offset, whence);
+    if (file->f_inode) {
+        printf("[vfs] filp_lseek: inode=%d, offset=%lld, whence=%d\n",
+               file->f_inode->i_ino, offset, whence);
+    }
 
     // 调用文件系统的 lseek 方法
     if (!file->f_op || !file->f_op->lseek) {
@@ -358,6 +419,85 @@ int filp_lseek(file_t *file, int64_t offset, int whence) {
     return file->f_op->lseek(file, offset, whence);
 }
 
+// ================================
+// 文件描述符表
+// ================================
+
+extern task_t *current_task[];
+
+static task_t *fd_task(void) {
+    return current_task[logical_cpu_id()];
+}
+
+/**
+ * @brief 把 file 放进当前进程的文件表
+ * @return 最小的空闲 fd；表满返回 -1，调用者负责关闭 file
+ */
+int fd_install(file_t *file) {
+    task_t *task = fd_task();
+
+    if (!task || !file) {
+        return -1;
+    }
+    for (int fd = FD_FIRST; fd < TASK_NOFILE; fd++) {
+        if (!task->files[fd]) {
+            task->files[fd] = file;
+            return fd;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 按 fd 取当前进程打开的文件
+ */
+file_t *fd_get(int fd) {
+    task_t *task = fd_task();
+
+    if (!task || fd < FD_FIRST || fd >= TASK_NOFILE) {
+        return NULL;
+    }
+    return task->files[fd];
+}
+
+/**
+ * @brief 关闭 fd（文件本身在最后一个引用关闭时释放）
+ */
+int fd_close(int fd) {
+    file_t *file = fd_get(fd);
+
+    if (!file) {
+        return -1;
+    }
+    fd_task()->files[fd] = NULL;
+    return filp_close(file);
+}
+
+/**
+ * @brief fork：子进程继承父进程的全部 fd，共享同一个 file
+ */
+void files_fork(task_t *child, task_t *parent) {
+    for (int fd = 0; fd < TASK_NOFILE; fd++) {
+        child->files[fd] = parent->files[fd];
+        if (child->files[fd]) {
+            child->files[fd]->f_count++;
+        }
+    }
+}
+
+/**
+ * @brief 进程退出：关闭所有 fd
+ */
+void files_exit(task_t *task) {
+    for (int fd = 0; fd < TASK_NOFILE; fd++) {
+        if (task->files[fd]) {
+            file_t *file = task->files[fd];
+            task->files[fd] = NULL;
+            filp_close(file);
+        }
+    }
+}
+
 // ================================
 // VFS 初始化
 // ================================
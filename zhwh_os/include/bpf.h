@@ -0,0 +1,129 @@
+/**
+ * @file bpf.h
+ * @brief 经典 BPF（cBPF）包过滤虚拟机
+ *
+ * 指令格式、操作码和语义与 Linux / BSD 的经典 BPF 一致（struct sock_filter），
+ * tcpdump -dd 生成的程序可以直接加载：
+ *
+ * - 累加器 A、索引寄存器 X、16 个字的暂存 M[]，全部 32 位无符号
+ * - 包数据按网络字节序读取，越界读直接返回 0（丢弃）
+ * - 跳转只能向前，所以程序一定会结束，执行步数不超过指令数
+ *
+ * 返回值：0 丢弃，BPF_RET_QUEUE(n) 接收并指定队列 n，其他非 0 值都是接收
+ * （经典 BPF 里它是截取长度，这里不截断）。
+ *
+ * 本文件和 net/bpf.c 不依赖内核其他部分，主机上的 net/bench/bpf_bench 直接编译同一份源码。
+ */
+
+#ifndef NET_BPF_H
+#define NET_BPF_H
+
+#include "types.h"
+
+// ==================== 指令格式 ====================
+
+typedef struct sock_filter {
+    uint16_t code;              // 操作码
+    uint8_t  jt;                // 条件成立时向前跳过的指令数
+    uint8_t  jf;                // 条件不成立时向前跳过的指令数
+    uint32_t k;                 // 常量 / 偏移
+} sock_filter_t;
+
+_Static_assert(sizeof(sock_filter_t) == 8, "sock_filter_t must be 8 bytes");
+
+#define BPF_MAXINSNS    256     // 单个程序最多指令数
+#define BPF_MEMWORDS    16      // M[] 暂存字数
+
+// 指令类
+#define BPF_CLASS(code) ((code) & 0x07)
+#define BPF_LD          0x00
+#define BPF_LDX         0x01
+#define BPF_ST          0x02
+#define BPF_STX         0x03
+#define BPF_ALU         0x04
+#define BPF_JMP         0x05
+#define BPF_RET         0x06
+#define BPF_MISC        0x07
+
+// ld/ldx 宽度
+#define BPF_SIZE(code)  ((code) & 0x18)
+#define BPF_W           0x00
+#define BPF_H           0x08
+#define BPF_B           0x10
+
+// ld/ldx 寻址方式
+#define BPF_MODE(code)  ((code) & 0xe0)
+#define BPF_IMM         0x00
+#define BPF_ABS         0x20
+#define BPF_IND         0x40
+#define BPF_MEM         0x60
+#define BPF_LEN         0x80
+#define BPF_MSH         0xa0    // ldxb 4*([k]&0xf)：取 IP 头长度
+
+// alu/jmp 操作
+#define BPF_OP(code)    ((code) & 0xf0)
+#define BPF_ADD         0x00
+#define BPF_SUB         0x10
+#define BPF_MUL         0x20
+#define BPF_DIV         0x30
+#define BPF_OR          0x40
+#define BPF_AND         0x50
+#define BPF_LSH         0x60
+#define BPF_RSH         0x70
+#define BPF_NEG         0x80
+#define BPF_MOD         0x90
+#define BPF_XOR         0xa0
+
+#define BPF_JA          0x00
+#define BPF_JEQ         0x10
+#define BPF_JGT         0x20
+#define BPF_JGE         0x30
+#define BPF_JSET        0x40
+
+// 操作数来源
+#define BPF_SRC(code)   ((code) & 0x08)
+#define BPF_K           0x00
+#define BPF_X           0x08
+
+// ret 的返回值来源
+#define BPF_RVAL(code)  ((code) & 0x18)
+#define BPF_A           0x10
+
+// misc 操作
+#define BPF_MISCOP(code) ((code) & 0xf8)
+#define BPF_TAX         0x00
+#define BPF_TXA         0x80
+
+#define BPF_STMT(code, k)           { (uint16_t)(code), 0, 0, k }
+#define BPF_JUMP(code, k, jt, jf)   { (uint16_t)(code), jt, jf, k }
+
+// ==================== 返回值 ====================
+
+#define BPF_RET_DROP        0u
+#define BPF_RET_ACCEPT      0xFFFFFFFFu
+#define BPF_RET_QUEUE(n)    (0x80000000u | ((n) & 0xFF))
+#define BPF_RET_IS_QUEUE(r) (((r) & 0xFFFFFF00u) == 0x80000000u)
+
+// ==================== 程序 ====================
+
+#define BPF_ERR_INVAL   (-22)   // 校验不通过
+
+typedef struct bpf_prog {
+    uint16_t len;               // 指令数
+    uint8_t  in_use;            // 程序池分配标记
+    uint32_t runs;              // 执行次数
+    uint32_t drops;             // 返回 0 的次数
+    sock_filter_t insns[BPF_MAXINSNS];
+} bpf_prog_t;
+
+/**
+ * @brief 校验程序：长度、操作码、跳转目标、M[] 下标、除数常量、
+ *        M[] 先写后读，最后一条必须是 ret
+ * @return 0 通过，BPF_ERR_INVAL 不通过
+ */
+int bpf_check(const sock_filter_t *insns, uint32_t len);
+
+// 在 len 字节的包上执行已通过校验的程序，返回程序的返回值
+uint32_t bpf_run(const sock_filter_t *insns, const uint8_t *pkt, uint32_t len);
+
+#endif // NET_BPF_H
@@ -0,0 +1,87 @@
+/**
+ * @file bypass.h
+ * @brief 内核旁路：把网卡的收发环交给用户进程直接驱动
+ *
+ * 特权进程用 SYS_NET_BYPASS 拿到一个 fd，网卡的 RX/TX 描述符环换成
+ * 一块新分配的物理连续内存里的用户环，连同缓冲区和门铃寄存器一起映射到
+ * NET_BYPASS_VADDR：
+ *
+ *   +------+---------+---------+------------------------+----------+
+ *   | info | RX 环   | TX 环   | 缓冲区 0 .. buf_nr-1    | 门铃页   |
+ *   +------+---------+---------+------------------------+----------+
+ *    各占一页                    每个 buf_size 字节          设备寄存器，不可缓存
+ *
+ * 数据区在用户空间和物理内存里的偏移相同，描述符里的缓冲区地址
+ * = dma_base + 偏移。用户自己填描述符、写门铃，不经过协议栈和系统调用；
+ * 旁路期间协议栈在这块网卡上既不收也不发。映射只对发起旁路的进程可见（usermap）。
+ *
+ * 接收中断变成通知：read(fd) 打开 RX 中断并等待，中断到达时驱动屏蔽 RX 中断
+ * 并计数，read 返回这段时间的通知次数（eventfd 语义，一秒内没有中断返回 0）；
+ * 纯轮询的进程不调用 read，中断一直屏蔽。
+ *
+ * fd 最后一次关闭（包括进程退出）时驱动换回自己的环，网卡重新交给协议栈。
+ * 布局结构和常量与用户态 libuser.h 中的定义一致。
+ */
+
+#ifndef BYPASS_H
+#define BYPASS_H
+
+#include "types.h"
+#include "net.h"
+#include "fs.h"
+
+#define NET_BYPASS_VADDR        0xB1000000  // 用户态映射地址（抓包环之后）
+#define NET_BYPASS_MAGIC        0x53505942  // "BYPS"
+#define NET_BYPASS_RING_SIZE    4096        // 每个描述符环占一页
+#define NET_BYPASS_BUF_SIZE     2048
+#define NET_BYPASS_BUF_NR       256         // 512KB
+#define NET_BYPASS_PAGES        (3 + NET_BYPASS_BUF_NR * NET_BYPASS_BUF_SIZE / PAGE_SIZE)
+#define NET_BYPASS_DOORBELL_MAX 2           // 门铃最多占几页寄存器空间
+
+// 区域第一页，用户只读这些字段
+typedef struct net_bypass_info {
+    uint32_t magic;
+    char     ifname[16];
+    uint8_t  mac[6];
+    uint16_t mtu;
+    uint32_t dma_base;              // 区域起始的物理地址
+    uint32_t rx_ring_offset;        // RX 描述符环（相对区域起始，下同）
+    uint32_t tx_ring_offset;
+    uint32_t rx_desc_nr;            // 描述符个数
+    uint32_t tx_desc_nr;
+    uint32_t buf_offset;            // 第一个缓冲区
+    uint32_t buf_size;
+    uint32_t buf_nr;
+    uint32_t doorbell_offset;       // 门铃页
+    uint32_t rx_doorbell;           // RX 尾指针寄存器（相对门铃页）
+    uint32_t tx_doorbell;           // TX 尾指针寄存器
+    volatile uint32_t irq_count;    // 累计通知次数
+} net_bypass_info_t;
+
+// 内核侧状态（静态，同一时间只有一个旁路）
+typedef struct net_bypass {
+    file_t file;                    // fd，嵌在这里，最后一次 close 时换回内核的环
+    net_device_t *dev;
+    net_bypass_info_t *info;        // 内核访问区域的地址
+    uint32_t pa;                    // 区域物理地址
+    uint32_t doorbell_pa;           // 驱动 attach 时填：门铃页物理地址（页对齐）
+    uint32_t doorbell_pages;        // 驱动 attach 时填：1 ~ NET_BYPASS_DOORBELL_MAX
+    uint32_t pid;                   // 持有者
+    volatile uint32_t pending;      // 还没被 read 取走的通知
+} net_bypass_t;
+
+// 用户环的物理地址（驱动 attach 时写进基址寄存器）
+static inline uint32_t net_bypass_rx_ring(const net_bypass_t *bp) {
+    return bp->pa + bp->info->rx_ring_offset;
+}
+
+static inline uint32_t net_bypass_tx_ring(const net_bypass_t *bp) {
+    return bp->pa + bp->info->tx_ring_offset;
+}
+
+// 驱动中断处理程序在旁路期间收到接收中断时调用（已屏蔽 RX 中断）
+void net_bypass_notify(net_device_t *dev);
+
+int sys_net_bypass(const char *ifname);
+
+#endif // BYPASS_H
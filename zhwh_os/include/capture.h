@@ -0,0 +1,89 @@
+/**
+ * @file capture.h
+ * @brief 抓包环（PACKET_MMAP 风格）
+ *
+ * 一块物理连续的内存同时映射进内核和用户空间（CAPTURE_RING_VADDR），
+ * 协议栈在收发路径上把帧拷进环里，用户态直接在映射上读，不走系统调用也不再拷贝：
+ *
+ *   +----------------+---------+---------+-----+---------+
+ *   | capture_ring_t | frame 0 | frame 1 | ... | frame N |
+ *   +----------------+---------+---------+-----+---------+
+ *    CAPTURE_FRAME_SIZE 字节     每个 CAPTURE_FRAME_SIZE 字节
+ *
+ * 每个帧槽的 status 表示归属：内核只写 CAPTURE_STATUS_KERNEL 的槽，写完置 USER；
+ * 用户态读完置回 KERNEL。内核要写的下一个槽还在用户手里就说明环满了，
+ * 这一帧丢掉并计入 drops，不会覆盖用户还没读的数据。
+ *
+ * 环头里的几何参数和计数由内核写给用户看，内核自己不读回（见 capture.c）。
+ * 环映射只对最近一次建立它的进程可见（usermap），建立环和打开抓包需要 uid 0。
+ *
+ * 布局结构和常量与用户态 libuser.h 中的定义一致。
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "types.h"
+#include "net.h"
+
+#define CAPTURE_RING_VADDR      0xB0000000  // 用户态映射地址
+#define CAPTURE_RING_PAGES      64          // 256KB
+#define CAPTURE_FRAME_SIZE      2048
+#define CAPTURE_RING_MAGIC      0x50434150  // "PCAP"
+
+// 帧槽归属（capture_frame_t.status）
+#define CAPTURE_STATUS_KERNEL   0
+#define CAPTURE_STATUS_USER     1
+
+// 抓包方向（net_device_t.capture 位和 capture_frame_t.dir）
+#define CAPTURE_RX              0x01
+#define CAPTURE_TX              0x02
+
+// 环头，占第一个帧槽（只读副本，内核不信任用户写回的值）
+typedef struct capture_ring {
+    uint32_t magic;
+    uint32_t frame_size;            // 帧槽大小
+    uint32_t frame_nr;              // 帧槽个数
+    uint32_t frame_offset;          // 第一个帧槽相对环起始的偏移
+    uint32_t snaplen;               // 每帧最多保存的字节数
+    volatile uint32_t packets;      // 写入环的帧数
+    volatile uint32_t drops;        // 环满丢掉的帧数
+} capture_ring_t;
+
+// 帧槽头，后面紧跟帧数据
+typedef struct capture_frame {
+    volatile uint32_t status;       // CAPTURE_STATUS_*
+    uint32_t len;                   // 帧原始长度
+    uint32_t caplen;                // 实际保存的长度（<= snaplen）
+    uint32_t tv_sec;                // 时间戳（启动以来）
+    uint32_t tv_usec;
+    uint8_t  dir;                   // CAPTURE_RX / CAPTURE_TX
+    uint8_t  reserved[3];
+    char     ifname[16];            // 收发设备名
+} capture_frame_t;
+
+#define CAPTURE_SNAPLEN         (CAPTURE_FRAME_SIZE - sizeof(capture_frame_t))
+
+// SYS_NET_CAPTURE 的 cmd
+#define NET_CAPTURE_SETUP       1   // 建立（或复位）环，返回用户态地址
+#define NET_CAPTURE_ENABLE      2   // 设置设备的抓包方向，arg = CAPTURE_RX | CAPTURE_TX，0 关闭
+#define NET_CAPTURE_SHOW        3   // 打印各设备抓包状态和环统计
+
+void net_capture_frame(net_device_t *dev, int dir, const uint8_t *data, uint32_t len);
+void net_capture_netbuf(net_device_t *dev, int dir, netbuf_t *nb);
+int sys_net_capture(int cmd, const char *ifname, uint32_t arg);
+
+// 收发路径上的钩子：设备没开抓包时只多一次判断
+static inline void net_capture_rx(net_device_t *dev, netbuf_t *nb) {
+    if (dev->capture & CAPTURE_RX) {
+        net_capture_netbuf(dev, CAPTURE_RX, nb);
+    }
+}
+
+static inline void net_capture_tx(net_device_t *dev, netbuf_t *nb) {
+    if (dev->capture & CAPTURE_TX) {
+        net_capture_netbuf(dev, CAPTURE_TX, nb);
+    }
+}
+
+#endif // CAPTURE_H
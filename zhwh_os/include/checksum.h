@@ -0,0 +1,70 @@
+/**
+ * @file checksum.h
+ * @brief Internet 校验和（RFC 1071 / RFC 1624）
+ *
+ * - csum_partial()：按 32 位字累加，进位留到最后折叠（end-around carry），
+ *   返回未折叠、未取反的部分和，可以分段接着累加
+ * - csum_tcpudp_nofold()：直接把伪头部字段加进部分和，不用拼出伪头部
+ * - csum_replace2/4()：RFC 1624 增量更新，改 TTL、改地址（NAT）时
+ *   不用重算整个校验和
+ *
+ * 所有数据按内存字节顺序累加，结果直接写回报文即为网络字节序。
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "types.h"
+
+// 累加 len 字节（任意对齐、任意长度），返回 32 位部分和
+uint32_t csum_partial(const void *buf, uint32_t len, uint32_t sum);
+
+// IP 头校验和（ihl 为 32 位字数），头部完好时返回 0
+uint16_t ip_fast_csum(const void *iph, uint32_t ihl);
+
+// 伪头部：saddr/daddr 为网络字节序，len/proto 为主机字节序
+uint32_t csum_tcpudp_nofold(uint32_t saddr, uint32_t daddr, uint32_t len,
+                            uint8_t proto, uint32_t sum);
+
+/**
+ * @brief 32 位部分和相加（回卷进位）
+ */
+static inline uint32_t csum_add(uint32_t sum, uint32_t addend) {
+    sum += addend;
+    return sum + (sum < addend);
+}
+
+/**
+ * @brief 折叠成 16 位并取反（最终写进报文的值）
+ */
+static inline uint16_t csum_fold(uint32_t sum) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+/**
+ * @brief RFC 1624 增量更新：报文中一个 16 位字从 old_val 改成 new_val
+ *
+ * HC' = ~(~HC + ~m + m')，例如 TTL 递减、ICMP 请求改应答。
+ */
+static inline void csum_replace2(uint16_t *sum, uint16_t old_val, uint16_t new_val) {
+    uint32_t s = (uint16_t)~*sum;
+    s += (uint16_t)~old_val;
+    s += new_val;
+    *sum = csum_fold(s);
+}
+
+/**
+ * @brief RFC 1624 增量更新：报文中一个 32 位字段（比如 IP 地址）改变
+ */
+static inline void csum_replace4(uint16_t *sum, uint32_t old_val, uint32_t new_val) {
+    uint32_t s = (uint16_t)~*sum;
+    s += (uint16_t)~old_val;
+    s += (uint16_t)~(old_val >> 16);
+    s += new_val & 0xFFFF;
+    s += new_val >> 16;
+    *sum = csum_fold(s);
+}
+
+#endif // CHECKSUM_H
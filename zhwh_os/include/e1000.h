@@ -54,6 +54,7 @@ typedef struct pci_dev pci_dev_t;
 #define E1000_RAL(n)   (0x05400 + (n) * 8)
 #define E1000_RAH(n)   (0x05404 + (n) * 8)
 #define E1000_MTA             0x05200  // Multicast Table Array
+#define E1000_RXCSUM          0x05000  // RX Checksum Control
 #define E1000_CRCERRS         0x04000  // CRC Error Count
 #define E1000_ALGNERRC        0x04004  // Alignment Error Count
 #define E1000_SYMERRS         0x04008  // Symbol Error Count
@@ -213,9 +214,18 @@ typedef struct pci_dev pci_dev_t;
 // 描述符相关
 #define E1000_NUM_RX_DESC     64
 #define E1000_NUM_TX_DESC     64
-#define E1000_RX_BUF_SIZE     2048
+#define E1000_RX_BUF_SIZE     NETBUF_DATA_SIZE  // RX 缓冲区就是 netbuf 的数据区
 #define E1000_TX_BUF_SIZE     2048
+
+// RCTL.BSIZE（位 17:16），BSEX 置位时大小乘 16
 #define E1000_RCTL_BSIZE_2048   0x00000000
+#define E1000_RCTL_BSIZE_1024   0x00010000
+#define E1000_RCTL_BSIZE_512    0x00020000
+#define E1000_RCTL_BSIZE_256    0x00030000
+#define E1000_RCTL_BSIZE_16384  (E1000_RCTL_BSIZE_1024 | E1000_RCTL_BSEX)
+#define E1000_RCTL_BSIZE_8192   (E1000_RCTL_BSIZE_512 | E1000_RCTL_BSEX)
+#define E1000_RCTL_BSIZE_4096   (E1000_RCTL_BSIZE_256 | E1000_RCTL_BSEX)
+#define E1000_RCTL_BSIZE_MASK   (0x00030000 | E1000_RCTL_BSEX)
 
 // TX 描述符状态位
 #define E1000_TXD_STAT_DD     0x00000001  // Descriptor Done
@@ -223,6 +233,31 @@ typedef struct pci_dev pci_dev_t;
 // RX 描述符状态位
 #define E1000_RXD_STAT_DD     0x00000001  // Descriptor Done
 #define E1000_RXD_STAT_EOP    0x00000002  // End of Packet
+#define E1000_RXD_STAT_IXSM   0x04        // Ignore Checksum Indication
+#define E1000_RXD_STAT_TCPCS  0x20        // TCP/UDP 校验和已检查
+#define E1000_RXD_STAT_IPCS   0x40        // IP 头校验和已检查
+
+// RX 描述符错误位
+#define E1000_RXD_ERR_TCPE    0x20        // TCP/UDP 校验和错误
+#define E1000_RXD_ERR_IPE     0x40        // IP 头校验和错误
+
+// RXCSUM 寄存器
+#define E1000_RXCSUM_IPOFL    0x00000100  // IP 头校验和卸载
+#define E1000_RXCSUM_TUOFL    0x00000200  // TCP/UDP 校验和卸载
+
+// 扩展 TX 数据描述符（校验和 / TSO），复用 e1000_tx_desc_t 的字节布局：
+//   cso 字节 = 长度高 4 位 | DTYP，cmd = DCMD，css 字节 = POPTS
+#define E1000_TXD_DTYP_D      0x10        // 数据描述符（cso 字节高 4 位）
+#define E1000_TXD_CMD_TSE     0x04        // TCP 分段
+#define E1000_TXD_CMD_DEXT    0x20        // 扩展描述符
+#define E1000_TXD_POPTS_IXSM  0x01        // 插入 IP 头校验和
+#define E1000_TXD_POPTS_TXSM  0x02        // 插入 TCP/UDP 校验和
+
+// TCP/IP 上下文描述符 TUCMD（cmd_and_length 最高字节）
+#define E1000_TXD_CTX_TCP     0x01        // L4 是 TCP（否则 UDP）
+#define E1000_TXD_CTX_IP      0x02        // IPv4
+#define E1000_TXD_CTX_TSE     0x04        // TCP 分段
+#define E1000_TXD_CTX_DEXT    0x20        // 扩展描述符（必须置位）
 
 // E1000 RX 描述符（Legacy 格式，32位系统专用）
 //
@@ -249,6 +284,20 @@ typedef struct __attribute__((packed)) {
     uint16_t vlan;            // Bytes 14-15: VLAN 标签
 } e1000_tx_desc_t;
 
+// E1000 TCP/IP 上下文描述符：告诉网卡后续数据包的校验和区间和 TSO 参数
+typedef struct __attribute__((packed)) {
+    uint8_t  ipcss;           // Byte 0:     IP 校验和起始
+    uint8_t  ipcso;           // Byte 1:     IP 校验和字段偏移
+    uint16_t ipcse;           // Bytes 2-3:  IP 校验和结束（含）
+    uint8_t  tucss;           // Byte 4:     TCP/UDP 校验和起始
+    uint8_t  tucso;           // Byte 5:     TCP/UDP 校验和字段偏移
+    uint16_t tucse;           // Bytes 6-7:  TCP/UDP 校验和结束（0 = 到包尾）
+    uint32_t cmd_and_length;  // Bytes 8-11: PAYLEN[19:0] | DTYP=0 | TUCMD[31:24]
+    uint8_t  status;          // Byte 12:    状态
+    uint8_t  hdr_len;         // Byte 13:    TSO 头部长度
+    uint16_t mss;             // Bytes 14-15: TSO MSS
+} e1000_ctx_desc_t;
+
 // 🔥 静态断言：确保大小为 16 字节
 _Static_assert(sizeof(e1000_rx_desc_t) == 16, "e1000_rx_desc_t must be 16 bytes");
 _Static_assert(sizeof(e1000_tx_desc_t) == 16, "e1000_tx_desc_t must be 16 bytes");
@@ -262,6 +311,22 @@ _Static_assert(sizeof(e1000_tx_desc_t) == 16, "e1000_tx_desc_t must be 16 bytes"
 #define E1000_TXD_CMD_VLE     0x40  // VLAN Packet Enable
 #define E1000_TXD_CMD_IDE     0x80  // Interrupt Delay Enable
 
+// 内核旁路时用户 RX / TX 环的描述符数（各占半页，剩下的缓冲区够转发时周转）
+#define E1000_BYPASS_DESC  128
+
+// 批量发送时最多攒这么多个包写一次门铃
+#define E1000_TX_BATCH  16
+
+// RX 中断源（NAPI 轮询期间整体屏蔽）
+#define E1000_IMS_RX  (E1000_ICR_RXT0 | E1000_ICR_RXDMT0 | E1000_ICR_RXO)
+
+// 自适应中断节流档位
+#define E1000_ITR_LOWEST_LATENCY  0   // 零星小包：尽快中断
+#define E1000_ITR_LOW_LATENCY     1   // 默认
+#define E1000_ITR_BULK_LATENCY    2   // 大包持续流量：多攒几个包再中断
+// ITR 寄存器单位 256ns，按每秒最多中断次数换算
+#define E1000_ITR_INTERVAL(rate)  (1000000000 / ((rate) * 256))
+
 // E1000 私有数据结构
 typedef struct {
     uint32_t mmio_base;        // MMIO 基地址（物理地址）
@@ -270,15 +335,30 @@ typedef struct {
 
     e1000_rx_desc_t *rx_desc;  // RX 描述符数组
     uint32_t rx_desc_phys;     // 🔥 RX 描述符物理地址（必须保存!）
-    uint8_t *rx_buffers[E1000_NUM_RX_DESC];  // RX 缓冲区
+    netbuf_t *rx_netbufs[E1000_NUM_RX_DESC]; // 各 RX 槽位挂着的 netbuf（收包后整块交给协议栈）
     uint16_t rx_cur;           // 当前 RX 描述符索引
+    // 跨多个描述符的长帧（LPE）：还没见到 EOP 的前几段串在 frag 链上
+    netbuf_t *rx_chain;        // 正在拼的帧（头 netbuf）
+    netbuf_t *rx_chain_tail;   // frag 链尾
+    uint32_t rx_chain_len;     // 已收到的字节数
+    uint8_t  rx_discard;       // 本帧前面的描述符出错，丢弃到 EOP 为止
+    uint32_t rx_multi_desc;    // 跨多个描述符收到的帧数
 
     e1000_tx_desc_t *tx_desc;  // TX 描述符数组
     uint32_t tx_desc_phys;     // 🔥 TX 描述符物理地址
     uint8_t *tx_buffers[E1000_NUM_TX_DESC];  // TX 缓冲区
     uint32_t tx_buffers_dma[E1000_NUM_TX_DESC]; // 🔥 TX 缓冲区 DMA 物理地址
-    uint16_t tx_cur;           // 当前 TX 描述符索引
-    uint16_t tx_tail;          // TX tail 指针
+    netbuf_t *tx_netbufs[E1000_NUM_TX_DESC];    // 包最后一个描述符上挂着的 netbuf（DD 后释放）
+    uint16_t tx_eop[E1000_NUM_TX_DESC];         // 包第一个描述符 -> 最后一个描述符
+    uint16_t tx_cur;           // 下一个空闲 TX 描述符（软件写指针）
+    uint16_t tx_tail;          // 最近一次写入 TDT 的值
+    uint16_t tx_dirty;         // 下一个待回收的 TX 描述符
+    uint16_t tx_pending;       // 已挂好但还没写门铃的包数
+    uint32_t tx_doorbells;     // 写 TDT 次数
+    uint32_t tx_busy;          // TX 环满丢包数
+    uint32_t tx_ctx_key;       // 上一个上下文描述符的校验和区间（相同就不重发）
+    uint32_t tx_tso_count;     // TSO 请求数
+    uint32_t rx_csum_errors;   // 硬件报告的校验和错误
 
     uint8_t mac_addr[ETH_ALEN]; // MAC 地址
 
@@ -287,6 +367,15 @@ typedef struct {
     uint32_t recv_call_count;  // e1000_recv 调用次数
     uint32_t empty_recv_count; // 空接收次数（cur == RDH）
     uint32_t packets_processed;// 实际处理的包数
+    uint32_t rx_dropped;       // 驱动层丢包数（错误帧 / 缓冲池耗尽）
+    uint32_t rx_filtered;      // 被接收过滤程序丢弃
+    uint32_t rx_overruns;      // RXO 中断次数（接收环被填满）
+
+    // 自适应中断节流（e1000_update_itr）
+    int itr_class;             // 当前档位 E1000_ITR_*
+    uint32_t itr_packets;      // 本轮轮询收到的包数
+    uint32_t itr_bytes;        // 本轮轮询收到的字节数
+    uint32_t poll_complete_count; // 轮询收空、重新打开中断的次数
 } e1000_priv_t;
 
 // 函数声明
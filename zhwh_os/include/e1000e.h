@@ -0,0 +1,182 @@
+/**
+ * @file e1000e.h
+ * @brief Intel 82574 (e1000e) 多队列网卡驱动（QEMU -device e1000e）
+ *
+ * - 2 个接收队列 + 2 个发送队列，每个队列一个 MSI-X 向量，外加一个"其他"向量（链路变化）
+ * - 接收用扩展描述符，硬件按 RSS（Toeplitz 哈希 IPv4 / IPv4+TCP）经重定向表把流分到两个队列，
+ *   同一条流总在同一个队列上，队列之间互不加锁
+ * - 每个接收队列一个 NAPI 上下文：队列中断只屏蔽自己，轮询收空后只打开自己
+ * - MSI-X 表项 n 的目的 CPU 取第 n 个已启动的 CPU（LAPIC ID），没有就投递给 BSP
+ * - 发送按流哈希选队列，每个队列有自己的上下文描述符缓存（校验和 / TSO 与 e1000 相同）
+ *
+ * 寄存器和描述符大部分与 e1000 相同，这里只定义 82574 新增的部分。
+ */
+
+#ifndef E1000E_H
+#define E1000E_H
+
+#include "net.h"
+#include "e1000.h"
+
+#define E1000E_DEVICE_ID_82574L     0x10D3
+
+// ==================== 每队列寄存器（队列 n 偏移 0x100 * n）====================
+
+#define E1000E_RDBAL(n)     (0x02800 + (n) * 0x100)
+#define E1000E_RDBAH(n)     (0x02804 + (n) * 0x100)
+#define E1000E_RDLEN(n)     (0x02808 + (n) * 0x100)
+#define E1000E_RDH(n)       (0x02810 + (n) * 0x100)
+#define E1000E_RDT(n)       (0x02818 + (n) * 0x100)
+#define E1000E_RXDCTL(n)    (0x02828 + (n) * 0x100)
+#define E1000E_TDBAL(n)     (0x03800 + (n) * 0x100)
+#define E1000E_TDBAH(n)     (0x03804 + (n) * 0x100)
+#define E1000E_TDLEN(n)     (0x03808 + (n) * 0x100)
+#define E1000E_TDH(n)       (0x03810 + (n) * 0x100)
+#define E1000E_TDT(n)       (0x03818 + (n) * 0x100)
+#define E1000E_TXDCTL(n)    (0x03828 + (n) * 0x100)
+
+// ==================== MSI-X / RSS 寄存器 ====================
+
+#define E1000E_EIAC         0x000DC     // MSI-X 自动清除 ICR 的位
+#define E1000E_IAM          0x000E0     // 中断自动屏蔽
+#define E1000E_IVAR         0x000E4     // 中断原因 -> MSI-X 表项
+#define E1000E_EITR(n)      (0x000E8 + (n) * 4)     // 每个向量的节流
+#define E1000E_RFCTL        0x05008     // 接收过滤控制
+#define E1000E_MRQC         0x05818     // 多队列接收控制
+#define E1000E_RETA(n)      (0x05C00 + (n) * 4)     // 重定向表，32 个双字 = 128 项
+#define E1000E_RSSRK(n)     (0x05C80 + (n) * 4)     // RSS 哈希密钥，10 个双字
+
+#define E1000E_CTRL_EXT_EIAME   0x01000000  // MSI-X 下按 IAM 自动屏蔽
+#define E1000E_CTRL_EXT_IAME    0x08000000  // 读 ICR 时按 IAM 屏蔽（MSI-X 下不用）
+#define E1000E_CTRL_EXT_PBA_CLR 0x80000000  // 中断应答后自动清 PBA
+
+#define E1000E_RFCTL_ACK_DIS    0x00001000
+#define E1000E_RFCTL_EXTEN      0x00008000  // 扩展接收描述符
+
+#define E1000E_RXCSUM_PCSD      0x00002000  // 写回 RSS 哈希而不是包校验和
+
+#define E1000E_MRQC_RSS_EN      0x00000001  // RSS，2 个队列
+#define E1000E_MRQC_TCP_IPV4    0x00010000
+#define E1000E_MRQC_IPV4        0x00020000
+
+#define E1000E_RETA_ENTRIES     128
+#define E1000E_RETA_QUEUE1      0x80        // 重定向表项 bit 7 选队列
+
+#define E1000E_TXDCTL_GRAN      0x01000000  // 阈值以描述符为单位
+#define E1000E_TXDCTL_WTHRESH(n) ((n) << 16)
+
+// IVAR：每个原因 4 位（低 3 位表项号 + 有效位），bit 31 = 每次写回都报发送中断
+#define E1000E_IVAR_VALID       0x8
+#define E1000E_IVAR_RX(n)       ((n) * 4)
+#define E1000E_IVAR_TX(n)       (8 + (n) * 4)
+#define E1000E_IVAR_OTHER       16
+#define E1000E_IVAR_INT_ALLOC   0x80000000
+
+// ICR / IMS 中的队列原因位
+#define E1000E_ICR_RXQ(n)       (0x00100000 << (n))
+#define E1000E_ICR_TXQ(n)       (0x00400000 << (n))
+#define E1000E_ICR_OTHER        0x01000000
+#define E1000E_ICR_QUEUES       0x00F00000
+
+// ==================== 扩展接收描述符 ====================
+
+// 读格式：驱动写缓冲区地址；写回格式：网卡写状态、长度和 RSS 哈希
+typedef union {
+    struct {
+        uint32_t buffer_addr;       // 物理地址（64 位字段拆两半）
+        uint32_t buffer_addr_hi;
+        uint32_t reserved[2];       // 写回前必须保持 DD 位为 0
+    } read;
+    struct {
+        uint32_t mrq;               // [3:0] RSS 类型，[12:8] 队列
+        uint32_t rss;               // RSS 哈希（RXCSUM.PCSD）
+        uint32_t status_error;      // [19:0] 扩展状态，[31:20] 扩展错误
+        uint16_t length;
+        uint16_t vlan;
+    } wb;
+} e1000e_rx_desc_t;
+
+_Static_assert(sizeof(e1000e_rx_desc_t) == 16, "e1000e_rx_desc_t must be 16 bytes");
+
+// 扩展状态（低位与 legacy status 字节相同）
+#define E1000E_RXD_STAT_DD      0x00000001
+#define E1000E_RXD_STAT_EOP     0x00000002
+#define E1000E_RXD_STAT_IXSM    0x00000004
+#define E1000E_RXD_STAT_TCPCS   0x00000020
+#define E1000E_RXD_STAT_IPCS    0x00000040
+// 扩展错误
+#define E1000E_RXD_ERR_TCPE     0x20000000
+#define E1000E_RXD_ERR_IPE      0x40000000
+#define E1000E_RXD_ERR_FRAME    0x97000000  // CE | SE | SEQ | CXE | RXE
+
+// ==================== 参数 ====================
+
+#define E1000E_NUM_QUEUES       2
+#define E1000E_NUM_RX_DESC      64          // 每个接收队列（netbuf 池是所有网卡共用的）
+#define E1000E_NUM_TX_DESC      128         // 每个发送队列
+#define E1000E_TX_BATCH         16
+
+// MSI-X 表项：RX0, RX1, TX0, TX1, 其他
+#define E1000E_MSIX_RX(n)       (n)
+#define E1000E_MSIX_TX(n)       (E1000E_NUM_QUEUES + (n))
+#define E1000E_MSIX_OTHER       (2 * E1000E_NUM_QUEUES)
+#define E1000E_MSIX_NVEC        (2 * E1000E_NUM_QUEUES + 1)
+#define E1000E_VECTOR_BASE      0x60        // 表项 i 用向量 0x60 + i；没有 MSI-X 时只用 0x60（MSI）
+
+// 每个向量的节流（单位 256ns）：约 20000 次/秒
+#define E1000E_EITR_DEFAULT     E1000_ITR_INTERVAL(20000)
+
+typedef struct {
+    uint8_t index;
+    e1000e_rx_desc_t *desc;
+    uint32_t desc_dma;
+    netbuf_t *netbufs[E1000E_NUM_RX_DESC];
+    uint16_t cur;                   // 下一个要检查的描述符
+    uint32_t ims;                   // 本队列的中断使能位（轮询结束时写 IMS）
+    napi_t napi;                    // 本队列的轮询上下文
+
+    uint32_t intr_count;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t filtered;              // 被接收过滤程序丢弃
+    uint32_t csum_errors;
+} e1000e_rx_ring_t;
+
+typedef struct {
+    uint8_t index;
+    e1000_tx_desc_t *desc;
+    uint32_t desc_dma;
+    netbuf_t *netbufs[E1000E_NUM_TX_DESC];  // 包最后一个描述符上挂着的 netbuf
+    uint16_t eop[E1000E_NUM_TX_DESC];       // 包第一个描述符 -> 最后一个描述符
+    uint16_t cur;                   // 下一个空闲描述符
+    uint16_t tail;                  // 最近一次写入 TDT 的值
+    uint16_t dirty;                 // 下一个待回收的描述符
+    uint16_t pending;               // 已挂好还没写门铃的包数
+    uint32_t ctx_key;               // 上一个上下文描述符的校验和区间
+
+    uint32_t intr_count;
+    uint32_t packets;
+    uint32_t doorbells;
+    uint32_t busy;
+    uint32_t tso_count;
+} e1000e_tx_ring_t;
+
+typedef struct {
+    volatile uint32_t *mmio;
+    uint32_t mmio_phys;
+    uint8_t  msix;                  // 1 = MSI-X 多向量，0 = 单个 MSI 向量
+    uint8_t  mac_addr[ETH_ALEN];
+    uint8_t  apic_ids[E1000E_MSIX_NVEC];    // 每个 MSI-X 表项的目的 CPU
+
+    e1000e_rx_ring_t rx[E1000E_NUM_QUEUES];
+    e1000e_tx_ring_t tx[E1000E_NUM_QUEUES];
+
+    uint32_t other_count;           // "其他"向量 / 链路变化次数
+} e1000e_priv_t;
+
+int e1000e_init_dev(pci_dev_t *pci_dev, const char *dev_name);
+void e1000e_msix_isr(int entry);    // entry = 向量 - E1000E_VECTOR_BASE
+void e1000e_dump(void);
+
+#endif // E1000E_H
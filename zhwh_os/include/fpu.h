@@ -0,0 +1,17 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include "types.h"
+
+struct task_t;
+
+// fpu.c - x87/SSE 状态管理（CR4.OSFXSR + FXSAVE/FXRSTOR）
+#define FPU_STATE_SIZE  512   // FXSAVE 区大小，要求 16 字节对齐
+
+void fpu_init(void);
+int  fpu_sse_enabled(void);
+void fpu_switch(struct task_t *prev, struct task_t *next);
+void fpu_fork(struct task_t *child);
+void fpu_exit(struct task_t *t);
+
+#endif
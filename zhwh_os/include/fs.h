@@ -99,12 +99,14 @@ typedef struct dentry {
 //   1. file 对应于进程的文件描述符
 //   2. 多个 file 可以指向同一个 inode（多次打开同一文件）
 //   3. file 包含读写位置（f_pos），每个进程独立
+//   4. 套接字等对象的 file 没有 inode，嵌在所属对象里，由 f_op->close 回收
 typedef struct file {
     struct inode *f_inode;       // 指向的 inode
     struct file_operations *f_op;  // 操作函数表
 
     uint32_t f_flags;            // 打开标志（O_RDONLY, O_WRONLY 等）
     uint64_t f_pos;              // 当前读写位置
+    uint32_t f_count;            // 引用计数（fork 后父子进程的 fd 指向同一个 file）
 
     void *f_private;             // 私有数据（可用于扩展）
 } file_t;
@@ -191,6 +193,18 @@ int filp_read(struct file *file, char *buffer, uint32_t size);
 int filp_write(struct file *file, const char *buffer, uint32_t size);
 int filp_lseek(struct file *file, int64_t offset, int whence);
 
+// ================================
+// 文件描述符表（当前进程的 task_t.files）
+// ================================
+#define FD_FIRST 3                  // 0/1/2 是控制台，不进文件表
+
+struct task_t;
+int fd_install(struct file *file);  // 返回新 fd，表满返回 -1（不释放 file）
+struct file *fd_get(int fd);
+int fd_close(int fd);
+void files_fork(struct task_t *child, struct task_t *parent);
+void files_exit(struct task_t *task);
+
 // ================================
 // 路径解析
 // ================================
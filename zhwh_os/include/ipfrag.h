@@ -0,0 +1,64 @@
+/**
+ * @file ipfrag.h
+ * @brief IPv4 分片与重组
+ *
+ * 发送：ip_output_dst 发现整个 IP 包超过出口 MTU 时调用 ip_fragment，
+ * 按 MTU 切成 8 字节对齐的分片，每片拷一份 IP 头后交给邻居子系统。
+ *
+ * 接收：ip_input 遇到 MF 置位或片偏移非 0 的包调用 ip_defrag。
+ * 同一个数据报的分片按 (src, dst, id, proto) 哈希到一个重组队列，
+ * 队列用 RFC 815 的空洞描述符记录还缺哪些字节，分片可以乱序到达；
+ * 空洞填满后把分片按偏移串成 frag 链交回 ip_input，负载不再拷贝。
+ *
+ * 资源有界：重组队列来自固定大小的池，所有队列持有的分片按占用的
+ * netbuf 数 × NETBUF_DATA_SIZE 计入全局内存，超过 IPFRAG_MEM_MAX 时先淘汰最老的队列；
+ * 每个队列从第一个分片到达起 IPFRAG_TIMEOUT 内没有凑齐就整体丢弃。
+ * 与已收到的数据部分重叠的分片视为非法，整个数据报丢弃。
+ */
+
+#ifndef IPFRAG_H
+#define IPFRAG_H
+
+#include "net.h"
+
+// ip_off 中的标志和片偏移（主机字节序）
+#define IP_DF               0x4000      // 不分片
+#define IP_MF               0x2000      // 后面还有分片
+#define IP_OFFMASK          0x1FFF      // 片偏移，单位 8 字节
+#define IP_MAX_LEN          65535       // IP 包总长上限
+
+// ==================== 参数 ====================
+
+#define IPFRAG_QUEUES       16                      // 同时重组的数据报数
+#define IPFRAG_HASH_SIZE    16                      // 哈希桶数（2 的幂）
+#define IPFRAG_MAX_HOLES    16                      // 每个数据报最多同时缺几段
+#define IPFRAG_MEM_MAX      (64 * NETBUF_DATA_SIZE) // 所有队列持有的分片内存上限
+#define IPFRAG_TIMEOUT      15000                   // 重组超时（ms，RFC 791 建议的初值）
+
+// 统计
+typedef struct {
+    uint32_t reasm_reqds;       // 收到的分片
+    uint32_t reasm_oks;         // 重组成功的数据报
+    uint32_t reasm_fails;       // 非法分片、重叠或资源不足丢弃的数据报 / 分片
+    uint32_t reasm_timeouts;    // 超时丢弃的数据报
+    uint32_t reasm_evictions;   // 内存或队列不够时淘汰的数据报
+    uint32_t frag_oks;          // 分片发送的数据报
+    uint32_t frag_creates;      // 生成的分片
+    uint32_t frag_fails;        // 分片失败（DF、缓冲池耗尽）
+} ipfrag_stats_t;
+
+void ipfrag_init(void);
+
+/**
+ * 接收分片（nb->data 指向 IP 头，连同 frag 链已截到 IP 总长，不接管 nb）
+ * 数据报凑齐时返回重组后的 netbuf（data 指向 IP 头，负载挂在 frag 链上，
+ * 调用者持有一个引用），否则返回 NULL。
+ */
+netbuf_t *ip_defrag(netbuf_t *nb);
+
+// 把超过 MTU 的 IP 包切片后发往 next_hop（nb->data 指向 IP 头，接管 nb）
+int ip_fragment(net_device_t *dev, uint32_t next_hop, netbuf_t *nb);
+
+void ipfrag_get_stats(ipfrag_stats_t *stats);
+
+#endif // IPFRAG_H
@@ -6,6 +6,8 @@ void            lapiceoi(void);
 void            lapicinit(void);
 void            lapicstartap(uint8_t, uint32_t);
 void            microdelay(int);
+void            lapic_timer_oneshot(uint32_t count, int masked);
+uint32_t        lapic_timer_current(void);
 
 uint8_t logical_cpu_id(void);
 uint32_t cpu_id(void);
@@ -25,6 +25,8 @@ typedef struct {
 
 // 系统调用号
 #define SYS_GUI_FB_INFO  70
+#define SYS_CLOCK_MS     74
+#define SYS_GUI_WAIT     75
 #define SYS_WRITE         4
 #define SYS_EXIT          1
 
@@ -44,6 +46,30 @@ static inline int gui_get_fb_info(fb_info_t *info) {
     return ret;
 }
 
+// 单调毫秒时钟（LV_TICK_CUSTOM_SYS_TIME_EXPR 使用）
+static inline uint32_t clock_ms(void) {
+    uint32_t ret;
+    __asm__ volatile(
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_CLOCK_MS)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+// 睡眠 timeout_ms 毫秒，期间有键盘/鼠标输入则提前返回 1
+static inline int gui_wait(uint32_t timeout_ms) {
+    int ret;
+    __asm__ volatile(
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GUI_WAIT), "b"(timeout_ms)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
 // 标准库函数实现 (inline 以避免链接冲突)
 static inline void *memcpy(void *dest, const void *src, size_t n) {
     unsigned char *d = (unsigned char *)dest;
@@ -49,7 +49,7 @@
 #define LV_MEM_CUSTOM 0
 #if LV_MEM_CUSTOM == 0
     /*Size of the memory available for `lv_mem_alloc()` in bytes (>= 2kB)*/
-    #define LV_MEM_SIZE (48U * 1024U)          /*[bytes]*/
+    #define LV_MEM_SIZE (64U * 1024U)          /*[bytes]*/
 
     /*Set an address for the memory pool instead of allocating it as a normal array. Can be in external SRAM too.*/
     #define LV_MEM_ADR 0     /*0: unused*/
@@ -85,10 +85,10 @@
 
 /*Use a custom tick source that tells the elapsed time in milliseconds.
  *It removes the need to manually update the tick with `lv_tick_inc()`)*/
-#define LV_TICK_CUSTOM 0
+#define LV_TICK_CUSTOM 1
 #if LV_TICK_CUSTOM
-    #define LV_TICK_CUSTOM_INCLUDE "Arduino.h"         /*Header for the system time function*/
-    #define LV_TICK_CUSTOM_SYS_TIME_EXPR (millis())    /*Expression evaluating to current system time in ms*/
+    #define LV_TICK_CUSTOM_INCLUDE "libuser_minimal.h" /*Header for the system time function*/
+    #define LV_TICK_CUSTOM_SYS_TIME_EXPR (clock_ms())  /*SYS_CLOCK_MS: 内核 TSC 单调毫秒时钟*/
     /*If using lvgl as ESP32 component*/
     // #define LV_TICK_CUSTOM_INCLUDE "esp_timer.h"
     // #define LV_TICK_CUSTOM_SYS_TIME_EXPR ((esp_timer_get_time() / 1000LL))
@@ -144,7 +144,12 @@
  *With complex image decoders (e.g. PNG or JPG) caching can save the continuous open/decode of images.
  *However the opened images might consume additional RAM.
  *0: to disable caching*/
-#define LV_IMG_CACHE_DEF_SIZE 0
+#define LV_IMG_CACHE_DEF_SIZE 8
+
+/*Memory budget of the image cache [bytes]. If not 0 (and LV_IMG_CACHE_DEF_SIZE > 0) the decoded images
+ *are stored in a dedicated arena of this size and the least recently used images are closed when it's full.
+ *Images which could be read only line-by-line (e.g. SJPG, indexed or file images) are decoded once into the arena.*/
+#define LV_IMG_CACHE_MEM_SIZE (64U * 1024U)
 
 /*Number of stops allowed per gradient. Increase this to allow more stops.
  *This adds (sizeof(lv_color_t) + 1) bytes per additional stop*/
@@ -225,6 +230,10 @@
     #define LV_GPU_SDL_CUSTOM_BLEND_MODE (SDL_VERSION_ATLEAST(2, 0, 6))
 #endif
 
+/*Use SSE2 fill/blend/copy kernels in the software renderer (x86, LV_COLOR_DEPTH 32).
+ *Selected at runtime with CPUID, falls back to the scalar code otherwise*/
+#define LV_USE_DRAW_SW_SSE2 1
+
 /*-------------
  * Logging
  *-----------*/
@@ -419,6 +428,14 @@
 /*Enable drawing placeholders when glyph dsc is not found*/
 #define LV_USE_FONT_PLACEHOLDER 1
 
+/*Cache rendered glyphs (1 byte opacity per pixel) in the software renderer so that
+ *redrawing a text doesn't unpack, decompress or rasterize the same glyph again.
+ *The cache is allocated from the LVGL heap, see LV_MEM_SIZE*/
+#define LV_USE_GLYPH_CACHE 1
+#if LV_USE_GLYPH_CACHE
+    #define LV_GLYPH_CACHE_SIZE (8U * 1024U)   /*[bytes] of glyph data*/
+#endif
+
 /*=================
  *  TEXT SETTINGS
  *=================*/
@@ -55,5 +55,6 @@ struct mpioapic {       // I/O APIC table entry
 // mp.c
 extern int      ismp;
 void            mpinit(void);
+int             mp_cpu_apicid(int n);   // 第 n 个已启动 CPU 的 LAPIC ID，未启动返回 -1
 //PAGEBREAK!
 // Blank page.
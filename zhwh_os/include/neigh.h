@@ -0,0 +1,76 @@
+/**
+ * @file neigh.h
+ * @brief 邻居子系统（IPv4 over Ethernet 的 ARP 缓存）
+ *
+ * - (设备, IP) 哈希表，表项来自静态池，够几百台主机用
+ * - 表项状态：INCOMPLETE（解析中）→ REACHABLE（最近确认过）→ STALE（过期但仍可用）
+ * - 解析中的表项挂一个小队列存放待发的包，收到 ARP 应答时一起发出；
+ *   发送方永远不等待解析
+ * - INCOMPLETE 表项用自己的定时器重发请求，超过次数就丢弃队列并删除；
+ *   另有一个老化定时器把 REACHABLE 降为 STALE、回收长期不用或探测失败的 STALE
+ * - 使用 STALE 表项时照常发包，同时单播一个请求确认对方还在
+ */
+
+#ifndef NEIGH_H
+#define NEIGH_H
+
+#include "net.h"
+#include "timer.h"
+
+// ==================== 参数 ====================
+
+#define NEIGH_MAX               512         // 表项池大小
+#define NEIGH_HASH_SIZE         256         // 哈希桶数（2 的幂）
+#define NEIGH_QUEUE_MAX         4           // 每个 INCOMPLETE 表项最多挂起的包
+#define NEIGH_RETRANS_MS        1000        // 请求重发间隔
+#define NEIGH_MAX_PROBES        3           // 解析 / STALE 确认最多发几次请求
+#define NEIGH_REACHABLE_MS      30000       // 确认后多久降为 STALE
+#define NEIGH_GC_STALE_MS       60000       // STALE 多久没用就回收
+#define NEIGH_GC_INTERVAL_MS    5000        // 老化定时器周期
+
+// 表项状态
+#define NUD_NONE        0
+#define NUD_INCOMPLETE  1
+#define NUD_REACHABLE   2
+#define NUD_STALE       3
+#define NUD_PERMANENT   4                   // 静态表项，不老化
+
+typedef struct neighbour {
+    struct neighbour *next;         // 哈希链 / 空闲链
+    net_device_t *dev;
+    uint32_t ip;                    // 主机字节序
+    uint8_t  mac[ETH_ALEN];
+    uint8_t  state;
+    uint8_t  probes;                // 当前这一轮已发的请求数
+    uint32_t confirmed;             // 最近一次收到对方 ARP 的时间（clock_ms）
+    uint32_t used;                  // 最近一次用来发包的时间
+    uint32_t probed;                // 最近一次发请求的时间
+    netbuf_t *queue;                // INCOMPLETE 时挂起的包（IP 头已填好）
+    uint8_t  qlen;
+    ktimer_t timer;                 // INCOMPLETE 重发
+} neighbour_t;
+
+typedef struct {
+    uint32_t entries;               // 当前表项数
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t res_failed;            // 解析失败（请求全部超时）
+    uint32_t queue_drops;           // 挂起队列满或解析失败丢弃的包
+    uint32_t table_full;            // 表满且没有可回收的 STALE 表项
+} neigh_stats_t;
+
+void neigh_init(void);
+
+// 发送 IP 包：nb->data 指向 IP 头，next_hop 为主机字节序；接管 nb
+int neigh_output(net_device_t *dev, uint32_t next_hop, netbuf_t *nb);
+
+// 收到 ARP 时调用：create 为 0 时只更新已有表项
+void neigh_update(net_device_t *dev, uint32_t ip, const uint8_t *mac, int create);
+
+// 静态表项
+int neigh_add_permanent(net_device_t *dev, uint32_t ip, const uint8_t *mac);
+
+void neigh_dump(net_device_t *dev);
+void neigh_get_stats(neigh_stats_t *stats);
+
+#endif // NEIGH_H
@@ -15,6 +15,7 @@
 #define NET_H
 
 #include "types.h"
+#include "netbuf.h"
 
 // ==================== 用户态-内核态共享数据结构 ====================
 
@@ -34,6 +35,8 @@ struct user_buf {
 #define ETH_HDR_LEN 14          // 以太网头部长度
 #define ETH_MTU 1500            // 最大传输单元
 #define ETH_MAX_FRAME 1518      // 最大以太网帧
+#define ETH_MIN_MTU 68          // IPv4 要求的最小 MTU（RFC 791）
+#define ETH_JUMBO_MTU 9000      // 巨型帧 MTU（net_device_t.max_mtu 的常用值）
 
 // 以太网帧类型
 #define ETH_P_IP   0x0800       // IPv4
@@ -75,15 +78,6 @@ typedef struct {
 // 🔥 静态断言：确保 ARP 头部大小为 28 字节
 _Static_assert(sizeof(arp_hdr_t) == 28, "arp_hdr_t must be 28 bytes");
 
-// ARP缓存表项（简化版）
-#define ARP_TABLE_SIZE 8
-
-typedef struct {
-    uint32_t ip;      // 主机字节序 (host byte order)
-    uint8_t  mac[6];
-    int      valid;
-} arp_entry_t;
-
 // ==================== IP ====================
 
 #define IP_HDR_LEN 20            // IP头部长度
@@ -164,6 +158,18 @@ typedef struct {
 
 // ==================== 网卡接口 ====================
 
+// NAPI 轮询上下文：每个设备默认一个（net_device_t.napi，poll 即 dev->poll），
+// 多队列网卡给每个接收队列一个，各自挂进轮询链表、各自打开中断
+typedef struct napi {
+    struct napi *poll_next;         // 轮询链表（由 core.c 维护）
+    uint8_t scheduled;              // 已在轮询链表中 / 正在轮询
+    // 每次最多处理 budget 个包，返回实际处理数；< budget 时先 napi_complete() 再开中断
+    int (*poll)(struct napi *napi, int budget);
+    struct net_device *dev;
+} napi_t;
+
+struct net_bypass;
+
 // 网卡设备结构
 typedef struct net_device {
     char name[16];              // 设备名称
@@ -172,15 +178,51 @@ typedef struct net_device {
     uint32_t netmask;           // 子网掩码
     uint32_t gateway;           // 网关
     uint16_t mtu;               // 最大传输单元
+    uint16_t max_mtu;           // 设备支持的最大 MTU（0 = ETH_MTU，注册时补上）
     void *priv;                 // 私有数据
     void *pci_dev;              // PCI设备指针（用于获取厂商/设备信息）
 
     // 驱动操作
     int (*send)(struct net_device *dev, uint8_t *data, uint32_t len);
+    int (*xmit)(struct net_device *dev, netbuf_t *nb);  // 发送 netbuf（接管所有权），为 NULL 时退回 send
     int (*recv)(struct net_device *dev, uint8_t *data, uint32_t len);
     int (*ioctl)(struct net_device *dev, int cmd, void *arg);
+    // 修改 MTU 前调用，驱动按新 MTU 重新配置接收（例如打开长帧接收）；为 NULL 表示无需配置
+    int (*change_mtu)(struct net_device *dev, uint16_t new_mtu);
+
+    // NAPI 风格轮询：每次最多收 budget 个包，返回实际收到的包数；
+    // 返回值 < budget 时驱动应先 net_napi_complete() 再打开 RX 中断
+    int (*poll)(struct net_device *dev, int budget);
+    napi_t napi;                    // 设备默认的轮询上下文（由 core.c 维护）
+
+    uint32_t features;              // 设备能力 NETIF_F_*
+    uint32_t gso_max_size;          // NETIF_F_TSO：一次 TSO 请求最多带多少字节 TCP 负载
+    // 批量发送结束时敲门铃（批量期间 xmit 只挂描述符，见 net_tx_batch_begin）
+    void (*tx_flush)(struct net_device *dev);
+
+    // 接收过滤程序（经典 BPF，见 bpf.h / net/filter.c），驱动在分配缓冲区前执行
+    struct bpf_prog *rx_filter;
+    // 抓包方向 CAPTURE_RX / CAPTURE_TX（见 capture.h / net/capture.c）
+    uint8_t capture;
+    // 发送排队规则（见 qdisc.h / net/sched.c），net_device_register 时挂上默认 FIFO
+    struct qdisc *qdisc;
+
+    // 内核旁路（见 bypass.h / net/bypass.c）：attach 把收发环换成用户环并填好 info 里的
+    // 描述符个数和门铃位置，detach 换回驱动自己的环，两者在关中断下调用；
+    // bypass_irq 打开 / 屏蔽接收中断。不支持旁路的驱动三者都为 NULL
+    int (*bypass_attach)(struct net_device *dev, struct net_bypass *bp);
+    void (*bypass_detach)(struct net_device *dev);
+    void (*bypass_irq)(struct net_device *dev, int enable);
+    struct net_bypass *bypass;      // 非 NULL：收发环在用户进程手里，协议栈不收不发
 } net_device_t;
 
+// 设备能力位（net_device_t.features）
+#define NETIF_F_SG          0x0001  // 分散/聚集：xmit 可以直接发送带 frag 链的 netbuf
+#define NETIF_F_IP_CSUM     0x0002  // 发送：网卡插入 IPv4 头和 TCP/UDP 校验和（CSUM_PARTIAL）
+#define NETIF_F_RXCSUM      0x0004  // 接收：网卡校验 IPv4 头和 TCP/UDP 校验和
+#define NETIF_F_TSO         0x0008  // TCP 分段卸载（需要 SG 和 IP_CSUM）
+#define NETIF_F_LOOPBACK    0x0010  // 回环：ip_output 直接把三层包交给 loopback_output，不经过邻居层和驱动
+
 // ==================== 网络统计 ====================
 
 typedef struct {
@@ -209,34 +251,88 @@ void net_init(void);
 int net_device_register(net_device_t *dev);
 net_device_t *net_device_get(const char *name);
 net_device_t *net_device_get_default(void);
+net_device_t *net_output_device(uint32_t dst_ip);  // 按路由表选择出口设备（dst_ip 主机字节序）
 int net_get_device_count(void);  // 🔥 新增：获取设备数量
 net_device_t **net_get_all_devices(void);  // 🔥 新增：获取所有设备数组
+// 修改设备 MTU（ETH_MIN_MTU ~ dev->max_mtu），之后建立的 TCP 连接按新 MTU 通告 MSS
+int net_device_set_mtu(net_device_t *dev, uint32_t mtu);
+int sys_net_mtu(const char *ifname, uint32_t mtu);
 
 // 数据包接收/发送
+// 拷贝型驱动入口：把 data 拷进一个 netbuf 后交给 net_rx_netbuf
 int net_rx_packet(net_device_t *dev, uint8_t *data, uint32_t len);
 int net_tx_packet(net_device_t *dev, uint8_t *data, uint32_t len);
+// netbuf 入口：nb->data 指向以太网头，两者都接管 nb 的所有权
+int net_rx_netbuf(net_device_t *dev, netbuf_t *nb);
+int net_tx_netbuf(net_device_t *dev, netbuf_t *nb);
+// qdisc 出队后交给驱动；xmit 环满时返回 NET_XMIT_BUSY 且不接管 nb
+#define NET_XMIT_BUSY       1
+int net_dev_xmit(net_device_t *dev, netbuf_t *nb);
+// 驱动回收了发送描述符后调用（任意上下文），让 qdisc 在 NET_TX_SOFTIRQ 里继续出队
+void net_tx_wake(net_device_t *dev);
+// 批量发送：begin/end 之间的 xmit 只挂描述符，end 时每个设备只写一次门铃（可嵌套）
+void net_tx_batch_begin(void);
+void net_tx_batch_end(void);
+int net_tx_batching(void);
+// 接收积压队列：驱动在中断里 enqueue（接管 nb），协议处理在 net_rx_action 中开中断完成
+// 按 nb->rx_queue 分 NET_RX_QUEUES 个队列，编号大的先处理
+#define NET_RX_QUEUES       2
+int net_rx_enqueue(net_device_t *dev, netbuf_t *nb);
+// 三层包入口（回环快速路径）：nb->data 指向 protocol 对应的头部，软中断里直接交给 ip_input，
+// 不抓包也不解析以太网头
+int net_rx_enqueue_l3(net_device_t *dev, netbuf_t *nb, uint16_t protocol);
+// NAPI 风格轮询：中断里屏蔽 RX 中断并 schedule，poll 收空后 complete 再打开中断
+void net_napi_schedule(net_device_t *dev);
+void net_napi_complete(net_device_t *dev);
+// 多队列驱动直接调度自己的轮询上下文（poll/dev 由驱动填好）
+void napi_schedule(napi_t *napi);
+void napi_complete(napi_t *napi);
+int net_rx_action(void);
+
+// 接收过滤（net/filter.c）：驱动拿到原始帧、还没分配新缓冲区时调用，
+// 返回 NET_RX_FILTER_DROP 丢弃，否则是积压队列号（没挂程序时恒为 0）
+#define NET_RX_FILTER_DROP  (-1)
+int net_rx_filter_run(net_device_t *dev, const uint8_t *data, uint32_t len);
+
+static inline int net_rx_filter(net_device_t *dev, const uint8_t *data, uint32_t len) {
+    return dev->rx_filter ? net_rx_filter_run(dev, data, len) : 0;
+}
+
+struct sock_filter;
+int net_filter_attach(net_device_t *dev, const struct sock_filter *insns, uint32_t len);
+void net_filter_detach(net_device_t *dev);
+
+// SYS_NET_FILTER 的 cmd（与用户态 libuser.h 中的定义一致）
+#define NET_FILTER_ATTACH   1
+#define NET_FILTER_DETACH   2
+#define NET_FILTER_SHOW     3
+int sys_net_filter(int cmd, const char *ifname, const void *insns, uint32_t len);
 
 // 协议处理
-int eth_input(net_device_t *dev, uint8_t *data, uint32_t len);
-int arp_input(net_device_t *dev, uint8_t *data, uint32_t len);
-int ip_input(net_device_t *dev, uint8_t *data, uint32_t len);
+// 输入函数：nb->data 指向本层头部，不接管 nb（由 net_rx_netbuf 释放）
+// 输出函数：nb->data 指向本层负载，接管 nb（成功或失败都会释放）
+int eth_input(net_device_t *dev, netbuf_t *nb);
+int eth_output(net_device_t *dev, const uint8_t *dst_mac, uint16_t eth_type,
+               netbuf_t *nb);
+int arp_input(net_device_t *dev, netbuf_t *nb);
+int ip_input(net_device_t *dev, netbuf_t *nb);
 int ip_output(net_device_t *dev, uint32_t dst_ip, uint8_t protocol,
-              uint8_t *data, uint32_t len);
-int icmp_input(net_device_t *dev, uint8_t *data, uint32_t len);
+              netbuf_t *nb);   // 查路由表发送；dev 非 NULL 时限定出口（ip_output_dst 见 route.h）
+int icmp_input(net_device_t *dev, netbuf_t *nb);
 int icmp_send_echo(net_device_t *dev, uint32_t dst_ip, uint16_t id, uint16_t seq);
-int udp_input(net_device_t *dev, uint8_t *data, uint32_t len);
+int udp_input(net_device_t *dev, netbuf_t *nb);
 int udp_output(net_device_t *dev, uint32_t dst_ip, uint16_t src_port,
                uint16_t dst_port, uint8_t *data, uint32_t len);
-int tcp_input(net_device_t *dev, uint8_t *data, uint32_t len);
-int tcp_output(net_device_t *dev, uint32_t dst_ip, uint16_t src_port,
-               uint16_t dst_port, uint32_t seq, uint32_t ack,
-               uint8_t flags, uint8_t *data, uint32_t len);
+int udp_output_netbuf(net_device_t *dev, uint32_t dst_ip, uint16_t src_port,
+                      uint16_t dst_port, netbuf_t *nb);
+int tcp_input(net_device_t *dev, netbuf_t *nb);   // 连接管理和收发见 tcp.h
+// 回环设备（NETIF_F_LOOPBACK）的 IP 出口：nb->data 指向 IP 头，接管 nb，推迟到 NET_RX_SOFTIRQ 递交
+int loopback_output(net_device_t *dev, netbuf_t *nb);
 
 // ARP
 int arp_request(net_device_t *dev, uint32_t ip_addr);
-void arp_handle(net_device_t *dev, uint8_t *data, uint32_t len);
-uint8_t *arp_cache_lookup(uint32_t ip);
 void arp_send_request(net_device_t *dev, uint32_t target_ip);
+void arp_solicit(net_device_t *dev, uint32_t target_ip, const uint8_t *dst_mac);  // dst_mac 为 NULL 时广播
 
 // 🔥 通用网络设备轮询接收和诊断
 void net_poll_rx(net_device_t *dev);
@@ -244,6 +340,7 @@ void net_dump_rx_regs(net_device_t *dev);
 
 // 工具函数
 uint16_t internet_checksum(uint16_t *data, uint32_t len);
+uint32_t csum_netbuf(const netbuf_t *nb, uint32_t sum);   // 累加整个分片链，返回部分和
 void print_mac(uint8_t *mac);
 void print_ip(uint32_t ip);
 
@@ -0,0 +1,179 @@
+/**
+ * @file netbuf.h
+ * @brief 网络数据包缓冲区（类似 Linux sk_buff）
+ *
+ * 一个 netbuf 描述一块定长数据区：
+ *
+ *   head        data             tail          end
+ *    |-headroom-|==== 有效数据 ====|--tailroom--|
+ *
+ * - 发送：上层先 netbuf_alloc() 预留 headroom，写入负载后，每一层用
+ *   netbuf_push() 在前面补自己的头部，整个过程不再重新分配和拷贝
+ * - 接收：驱动把整帧放进 netbuf，每一层用 netbuf_pull() 剥掉自己的头部
+ * - 引用计数：netbuf_get() / netbuf_free()，计数归零才回到缓冲池
+ *
+ * 数据区来自 DMA coherent 区域，netbuf_dma() 给出 data 的物理地址，
+ * 网卡驱动可以直接把它填进描述符。
+ *
+ * 发送方向可以把负载放在另一个 netbuf 里挂到 frag 链上（头部和负载分开，
+ * 负载不用为头部腾位置也不用拷贝），frag 链属于头 netbuf，随它一起释放。
+ * 不支持分散/聚集的设备由 net_tx_netbuf 先调用 netbuf_linearize() 合并。
+ * 接收方向超过一个数据区的帧（巨型帧、IP 重组）同样以 frag 链交给协议栈。
+ */
+
+#ifndef NETBUF_H
+#define NETBUF_H
+
+#include "types.h"
+
+struct net_device;
+
+#define NETBUF_DATA_SIZE   2048   // 每个数据区大小（与网卡 RX 缓冲区一致）
+#define NETBUF_HEADROOM    128    // 发送方向默认预留的头部空间（以太网+IP+TCP+选项）
+#define NETBUF_POOL_SIZE   256    // 缓冲池中 netbuf 数量
+
+typedef struct netbuf {
+    struct netbuf *next;        // 队列 / 空闲链表
+    uint8_t *head;              // 数据区起始
+    uint8_t *data;              // 有效数据起始
+    uint8_t *tail;              // 有效数据结束
+    uint8_t *end;               // 数据区结束
+    uint32_t len;               // 有效数据长度（tail - data）
+    uint32_t dma;               // head 对应的物理地址
+    struct net_device *dev;     // 收/发设备
+    uint16_t protocol;          // 以太网类型（主机字节序）
+    uint16_t refcnt;            // 引用计数
+    uint8_t *mac_hdr;           // 以太网头（接收时由 eth_input 设置）
+    uint8_t *net_hdr;           // IP/ARP 头
+    uint8_t *trans_hdr;         // ICMP/UDP/TCP 头
+    struct netbuf *frag;        // 分片链：后续负载（发送时由支持 SG 的网卡直接挂描述符）
+    uint8_t ip_summed;          // 校验和状态 NETBUF_CSUM_*
+    uint8_t csum_offset;        // CSUM_PARTIAL：校验和字段相对传输层头部的偏移
+    uint16_t gso_size;          // 非 0：交给网卡按这个 MSS 切分（TSO）
+    uint8_t rx_queue;           // 接收积压队列号（BPF 过滤器返回 BPF_RET_QUEUE(n) 时设置）
+    uint8_t tos;                // 发送：IP 头的 TOS（套接字 IP_TOS），qdisc 按它分类
+} netbuf_t;
+
+// netbuf_t.ip_summed
+#define NETBUF_CSUM_NONE         0  // 软件已算好 / 未校验
+#define NETBUF_CSUM_PARTIAL      1  // 发送：校验和字段里是伪头部和，由网卡补全 L4 和 IP 头校验和
+#define NETBUF_CSUM_UNNECESSARY  2  // 接收：网卡已校验 IP 头和 L4 校验和
+
+// 缓冲池统计
+typedef struct {
+    uint32_t total;             // 池中 netbuf 总数
+    uint32_t free;              // 当前空闲数
+    uint32_t alloc_count;       // 累计分配次数
+    uint32_t fail_count;        // 分配失败次数（池耗尽）
+} netbuf_stats_t;
+
+// 缓冲池初始化（net_init 调用）
+int netbuf_pool_init(void);
+
+// 分配一个 netbuf，data 前预留 headroom 字节，len = 0
+netbuf_t *netbuf_alloc(uint32_t headroom);
+
+// 分配 netbuf 并拷入一段数据（预留 headroom），用于拷贝型驱动和用户数据入口
+netbuf_t *netbuf_from(const void *src, uint32_t len, uint32_t headroom);
+// 同上，放不下的数据挂在 frag 链上（要在 IP 层分片的大数据报）
+netbuf_t *netbuf_from_chain(const void *src, uint32_t len, uint32_t headroom);
+
+// 增加 / 减少引用计数，计数归零时回收到缓冲池
+netbuf_t *netbuf_get(netbuf_t *nb);
+void netbuf_free(netbuf_t *nb);
+
+void netbuf_get_stats(netbuf_stats_t *stats);
+
+// 把 frag 链追加到 nb 的分片链尾部（接管 frag）
+void netbuf_frag_append(netbuf_t *nb, netbuf_t *frag);
+
+// 把分片链拷回头 netbuf 的尾部并释放分片；tailroom 不足返回 -1
+int netbuf_linearize(netbuf_t *nb);
+
+// 把整条分片链截断为 len 字节（netbuf_trim 只截头 netbuf）
+void netbuf_trim_total(netbuf_t *nb, uint32_t len);
+
+// ==================== 头部操作 ====================
+
+static inline uint32_t netbuf_headroom(const netbuf_t *nb) {
+    return (uint32_t)(nb->data - nb->head);
+}
+
+static inline uint32_t netbuf_tailroom(const netbuf_t *nb) {
+    return (uint32_t)(nb->end - nb->tail);
+}
+
+/**
+ * @brief 在空缓冲区前部预留 len 字节（只能在写入数据前调用）
+ */
+static inline void netbuf_reserve(netbuf_t *nb, uint32_t len) {
+    nb->data += len;
+    nb->tail += len;
+}
+
+/**
+ * @brief 在数据前面扩展 len 字节（添加头部），返回新的 data；headroom 不足返回 NULL
+ */
+static inline uint8_t *netbuf_push(netbuf_t *nb, uint32_t len) {
+    if (netbuf_headroom(nb) < len) {
+        return NULL;
+    }
+    nb->data -= len;
+    nb->len += len;
+    return nb->data;
+}
+
+/**
+ * @brief 从数据前面剥掉 len 字节（去掉头部），返回新的 data；数据不足返回 NULL
+ */
+static inline uint8_t *netbuf_pull(netbuf_t *nb, uint32_t len) {
+    if (nb->len < len) {
+        return NULL;
+    }
+    nb->data += len;
+    nb->len -= len;
+    return nb->data;
+}
+
+/**
+ * @brief 在数据尾部追加 len 字节，返回追加区域的起始；tailroom 不足返回 NULL
+ */
+static inline uint8_t *netbuf_put(netbuf_t *nb, uint32_t len) {
+    uint8_t *p = nb->tail;
+    if (netbuf_tailroom(nb) < len) {
+        return NULL;
+    }
+    nb->tail += len;
+    nb->len += len;
+    return p;
+}
+
+/**
+ * @brief 把有效数据截断为 len 字节（例如去掉以太网最小帧填充）
+ */
+static inline void netbuf_trim(netbuf_t *nb, uint32_t len) {
+    if (nb->len > len) {
+        nb->len = len;
+        nb->tail = nb->data + len;
+    }
+}
+
+/**
+ * @brief 整个分片链的数据总长度
+ */
+static inline uint32_t netbuf_total_len(const netbuf_t *nb) {
+    uint32_t len = 0;
+    for (; nb; nb = nb->frag) {
+        len += nb->len;
+    }
+    return len;
+}
+
+/**
+ * @brief data 对应的物理地址（供 DMA 描述符使用）
+ */
+static inline uint32_t netbuf_dma(const netbuf_t *nb) {
+    return nb->dma + (uint32_t)(nb->data - nb->head);
+}
+
+#endif // NETBUF_H
@@ -24,4 +24,18 @@ int pci_enable_msi(unsigned bus, unsigned dev, unsigned func, uint8_t vector);
  */
 void pci_disable_msi(unsigned bus, unsigned dev, unsigned func);
 
+/**
+ * @brief 启用 PCI 设备的 MSI-X 中断，表项 i 投递到 vectors[i]
+ *
+ * @return 成功返回 0，失败返回 -1（没有 MSI-X 或表项不够）
+ */
+int pci_enable_msix(unsigned bus, unsigned dev, unsigned func,
+                    const uint8_t *vectors, int nvec);
+
+/**
+ * @brief 同上，表项 i 投递到 LAPIC ID 为 apic_ids[i] 的 CPU（多队列网卡把队列分到不同 CPU）
+ */
+int pci_enable_msix_affinity(unsigned bus, unsigned dev, unsigned func,
+                             const uint8_t *vectors, const uint8_t *apic_ids, int nvec);
+
 #endif // PCI_MSI_H
@@ -0,0 +1,99 @@
+/**
+ * @file qdisc.h
+ * @brief 发送排队规则（traffic control）
+ *
+ * 每个设备一个 qdisc，net_tx_netbuf 不再直接调用驱动，而是先入队再由 qdisc_run 出队：
+ *
+ * - FIFO：单队列，有界积压（默认）
+ * - PRIO：3 个优先级队列，按 IP TOS 分类，出队时总是先发编号小的队列；
+ *   ARP 和带低延迟 / 高优先级标记的流量进 0 号队列，标了吞吐量 / CS1 的批量流量进 2 号队列
+ * - TBF：令牌桶整形，叠加在上面两种之上；rate 为 0 表示不限速
+ *
+ * 驱动环满时 xmit 返回 NET_XMIT_BUSY 且不释放 netbuf，包留在队头，
+ * 驱动回收发送描述符后调用 net_tx_wake() 置 NET_TX_SOFTIRQ 继续出队；
+ * 令牌不够时挂一个内核定时器，到时间再出队。突发先进队列吸收，队列满才丢弃，
+ * UDP 套接字在队列满时阻塞或返回 SOCK_ERR_AGAIN（qdisc_writable）。
+ */
+
+#ifndef QDISC_H
+#define QDISC_H
+
+#include "net.h"
+#include "timer.h"
+
+// ==================== 参数 ====================
+
+#define QDISC_MAX           16          // 设备数上限（与 net_devices 一致）
+#define QDISC_BANDS         3           // PRIO 队列数
+#define QDISC_DEFAULT_LIMIT 128         // 每个队列默认最多排队的包数
+#define QDISC_MAX_LIMIT     NETBUF_POOL_SIZE
+
+// qdisc 种类
+#define QDISC_FIFO          0
+#define QDISC_PRIO          1
+
+// 没有 IP 头时默认进的队列
+#define QDISC_BAND_CONTROL  0
+#define QDISC_BAND_DEFAULT  1
+#define QDISC_BAND_BULK     2
+
+// IP TOS 位
+#define IPTOS_LOWDELAY      0x10
+#define IPTOS_THROUGHPUT    0x08
+#define IPTOS_PREC(tos)     ((tos) >> 5)    // 优先级（DSCP 类选择器）
+
+typedef struct qdisc_band {
+    netbuf_t *head;
+    netbuf_t *tail;
+    uint32_t qlen;              // 当前排队的包数
+    uint32_t backlog;           // 当前排队的字节数
+    uint32_t packets;           // 出队交给驱动的包数
+    uint32_t bytes;
+    uint32_t drops;             // 队列满丢弃
+    uint32_t requeues;          // 驱动忙退回队头
+} qdisc_band_t;
+
+typedef struct qdisc {
+    net_device_t *dev;
+    uint8_t  kind;              // QDISC_FIFO / QDISC_PRIO
+    uint8_t  nbands;
+    uint8_t  scheduled;         // 已挂在 NET_TX_SOFTIRQ 的待运行链表上
+    uint8_t  running;           // qdisc_run 正在出队（防止重入）
+    uint8_t  rerun;             // 出队期间有人要求再跑一轮
+    uint32_t limit;             // 每个队列的包数上限
+    qdisc_band_t bands[QDISC_BANDS];
+    struct qdisc *next_sched;
+
+    // 令牌桶（字节）
+    uint32_t rate;              // 字节/秒，0 不限速
+    uint32_t burst;             // 桶深
+    int32_t  tokens;            // 可以透支一个包，之后等补回正数
+    uint32_t t_last;            // 上次补令牌的时间（clock_ms）
+    uint32_t t_frac;            // 补令牌时不足 1 字节的部分（千分之一字节）
+    uint32_t overlimits;        // 因令牌不够推迟出队的次数
+    ktimer_t watchdog;          // 令牌不够时的唤醒定时器
+} qdisc_t;
+
+// SYS_NET_QDISC 使用的配置（与用户态 libuser.h 中的定义一致）
+typedef struct {
+    char     ifname[16];
+    uint32_t kind;              // QDISC_FIFO / QDISC_PRIO
+    uint32_t limit;             // 每队列包数，0 取默认
+    uint32_t rate;              // 字节/秒，0 不限速
+    uint32_t burst;             // 字节，0 取 rate / 10（至少一个最大帧）
+} qdisc_conf_t;
+
+#define QDISC_CMD_SET       1
+#define QDISC_CMD_SHOW      2
+
+void qdisc_init(void);
+// net_device_register 调用：给设备挂默认 FIFO
+int qdisc_attach(net_device_t *dev);
+// 入队并尝试出队（接管 nb）；队列满返回 -1
+int qdisc_enqueue(net_device_t *dev, netbuf_t *nb);
+void qdisc_run(qdisc_t *q);
+// 按 nb 的 IP TOS 能否再入队（UDP 发送前检查，用于阻塞 / EAGAIN）
+int qdisc_writable(net_device_t *dev, uint8_t tos);
+int sys_net_qdisc(int cmd, const qdisc_conf_t *conf);
+
+#endif // QDISC_H
@@ -0,0 +1,103 @@
+/**
+ * @file route.h
+ * @brief IPv4 路由表（最长前缀匹配）
+ *
+ * - 每个前缀长度一张哈希表，外加一个"哪些长度有路由"的位图；
+ *   查找从 /32 往 /0 逐个长度查一次哈希，代价 O(前缀长度)
+ * - 每条路由带出口设备、网关和度量值；同一前缀多条路由时取度量值最小的
+ * - 设备配置地址时自动生成直连路由（和网关对应的默认路由），标记为 RTF_KERNEL，
+ *   重新配置地址时整体替换；用户添加的路由不受影响
+ * - 路由表每次变化 route_genid 加一；套接字把查找结果缓存在 dst_cache_t 里，
+ *   代数不变就不必重新查表
+ */
+
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include "net.h"
+
+// ==================== 参数 ====================
+
+#define ROUTE_MAX           64          // 路由表项池大小
+#define ROUTE_HASH_SIZE     16          // 每个前缀长度的哈希桶数（2 的幂）
+
+// 路由标志
+#define RTF_UP              0x0001
+#define RTF_GATEWAY         0x0002      // 下一跳是网关（否则直连）
+#define RTF_HOST            0x0004      // /32 主机路由
+#define RTF_KERNEL          0x0100      // 由接口地址自动生成
+
+typedef struct route {
+    struct route *next;         // 哈希链 / 空闲链
+    uint32_t dst;               // 目的网络（主机字节序，已按前缀长度清零主机位）
+    uint8_t  prefix_len;
+    uint16_t flags;
+    uint16_t metric;
+    uint32_t gateway;           // RTF_GATEWAY 时有效
+    net_device_t *dev;
+    uint32_t use;               // 命中次数
+} route_t;
+
+// 路由查找结果；也用作套接字里的路由缓存（genid 与 route_genid 相同才有效）
+typedef struct {
+    uint32_t genid;
+    uint32_t dst;               // 缓存对应的目的地址
+    net_device_t *dev;          // 出口设备
+    uint32_t next_hop;          // 直连时就是 dst
+} dst_cache_t;
+
+// 系统调用使用的路由描述（与用户态 libuser.h 中的定义一致）
+typedef struct {
+    uint32_t dst;               // 主机字节序
+    uint32_t prefix_len;
+    uint32_t gateway;           // 0 表示直连
+    uint32_t metric;
+    char     ifname[16];        // 空串表示按网关所在网段自动选择设备
+} route_entry_t;
+
+#define ROUTE_CMD_ADD       1
+#define ROUTE_CMD_DEL       2
+#define ROUTE_CMD_SHOW      3
+
+#define ROUTE_ERR_INVAL     (-22)
+#define ROUTE_ERR_NOENT     (-2)
+#define ROUTE_ERR_EXIST     (-17)
+#define ROUTE_ERR_NOMEM     (-12)
+#define ROUTE_ERR_NODEV     (-19)
+#define ROUTE_ERR_NETUNREACH (-101)
+
+extern uint32_t route_genid;
+
+void route_init(void);
+
+int route_add(uint32_t dst, uint8_t prefix_len, uint32_t gateway,
+              net_device_t *dev, uint16_t metric, uint16_t flags);
+int route_del(uint32_t dst, uint8_t prefix_len, uint32_t gateway, net_device_t *dev);
+void route_flush_dev(net_device_t *dev, uint16_t flags);   // 删除设备上带 flags 的路由
+
+// 最长前缀匹配；oif 非 NULL 时只考虑经过该设备的路由
+int route_lookup(uint32_t dst, net_device_t *oif, dst_cache_t *res);
+
+// 先查缓存，代数或目的地址变了才重新查表
+static inline int route_output(dst_cache_t *cache, uint32_t dst, net_device_t *oif) {
+    if (cache->genid == route_genid && cache->dev && cache->dst == dst) {
+        return 0;
+    }
+    return route_lookup(dst, oif, cache);
+}
+
+// 按已查好的路由发送（core.c；nb->data 指向本层负载，接管 nb）
+int ip_output_dst(const dst_cache_t *rt, uint32_t dst_ip, uint8_t protocol, netbuf_t *nb);
+int udp_output_dst(const dst_cache_t *rt, uint32_t dst_ip, uint16_t src_port,
+                   uint16_t dst_port, netbuf_t *nb);
+
+// 接口地址配置：更新设备地址并重建它的直连路由和默认路由
+int net_device_set_addr(net_device_t *dev, uint32_t ip, uint32_t netmask, uint32_t gateway);
+
+void route_dump(void);
+
+// 系统调用实现（entry 直接指向用户内存）
+int sys_route(int cmd, route_entry_t *entry);
+int sys_ifconfig_set(const char *ifname, uint32_t ip, uint32_t netmask, uint32_t gateway);
+
+#endif // ROUTE_H
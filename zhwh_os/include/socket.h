@@ -0,0 +1,113 @@
+/**
+ * @file socket.h
+ * @brief BSD 风格套接字层（AF_INET：UDP 数据报、TCP 流）
+ *
+ * - 套接字是进程文件表里的 fd：read/write/close 对套接字同样有效
+ * - UDP：按本地端口哈希分发，每个套接字一条有界接收队列（超出即丢弃），
+ *   connect 之后可以直接 send/recv，请求/响应服务不必每次传地址
+ * - TCP：包装 tcp.h 的非阻塞接口，阻塞等待在这里完成
+ * - 默认阻塞；SOCK_NONBLOCK 创建的套接字或带 MSG_DONTWAIT 的调用
+ *   在不能立即完成时返回 SOCK_ERR_AGAIN
+ *
+ * 地址结构与 BSD 一致：sin_port / sin_addr 都是网络字节序。
+ * 错误返回负的 errno 数值，和 tcp.h 的 TCP_ERR_* 是同一套。
+ */
+
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include "net.h"
+#include "tcp.h"
+#include "fs.h"
+
+// ==================== 参数 ====================
+
+#define SOCK_MAX            64          // 套接字池大小
+#define SOCK_UDP_HASH_SIZE  32          // UDP 端口哈希表桶数（2 的幂）
+#define SOCK_UDP_RCVQ_MAX   32          // 每个 UDP 套接字最多排队的数据报
+// 排队的数据报直接占着接收用的 netbuf（零拷贝，重组 / 巨型帧还带 frag 链），
+// 按占用的 netbuf 个数记账：单个套接字和全部 UDP 套接字各有上限，
+// 读得慢的套接字不会把网卡补缓冲区用的池子占光
+#define SOCK_UDP_RCVBUF     16                      // 每个套接字接收队列最多占用的 netbuf
+#define SOCK_UDP_RCVBUF_ALL (NETBUF_POOL_SIZE / 4)  // 所有 UDP 接收队列合计
+#define SOCK_UDP_EPHEMERAL  49152       // 自动分配端口的起点
+
+// ==================== 常量（取 BSD / Linux 的数值） ====================
+
+#define AF_INET             2
+#define SOCK_STREAM         1
+#define SOCK_DGRAM          2
+#define SOCK_NONBLOCK       04000       // 与 type 按位或
+#define MSG_DONTWAIT        0x40
+#define INADDR_ANY          0
+#define IPPROTO_IP          0           // setsockopt level
+#define IP_TOS              1           // 选项值为 int，低 8 位写进 IP 头的 TOS
+
+#define SOCK_ERR_BADF           (-9)
+#define SOCK_ERR_AGAIN          TCP_ERR_AGAIN
+#define SOCK_ERR_NOMEM          TCP_ERR_NOMEM
+#define SOCK_ERR_INVAL          TCP_ERR_INVAL
+#define SOCK_ERR_MFILE          (-24)
+#define SOCK_ERR_NOTSOCK        (-88)
+#define SOCK_ERR_DESTADDRREQ    (-89)
+#define SOCK_ERR_MSGSIZE        (-90)
+#define SOCK_ERR_PROTONOSUPPORT (-93)
+#define SOCK_ERR_OPNOTSUPP      (-95)
+#define SOCK_ERR_AFNOSUPPORT    (-97)
+#define SOCK_ERR_ADDRINUSE      TCP_ERR_ADDRINUSE
+#define SOCK_ERR_NETUNREACH     (-101)
+#define SOCK_ERR_ISCONN         (-106)
+#define SOCK_ERR_NOTCONN        TCP_ERR_NOTCONN
+#define SOCK_ERR_INPROGRESS     (-115)      // 非阻塞 connect 已发出 SYN
+
+struct sockaddr_in {
+    uint16_t sin_family;                // AF_INET
+    uint16_t sin_port;                  // 网络字节序
+    uint32_t sin_addr;                  // 网络字节序
+    uint8_t  sin_zero[8];
+};
+
+typedef struct socket {
+    file_t   file;                      // 进程文件表里的 fd 指向这里（f_private 指回套接字）
+    uint8_t  in_use;
+    uint8_t  type;                      // SOCK_STREAM / SOCK_DGRAM
+    uint8_t  nonblock;
+    uint8_t  connected;                 // UDP：connect 过，remote_* 有效
+    uint8_t  tos;                       // IP_TOS（UDP；TCP 在 tp->tos）
+
+    // 地址（主机字节序）
+    uint32_t local_ip;
+    uint32_t remote_ip;
+    uint16_t local_port;
+    uint16_t remote_port;
+
+    // UDP：端口哈希链和接收队列（netbuf 的 data 指向负载，net_hdr/trans_hdr 保留来源地址）
+    struct socket *hnext;
+    netbuf_t *rq_head;
+    netbuf_t *rq_tail;
+    uint32_t rq_len;
+    uint32_t rq_bufs;                   // 队列占用的 netbuf（含 frag 链）
+    uint32_t rq_drops;                  // 队列满 / 超出 netbuf 配额丢弃的数据报
+    dst_cache_t dst;                    // 上一次发送的路由（UDP；TCP 在 tp->dst）
+
+    // TCP
+    tcp_sock_t *tp;
+} socket_t;
+
+// 系统调用实现（fd 属于当前进程；addr 直接指向用户内存）
+int sys_socket(int domain, int type, int protocol);
+int sys_bind(int fd, const struct sockaddr_in *addr);
+int sys_connect(int fd, const struct sockaddr_in *addr);
+int sys_listen(int fd, int backlog);
+int sys_accept(int fd, struct sockaddr_in *addr);
+int sys_sendto(int fd, const void *buf, uint32_t len, int flags,
+               const struct sockaddr_in *addr);
+int sys_recvfrom(int fd, void *buf, uint32_t len, int flags,
+                 struct sockaddr_in *addr);
+int sys_setsockopt(int fd, int level, int optname, const void *optval, uint32_t optlen);
+
+// UDP 分发（udp_input 调用，不接管 nb；没有套接字时返回 -1）
+int sock_udp_deliver(netbuf_t *nb, uint32_t src_ip, uint16_t sport,
+                     uint32_t dst_ip, uint16_t dport);
+
+#endif // SOCKET_H
@@ -0,0 +1,53 @@
+/**
+ * @file softirq.h
+ * @brief 软中断（下半部）
+ *
+ * 硬中断处理程序只做应答设备、摘下描述符这类必须马上做的事，
+ * 然后 raise_softirq() 置一个挂起位；真正的协议处理 / 传输完成处理
+ * 在中断返回前（irq_exit）开中断执行，期间时钟、键盘等硬中断可以照常进来。
+ *
+ * - 挂起位图按 CPU 分开，哪个 CPU 上的中断置的位就由哪个 CPU 处理
+ * - 一次 do_softirq 最多重跑 SOFTIRQ_MAX_RESTART 轮、最多 SOFTIRQ_MAX_MS 毫秒，
+ *   超出预算的留给 ksoftirqd：空闲循环里接着跑，另有一个 1ms 定时器保证
+ *   CPU 一直被用户任务占着时也能继续处理
+ * - 被打断的上下文关着中断（临界区里发生异常）时不跑软中断
+ */
+
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include "types.h"
+
+// 软中断号，数值小的先执行
+enum {
+    TIMER_SOFTIRQ,      // 内核定时器（timer_run）
+    NET_RX_SOFTIRQ,     // 网卡轮询和接收积压队列（net_rx_action）
+    NET_TX_SOFTIRQ,     // 发送排队规则出队（net/sched.c）
+    USB_SOFTIRQ,        // UHCI 传输完成
+    WIFI_SOFTIRQ,       // 无线网卡接收
+    NR_SOFTIRQS
+};
+
+#define SOFTIRQ_MAX_RESTART 10      // 处理期间又被置位时最多重跑几轮
+#define SOFTIRQ_MAX_MS      2       // 单次 do_softirq 最长执行时间
+
+typedef void (*softirq_action_t)(void);
+
+void softirq_init(void);
+void open_softirq(int nr, softirq_action_t action);
+
+// 置挂起位（任意上下文可调用）；不在中断里时由 ksoftirqd 处理
+void raise_softirq(int nr);
+
+// 硬中断进出（do_irq_handler 调用）；eflags 是被打断上下文的 EFLAGS
+void irq_enter(void);
+void irq_exit(uint32_t eflags);
+int in_interrupt(void);
+
+void do_softirq(void);
+// 进程上下文（系统调用返回前、回环发送后）马上处理挂起位；eflags 是要回到的上下文的
+void softirq_run_pending(uint32_t eflags);
+// ksoftirqd：空闲循环里调用，处理超出预算或从进程上下文置位的软中断
+void ksoftirqd_run(void);
+
+#endif // SOFTIRQ_H
@@ -55,8 +55,12 @@ typedef uint32_t gid_t;
 typedef uint8_t cpu_id_t;
 
 struct task_t;
+struct file;
 typedef void (*task_idle_timer_t)(void);
 
+// 每个进程的文件描述符表大小（fd 0/1/2 保留给控制台，见 fs.h）
+#define TASK_NOFILE 16
+
 /**
  * @brief Represents an idle timer callback.
  */
@@ -103,7 +107,7 @@ typedef struct task_t {
         // ⚠️ intr_depth 字段已删除（Linux 不使用 per-task 中断深度）
 	pid_t			pid;        /**< Unique taskess ID */
 	pid_t			ppid;       /**< Parent taskess ID */
-	uid_t			uid;        /**< User ID (future use) */
+	uid_t			uid;        /**< User ID：0 是特权用户，fork 继承，见 sys_setuid */
 	gid_t			gid;        /**< Group ID (future use) */
 	int		state;      /**< Running state */
 
@@ -147,6 +151,12 @@ typedef struct task_t {
         // 这是预分配的内存区域，不是在栈上临时构建的
         // 布局：[eip][cs][eflags][esp][ss]
         uint32_t iret_frame[5];
+
+        // FXSAVE 区的 kmalloc 原始地址（使用时按 16 字节对齐，见 fpu.c）；新字段只能往后加，汇编里按偏移访问前面的字段
+        void *fpu_state;
+
+        // 打开的文件（下标即 fd；fork 时共享，靠 file->f_count 计数）
+        struct file *files[TASK_NOFILE];
 } task_t;
 
 
@@ -190,3 +200,8 @@ void task_to_user_mode_with_task_wrapper(struct task_t *task);  // C包装函数
 void ok_here();
 void do_exit(int code);
 
+// 权限：内核启动的任务是 uid 0，fork 继承；setuid 降到普通用户后回不来
+int task_privileged(void);
+int sys_getuid(void);
+int sys_setuid(uint32_t uid);
+
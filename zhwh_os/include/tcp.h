@@ -0,0 +1,190 @@
+/**
+ * @file tcp.h
+ * @brief TCP 协议（RFC 793 / 6298 / 5681 / 6582）
+ *
+ * - 连接表按四元组哈希查找，监听套接字单独一张表
+ * - 完整的 RFC 793 状态机（含同时打开/同时关闭、TIME_WAIT）
+ * - 发送/接收环形缓冲区和滑动窗口，乱序段直接写进接收缓冲区的对应位置
+ * - RFC 6298 RTT 估计（Karn 算法），指数退避的重传定时器
+ * - 延迟 ACK（每两个满段立即确认）、零窗口探测
+ * - NewReno 拥塞控制：慢启动、拥塞避免、快速重传/快速恢复（部分 ACK）
+ *
+ * 这里的接口都是非阻塞的：没有数据/空间时返回 TCP_ERR_AGAIN，
+ * 状态变化（可读、可写、连接建立、有新连接、出错）时调用 notify 回调，
+ * 由上层（套接字层）负责睡眠和唤醒。
+ */
+
+#ifndef TCP_H
+#define TCP_H
+
+#include "net.h"
+#include "timer.h"
+#include "route.h"
+
+// ==================== 参数 ====================
+
+#define TCP_MAX_SOCKS       64          // TCB 池大小
+#define TCP_HASH_SIZE       64          // 连接哈希表桶数（2 的幂）
+#define TCP_SNDBUF_SIZE     32768       // 发送缓冲区（2 的幂）
+#define TCP_RCVBUF_SIZE     32768       // 接收缓冲区（2 的幂，不超过 65535：不做窗口扩大）
+#define TCP_OOO_MAX         4           // 最多记录的乱序区间数
+#define TCP_DEFAULT_MSS     536         // 对端没带 MSS 选项时（RFC 879）
+
+#define TCP_RTO_INIT        1000        // 初始 RTO（ms）
+#define TCP_RTO_MIN         200         // RTO 下限（ms）
+#define TCP_RTO_MAX         60000       // RTO 上限（ms）
+#define TCP_DELACK_MS       40          // 延迟 ACK（ms）
+#define TCP_MSL_MS          15000       // 报文最大生存时间，TIME_WAIT 持续 2MSL
+#define TCP_FIN_WAIT2_MS    30000       // 已关闭的连接在 FIN_WAIT2 最多等这么久
+#define TCP_SYN_RETRIES     5
+#define TCP_MAX_RETRIES     10          // 数据段最多重传次数，超过就放弃连接
+
+// ==================== 状态 ====================
+
+#define TCP_CLOSED          0
+#define TCP_LISTEN          1
+#define TCP_SYN_SENT        2
+#define TCP_SYN_RCVD        3
+#define TCP_ESTABLISHED     4
+#define TCP_FIN_WAIT1       5
+#define TCP_FIN_WAIT2       6
+#define TCP_CLOSE_WAIT      7
+#define TCP_CLOSING         8
+#define TCP_LAST_ACK        9
+#define TCP_TIME_WAIT       10
+
+// ==================== 错误码（取 errno 的数值，返回时取负） ====================
+
+#define TCP_ERR_PIPE        (-32)       // 已关闭发送方向
+#define TCP_ERR_AGAIN       (-11)       // 暂时无数据 / 无空间 / 无连接可 accept
+#define TCP_ERR_NOMEM       (-12)
+#define TCP_ERR_INVAL       (-22)
+#define TCP_ERR_ADDRINUSE   (-98)
+#define TCP_ERR_CONNRESET   (-104)
+#define TCP_ERR_NOTCONN     (-107)
+#define TCP_ERR_TIMEDOUT    (-110)
+#define TCP_ERR_CONNREFUSED (-111)
+#define TCP_ERR_NETUNREACH  (-101)      // 没有到对端的路由
+
+// 套接字标志 tcp_sock_t.flags
+#define TCP_F_NODELAY       0x01        // 关闭 Nagle
+#define TCP_F_USER_CLOSED   0x02        // 用户已 close，连接结束后自动回收
+#define TCP_F_ACK_NOW       0x04        // 立即发送 ACK
+#define TCP_F_FIN_QUEUED    0x08        // 发送缓冲区发完后发 FIN
+#define TCP_F_FIN_SENT      0x10        // FIN 已发出（占用序号 snd_max - 1）
+#define TCP_F_RCV_FIN       0x20        // 已收到对端 FIN（按序）
+#define TCP_F_IN_RECOVERY   0x40        // NewReno 快速恢复中
+
+typedef struct tcp_sock {
+    uint8_t  state;
+    uint8_t  flags;
+    uint8_t  in_use;
+    uint8_t  retries;               // 当前这一轮连续超时次数
+    uint8_t  tos;                   // IP 头的 TOS（setsockopt IP_TOS，accept 出来的连接继承监听套接字）
+    int      error;                 // 连接出错原因（TCP_ERR_*），由 tcp_recv/tcp_send 返回
+
+    // 四元组（主机字节序）
+    uint32_t local_ip;
+    uint32_t remote_ip;
+    uint16_t local_port;
+    uint16_t remote_port;
+    net_device_t *dev;              // 连接绑定的出口设备（源地址属于它）
+    dst_cache_t dst;                // 路由缓存：路由表不变就不重新查
+    struct tcp_sock *hnext;         // 哈希桶链
+
+    // 被动打开
+    struct tcp_sock *parent;        // 所属的监听套接字
+    struct tcp_sock *accept_next;   // 监听套接字上的完成队列
+    struct tcp_sock *accept_head;
+    uint16_t backlog;               // 监听套接字：半连接 + 完成队列上限
+    uint16_t pending;               // 监听套接字：当前半连接 + 完成队列个数
+
+    // 发送序号空间
+    uint32_t iss;
+    uint32_t snd_una;               // 最早未确认
+    uint32_t snd_nxt;               // 下一个要发送（超时后会回退到 snd_una）
+    uint32_t snd_max;               // 已发送过的最大序号
+    uint32_t snd_wnd;               // 对端通告窗口
+    uint32_t snd_wl1, snd_wl2;      // 上次更新窗口时的 seq/ack
+    uint16_t mss;                   // 有效 MSS（双方较小值）
+
+    // 接收序号空间
+    uint32_t irs;
+    uint32_t rcv_nxt;
+    uint32_t rcv_adv;               // 已通告给对端的窗口右沿
+    uint32_t rcv_fin_seq;           // 乱序到达的 FIN 的序号（rcv_fin_ooo 有效时）
+    uint8_t  rcv_fin_ooo;
+    uint8_t  ooo_count;
+    uint32_t ooo_start[TCP_OOO_MAX];// 乱序区间 [start, end)，已写进接收缓冲区
+    uint32_t ooo_end[TCP_OOO_MAX];
+    uint32_t unacked_bytes;         // 收到但还没确认的字节数（延迟 ACK）
+
+    // 缓冲区（环形，按需分配，TCB 回收后保留复用）
+    uint8_t *sndbuf;
+    uint32_t snd_head;              // snd_una 对应的下标
+    uint32_t snd_len;               // 缓冲区里的字节数（从 snd_una 开始，含未发送）
+    uint8_t *rcvbuf;
+    uint32_t rcv_head;              // 应用下一次读取的下标
+    uint32_t rcv_len;               // 按序可读的字节数
+
+    // RTT 估计（RFC 6298，单位 ms，srtt 放大 8 倍，rttvar 放大 4 倍）
+    uint32_t srtt8;
+    uint32_t rttvar4;
+    uint32_t rto;
+    uint32_t rtt_seq;               // 正在计时的段
+    uint32_t rtt_start;
+    uint8_t  rtt_active;
+
+    // 拥塞控制（NewReno）
+    uint32_t cwnd;
+    uint32_t ssthresh;
+    uint32_t bytes_acked;           // 拥塞避免阶段累计确认字节
+    uint32_t recover;               // 进入快速恢复时的 snd_max
+    uint8_t  dupacks;
+
+    ktimer_t rtx_timer;             // 重传 / 持续（零窗口探测）/ TIME_WAIT / FIN_WAIT2
+    ktimer_t delack_timer;
+
+    // 上层通知（套接字层在这里唤醒等待的进程）
+    void (*notify)(struct tcp_sock *tp);
+    void *owner;
+} tcp_sock_t;
+
+// 统计
+typedef struct {
+    uint32_t active_opens;
+    uint32_t passive_opens;
+    uint32_t attempt_fails;
+    uint32_t estab_resets;
+    uint32_t in_segs;
+    uint32_t out_segs;
+    uint32_t retrans_segs;
+    uint32_t fast_retrans;
+    uint32_t timeouts;
+    uint32_t in_errs;
+    uint32_t out_rsts;
+    uint32_t ooo_segs;
+    uint32_t delayed_acks;
+} tcp_stats_t;
+
+// 连接管理
+tcp_sock_t *tcp_socket(void);
+int tcp_bind(tcp_sock_t *tp, uint32_t ip, uint16_t port);
+int tcp_listen(tcp_sock_t *tp, int backlog);
+tcp_sock_t *tcp_accept(tcp_sock_t *tp, int *err);
+int tcp_connect(tcp_sock_t *tp, uint32_t ip, uint16_t port);
+int tcp_close(tcp_sock_t *tp);
+void tcp_abort(tcp_sock_t *tp);
+
+// 数据收发：返回字节数；0 表示对端已关闭（仅 tcp_recv）；负数为 TCP_ERR_*
+int tcp_send(tcp_sock_t *tp, const void *data, uint32_t len);
+int tcp_recv(tcp_sock_t *tp, void *buf, uint32_t len);
+
+// 状态查询（给 poll/阻塞等待用）
+uint32_t tcp_readable(const tcp_sock_t *tp);
+uint32_t tcp_writable(const tcp_sock_t *tp);
+
+void tcp_get_stats(tcp_stats_t *stats);
+const char *tcp_state_name(int state);
+
+#endif // TCP_H
@@ -2,3 +2,11 @@
 typedef uint32_t time_t;
 
 int time();
+
+// clock.c - 单调毫秒时钟（TSC 计时，PIT 通道 2 校准，LAPIC 单次定时器唤醒）
+void     clock_init(void);
+uint32_t clock_ms(void);
+void     clock_timestamp(uint32_t *sec, uint32_t *usec);
+int      clock_sleep_until(uint32_t deadline_ms, int (*wake_pending)(void));
+int      clock_wait_event(uint32_t deadline_ms, int (*cond)(void *arg), void *arg);
+void     clock_set_alarm(uint32_t deadline_ms, int enable);
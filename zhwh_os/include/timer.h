@@ -0,0 +1,38 @@
+/**
+ * @file timer.h
+ * @brief 内核定时器（毫秒精度，单次触发）
+ *
+ * 到期时间是 clock_ms() 的绝对值。所有待触发的定时器按到期时间排成
+ * 有序链表，链表头的到期时间通过 clock_set_alarm() 交给 LAPIC 单次
+ * 定时器；IRQ_TIMER 到来时 timer_run() 依次调用已到期的回调。
+ *
+ * 回调在时钟中断返回前、开中断的状态下执行，可以再次 timer_mod()
+ * 自己（周期定时器）或者发包，但不能睡眠。
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+
+typedef struct ktimer {
+    uint32_t expires;                   // 到期时间（clock_ms）
+    void (*func)(struct ktimer *t);     // 到期回调
+    void *data;                         // 回调私有数据
+    struct ktimer *next;                // 待触发链表（按 expires 排序）
+    uint8_t pending;                    // 是否在待触发链表中
+} ktimer_t;
+
+void timer_setup(ktimer_t *t, void (*func)(ktimer_t *t), void *data);
+// 设置到期时间（已挂上的定时器会被移到新位置）
+void timer_mod(ktimer_t *t, uint32_t expires);
+// 取消，返回取消前是否处于待触发状态
+int timer_del(ktimer_t *t);
+// 时钟中断里调用：执行所有已到期的定时器
+void timer_run(void);
+
+static inline int timer_pending(const ktimer_t *t) {
+    return t->pending;
+}
+
+#endif // TIMER_H
@@ -0,0 +1,34 @@
+/**
+ * @file usermap.h
+ * @brief 只对一个任务可见的用户态映射
+ *
+ * 所有任务共用内核页目录，map_page 建立的用户页对每个进程都可见。
+ * 抓包环、旁路网卡这类映射登记在这里，调度器切换任务时只给属主打开
+ * PTE_U：属主之外的任务访问这些地址会缺页，内核自己走另外的映射不受影响。
+ *
+ * 这依赖同一时间只有一个 CPU 在跑用户任务（AP 目前不启动）；
+ * 要上多核得先有每进程的页目录。
+ */
+
+#ifndef USERMAP_H
+#define USERMAP_H
+
+#include "types.h"
+
+struct task_t;
+
+typedef struct usermap {
+    uint32_t va;                    // 页对齐
+    uint32_t pages;
+    uint32_t owner;                 // 属主 pid（不存指针：任务结构会被重用）
+    struct usermap *next;
+} usermap_t;
+
+// 登记已用 map_page 建好（不带 PTE_U）的一段映射；属主是当前任务时立即打开 PTE_U
+void usermap_add(usermap_t *m, uint32_t va, uint32_t pages, uint32_t owner);
+// 撤销登记（PTE 本身由调用者清掉）
+void usermap_del(usermap_t *m);
+// 调度器在关中断、切换到 next 之前调用
+void usermap_switch(struct task_t *prev, struct task_t *next);
+
+#endif // USERMAP_H
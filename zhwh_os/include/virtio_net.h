@@ -0,0 +1,178 @@
+/**
+ * @file virtio_net.h
+ * @brief virtio-net 网卡驱动（传统 virtio-pci 接口，QEMU -device virtio-net-pci）
+ *
+ * - 寄存器在 BAR0 的 I/O 端口空间；每个队列是一个 split virtqueue：
+ *   描述符表 + avail 环（驱动写）+ used 环（设备写），用 QUEUE_PFN 告诉设备物理页号
+ * - 队列 0 收、队列 1 发；发送时每个包占一条描述符链：virtio 头 + 每个 netbuf 段一个
+ * - 协商 MRG_RXBUF：每个接收缓冲区是一个单独的 netbuf，设备在头里写明一个包用了几个；
+ *   没协商时收发都用 10 字节的旧头，一个包只占一个缓冲区
+ * - 协商 CSUM / GUEST_CSUM：发送方向由设备补 L4 校验和，接收方向设备校验过的包
+ *   直接标成 CSUM_UNNECESSARY
+ * - 协商 EVENT_IDX：驱动只在设备要求的位置之后才写通知寄存器（批量发送时一批只敲一次），
+ *   设备也只在驱动要求的位置之后才发中断
+ */
+
+#ifndef VIRTIO_NET_H
+#define VIRTIO_NET_H
+
+#include "net.h"
+
+#define VIRTIO_VENDOR_ID            0x1AF4
+#define VIRTIO_NET_DEVICE_ID        0x1000  // 传统 / 过渡设备
+
+// ==================== 传统 virtio-pci 寄存器（BAR0 I/O 端口偏移）====================
+
+#define VIRTIO_PCI_HOST_FEATURES    0x00    // 32 位，设备支持的特性
+#define VIRTIO_PCI_GUEST_FEATURES   0x04    // 32 位，驱动接受的特性
+#define VIRTIO_PCI_QUEUE_PFN        0x08    // 32 位，队列物理页号
+#define VIRTIO_PCI_QUEUE_NUM        0x0C    // 16 位，队列大小（只读）
+#define VIRTIO_PCI_QUEUE_SEL        0x0E    // 16 位
+#define VIRTIO_PCI_QUEUE_NOTIFY     0x10    // 16 位，写队列号通知设备
+#define VIRTIO_PCI_STATUS           0x12    // 8 位
+#define VIRTIO_PCI_ISR              0x13    // 8 位，读清零
+#define VIRTIO_MSI_CONFIG_VECTOR    0x14    // 16 位，仅 MSI-X 打开时存在
+#define VIRTIO_MSI_QUEUE_VECTOR     0x16    // 16 位，仅 MSI-X 打开时存在
+#define VIRTIO_MSI_NO_VECTOR        0xFFFF
+
+// 设备配置空间起始：MSI-X 打开时后移 4 字节
+#define VIRTIO_PCI_CONFIG(msix)     ((msix) ? 0x18 : 0x14)
+
+// 设备状态
+#define VIRTIO_STATUS_ACKNOWLEDGE   0x01
+#define VIRTIO_STATUS_DRIVER        0x02
+#define VIRTIO_STATUS_DRIVER_OK     0x04
+#define VIRTIO_STATUS_FEATURES_OK   0x08
+#define VIRTIO_STATUS_FAILED        0x80
+
+// 特性位
+#define VIRTIO_NET_F_CSUM           (1u << 0)   // 设备能补发送包的校验和
+#define VIRTIO_NET_F_GUEST_CSUM     (1u << 1)   // 驱动接受部分校验和 / 设备报告已校验
+#define VIRTIO_NET_F_MAC            (1u << 5)   // 配置空间里有 MAC
+#define VIRTIO_NET_F_MRG_RXBUF      (1u << 15)  // 接收时可以合并多个缓冲区
+#define VIRTIO_NET_F_STATUS         (1u << 16)  // 配置空间里有链路状态
+#define VIRTIO_RING_F_EVENT_IDX     (1u << 29)  // used_event / avail_event
+
+#define VIRTIO_NET_S_LINK_UP        1
+
+// ==================== split virtqueue ====================
+// 环结构的字段都按自然边界对齐，不需要 packed
+
+#define VRING_DESC_F_NEXT           1
+#define VRING_DESC_F_WRITE          2       // 设备写（接收缓冲区）
+#define VRING_AVAIL_F_NO_INTERRUPT  1
+#define VRING_USED_F_NO_NOTIFY      1
+
+#define VIRTIO_PCI_VRING_ALIGN      4096    // 传统接口 used 环按页对齐
+#define VIRTIO_QUEUE_MAX            1024    // 设备报告的队列大小上限（传统接口不能改）
+
+typedef struct {
+    uint32_t addr;                  // 物理地址（64 位字段；这里的 uint64_t 只有 32 位，拆成两半）
+    uint32_t addr_hi;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} vring_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];                // 之后是 used_event
+} vring_avail_t;
+
+typedef struct {
+    uint32_t id;                    // 描述符链头
+    uint32_t len;                   // 设备写入的字节数
+} vring_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];       // 之后是 avail_event
+} vring_used_t;
+
+/**
+ * @brief 设备是否需要通知：event 落在 (old, new] 区间里（16 位回绕）
+ */
+static inline int vring_need_event(uint16_t event, uint16_t new_idx, uint16_t old) {
+    return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old);
+}
+
+typedef struct {
+    uint16_t index;                 // 队列号
+    uint16_t num;                   // 队列大小
+    volatile vring_desc_t  *desc;
+    volatile vring_avail_t *avail;
+    volatile vring_used_t  *used;
+    volatile uint16_t *used_event;  // avail->ring[num]：驱动要求的中断位置
+    volatile uint16_t *avail_event; // used->ring[num]：设备要求的通知位置
+
+    uint16_t free_head;             // 空闲描述符链
+    uint16_t num_free;
+    uint16_t avail_idx;             // 下一个要写的 avail 位置（avail->idx 的影子）
+    uint16_t kicked_idx;            // 上次通知时的 avail_idx
+    uint16_t last_used_idx;         // 下一个要处理的 used 位置
+    uint16_t pending;               // 已挂好还没通知的包数
+    netbuf_t *bufs[VIRTIO_QUEUE_MAX];   // 按描述符链头记录的 netbuf
+} virtqueue_t;
+
+// ==================== virtio-net ====================
+
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM 1       // 校验和从 csum_start 算起，写到 csum_start + csum_offset
+#define VIRTIO_NET_HDR_F_DATA_VALID 2       // 设备已校验
+#define VIRTIO_NET_HDR_GSO_NONE     0
+
+// 协商了 MRG_RXBUF 时收发两个方向都用这个头，没协商时头里没有 num_buffers
+// （VIRTIO_NET_HDR_LEGACY_LEN 字节），实际长度见 virtio_net_priv_t.hdr_len
+typedef struct {
+    uint8_t  flags;
+    uint8_t  gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+    uint16_t num_buffers;           // 接收：本包用了几个缓冲区
+} __attribute__((packed)) virtio_net_hdr_t;
+
+#define VIRTIO_NET_HDR_LEGACY_LEN   10
+
+#define VIRTIO_NET_RXQ              0
+#define VIRTIO_NET_TXQ              1
+#define VIRTIO_NET_MSIX_VECTOR      0x25    // 两个队列共用一个 MSI-X 向量
+#define VIRTIO_NET_POLL_MS          2       // 没有 MSI-X 时的轮询周期
+#define VIRTIO_NET_TX_BATCH         32      // 批量发送中攒够这么多包也通知一次
+#define VIRTIO_NET_RX_BUFS          64      // 最多挂这么多接收缓冲区（netbuf 池是所有网卡共用的）
+
+#define VIRTIO_NET_FEATURES (VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM | VIRTIO_NET_F_MAC | \
+                             VIRTIO_NET_F_MRG_RXBUF | VIRTIO_NET_F_STATUS | VIRTIO_RING_F_EVENT_IDX)
+
+typedef struct {
+    uint16_t io_base;               // BAR0 I/O 端口基址
+    uint8_t  irq;
+    uint8_t  msix;                  // 是否用 MSI-X
+    uint32_t features;              // 协商结果
+    uint32_t hdr_len;               // 收发 virtio 头的实际长度（取决于 MRG_RXBUF）
+    uint8_t  mac_addr[ETH_ALEN];
+    virtqueue_t rxq;
+    virtqueue_t txq;
+    virtio_net_hdr_t *tx_hdrs;      // 每个发送描述符链头一个 virtio 头
+    uint32_t tx_hdrs_dma;
+
+    // 统计
+    uint32_t intr_count;
+    uint32_t rx_packets;
+    uint32_t rx_merged;             // 跨多个缓冲区的包
+    uint32_t rx_dropped;
+    uint32_t rx_filtered;           // 被接收过滤程序丢弃
+    uint32_t rx_csum_sw;            // NEEDS_CSUM，软件补的校验和
+    uint32_t tx_packets;
+    uint32_t tx_busy;               // 描述符不够丢弃的包
+    uint32_t tx_kicks;              // 实际写通知寄存器的次数
+    uint32_t tx_kicks_suppressed;   // 被 avail_event 省掉的通知
+} virtio_net_priv_t;
+
+int virtio_net_init(const char *dev_name);
+void virtio_net_isr(void);
+void virtio_net_dump(void);
+
+#endif // VIRTIO_NET_H
@@ -11,6 +11,7 @@
 #include "task.h"
 #include "lapic.h"
 #include "syscall.h"
+#include "softirq.h"
 
 extern void alltraps(void);
 extern task_t* current_task[8];
@@ -401,10 +402,18 @@ void do_irq_handler(struct trapframe *tf) {
         // printf("[syscall] eip=0x%x, esp=0x%x, cs=0x%x, ds/es/fs/gs=0x%x/0x%x/0x%x/0x%x\n",
         //        tf->eip, tf->esp, tf->cs, tf->ds, tf->es, tf->fs, tf->gs);
         syscall_dispatch(tf);
+        // 系统调用里置的软中断（回环发送等）返回用户态前处理，不等 1ms 定时器
+        softirq_run_pending(tf->eflags);
         return;
      }
 
     // 2. 根据中断号处理不同类型的中断
+    // 硬中断只做必须马上做的事，其余 raise_softirq() 留到 irq_exit 开中断处理。
+    // 异常和 sys_block 可能切走任务不再返回，不计入硬中断嵌套
+    int hardirq = tf->trapno >= T_IRQ0 && tf->trapno != T_IRQ0 + IRQ_SYS_BLOCK;
+    if (hardirq) {
+        irq_enter();
+    }
     switch (tf->trapno) {
         case 0:  // 除法错误
             // ⚠️ 移除所有printf调试,避免printf中的除法导致二次异常
@@ -463,6 +472,10 @@ void do_irq_handler(struct trapframe *tf) {
             // 时钟中断只设置 need_resched 标志
             // 实际调度由 interrupt_exit 在返回用户态前执行
             send_eoi(0);  // 发送EOI
+            // clock.c 使用 LAPIC 单次定时器投递同一向量，还需 LAPIC EOI
+            lapiceoi();
+            // 内核定时器（TCP 重传等）借同一个 LAPIC 单次定时器到期
+            raise_softirq(TIMER_SOFTIRQ);
             break;
        case T_IRQ0 + IRQ_SYS_BLOCK:
 
@@ -511,6 +524,29 @@ void do_irq_handler(struct trapframe *tf) {
             extern void e1000_isr(void);
             e1000_isr();
             lapiceoi();
+            // 轮询网卡和处理接收帧在 NET_RX_SOFTIRQ 里做
+            break;
+        }
+
+        // virtio-net MSI-X（VIRTIO_NET_MSIX_VECTOR）
+        case 37:
+        {
+            extern void virtio_net_isr(void);
+            virtio_net_isr();
+            lapiceoi();
+            break;
+        }
+
+        // e1000e (82574) MSI-X：RX0, RX1, TX0, TX1, 其他（E1000E_VECTOR_BASE 起）
+        case 0x60:
+        case 0x61:
+        case 0x62:
+        case 0x63:
+        case 0x64:
+        {
+            extern void e1000e_msix_isr(int entry);
+            e1000e_msix_isr(tf->trapno - 0x60);
+            lapiceoi();
             break;
         }
 
@@ -571,7 +607,10 @@ void do_irq_handler(struct trapframe *tf) {
             }
             break;
     }
-    
+
+    if (hardirq) {
+        irq_exit(tf->eflags);
+    }
 }
 
 
@@ -16,6 +16,7 @@
 #include "kmalloc.h"
 //#include "task.h"
 #include "sched.h"
+#include "fpu.h"
 #include "x86/io.h"
 #include "net/wifi/atheros.h"
 
@@ -166,6 +167,12 @@ kernel_main(uint32_t mb_magic, uint32_t mb_info_addr)
         // 必须初始化 LAPIC，因为 logical_cpu_id() 依赖它
         lapicinit();
 
+        // 校准 TSC/LAPIC 定时器，提供单调毫秒时钟（LVGL tick、GUI 睡眠）
+        extern void clock_init(void);
+        clock_init();
+        extern void softirq_init(void);
+        softirq_init();
+
         // 🔥 初始化 IOAPIC（必须在键盘初始化之前！）
         extern void ioapicinit(void);
         ioapicinit();
@@ -187,13 +194,8 @@ kernel_main(uint32_t mb_magic, uint32_t mb_info_addr)
         printf("segment idt init is ok\n");
 
         // 🔥🔥 在开中断前再次确保 FPU 已初始化（防止 Trap 19）
-        __asm__ volatile("fninit");
-        __asm__ volatile("fnclex");
-        uint32_t cr0_check;
-        __asm__ volatile("movl %%cr0, %0" : "=r"(cr0_check));
-        cr0_check &= ~(1 << 3);  // 清除 TS
-        cr0_check &= ~(1 << 2);  // 清除 EM
-        __asm__ volatile("movl %0, %%cr0" : : "r"(cr0_check));
+        // fpu_init: 清除 TS/EM，fninit，并在支持时打开 CR4.OSFXSR 供用户态 SSE 使用
+        fpu_init();
 
         // 🔥 调试：打印当前栈指针
         uint32_t current_esp;
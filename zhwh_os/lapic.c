@@ -179,6 +179,27 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+// 单次模式启动 LAPIC 定时器：count 个总线周期后触发 T_IRQ0+IRQ_TIMER。
+// masked=1 时只计数不产生中断（clock.c 校准时使用），count=0 停止定时器。
+void
+lapic_timer_oneshot(uint32_t count, int masked)
+{
+  if(!lapic)
+    return;
+  lapicw(TDCR, X1);
+  lapicw(TIMER, (masked ? MASKED : 0) | (T_IRQ0 + IRQ_TIMER));
+  lapicw(TICR, count);
+}
+
+// 读取 LAPIC 定时器当前计数值（向下计数）
+uint32_t
+lapic_timer_current(void)
+{
+  if(!lapic)
+    return 0;
+  return lapic[TCCR];
+}
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
@@ -0,0 +1,25 @@
+/**
+ * @file libuser_minimal.h
+ * @brief 主机基准测试用的 libuser_minimal.h 替身
+ *
+ * lv_conf.h 中 LV_TICK_CUSTOM_INCLUDE 指向 "libuser_minimal.h"，
+ * 目标系统上它通过 int $0x80 读取内核时钟；主机构建时本目录在
+ * 头文件搜索路径最前面，改用 clock_gettime 提供同名 clock_ms()。
+ */
+
+#ifndef LIBUSER_MINIMAL_H
+#define LIBUSER_MINIMAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint32_t clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+
+#endif /* LIBUSER_MINIMAL_H */
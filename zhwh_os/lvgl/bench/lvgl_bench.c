@@ -0,0 +1,352 @@
+/**
+ * @file lvgl_bench.c
+ * @brief LVGL 软件渲染器主机基准测试
+ *
+ * 在 Linux 主机上链接与 lvglanet.elf 相同的 lvgl/source 和 lv_conf.h，
+ * 使用内存中的显示驱动渲染一组标准场景，输出每个场景的帧时间和
+ * 像素吞吐量，用于在不启动 QEMU 的情况下评估 lv_draw_sw_* 的优化效果。
+ *
+ * 用法：./lvgl_bench [-n 帧数] [场景名...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <lvgl.h>
+#include "draw/sw/lv_draw_sw_glyph_cache.h"
+
+// 与 lvgl_port.c 保持一致：1024x768，100 行绘制缓冲区
+#define BENCH_HOR_RES   1024
+#define BENCH_VER_RES   768
+#define BENCH_BUF_LINES 100
+#define BENCH_WARMUP    3
+
+static uint32_t *framebuffer;
+static uint64_t flushed_px;     // 当前统计窗口内 flush 的像素数
+
+/**
+ * @brief 内存显示驱动：和目标系统一样把绘制缓冲区拷贝到帧缓冲区
+ */
+static void bench_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    int32_t w = lv_area_get_width(area);
+    uint32_t *src = (uint32_t *)color_p;
+
+    for (int32_t y = area->y1; y <= area->y2; y++) {
+        memcpy(&framebuffer[y * BENCH_HOR_RES + area->x1], src, w * sizeof(uint32_t));
+        src += w;
+    }
+    flushed_px += (uint64_t)w * lv_area_get_height(area);
+    lv_disp_flush_ready(drv);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* 场景                                                                    */
+/* ---------------------------------------------------------------------- */
+
+static void scene_rects(lv_obj_t *scr) {
+    for (int i = 0; i < 24; i++) {
+        lv_obj_t *o = lv_obj_create(scr);
+        lv_obj_set_size(o, 180, 120);
+        lv_obj_set_pos(o, 20 + (i % 5) * 200, 20 + (i / 5) * 150);
+        lv_obj_set_style_radius(o, 16, 0);
+        lv_obj_set_style_bg_color(o, lv_palette_main(i % 19), 0);
+        lv_obj_set_style_border_width(o, 3, 0);
+        lv_obj_set_style_border_color(o, lv_color_black(), 0);
+        lv_obj_set_style_shadow_width(o, 24, 0);
+        lv_obj_set_style_shadow_ofs_y(o, 6, 0);
+        lv_obj_set_style_shadow_opa(o, LV_OPA_50, 0);
+    }
+}
+
+static void scene_gradients(lv_obj_t *scr) {
+    lv_obj_set_style_bg_color(scr, lv_color_hex(0x102040), 0);
+    lv_obj_set_style_bg_grad_color(scr, lv_color_hex(0x80c0ff), 0);
+    lv_obj_set_style_bg_grad_dir(scr, LV_GRAD_DIR_VER, 0);
+
+    for (int i = 0; i < 12; i++) {
+        lv_obj_t *o = lv_obj_create(scr);
+        lv_obj_set_size(o, 300, 160);
+        lv_obj_set_pos(o, 20 + (i % 3) * 330, 20 + (i / 3) * 185);
+        lv_obj_set_style_radius(o, 8, 0);
+        lv_obj_set_style_bg_color(o, lv_palette_main(i % 19), 0);
+        lv_obj_set_style_bg_grad_color(o, lv_palette_lighten(i % 19, 4), 0);
+        lv_obj_set_style_bg_grad_dir(o, (i & 1) ? LV_GRAD_DIR_HOR : LV_GRAD_DIR_VER, 0);
+        lv_obj_set_style_bg_opa(o, (i & 2) ? LV_OPA_70 : LV_OPA_COVER, 0);
+    }
+}
+
+static lv_img_dsc_t bench_img;
+
+static void bench_img_init(void) {
+    const int w = 96, h = 96;
+    uint8_t *px = malloc(w * h * LV_IMG_PX_SIZE_ALPHA_BYTE);
+
+    // ARGB8888：径向亮度 + 对角线透明度，覆盖不透明、半透明和全透明像素
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint8_t *p = &px[(y * w + x) * LV_IMG_PX_SIZE_ALPHA_BYTE];
+            int dx = x - w / 2, dy = y - h / 2;
+            int d = dx * dx + dy * dy;
+            p[0] = (uint8_t)(x * 255 / w);              // B
+            p[1] = (uint8_t)(y * 255 / h);              // G
+            p[2] = (uint8_t)(255 - (d * 255) / (w * w / 2)); // R
+            p[3] = d > (w * w / 4) ? 0 : (uint8_t)(128 + ((x + y) & 127)); // A
+        }
+    }
+
+    bench_img.header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    bench_img.header.always_zero = 0;
+    bench_img.header.w = w;
+    bench_img.header.h = h;
+    bench_img.data_size = w * h * LV_IMG_PX_SIZE_ALPHA_BYTE;
+    bench_img.data = px;
+}
+
+static void scene_images(lv_obj_t *scr) {
+    for (int i = 0; i < 40; i++) {
+        lv_obj_t *img = lv_img_create(scr);
+        lv_img_set_src(img, &bench_img);
+        lv_obj_set_pos(img, 10 + (i % 8) * 125, 10 + (i / 8) * 150);
+        // 每 4 个中有一个做缩放 + 旋转，走 lv_draw_sw_transform
+        if (i % 4 == 3) {
+            lv_img_set_zoom(img, 320);
+            lv_img_set_angle(img, 150);
+        }
+    }
+}
+
+// 4 位调色板图标：只能逐行解码（查调色板），由图像缓存一次性解码到 arena
+#define BENCH_ICON_NUM  6
+#define BENCH_ICON_SIZE 48
+static lv_img_dsc_t bench_icons[BENCH_ICON_NUM];
+
+static void bench_icons_init(void) {
+    const int w = BENCH_ICON_SIZE, h = BENCH_ICON_SIZE;
+    const int stride = (w + 1) / 2;
+
+    for (int n = 0; n < BENCH_ICON_NUM; n++) {
+        uint32_t size = 16 * sizeof(lv_color32_t) + stride * h;
+        uint8_t *data = calloc(1, size);
+        lv_color32_t *palette = (lv_color32_t *)data;
+        uint8_t *px = data + 16 * sizeof(lv_color32_t);
+
+        // 索引 0 透明，其余为不同亮度的同一色相
+        for (int c = 1; c < 16; c++) {
+            lv_color_t col = lv_palette_lighten(n * 2 % 19, c / 4);
+            palette[c].full = lv_color_to32(col);
+            palette[c].ch.alpha = 255;
+        }
+        palette[0].full = 0;
+
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                int dx = x - w / 2, dy = y - h / 2;
+                int d = dx * dx + dy * dy;
+                int idx = d > (w * w / 4) ? 0 : 1 + ((x / 6 + y / 6 + n) % 15);
+                px[y * stride + x / 2] |= (x & 1) ? idx : idx << 4;
+            }
+        }
+
+        bench_icons[n].header.cf = LV_IMG_CF_INDEXED_4BIT;
+        bench_icons[n].header.always_zero = 0;
+        bench_icons[n].header.w = w;
+        bench_icons[n].header.h = h;
+        bench_icons[n].data_size = size;
+        bench_icons[n].data = data;
+    }
+}
+
+static void scene_icons(lv_obj_t *scr) {
+    for (int i = 0; i < 96; i++) {
+        lv_obj_t *img = lv_img_create(scr);
+        lv_img_set_src(img, &bench_icons[i % BENCH_ICON_NUM]);
+        lv_obj_set_pos(img, 16 + (i % 16) * 63, 16 + (i / 16) * 120);
+    }
+}
+
+static const char bench_text[] =
+    "The quick brown fox jumps over the lazy dog. 0123456789 "
+    "PACK MY BOX WITH FIVE DOZEN LIQUOR JUGS! ping 10.0.2.2 "
+    "64 bytes from 10.0.2.2: icmp_seq=1 ttl=64 time=0.42 ms ";
+
+static void scene_labels(lv_obj_t *scr) {
+    for (int i = 0; i < 4; i++) {
+        lv_obj_t *label = lv_label_create(scr);
+        lv_label_set_long_mode(label, LV_LABEL_LONG_WRAP);
+        lv_obj_set_width(label, 490);
+        lv_obj_set_pos(label, 10 + (i % 2) * 510, 10 + (i / 2) * 380);
+        lv_obj_set_style_text_color(label, lv_palette_main(i * 4), 0);
+        lv_obj_set_style_text_line_space(label, 2, 0);
+        // 约 20 行终端式文字
+        lv_label_set_text_fmt(label, "%s%s%s%s%s%s%s%s", bench_text, bench_text, bench_text,
+                              bench_text, bench_text, bench_text, bench_text, bench_text);
+    }
+}
+
+static void scene_arcs(lv_obj_t *scr) {
+    for (int i = 0; i < 15; i++) {
+        lv_obj_t *arc = lv_arc_create(scr);
+        lv_obj_set_size(arc, 180, 180);
+        lv_obj_set_pos(arc, 20 + (i % 5) * 200, 20 + (i / 5) * 240);
+        lv_arc_set_bg_angles(arc, 0, 360);
+        lv_arc_set_angles(arc, 30 * i, 30 * i + 240);
+        lv_obj_set_style_arc_width(arc, 14, LV_PART_MAIN);
+        lv_obj_set_style_arc_width(arc, 14, LV_PART_INDICATOR);
+        lv_obj_set_style_arc_rounded(arc, 1, LV_PART_INDICATOR);
+        lv_obj_set_style_arc_color(arc, lv_palette_main(i % 19), LV_PART_INDICATOR);
+    }
+}
+
+static lv_obj_t *list_cont;
+
+static void scene_list(lv_obj_t *scr) {
+    list_cont = lv_obj_create(scr);
+    lv_obj_set_size(list_cont, 600, 700);
+    lv_obj_center(list_cont);
+    lv_obj_set_style_pad_all(list_cont, 6, 0);
+
+    // 没有编译 flex 布局（LV_USE_EXTRA=0），手动排列行
+    for (int i = 0; i < 60; i++) {
+        lv_obj_t *btn = lv_btn_create(list_cont);
+        lv_obj_set_size(btn, 560, 44);
+        lv_obj_set_pos(btn, 0, i * 52);
+        lv_obj_set_style_radius(btn, 6, 0);
+        lv_obj_t *label = lv_label_create(btn);
+        lv_label_set_text_fmt(label, "Item %d  -  eth0 rx=%d tx=%d", i, i * 1500, i * 64);
+        lv_obj_center(label);
+    }
+}
+
+// 滚动列表每帧滚动一段距离，其他场景每帧整屏失效重绘
+static void frame_list(lv_obj_t *scr, int frame) {
+    (void)scr;
+    lv_coord_t dy = (frame / 40) & 1 ? 24 : -24;
+    lv_obj_scroll_by(list_cont, 0, dy, LV_ANIM_OFF);
+}
+
+static void frame_full(lv_obj_t *scr, int frame) {
+    (void)frame;
+    lv_obj_invalidate(scr);
+}
+
+typedef struct {
+    const char *name;
+    void (*build)(lv_obj_t *scr);
+    void (*frame)(lv_obj_t *scr, int frame);
+} bench_scene_t;
+
+static const bench_scene_t scenes[] = {
+    { "rects",     scene_rects,     frame_full },
+    { "gradients", scene_gradients, frame_full },
+    { "images",    scene_images,    frame_full },
+    { "icons",     scene_icons,     frame_full },
+    { "labels",    scene_labels,    frame_full },
+    { "arcs",      scene_arcs,      frame_full },
+    { "list",      scene_list,      frame_list },
+};
+
+#define NUM_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+static void run_scene(lv_disp_t *disp, const bench_scene_t *sc, int frames) {
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_scr_load(scr);
+    sc->build(scr);
+    lv_refr_now(disp);
+
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        sc->frame(scr, i);
+        lv_refr_now(disp);
+    }
+
+    double min = 1e9, total = 0;
+    flushed_px = 0;
+    for (int i = 0; i < frames; i++) {
+        sc->frame(scr, i);
+        double t0 = now_ms();
+        lv_refr_now(disp);
+        double dt = now_ms() - t0;
+        total += dt;
+        if (dt < min) min = dt;
+    }
+
+    double avg = total / frames;
+    double mpx = total > 0 ? (double)flushed_px / (total * 1000.0) : 0;
+    printf("%-10s %6d %10.3f %10.3f %12.2f\n", sc->name, frames, avg, min, mpx);
+
+    lv_obj_t *blank = lv_obj_create(NULL);
+    lv_scr_load(blank);
+    lv_obj_del(scr);
+}
+
+int main(int argc, char **argv) {
+    int frames = 50;
+    int first_scene = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        frames = atoi(argv[2]);
+        if (frames <= 0) frames = 1;
+        first_scene = 3;
+    }
+
+    framebuffer = calloc(BENCH_HOR_RES * BENCH_VER_RES, sizeof(uint32_t));
+
+    lv_init();
+
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t buf[BENCH_HOR_RES * BENCH_BUF_LINES];
+    lv_disp_draw_buf_init(&draw_buf, buf, NULL, BENCH_HOR_RES * BENCH_BUF_LINES);
+
+    static lv_disp_drv_t disp_drv;
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = BENCH_HOR_RES;
+    disp_drv.ver_res = BENCH_VER_RES;
+    disp_drv.flush_cb = bench_flush_cb;
+    disp_drv.draw_buf = &draw_buf;
+    lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
+
+    bench_img_init();
+    bench_icons_init();
+
+    // 启动时预热图标，第一帧就不需要解码
+    for (int i = 0; i < BENCH_ICON_NUM; i++) {
+        lv_img_cache_prewarm(&bench_icons[i], lv_color_black());
+    }
+
+    printf("LVGL %d.%d.%d sw renderer, %dx%d, %d-bit, %d-line buffer\n",
+           LVGL_VERSION_MAJOR, LVGL_VERSION_MINOR, LVGL_VERSION_PATCH,
+           BENCH_HOR_RES, BENCH_VER_RES, LV_COLOR_DEPTH, BENCH_BUF_LINES);
+    printf("%-10s %6s %10s %10s %12s\n", "scene", "frames", "avg(ms)", "min(ms)", "Mpixel/s");
+
+    for (size_t i = 0; i < NUM_SCENES; i++) {
+        int selected = (first_scene >= argc);
+        for (int a = first_scene; a < argc; a++) {
+            if (strcmp(argv[a], scenes[i].name) == 0) selected = 1;
+        }
+        if (selected) {
+            run_scene(disp, &scenes[i], frames);
+        }
+    }
+
+    lv_img_cache_stats_t ic;
+    lv_img_cache_get_stats(&ic);
+    printf("image cache: %u hit, %u miss, %u evict, %u open, %u/%u bytes\n",
+           (unsigned)ic.hit_cnt, (unsigned)ic.miss_cnt, (unsigned)ic.evict_cnt, (unsigned)ic.entry_cnt,
+           (unsigned)ic.mem_used, (unsigned)ic.mem_total);
+
+#if LV_USE_GLYPH_CACHE
+    lv_draw_sw_glyph_cache_stats_t gc;
+    lv_draw_sw_glyph_cache_get_stats(&gc);
+    printf("glyph cache: %u hit, %u miss, %u skip, %u/%u bytes\n",
+           (unsigned)gc.hit_cnt, (unsigned)gc.miss_cnt, (unsigned)gc.skip_cnt,
+           (unsigned)gc.used_size, (unsigned)gc.total_size);
+#endif
+
+    return 0;
+}
@@ -135,13 +135,8 @@ int lvgl_display_init(void) {
     printf("[LVGL]   Registered resolution: %dx%d\n",
            lv_disp_get_hor_res(disp), lv_disp_get_ver_res(disp));
 
-    // 创建一个定时器来触发LVGL处理
-    lv_timer_t *timer = lv_timer_create(lv_timer_handler, 5, NULL);
-    if (!timer) {
-        printf("[LVGL] WARNING: Failed to create timer\n");
-    } else {
-        printf("[LVGL] Timer created successfully\n");
-    }
+    // 不再创建 5ms 周期的驱动定时器：主循环按 lv_timer_handler() 返回的
+    // 时间调用 gui_wait() 睡眠，tick 由 LV_TICK_CUSTOM (clock_ms) 提供
 
     printf("[LVGL] Display initialized successfully!\n");
     return 0;
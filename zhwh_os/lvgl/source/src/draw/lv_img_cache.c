@@ -12,6 +12,7 @@
 #include "lv_draw_img.h"
 #include "../hal/lv_hal_tick.h"
 #include "../misc/lv_gc.h"
+#include "../misc/lv_tlsf.h"
 
 /*********************
  *      DEFINES
@@ -35,6 +36,12 @@
  **********************/
 #if LV_IMG_CACHE_DEF_SIZE
     static bool lv_img_cache_match(const void * src1, const void * src2);
+    static void lv_img_cache_close_entry(_lv_img_cache_entry_t * entry);
+#endif
+#if _LV_IMG_CACHE_USE_MEM
+    static bool lv_img_cache_evict_lru(void);
+    static void lv_img_cache_decode_lines(_lv_img_cache_entry_t * entry);
+    static bool lv_img_cache_in_arena(const void * buf);
 #endif
 
 /**********************
@@ -43,6 +50,18 @@
 #if LV_IMG_CACHE_DEF_SIZE
     static uint16_t entry_cnt;
 #endif
+static uint32_t hit_cnt;
+static uint32_t miss_cnt;
+static uint32_t evict_cnt;
+
+#if _LV_IMG_CACHE_USE_MEM
+    /*The arena of the decoded images*/
+    static LV_ATTRIBUTE_LARGE_RAM_ARRAY uint64_t arena_mem[(LV_IMG_CACHE_MEM_SIZE + 7) / 8];
+    static lv_tlsf_t arena;
+    static size_t arena_used;
+    static uint32_t use_cnt;
+    static _lv_img_cache_entry_t * opening;    /*The entry being opened now. It can't be evicted.*/
+#endif
 
 /**********************
  *      MACROS
@@ -91,14 +110,30 @@ _lv_img_cache_entry_t * _lv_img_cache_open(const void * src, lv_color_t color, i
             cached_src = &cache[i];
             cached_src->life += cached_src->dec_dsc.time_to_open * LV_IMG_CACHE_LIFE_GAIN;
             if(cached_src->life > LV_IMG_CACHE_LIFE_LIMIT) cached_src->life = LV_IMG_CACHE_LIFE_LIMIT;
+#if _LV_IMG_CACHE_USE_MEM
+            cached_src->last_use = ++use_cnt;
+#endif
             LV_LOG_TRACE("image source found in the cache");
             break;
         }
     }
 
     /*The image is not cached then cache it now*/
-    if(cached_src) return cached_src;
+    if(cached_src) {
+        hit_cnt++;
+        return cached_src;
+    }
 
+#if _LV_IMG_CACHE_USE_MEM
+    /*Find an entry to reuse. Select an empty or the least recently used entry.
+     *The size of the images is handled by `lv_img_cache_mem_alloc()` which closes images when the arena is full*/
+    cached_src = &cache[0];
+    for(i = 1; i < entry_cnt && cached_src->dec_dsc.src; i++) {
+        if(cache[i].dec_dsc.src == NULL || cache[i].last_use < cached_src->last_use) {
+            cached_src = &cache[i];
+        }
+    }
+#else
     /*Find an entry to reuse. Select the entry with the least life*/
     cached_src = &cache[0];
     for(i = 1; i < entry_cnt; i++) {
@@ -106,10 +141,12 @@ _lv_img_cache_entry_t * _lv_img_cache_open(const void * src, lv_color_t color, i
             cached_src = &cache[i];
         }
     }
+#endif
 
     /*Close the decoder to reuse if it was opened (has a valid source)*/
     if(cached_src->dec_dsc.src) {
-        lv_img_decoder_close(&cached_src->dec_dsc);
+        lv_img_cache_close_entry(cached_src);
+        evict_cnt++;
         LV_LOG_INFO("image draw: cache miss, close and reuse an entry");
     }
     else {
@@ -118,13 +155,21 @@ _lv_img_cache_entry_t * _lv_img_cache_open(const void * src, lv_color_t color, i
 #else
     cached_src = &LV_GC_ROOT(_lv_img_cache_single);
 #endif
+    miss_cnt++;
+
     /*Open the image and measure the time to open*/
+#if _LV_IMG_CACHE_USE_MEM
+    opening = cached_src;
+#endif
     uint32_t t_start  = lv_tick_get();
     lv_res_t open_res = lv_img_decoder_open(&cached_src->dec_dsc, src, color, frame_id);
     if(open_res == LV_RES_INV) {
         LV_LOG_WARN("Image draw cannot open the image resource");
         lv_memset_00(cached_src, sizeof(_lv_img_cache_entry_t));
         cached_src->life = INT32_MIN; /*Make the empty entry very "weak" to force its us*/
+#if _LV_IMG_CACHE_USE_MEM
+        opening = NULL;
+#endif
         return NULL;
     }
 
@@ -137,6 +182,14 @@ _lv_img_cache_entry_t * _lv_img_cache_open(const void * src, lv_color_t color, i
 
     if(cached_src->dec_dsc.time_to_open == 0) cached_src->dec_dsc.time_to_open = 1;
 
+#if _LV_IMG_CACHE_USE_MEM
+    cached_src->last_use = ++use_cnt;
+
+    /*Decode the images which are read line-by-line once (if they fit into the arena)*/
+    if(cached_src->dec_dsc.img_data == NULL) lv_img_cache_decode_lines(cached_src);
+    opening = NULL;
+#endif
+
     return cached_src;
 }
 
@@ -169,6 +222,12 @@ void lv_img_cache_set_size(uint16_t new_entry_cnt)
 
     /*Clean the cache*/
     lv_memset_00(LV_GC_ROOT(_lv_img_cache_array), entry_cnt * sizeof(_lv_img_cache_entry_t));
+
+#if _LV_IMG_CACHE_USE_MEM
+    /*All images are closed, start with an empty arena*/
+    arena = lv_tlsf_create_with_pool((void *)arena_mem, sizeof(arena_mem));
+    arena_used = 0;
+#endif
 #endif
 }
 
@@ -186,16 +245,130 @@ void lv_img_cache_invalidate_src(const void * src)
     uint16_t i;
     for(i = 0; i < entry_cnt; i++) {
         if(src == NULL || lv_img_cache_match(src, cache[i].dec_dsc.src)) {
-            if(cache[i].dec_dsc.src != NULL) {
-                lv_img_decoder_close(&cache[i].dec_dsc);
-            }
-
-            lv_memset_00(&cache[i], sizeof(_lv_img_cache_entry_t));
+            lv_img_cache_close_entry(&cache[i]);
         }
     }
 #endif
 }
 
+/**
+ * Open an image into the cache in advance, e.g. the icons and backgrounds at the start of the application,
+ * so that the first draw doesn't have to decode it.
+ * @param src source of the image. Path to file or pointer to an `lv_img_dsc_t` variable
+ * @param color the color of the image with `LV_IMG_CF_ALPHA_...` (the `img_recolor` style property)
+ * @return LV_RES_OK: the image is cached; LV_RES_INV: the image can't be opened or the cache is disabled
+ */
+lv_res_t lv_img_cache_prewarm(const void * src, lv_color_t color)
+{
+#if LV_IMG_CACHE_DEF_SIZE
+    return _lv_img_cache_open(src, color, 0) ? LV_RES_OK : LV_RES_INV;
+#else
+    LV_UNUSED(src);
+    LV_UNUSED(color);
+    LV_LOG_WARN("Can't prewarm the image because the cache is disabled by LV_IMG_CACHE_DEF_SIZE = 0");
+    return LV_RES_INV;
+#endif
+}
+
+/**
+ * Get the hit/miss statistics and the memory usage of the image cache.
+ * @param stats the statistics will be copied here
+ */
+void lv_img_cache_get_stats(lv_img_cache_stats_t * stats)
+{
+    LV_ASSERT_NULL(stats);
+    lv_memset_00(stats, sizeof(lv_img_cache_stats_t));
+
+    stats->hit_cnt = hit_cnt;
+    stats->miss_cnt = miss_cnt;
+    stats->evict_cnt = evict_cnt;
+
+#if LV_IMG_CACHE_DEF_SIZE
+    _lv_img_cache_entry_t * cache = LV_GC_ROOT(_lv_img_cache_array);
+    uint16_t i;
+    for(i = 0; i < entry_cnt; i++) {
+        if(cache[i].dec_dsc.src) stats->entry_cnt++;
+    }
+#endif
+
+#if _LV_IMG_CACHE_USE_MEM
+    stats->mem_used = arena_used;
+    stats->mem_total = sizeof(arena_mem);
+#endif
+}
+
+/**
+ * Reset the hit/miss/evict counters of the image cache.
+ */
+void lv_img_cache_reset_stats(void)
+{
+    hit_cnt = 0;
+    miss_cnt = 0;
+    evict_cnt = 0;
+}
+
+/**
+ * Allocate memory for a decoded image from the arena of the image cache.
+ * Least recently used images are closed if there is not enough free space.
+ * @param size size of the memory in bytes
+ * @return pointer to the memory or NULL if the arena is disabled or too small
+ */
+void * lv_img_cache_mem_alloc(size_t size)
+{
+#if _LV_IMG_CACHE_USE_MEM
+    if(arena == NULL || size == 0 || size > sizeof(arena_mem)) return NULL;
+
+    void * buf = lv_tlsf_malloc(arena, size);
+    while(buf == NULL) {
+        /*Close the least recently used images until the new one fits*/
+        if(!lv_img_cache_evict_lru()) return NULL;
+        buf = lv_tlsf_malloc(arena, size);
+    }
+
+    arena_used += lv_tlsf_block_size(buf);
+    return buf;
+#else
+    LV_UNUSED(size);
+    return NULL;
+#endif
+}
+
+/**
+ * Move an image decoded into normal LVGL memory (`lv_mem_alloc`) to the arena of the image cache.
+ * @param buf the decoded image. It's freed if it was moved.
+ * @param size size of `buf` in bytes
+ * @return the new location of the image or `buf` if it couldn't be moved
+ */
+void * lv_img_cache_mem_take(void * buf, size_t size)
+{
+    void * new_buf = lv_img_cache_mem_alloc(size);
+    if(new_buf == NULL) return buf;
+
+    lv_memcpy(new_buf, buf, size);
+    lv_mem_free(buf);
+    return new_buf;
+}
+
+/**
+ * Free memory returned by `lv_img_cache_mem_alloc()` or `lv_img_cache_mem_take()`.
+ * Memory allocated by `lv_mem_alloc()` is freed with `lv_mem_free()`.
+ * @param buf pointer to the memory
+ */
+void lv_img_cache_mem_free(void * buf)
+{
+    if(buf == NULL) return;
+
+#if _LV_IMG_CACHE_USE_MEM
+    if(lv_img_cache_in_arena(buf)) {
+        arena_used -= lv_tlsf_block_size(buf);
+        lv_tlsf_free(arena, buf);
+        return;
+    }
+#endif
+
+    lv_mem_free(buf);
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -212,4 +385,90 @@ static bool lv_img_cache_match(const void * src1, const void * src2)
         return false;
     return strcmp(src1, src2) == 0;
 }
+
+static void lv_img_cache_close_entry(_lv_img_cache_entry_t * entry)
+{
+    if(entry->dec_dsc.src != NULL) {
+#if _LV_IMG_CACHE_USE_MEM
+        if(entry->decoded) {
+            /*The decoder doesn't know about the image decoded by the cache*/
+            entry->dec_dsc.img_data = NULL;
+            lv_img_cache_mem_free(entry->decoded);
+        }
+#endif
+        lv_img_decoder_close(&entry->dec_dsc);
+    }
+
+    lv_memset_00(entry, sizeof(_lv_img_cache_entry_t));
+}
+#endif
+
+#if _LV_IMG_CACHE_USE_MEM
+/**
+ * Close the least recently used image which has memory in the arena.
+ * @return false if there was no such image
+ */
+static bool lv_img_cache_evict_lru(void)
+{
+    _lv_img_cache_entry_t * cache = LV_GC_ROOT(_lv_img_cache_array);
+    _lv_img_cache_entry_t * lru = NULL;
+
+    uint16_t i;
+    for(i = 0; i < entry_cnt; i++) {
+        if(cache[i].dec_dsc.src == NULL || &cache[i] == opening) continue;
+        if(cache[i].decoded == NULL && !lv_img_cache_in_arena(cache[i].dec_dsc.img_data)) continue;
+        if(lru == NULL || cache[i].last_use < lru->last_use) lru = &cache[i];
+    }
+
+    if(lru == NULL) return false;
+
+    LV_LOG_INFO("image cache: arena is full, close the least recently used image");
+    lv_img_cache_close_entry(lru);
+    lru->life = INT32_MIN;
+    evict_cnt++;
+    return true;
+}
+
+/**
+ * Read an image which is available only line-by-line into the arena
+ * so that the lines don't need to be read (decoded) again on every draw.
+ * The lines are stored in the format in which `lv_draw_img` would draw them.
+ */
+static void lv_img_cache_decode_lines(_lv_img_cache_entry_t * entry)
+{
+    lv_img_decoder_dsc_t * dsc = &entry->dec_dsc;
+    if(dsc->error_msg != NULL) return;
+
+    lv_img_cf_t cf = dsc->header.cf;
+    uint32_t px_size;
+    if(lv_img_cf_is_chroma_keyed(cf)) px_size = LV_COLOR_SIZE / 8;
+    else if(cf == LV_IMG_CF_ALPHA_8BIT || cf == LV_IMG_CF_RGB565A8) return;  /*Their pixel data is not line based*/
+    else if(lv_img_cf_has_alpha(cf)) px_size = LV_IMG_PX_SIZE_ALPHA_BYTE;
+    else px_size = LV_COLOR_SIZE / 8;
+
+    lv_coord_t w = dsc->header.w;
+    lv_coord_t h = dsc->header.h;
+    size_t line_size = (size_t)w * px_size;
+    if(line_size == 0 || h == 0) return;
+
+    uint8_t * buf = lv_img_cache_mem_alloc(line_size * h);
+    if(buf == NULL) return;  /*Doesn't fit, keep reading it line-by-line*/
+
+    lv_coord_t y;
+    for(y = 0; y < h; y++) {
+        if(lv_img_decoder_read_line(dsc, 0, y, w, buf + y * line_size) != LV_RES_OK) {
+            lv_img_cache_mem_free(buf);
+            return;
+        }
+    }
+
+    entry->decoded = buf;
+    dsc->img_data = buf;
+}
+
+static bool lv_img_cache_in_arena(const void * buf)
+{
+    const uint8_t * start = (const uint8_t *)arena_mem;
+    return (const uint8_t *)buf >= start && (const uint8_t *)buf < start + sizeof(arena_mem);
+}
 #endif
@@ -18,6 +18,12 @@ extern "C" {
 /*********************
  *      DEFINES
  *********************/
+/*Keep the decoded images in a dedicated arena with an LRU byte budget*/
+#if LV_IMG_CACHE_DEF_SIZE && LV_IMG_CACHE_MEM_SIZE
+#    define _LV_IMG_CACHE_USE_MEM       1
+#else
+#    define _LV_IMG_CACHE_USE_MEM       0
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -35,8 +41,22 @@ typedef struct {
      * Decrement all lifes by one every in every ::lv_img_cache_open.
      * If life == 0 the entry can be reused*/
     int32_t life;
+
+#if _LV_IMG_CACHE_USE_MEM
+    uint32_t last_use;  /**< Value of the cache's use counter when the entry was opened last time (LRU)*/
+    uint8_t * decoded;  /**< The image decoded from `read_line` into the arena. Owned by the cache.*/
+#endif
 } _lv_img_cache_entry_t;
 
+typedef struct {
+    uint32_t hit_cnt;   /**< Image opens served from the cache*/
+    uint32_t miss_cnt;  /**< Image opens which needed decoding*/
+    uint32_t evict_cnt; /**< Images closed to make room for other images*/
+    uint16_t entry_cnt; /**< Number of images open in the cache*/
+    size_t mem_used;    /**< Bytes used in the arena of the decoded images*/
+    size_t mem_total;   /**< Size of the arena (`LV_IMG_CACHE_MEM_SIZE`)*/
+} lv_img_cache_stats_t;
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -67,6 +87,49 @@ void lv_img_cache_set_size(uint16_t new_slot_num);
  */
 void lv_img_cache_invalidate_src(const void * src);
 
+/**
+ * Open an image into the cache in advance, e.g. the icons and backgrounds at the start of the application,
+ * so that the first draw doesn't have to decode it.
+ * @param src source of the image. Path to file or pointer to an `lv_img_dsc_t` variable
+ * @param color the color of the image with `LV_IMG_CF_ALPHA_...` (the `img_recolor` style property)
+ * @return LV_RES_OK: the image is cached; LV_RES_INV: the image can't be opened or the cache is disabled
+ */
+lv_res_t lv_img_cache_prewarm(const void * src, lv_color_t color);
+
+/**
+ * Get the hit/miss statistics and the memory usage of the image cache.
+ * @param stats the statistics will be copied here
+ */
+void lv_img_cache_get_stats(lv_img_cache_stats_t * stats);
+
+/**
+ * Reset the hit/miss/evict counters of the image cache.
+ */
+void lv_img_cache_reset_stats(void);
+
+/**
+ * Allocate memory for a decoded image from the arena of the image cache.
+ * Least recently used images are closed if there is not enough free space.
+ * @param size size of the memory in bytes
+ * @return pointer to the memory or NULL if the arena is disabled or too small
+ */
+void * lv_img_cache_mem_alloc(size_t size);
+
+/**
+ * Move an image decoded into normal LVGL memory (`lv_mem_alloc`) to the arena of the image cache.
+ * @param buf the decoded image. It's freed if it was moved.
+ * @param size size of `buf` in bytes
+ * @return the new location of the image or `buf` if it couldn't be moved
+ */
+void * lv_img_cache_mem_take(void * buf, size_t size);
+
+/**
+ * Free memory returned by `lv_img_cache_mem_alloc()` or `lv_img_cache_mem_take()`.
+ * Memory allocated by `lv_mem_alloc()` is freed with `lv_mem_free()`.
+ * @param buf pointer to the memory
+ */
+void lv_img_cache_mem_free(void * buf);
+
 /**********************
  *      MACROS
  **********************/
@@ -10,6 +10,7 @@
 #include "../../misc/lv_math.h"
 #include "../../hal/lv_hal_disp.h"
 #include "../../core/lv_refr.h"
+#include "lv_draw_sw_blend_sse2.h"
 
 /*********************
  *      DEFINES
@@ -248,6 +249,13 @@ static LV_ATTRIBUTE_FAST_MEM void fill_normal(lv_color_t * dest_buf, const lv_ar
                                               lv_coord_t dest_stride, lv_color_t color, lv_opa_t opa,
                                               const lv_opa_t * mask, lv_coord_t mask_stride)
 {
+#if LV_DRAW_SW_SSE2
+    if(lv_draw_sw_sse2_is_enabled()) {
+        lv_draw_sw_sse2_fill_normal(dest_buf, dest_area, dest_stride, color, opa, mask, mask_stride);
+        return;
+    }
+#endif
+
     int32_t w = lv_area_get_width(dest_area);
     int32_t h = lv_area_get_height(dest_area);
 
@@ -649,6 +657,13 @@ static void LV_ATTRIBUTE_FAST_MEM map_normal(lv_color_t * dest_buf, const lv_are
                                              lv_coord_t mask_stride)
 
 {
+#if LV_DRAW_SW_SSE2
+    if(lv_draw_sw_sse2_is_enabled()) {
+        lv_draw_sw_sse2_map_normal(dest_buf, dest_area, dest_stride, src_buf, src_stride, opa, mask, mask_stride);
+        return;
+    }
+#endif
+
     int32_t w = lv_area_get_width(dest_area);
     int32_t h = lv_area_get_height(dest_area);
 
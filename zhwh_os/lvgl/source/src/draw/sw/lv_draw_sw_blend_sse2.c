@@ -0,0 +1,370 @@
+/**
+ * @file lv_draw_sw_blend_sse2.c
+ *
+ * SSE2 kernels for the normal blend mode with LV_COLOR_DEPTH 32.
+ * They mirror `fill_normal()` and `map_normal()` in lv_draw_sw_blend.c pixel by pixel
+ * (including the 4-pixel mask grouping), so the output is bit-exact with the scalar path.
+ *
+ * The GCC vector extensions and `__builtin_ia32_*` are used instead of <emmintrin.h>
+ * because the target build is compiled with -nostdinc.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_draw_sw_blend_sse2.h"
+
+#if LV_DRAW_SW_SSE2
+
+/*********************
+ *      DEFINES
+ *********************/
+#define SSE2_FN static inline __attribute__((always_inline, target("sse2")))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef char v16qi __attribute__((vector_size(16)));
+typedef short v8hi __attribute__((vector_size(16)));
+typedef unsigned short v8hu __attribute__((vector_size(16)));
+typedef int v4si __attribute__((vector_size(16)));
+/*Unaligned access to the pixel buffers*/
+typedef int v4si_u __attribute__((vector_size(16), aligned(1), __may_alias__));
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static int8_t sse2_available = -1;
+static bool sse2_enabled = true;
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+SSE2_FN v4si load4(const lv_color_t * p)
+{
+    return *(const v4si_u *)p;
+}
+
+SSE2_FN void store4(lv_color_t * p, v4si v)
+{
+    *(v4si_u *)p = v;
+}
+
+SSE2_FN v4si splat32(uint32_t v)
+{
+    return (v4si) {
+        (int)v, (int)v, (int)v, (int)v
+    };
+}
+
+SSE2_FN v8hi splat16(uint16_t v)
+{
+    return (v8hi) {
+        (short)v, (short)v, (short)v, (short)v, (short)v, (short)v, (short)v, (short)v
+    };
+}
+
+SSE2_FN v4si select32(v4si a, v4si b, v4si sel)
+{
+    return (a & ~sel) | (b & sel);
+}
+
+/*Bytes of 2 pixels to 16 bit channels*/
+SSE2_FN v8hi unpack_lo(v4si px)
+{
+    return (v8hi)__builtin_ia32_punpcklbw128((v16qi)px, (v16qi) {
+        0
+    });
+}
+
+SSE2_FN v8hi unpack_hi(v4si px)
+{
+    return (v8hi)__builtin_ia32_punpckhbw128((v16qi)px, (v16qi) {
+        0
+    });
+}
+
+/**
+ * LV_UDIV255(fg * mix + bg * (255 - mix)) per 16 bit channel, same as `lv_color_mix()`.
+ * The sum is <= 65025 so it fits into 16 bits, and (x * 0x8081) >> 23 == mulhi(x, 0x8081) >> 7.
+ */
+SSE2_FN v8hi mix16(v8hi fg, v8hi bg, v8hi mix)
+{
+    v8hu t = (v8hu)(fg * mix + bg * (splat16(255) - mix));
+    return (v8hi)((v8hu)__builtin_ia32_pmulhuw128((v8hi)t, splat16(0x8081)) >> 7);
+}
+
+/**
+ * `lv_color_mix()` for 4 pixels. `mix_lo`/`mix_hi` hold the mix value of pixel 0-1 and 2-3
+ * repeated for every channel. The alpha channel of the result is 0xFF.
+ */
+SSE2_FN v4si mix4(v4si fg, v4si bg, v8hi mix_lo, v8hi mix_hi)
+{
+    v8hi lo = mix16(unpack_lo(fg), unpack_lo(bg), mix_lo);
+    v8hi hi = mix16(unpack_hi(fg), unpack_hi(bg), mix_hi);
+    v4si res = (v4si)__builtin_ia32_packuswb128(lo, hi);
+    return res | splat32(0xFF000000);
+}
+
+/*4 mask bytes to 16 bit lanes: m16 = [m0 m1 m2 m3 0 0 0 0]*/
+SSE2_FN v8hi mask_to16(uint32_t mask32)
+{
+    v4si m = {(int)mask32, 0, 0, 0};
+    return (v8hi)__builtin_ia32_punpcklbw128((v16qi)m, (v16qi) {
+        0
+    });
+}
+
+/*m16 to per channel values: lo = [m0 x4, m1 x4], hi = [m2 x4, m3 x4]*/
+SSE2_FN void mask_spread(v8hi m16, v8hi * lo, v8hi * hi)
+{
+    v4si m32 = (v4si)__builtin_ia32_punpcklwd128(m16, m16);
+    *lo = (v8hi)__builtin_ia32_punpckldq128(m32, m32);
+    *hi = (v8hi)__builtin_ia32_punpckhdq128(m32, m32);
+}
+
+/*m16 to one 32 bit lane per pixel: [m0 m1 m2 m3]*/
+SSE2_FN v4si mask_px(v8hi m16)
+{
+    return (v4si)__builtin_ia32_punpcklwd128(m16, (v8hi) {
+        0
+    });
+}
+
+SSE2_FN uint32_t load_mask32(const lv_opa_t * mask)
+{
+    return (uint32_t)mask[0] | ((uint32_t)mask[1] << 8) | ((uint32_t)mask[2] << 16) | ((uint32_t)mask[3] << 24);
+}
+
+__attribute__((target("sse2")))
+static void fill_row(lv_color_t * dest_buf, lv_color_t color, int32_t w)
+{
+    v4si c = splat32(color.full);
+    int32_t x;
+    for(x = 0; x <= w - 4; x += 4) store4(&dest_buf[x], c);
+    for(; x < w; x++) dest_buf[x] = color;
+}
+
+__attribute__((target("sse2")))
+static void copy_row(lv_color_t * dest_buf, const lv_color_t * src_buf, int32_t w)
+{
+    int32_t x;
+    for(x = 0; x <= w - 4; x += 4) store4(&dest_buf[x], load4(&src_buf[x]));
+    for(; x < w; x++) dest_buf[x] = src_buf[x];
+}
+
+/*dest = lv_color_mix(fg, dest, opa) for a row, fg is either a color (fg_buf == NULL) or a buffer*/
+__attribute__((target("sse2")))
+static void mix_row(lv_color_t * dest_buf, const lv_color_t * fg_buf, lv_color_t fg_color, lv_opa_t opa, int32_t w)
+{
+    v8hi m = splat16(opa);
+    v4si c = splat32(fg_color.full);
+    int32_t x;
+    for(x = 0; x <= w - 4; x += 4) {
+        v4si fg = fg_buf ? load4(&fg_buf[x]) : c;
+        store4(&dest_buf[x], mix4(fg, load4(&dest_buf[x]), m, m));
+    }
+    for(; x < w; x++) {
+        dest_buf[x] = lv_color_mix(fg_buf ? fg_buf[x] : fg_color, dest_buf[x], opa);
+    }
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+bool lv_draw_sw_sse2_available(void)
+{
+    if(sse2_available < 0) {
+        uint32_t eax = 1, ebx, ecx = 0, edx;
+        __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+        sse2_available = (edx & (1u << 26)) ? 1 : 0;
+    }
+    return sse2_available == 1;
+}
+
+void lv_draw_sw_sse2_enable(bool en)
+{
+    sse2_enabled = en;
+}
+
+bool lv_draw_sw_sse2_is_enabled(void)
+{
+    return sse2_enabled && lv_draw_sw_sse2_available();
+}
+
+__attribute__((target("sse2")))
+void lv_draw_sw_sse2_fill_normal(lv_color_t * dest_buf, const lv_area_t * dest_area, lv_coord_t dest_stride,
+                                 lv_color_t color, lv_opa_t opa, const lv_opa_t * mask, lv_coord_t mask_stride)
+{
+    int32_t w = lv_area_get_width(dest_area);
+    int32_t h = lv_area_get_height(dest_area);
+    int32_t x;
+    int32_t y;
+
+    /*No mask*/
+    if(mask == NULL) {
+        for(y = 0; y < h; y++) {
+            if(opa >= LV_OPA_MAX) fill_row(dest_buf, color, w);
+            else mix_row(dest_buf, NULL, color, opa, w);
+            dest_buf += dest_stride;
+        }
+        return;
+    }
+
+    v4si c = splat32(color.full);
+
+    /*Only the mask matters*/
+    if(opa >= LV_OPA_MAX) {
+        int32_t x_end4 = w - 4;
+        for(y = 0; y < h; y++) {
+            /*Same grouping as the scalar code: unaligned head pixel by pixel, then 4 pixels
+             *aligned to the mask. Transparent groups are skipped, others are mixed even where the
+             *mask is 0 (that sets alpha to 0xFF like FILL_NORMAL_MASK_PX does)*/
+            for(x = 0; x < w && ((lv_uintptr_t)(mask + x) & 0x3); x++) {
+                dest_buf[x] = mask[x] == LV_OPA_COVER ? color : lv_color_mix(color, dest_buf[x], mask[x]);
+            }
+
+            for(; x <= x_end4; x += 4) {
+                uint32_t mask32 = load_mask32(&mask[x]);
+                if(mask32 == 0xFFFFFFFF) {
+                    store4(&dest_buf[x], c);
+                }
+                else if(mask32) {
+                    v8hi m16 = mask_to16(mask32);
+                    v8hi m_lo, m_hi;
+                    mask_spread(m16, &m_lo, &m_hi);
+                    v4si res = mix4(c, load4(&dest_buf[x]), m_lo, m_hi);
+                    v4si cover = mask_px(m16) == splat32(LV_OPA_COVER);
+                    store4(&dest_buf[x], select32(res, c, cover));
+                }
+            }
+
+            for(; x < w; x++) {
+                dest_buf[x] = mask[x] == LV_OPA_COVER ? color : lv_color_mix(color, dest_buf[x], mask[x]);
+            }
+            dest_buf += dest_stride;
+            mask += mask_stride;
+        }
+    }
+    /*With opacity*/
+    else {
+        v8hi opa16 = splat16(opa);
+        for(y = 0; y < h; y++) {
+            for(x = 0; x <= w - 4; x += 4) {
+                uint32_t mask32 = load_mask32(&mask[x]);
+                if(mask32 == 0) continue;
+
+                /*opa_tmp = mask == COVER ? opa : (mask * opa) >> 8; opa < LV_OPA_MAX so it's never COVER*/
+                v8hi m16 = mask_to16(mask32);
+                v8hi scaled = (v8hi)((v8hu)(m16 * opa16) >> 8);
+                v8hi opa_tmp = (scaled & ~(m16 == splat16(LV_OPA_COVER))) | (opa16 & (m16 == splat16(LV_OPA_COVER)));
+                v8hi m_lo, m_hi;
+                mask_spread(opa_tmp, &m_lo, &m_hi);
+
+                v4si dest = load4(&dest_buf[x]);
+                v4si res = mix4(c, dest, m_lo, m_hi);
+                v4si transp = mask_px(m16) == splat32(0);
+                store4(&dest_buf[x], select32(res, dest, transp));
+            }
+            for(; x < w; x++) {
+                if(mask[x]) {
+                    lv_opa_t opa_tmp = mask[x] == LV_OPA_COVER ? opa : (uint32_t)((uint32_t)mask[x] * opa) >> 8;
+                    dest_buf[x] = opa_tmp == LV_OPA_COVER ? color : lv_color_mix(color, dest_buf[x], opa_tmp);
+                }
+            }
+            dest_buf += dest_stride;
+            mask += mask_stride;
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+void lv_draw_sw_sse2_map_normal(lv_color_t * dest_buf, const lv_area_t * dest_area, lv_coord_t dest_stride,
+                                const lv_color_t * src_buf, lv_coord_t src_stride, lv_opa_t opa,
+                                const lv_opa_t * mask, lv_coord_t mask_stride)
+{
+    int32_t w = lv_area_get_width(dest_area);
+    int32_t h = lv_area_get_height(dest_area);
+    int32_t x;
+    int32_t y;
+
+    /*Simple copy or opacity mix, no masking*/
+    if(mask == NULL) {
+        for(y = 0; y < h; y++) {
+            if(opa >= LV_OPA_MAX) copy_row(dest_buf, src_buf, w);
+            else mix_row(dest_buf, src_buf, lv_color_black(), opa, w);
+            dest_buf += dest_stride;
+            src_buf += src_stride;
+        }
+        return;
+    }
+
+    /*Only the mask matters (MAP_NORMAL_MASK_PX leaves mask == 0 pixels untouched)*/
+    if(opa > LV_OPA_MAX) {
+        for(y = 0; y < h; y++) {
+            for(x = 0; x <= w - 4; x += 4) {
+                uint32_t mask32 = load_mask32(&mask[x]);
+                if(mask32 == 0) continue;
+
+                v4si src = load4(&src_buf[x]);
+                if(mask32 == 0xFFFFFFFF) {
+                    store4(&dest_buf[x], src);
+                    continue;
+                }
+
+                v8hi m16 = mask_to16(mask32);
+                v8hi m_lo, m_hi;
+                mask_spread(m16, &m_lo, &m_hi);
+                v4si dest = load4(&dest_buf[x]);
+                v4si res = mix4(src, dest, m_lo, m_hi);
+                v4si m_px = mask_px(m16);
+                res = select32(res, src, m_px == splat32(LV_OPA_COVER));
+                store4(&dest_buf[x], select32(res, dest, m_px == splat32(0)));
+            }
+            for(; x < w; x++) {
+                if(mask[x]) {
+                    if(mask[x] == LV_OPA_COVER) dest_buf[x] = src_buf[x];
+                    else dest_buf[x] = lv_color_mix(src_buf[x], dest_buf[x], mask[x]);
+                }
+            }
+            dest_buf += dest_stride;
+            src_buf += src_stride;
+            mask += mask_stride;
+        }
+    }
+    /*Handle opa and mask values too*/
+    else {
+        v8hi opa16 = splat16(opa);
+        for(y = 0; y < h; y++) {
+            for(x = 0; x <= w - 4; x += 4) {
+                uint32_t mask32 = load_mask32(&mask[x]);
+                if(mask32 == 0) continue;
+
+                /*opa_tmp = mask >= LV_OPA_MAX ? opa : (opa * mask) >> 8*/
+                v8hi m16 = mask_to16(mask32);
+                v8hi full = m16 > splat16(LV_OPA_MAX - 1);
+                v8hi scaled = (v8hi)((v8hu)(m16 * opa16) >> 8);
+                v8hi opa_tmp = (scaled & ~full) | (opa16 & full);
+                v8hi m_lo, m_hi;
+                mask_spread(opa_tmp, &m_lo, &m_hi);
+
+                v4si dest = load4(&dest_buf[x]);
+                v4si res = mix4(load4(&src_buf[x]), dest, m_lo, m_hi);
+                store4(&dest_buf[x], select32(res, dest, mask_px(m16) == splat32(0)));
+            }
+            for(; x < w; x++) {
+                if(mask[x]) {
+                    lv_opa_t opa_tmp = mask[x] >= LV_OPA_MAX ? opa : ((opa * mask[x]) >> 8);
+                    dest_buf[x] = lv_color_mix(src_buf[x], dest_buf[x], opa_tmp);
+                }
+            }
+            dest_buf += dest_stride;
+            src_buf += src_stride;
+            mask += mask_stride;
+        }
+    }
+}
+
+#endif /*LV_DRAW_SW_SSE2*/
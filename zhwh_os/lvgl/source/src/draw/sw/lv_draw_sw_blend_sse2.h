@@ -0,0 +1,71 @@
+/**
+ * @file lv_draw_sw_blend_sse2.h
+ *
+ */
+
+#ifndef LV_DRAW_SW_BLEND_SSE2_H
+#define LV_DRAW_SW_BLEND_SSE2_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "../../misc/lv_color.h"
+#include "../../misc/lv_area.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#if LV_USE_DRAW_SW_SSE2 && LV_COLOR_DEPTH == 32 && (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+#define LV_DRAW_SW_SSE2 1
+#else
+#define LV_DRAW_SW_SSE2 0
+#endif
+
+#if LV_DRAW_SW_SSE2
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Check CPUID once for SSE2 support.
+ * @return true if the CPU supports SSE2
+ */
+bool lv_draw_sw_sse2_available(void);
+
+/**
+ * Enable or disable the SSE2 kernels (e.g. to compare against the scalar path).
+ * Enabling has no effect if the CPU doesn't support SSE2.
+ * @param en true: use SSE2 when available; false: always use the scalar code
+ */
+void lv_draw_sw_sse2_enable(bool en);
+
+/**
+ * @return true if the SSE2 kernels are used by `lv_draw_sw_blend_basic()`
+ */
+bool lv_draw_sw_sse2_is_enabled(void);
+
+/**
+ * SSE2 version of `fill_normal()` in lv_draw_sw_blend.c. Produces bit-exact results.
+ */
+void lv_draw_sw_sse2_fill_normal(lv_color_t * dest_buf, const lv_area_t * dest_area, lv_coord_t dest_stride,
+                                 lv_color_t color, lv_opa_t opa, const lv_opa_t * mask, lv_coord_t mask_stride);
+
+/**
+ * SSE2 version of `map_normal()` in lv_draw_sw_blend.c. Produces bit-exact results.
+ */
+void lv_draw_sw_sse2_map_normal(lv_color_t * dest_buf, const lv_area_t * dest_area, lv_coord_t dest_stride,
+                                const lv_color_t * src_buf, lv_coord_t src_stride, lv_opa_t opa,
+                                const lv_opa_t * mask, lv_coord_t mask_stride);
+
+#endif /*LV_DRAW_SW_SSE2*/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_DRAW_SW_BLEND_SSE2_H*/
@@ -0,0 +1,218 @@
+/**
+ * @file lv_draw_sw_glyph_cache.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_draw_sw_glyph_cache.h"
+#if LV_USE_GLYPH_CACHE
+
+#include "../../misc/lv_lru.h"
+#include "../../misc/lv_mem.h"
+#include "../../misc/lv_gc.h"
+#include "../../misc/lv_log.h"
+#include "../../misc/lv_assert.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Used to size the hash table of the LRU cache (a 14 px glyph is ~10x12 px)*/
+#define GLYPH_AVERAGE_SIZE  64
+
+/*Glyphs larger than this part of the budget are not cached to avoid flushing the whole cache for one glyph*/
+#define GLYPH_MAX_SHARE     4
+
+#define glyph_cache         LV_GC_ROOT(_lv_glyph_cache)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    const lv_font_t * font;
+    uint32_t letter;
+    lv_coord_t line_height;     /*Changes with the size of the font (e.g. `lv_tiny_ttf_set_size()`)*/
+    uint16_t box_w;
+    uint16_t box_h;
+} glyph_cache_key_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool cache_create(void);
+static void glyph_to_a8(const uint8_t * map_p, uint32_t bpp, uint32_t px_cnt, uint8_t * a8);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static size_t cache_size = LV_GLYPH_CACHE_SIZE;
+static uint32_t hit_cnt;
+static uint32_t miss_cnt;
+static uint32_t skip_cnt;
+
+extern const uint8_t _lv_bpp1_opa_table[2];
+extern const uint8_t _lv_bpp2_opa_table[4];
+extern const uint8_t _lv_bpp4_opa_table[16];
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+const uint8_t * _lv_draw_sw_glyph_cache_get(const lv_font_glyph_dsc_t * g, uint32_t letter)
+{
+    /*Sub-pixel and image font glyphs are drawn differently, keep them out of the cache*/
+    if(g->resolved_font == NULL || g->resolved_font->subpx) return NULL;
+    if(g->bpp != 1 && g->bpp != 2 && g->bpp != 3 && g->bpp != 4 && g->bpp != 8) return NULL;
+
+    uint32_t px_cnt = (uint32_t)g->box_w * g->box_h;
+    if(px_cnt == 0) return NULL;
+
+    if(glyph_cache == NULL && !cache_create()) return NULL;
+
+    if(px_cnt > cache_size / GLYPH_MAX_SHARE) {
+        skip_cnt++;
+        return NULL;
+    }
+
+    glyph_cache_key_t key;
+    lv_memset_00(&key, sizeof(key)); /*Zero padding*/
+    key.font = g->resolved_font;
+    key.letter = letter;
+    key.line_height = g->resolved_font->line_height;
+    key.box_w = g->box_w;
+    key.box_h = g->box_h;
+
+    uint8_t * a8 = NULL;
+    lv_lru_get(glyph_cache, &key, sizeof(key), (void **)&a8);
+    if(a8) {
+        hit_cnt++;
+        return a8;
+    }
+
+    const uint8_t * map_p = lv_font_get_glyph_bitmap(g->resolved_font, letter);
+    if(map_p == NULL) return NULL;
+
+    a8 = lv_mem_alloc(px_cnt);
+    if(a8 == NULL) {
+        skip_cnt++;
+        return NULL;
+    }
+
+    glyph_to_a8(map_p, g->bpp, px_cnt, a8);
+
+    if(lv_lru_set(glyph_cache, &key, sizeof(key), a8, px_cnt) != LV_LRU_OK) {
+        lv_mem_free(a8);
+        skip_cnt++;
+        return NULL;
+    }
+
+    miss_cnt++;
+    return a8;
+}
+
+void lv_draw_sw_glyph_cache_set_size(size_t size)
+{
+    lv_draw_sw_glyph_cache_invalidate();
+    cache_size = size;
+}
+
+void lv_draw_sw_glyph_cache_invalidate(void)
+{
+    if(glyph_cache) {
+        lv_lru_del(glyph_cache);
+        glyph_cache = NULL;
+    }
+}
+
+void lv_draw_sw_glyph_cache_get_stats(lv_draw_sw_glyph_cache_stats_t * stats)
+{
+    LV_ASSERT_NULL(stats);
+
+    stats->hit_cnt = hit_cnt;
+    stats->miss_cnt = miss_cnt;
+    stats->skip_cnt = skip_cnt;
+    stats->total_size = cache_size;
+    stats->used_size = glyph_cache ? glyph_cache->total_memory - glyph_cache->free_memory : 0;
+}
+
+void lv_draw_sw_glyph_cache_reset_stats(void)
+{
+    hit_cnt = 0;
+    miss_cnt = 0;
+    skip_cnt = 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static bool cache_create(void)
+{
+    if(cache_size < GLYPH_AVERAGE_SIZE) return false;
+
+    glyph_cache = lv_lru_create(cache_size, GLYPH_AVERAGE_SIZE, lv_mem_free, lv_mem_free);
+    if(glyph_cache == NULL) {
+        LV_LOG_WARN("couldn't allocate the glyph cache, drawing without it");
+        cache_size = 0;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Convert a glyph bitmap to 1 byte opacity per pixel.
+ * Walks the bits exactly as `draw_letter_normal()` does for a fully visible glyph.
+ */
+static void glyph_to_a8(const uint8_t * map_p, uint32_t bpp, uint32_t px_cnt, uint8_t * a8)
+{
+    const uint8_t * bpp_opa_table;
+    uint32_t bitmask_init;
+
+    if(bpp == 3) bpp = 4;
+
+    switch(bpp) {
+        case 1:
+            bpp_opa_table = _lv_bpp1_opa_table;
+            bitmask_init  = 0x80;
+            break;
+        case 2:
+            bpp_opa_table = _lv_bpp2_opa_table;
+            bitmask_init  = 0xC0;
+            break;
+        case 4:
+            bpp_opa_table = _lv_bpp4_opa_table;
+            bitmask_init  = 0xF0;
+            break;
+        default:
+            /*8 bpp: the pixel value is the opacity*/
+            lv_memcpy(a8, map_p, px_cnt);
+            return;
+    }
+
+    uint32_t col_bit_max = 8 - bpp;
+    uint32_t col_bit = 0;
+    uint32_t bitmask = bitmask_init;
+    uint32_t i;
+    for(i = 0; i < px_cnt; i++) {
+        a8[i] = bpp_opa_table[(*map_p & bitmask) >> (col_bit_max - col_bit)];
+
+        if(col_bit < col_bit_max) {
+            col_bit += bpp;
+            bitmask = bitmask >> bpp;
+        }
+        else {
+            col_bit = 0;
+            bitmask = bitmask_init;
+            map_p++;
+        }
+    }
+}
+
+#endif /*LV_USE_GLYPH_CACHE*/
@@ -0,0 +1,85 @@
+/**
+ * @file lv_draw_sw_glyph_cache.h
+ *
+ */
+
+#ifndef LV_DRAW_SW_GLYPH_CACHE_H
+#define LV_DRAW_SW_GLYPH_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "../../lv_conf_internal.h"
+#include "../../font/lv_font.h"
+
+#include <stddef.h>
+
+#if LV_USE_GLYPH_CACHE
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+    uint32_t hit_cnt;       /**< Glyphs served from the cache*/
+    uint32_t miss_cnt;      /**< Glyphs decoded and added to the cache*/
+    uint32_t skip_cnt;      /**< Glyphs drawn without the cache (too large, out of memory, etc.)*/
+    size_t used_size;       /**< Bytes of glyph data currently in the cache*/
+    size_t total_size;      /**< Memory budget of the cache in bytes*/
+} lv_draw_sw_glyph_cache_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Get the rendered glyph of a letter: one opacity byte per pixel, `g->box_w * g->box_h` bytes.
+ * On a miss the font's bitmap is decoded once and stored in the cache.
+ * @param g         glyph descriptor of `letter` from `lv_font_get_glyph_dsc()`
+ * @param letter    the letter
+ * @return          pointer to the rendered glyph (valid until the next call) or NULL
+ *                  if the glyph can't be cached; draw it from the font's bitmap then
+ */
+const uint8_t * _lv_draw_sw_glyph_cache_get(const lv_font_glyph_dsc_t * g, uint32_t letter);
+
+/**
+ * Change the memory budget of the glyph cache. The cached glyphs are dropped.
+ * @param size      new budget in bytes, 0 to disable the cache
+ */
+void lv_draw_sw_glyph_cache_set_size(size_t size);
+
+/**
+ * Drop all cached glyphs, e.g. before a dynamically created font is freed.
+ */
+void lv_draw_sw_glyph_cache_invalidate(void);
+
+/**
+ * Get the statistics of the glyph cache.
+ * @param stats     the statistics will be copied here
+ */
+void lv_draw_sw_glyph_cache_get_stats(lv_draw_sw_glyph_cache_stats_t * stats);
+
+/**
+ * Reset the hit/miss/skip counters.
+ */
+void lv_draw_sw_glyph_cache_reset_stats(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /*LV_USE_GLYPH_CACHE*/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_DRAW_SW_GLYPH_CACHE_H*/
@@ -7,6 +7,7 @@
  *      INCLUDES
  *********************/
 #include "lv_draw_sw.h"
+#include "lv_draw_sw_glyph_cache.h"
 #include "../../hal/lv_hal_disp.h"
 #include "../../misc/lv_math.h"
 #include "../../misc/lv_assert.h"
@@ -140,6 +141,16 @@ void lv_draw_sw_letter(lv_draw_ctx_t * draw_ctx, const lv_draw_label_dsc_t * dsc
         return;
     }
 
+#if LV_USE_GLYPH_CACHE
+    /*Draw the already rendered 8 bpp version of the glyph if possible*/
+    const uint8_t * a8_p = _lv_draw_sw_glyph_cache_get(&g, letter);
+    if(a8_p) {
+        g.bpp = 8;
+        draw_letter_normal(draw_ctx, dsc, &gpos, &g, a8_p);
+        return;
+    }
+#endif
+
     const uint8_t * map_p = lv_font_get_glyph_bitmap(g.resolved_font, letter);
     if(map_p == NULL) {
         LV_LOG_WARN("lv_draw_letter: character's bitmap not found");
@@ -286,30 +297,46 @@ static void LV_ATTRIBUTE_FAST_MEM draw_letter_normal(lv_draw_ctx_t * draw_ctx, c
 #if LV_DRAW_COMPLEX
         int32_t mask_p_start = mask_p;
 #endif
-        bitmask = bitmask_init >> col_bit;
-        for(col = col_start; col < col_end; col++) {
-            /*Load the pixel's opacity into the mask*/
-            letter_px = (*map_p & bitmask) >> (col_bit_max - col_bit);
-            if(letter_px) {
-                mask_buf[mask_p] = bpp_opa_table_p[letter_px];
+        if(bpp == 8) {
+            /*One byte per pixel (e.g. glyphs from the glyph cache): no bit unpacking needed*/
+            int32_t w = col_end - col_start;
+            if(bpp_opa_table_p == _lv_bpp8_opa_table) {
+                lv_memcpy(mask_buf + mask_p, map_p, w);
             }
             else {
-                mask_buf[mask_p] = 0;
+                for(col = 0; col < w; col++) {
+                    mask_buf[mask_p + col] = bpp_opa_table_p[map_p[col]];
+                }
             }
+            map_p += w;
+            mask_p += w;
+        }
+        else {
+            bitmask = bitmask_init >> col_bit;
+            for(col = col_start; col < col_end; col++) {
+                /*Load the pixel's opacity into the mask*/
+                letter_px = (*map_p & bitmask) >> (col_bit_max - col_bit);
+                if(letter_px) {
+                    mask_buf[mask_p] = bpp_opa_table_p[letter_px];
+                }
+                else {
+                    mask_buf[mask_p] = 0;
+                }
 
-            /*Go to the next column*/
-            if(col_bit < col_bit_max) {
-                col_bit += bpp;
-                bitmask = bitmask >> bpp;
-            }
-            else {
-                col_bit = 0;
-                bitmask = bitmask_init;
-                map_p++;
-            }
+                /*Go to the next column*/
+                if(col_bit < col_bit_max) {
+                    col_bit += bpp;
+                    bitmask = bitmask >> bpp;
+                }
+                else {
+                    col_bit = 0;
+                    bitmask = bitmask_init;
+                    map_p++;
+                }
 
-            /*Next mask byte*/
-            mask_p++;
+                /*Next mask byte*/
+                mask_p++;
+            }
         }
 
 #if LV_DRAW_COMPLEX
@@ -183,7 +183,9 @@ static lv_res_t decoder_open(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t *
 
             /*Convert the image to the system's color depth*/
             convert_color_depth(img_data,  png_width * png_height);
-            dsc->img_data = img_data;
+
+            /*Keep the decoded image in the image cache's arena if possible*/
+            dsc->img_data = lv_img_cache_mem_take(img_data, png_width * png_height * LV_IMG_PX_SIZE_ALPHA_BYTE);
             return LV_RES_OK;     /*The image is fully decoded. Return with its pointer*/
         }
     }
@@ -206,7 +208,8 @@ static lv_res_t decoder_open(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t *
         /*Convert the image to the system's color depth*/
         convert_color_depth(img_data,  png_width * png_height);
 
-        dsc->img_data = img_data;
+        /*Keep the decoded image in the image cache's arena if possible*/
+        dsc->img_data = lv_img_cache_mem_take(img_data, png_width * png_height * LV_IMG_PX_SIZE_ALPHA_BYTE);
         return LV_RES_OK;     /*Return with its pointer*/
     }
 
@@ -220,7 +223,7 @@ static void decoder_close(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc
 {
     LV_UNUSED(decoder); /*Unused*/
     if(dsc->img_data) {
-        lv_mem_free((uint8_t *)dsc->img_data);
+        lv_img_cache_mem_free((uint8_t *)dsc->img_data);
         dsc->img_data = NULL;
     }
 }
@@ -3,6 +3,7 @@
 #if LV_USE_TINY_TTF
 #include <stdio.h>
 #include "../../../misc/lv_lru.h"
+#include "../../../draw/sw/lv_draw_sw_glyph_cache.h"
 
 #define STB_RECT_PACK_IMPLEMENTATION
 #define STBRP_STATIC
@@ -268,6 +269,10 @@ void lv_tiny_ttf_set_size(lv_font_t * font, lv_coord_t font_size)
 void lv_tiny_ttf_destroy(lv_font_t * font)
 {
     if(font != NULL) {
+#if LV_USE_GLYPH_CACHE
+        /*The address of the font might be reused by a new font*/
+        lv_draw_sw_glyph_cache_invalidate();
+#endif
         if(font->dsc != NULL) {
             ttf_font_desc_t * ttf = (ttf_font_desc_t *)font->dsc;
 #if LV_TINY_TTF_FILE_SUPPORT
@@ -356,6 +356,17 @@
     #endif
 #endif
 
+/*Memory budget of the image cache [bytes]. If not 0 (and LV_IMG_CACHE_DEF_SIZE > 0) the decoded images
+ *are stored in a dedicated arena of this size and the least recently used images are closed when it's full.
+ *Images which could be read only line-by-line (e.g. SJPG, indexed or file images) are decoded once into the arena.*/
+#ifndef LV_IMG_CACHE_MEM_SIZE
+    #ifdef CONFIG_LV_IMG_CACHE_MEM_SIZE
+        #define LV_IMG_CACHE_MEM_SIZE CONFIG_LV_IMG_CACHE_MEM_SIZE
+    #else
+        #define LV_IMG_CACHE_MEM_SIZE 0
+    #endif
+#endif
+
 /*Number of stops allowed per gradient. Increase this to allow more stops.
  *This adds (sizeof(lv_color_t) + 1) bytes per additional stop*/
 #ifndef LV_GRADIENT_MAX_STOPS
@@ -549,6 +560,16 @@
     #endif
 #endif
 
+/*Use SSE2 fill/blend/copy kernels in the software renderer (x86, LV_COLOR_DEPTH 32).
+ *Selected at runtime with CPUID, falls back to the scalar code otherwise*/
+#ifndef LV_USE_DRAW_SW_SSE2
+    #ifdef CONFIG_LV_USE_DRAW_SW_SSE2
+        #define LV_USE_DRAW_SW_SSE2 CONFIG_LV_USE_DRAW_SW_SSE2
+    #else
+        #define LV_USE_DRAW_SW_SSE2 0
+    #endif
+#endif
+
 /*-------------
  * Logging
  *-----------*/
@@ -1261,6 +1282,26 @@
     #endif
 #endif
 
+/*Cache rendered glyphs (1 byte opacity per pixel) in the software renderer so that
+ *redrawing a text doesn't unpack, decompress or rasterize the same glyph again.
+ *The cache is allocated from the LVGL heap, see LV_MEM_SIZE*/
+#ifndef LV_USE_GLYPH_CACHE
+    #ifdef CONFIG_LV_USE_GLYPH_CACHE
+        #define LV_USE_GLYPH_CACHE CONFIG_LV_USE_GLYPH_CACHE
+    #else
+        #define LV_USE_GLYPH_CACHE 0
+    #endif
+#endif
+#if LV_USE_GLYPH_CACHE
+    #ifndef LV_GLYPH_CACHE_SIZE
+        #ifdef CONFIG_LV_GLYPH_CACHE_SIZE
+            #define LV_GLYPH_CACHE_SIZE CONFIG_LV_GLYPH_CACHE_SIZE
+        #else
+            #define LV_GLYPH_CACHE_SIZE (8U * 1024U)   /*[bytes] of glyph data*/
+        #endif
+    #endif
+#endif
+
 /*=================
  *  TEXT SETTINGS
  *=================*/
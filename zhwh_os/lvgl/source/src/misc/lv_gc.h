@@ -59,6 +59,7 @@ extern "C" {
     LV_DISPATCH(f, void * , _lv_theme_default_styles)                                                  \
     LV_DISPATCH(f, void * , _lv_theme_basic_styles)                                                  \
     LV_DISPATCH_COND(f, uint8_t *, _lv_font_decompr_buf, LV_USE_FONT_COMPRESSED, 1)                    \
+    LV_DISPATCH_COND(f, struct lv_lru_t *, _lv_glyph_cache, LV_USE_GLYPH_CACHE, 1)                      \
     LV_DISPATCH(f, uint8_t * , _lv_grad_cache_mem)                                                     \
     LV_DISPATCH(f, uint8_t * , _lv_style_custom_prop_flag_lookup_table)
 
@@ -154,3 +154,14 @@ mpinit(void)
     outb(0x23, inb(0x23) | 1);  // Mask external interrupts.
   }
 }
+
+/**
+ * @brief 第 n 个 CPU 的 LAPIC ID（中断亲和性用）
+ * @return CPU 不存在或还没启动时返回 -1，调用者应退回到 BSP
+ */
+int mp_cpu_apicid(int n) {
+  if (n < 0 || n >= ncpu || !cpus[n].started) {
+    return -1;
+  }
+  return cpus[n].apicid;
+}
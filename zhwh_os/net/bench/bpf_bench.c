@@ -0,0 +1,358 @@
+/**
+ * @file bpf_bench.c
+ * @brief 经典 BPF 校验器 / 解释器主机测试和基准
+ *
+ * 把 net/bpf.c 原样编译进主机程序：
+ *
+ * 1. 校验器：合法程序通过；越界跳转、非法操作码、M[] 先读后写（包括只在
+ *    一条分支上写过）、常量除 0、移位 >= 32、最后一条不是 ret 等都被拒绝
+ * 2. 解释器：两个过滤程序在随机帧上的结果与等价的 C 代码逐包比对
+ *    - 风暴过滤：只收 IPv4 单播和问本机的 ARP（后者放进优先队列），其余丢弃
+ *    - "udp dst port 53"：tcpdump -dd 的写法（分片检查 + ldxb 4*([14]&0xf)）
+ *    包括截短的帧（越界读必须丢弃）
+ * 3. 性能：每个程序 ns/包，对比手写 C 判断和"先拷一份 netbuf 再判断"的旧路径
+ *
+ * 用法：./bpf_bench [迭代次数]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bpf.h"
+
+#define ETH_P_IP    0x0800
+#define ETH_P_ARP   0x0806
+#define ETH_P_IPV6  0x86DD
+#define OUR_IP      0x0A00020Fu     // 10.0.2.15
+
+// ==================== 过滤程序 ====================
+
+static const sock_filter_t storm_filter[] = {
+    /* 0 */ BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+    /* 1 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_ARP, 4, 0),     // -> 6
+    /* 2 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 5),      // -> 8
+    /* 3 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+    /* 4 */ BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x01, 3, 0),         // 组播 / 广播 -> 8
+    /* 5 */ BPF_STMT(BPF_RET | BPF_K, BPF_RET_ACCEPT),
+    /* 6 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 38),                   // ARP 目标 IP
+    /* 7 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, OUR_IP, 1, 0),        // -> 9
+    /* 8 */ BPF_STMT(BPF_RET | BPF_K, BPF_RET_DROP),
+    /* 9 */ BPF_STMT(BPF_RET | BPF_K, BPF_RET_QUEUE(1)),
+};
+
+static const sock_filter_t dns_filter[] = {
+    /* 0 */ BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+    /* 1 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 8),      // -> 10
+    /* 2 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+    /* 3 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 17, 0, 6),            // -> 10
+    /* 4 */ BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+    /* 5 */ BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1FFF, 4, 0),       // 非首片 -> 10
+    /* 6 */ BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+    /* 7 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+    /* 8 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 53, 0, 1),            // -> 10
+    /* 9 */ BPF_STMT(BPF_RET | BPF_K, BPF_RET_ACCEPT),
+    /* 10 */ BPF_STMT(BPF_RET | BPF_K, BPF_RET_DROP),
+};
+
+#define PROG_LEN(p) ((uint32_t)(sizeof(p) / sizeof((p)[0])))
+
+// ==================== 等价的 C 实现 ====================
+
+static uint32_t rd16(const uint8_t *p) {
+    return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return (rd16(p) << 16) | rd16(p + 2);
+}
+
+static uint32_t storm_ref(const uint8_t *pkt, uint32_t len) {
+    if (len < 14) {
+        return BPF_RET_DROP;
+    }
+    uint32_t type = rd16(pkt + 12);
+    if (type == ETH_P_ARP) {
+        if (len < 42) {
+            return BPF_RET_DROP;
+        }
+        return rd32(pkt + 38) == OUR_IP ? BPF_RET_QUEUE(1) : BPF_RET_DROP;
+    }
+    if (type != ETH_P_IP || (pkt[0] & 1)) {
+        return BPF_RET_DROP;
+    }
+    return BPF_RET_ACCEPT;
+}
+
+static uint32_t dns_ref(const uint8_t *pkt, uint32_t len) {
+    if (len < 24 || rd16(pkt + 12) != ETH_P_IP || pkt[23] != 17 ||
+        (rd16(pkt + 20) & 0x1FFF)) {
+        return BPF_RET_DROP;
+    }
+    uint32_t off = 14 + ((pkt[14] & 0xF) << 2) + 2;
+    if (off + 2 > len) {
+        return BPF_RET_DROP;
+    }
+    return rd16(pkt + off) == 53 ? BPF_RET_ACCEPT : BPF_RET_DROP;
+}
+
+// ==================== 随机帧 ====================
+
+static uint32_t rnd_state = 2463534242u;
+
+static uint32_t rnd(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void wr16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/**
+ * @brief 生成一个随机帧：以太网类型、目的 MAC、IP 头长度、协议、端口、
+ *        分片偏移、ARP 目标都偏向会命中过滤条件的取值；长度偶尔截短
+ */
+static uint32_t random_frame(uint8_t *pkt) {
+    static const uint32_t types[] = { ETH_P_IP, ETH_P_IP, ETH_P_ARP, ETH_P_IPV6, 0x88CC, 0x9000 };
+    uint32_t len = 60 + rnd() % (1514 - 60 + 1);
+
+    for (uint32_t i = 0; i < len; i++) {
+        pkt[i] = (uint8_t)rnd();
+    }
+    if (rnd() & 1) {
+        memset(pkt, 0xFF, 6);           // 广播
+    } else {
+        pkt[0] &= ~1;                   // 单播
+    }
+    wr16(pkt + 12, types[rnd() % 6]);
+
+    pkt[14] = 0x40 | (5 + rnd() % 11);  // IHL 5..15
+    if (rnd() & 1) {
+        pkt[23] = 17;
+    }
+    if (rnd() & 1) {
+        wr16(pkt + 20, 0x4000);         // DF，非分片
+    }
+    uint32_t udp = 14 + ((pkt[14] & 0xF) << 2);
+    if ((rnd() & 1) && udp + 4 <= len) {
+        wr16(pkt + udp + 2, 53);
+    }
+    if (rnd() & 1) {
+        pkt[38] = 10; pkt[39] = 0; pkt[40] = 2; pkt[41] = 15;
+    }
+
+    // 截短：覆盖各个越界读
+    if ((rnd() & 7) == 0) {
+        len = rnd() % 80;
+    }
+    return len;
+}
+
+// ==================== 校验器 ====================
+
+typedef struct {
+    const char *name;
+    sock_filter_t insns[6];
+    uint32_t len;
+    int ok;                     // 期望结果：1 通过，0 拒绝
+} check_case_t;
+
+static const check_case_t check_cases[] = {
+    { "ret k", { BPF_STMT(BPF_RET | BPF_K, 0) }, 1, 1 },
+    { "empty", { BPF_STMT(BPF_RET | BPF_K, 0) }, 0, 0 },
+    { "no trailing ret", { BPF_STMT(BPF_LD | BPF_IMM, 1) }, 1, 0 },
+    { "bad opcode", { BPF_STMT(0xFF, 0), BPF_STMT(BPF_RET | BPF_K, 0) }, 2, 0 },
+    { "ld size 0x18", { BPF_STMT(BPF_LD | 0x18 | BPF_ABS, 0), BPF_STMT(BPF_RET | BPF_A, 0) }, 2, 0 },
+    { "ja past end", { BPF_STMT(BPF_JMP | BPF_JA, 1), BPF_STMT(BPF_RET | BPF_K, 0) }, 2, 0 },
+    { "ja huge k", { BPF_STMT(BPF_JMP | BPF_JA, 0xFFFFFFFF), BPF_STMT(BPF_RET | BPF_K, 0) }, 2, 0 },
+    { "jeq jt past end",
+      { BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0), BPF_STMT(BPF_RET | BPF_K, 0) }, 2, 0 },
+    { "div by k=0", { BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 0), BPF_STMT(BPF_RET | BPF_A, 0) }, 2, 0 },
+    { "mod by k=0", { BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, 0), BPF_STMT(BPF_RET | BPF_A, 0) }, 2, 0 },
+    { "lsh 32", { BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 32), BPF_STMT(BPF_RET | BPF_A, 0) }, 2, 0 },
+    { "neg x", { BPF_STMT(BPF_ALU | BPF_NEG | BPF_X, 0), BPF_STMT(BPF_RET | BPF_A, 0) }, 2, 0 },
+    { "st M[16]", { BPF_STMT(BPF_ST, 16), BPF_STMT(BPF_RET | BPF_K, 0) }, 2, 0 },
+    { "ld M[0] unwritten", { BPF_STMT(BPF_LD | BPF_MEM, 0), BPF_STMT(BPF_RET | BPF_A, 0) }, 2, 0 },
+    { "st then ld M[3]",
+      { BPF_STMT(BPF_ST, 3), BPF_STMT(BPF_LDX | BPF_MEM, 3), BPF_STMT(BPF_RET | BPF_A, 0) }, 3, 1 },
+    // 只有条件成立的分支写了 M[1]，汇合后读它必须拒绝
+    { "M[1] on one branch",
+      { BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1), BPF_STMT(BPF_ST, 1),
+        BPF_STMT(BPF_LD | BPF_MEM, 1), BPF_STMT(BPF_RET | BPF_A, 0) }, 4, 0 },
+    // 两条分支都写了 M[1]
+    { "M[1] on both branches",
+      { BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2), BPF_STMT(BPF_ST, 1),
+        BPF_STMT(BPF_JMP | BPF_JA, 1), BPF_STMT(BPF_STX, 1),
+        BPF_STMT(BPF_LD | BPF_MEM, 1), BPF_STMT(BPF_RET | BPF_A, 0) }, 6, 1 },
+    { "ret x", { BPF_STMT(BPF_RET | BPF_X, 0) }, 1, 0 },
+};
+
+static int check_verifier(void) {
+    int fails = 0;
+
+    for (uint32_t i = 0; i < sizeof(check_cases) / sizeof(check_cases[0]); i++) {
+        const check_case_t *c = &check_cases[i];
+        int ok = bpf_check(c->insns, c->len) == 0;
+        if (ok != c->ok) {
+            printf("VERIFIER MISMATCH '%s': expected %s\n", c->name, c->ok ? "accept" : "reject");
+            fails++;
+        }
+    }
+
+    static sock_filter_t big[BPF_MAXINSNS + 1];
+    for (int i = 0; i <= BPF_MAXINSNS; i++) {
+        big[i] = (sock_filter_t)BPF_STMT(BPF_RET | BPF_K, 0);
+    }
+    if (bpf_check(big, BPF_MAXINSNS) != 0 || bpf_check(big, BPF_MAXINSNS + 1) == 0) {
+        printf("VERIFIER MISMATCH: BPF_MAXINSNS limit\n");
+        fails++;
+    }
+    if (bpf_check(storm_filter, PROG_LEN(storm_filter)) != 0 ||
+        bpf_check(dns_filter, PROG_LEN(dns_filter)) != 0) {
+        printf("VERIFIER MISMATCH: sample filters rejected\n");
+        fails++;
+    }
+    return fails;
+}
+
+// ==================== 解释器 ====================
+
+static int check_interp(void) {
+    static uint8_t pkt[1514];
+    int fails = 0;
+    uint32_t storm_drops = 0, dns_hits = 0;
+
+    for (int it = 0; it < 500000 && fails < 10; it++) {
+        uint32_t len = random_frame(pkt);
+
+        uint32_t a = bpf_run(storm_filter, pkt, len);
+        uint32_t b = storm_ref(pkt, len);
+        if (a != b) {
+            printf("STORM MISMATCH len=%u bpf=%08x ref=%08x\n", len, a, b);
+            fails++;
+        }
+        storm_drops += (a == BPF_RET_DROP);
+
+        a = bpf_run(dns_filter, pkt, len);
+        b = dns_ref(pkt, len);
+        if (a != b) {
+            printf("DNS MISMATCH len=%u bpf=%08x ref=%08x\n", len, a, b);
+            fails++;
+        }
+        dns_hits += (a != BPF_RET_DROP);
+    }
+
+    // 算术 / 暂存 / 除 0：A = (len * 3 + 7) / X，X = 0 时返回 0
+    static const sock_filter_t alu[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 3),
+        BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 7),
+        BPF_STMT(BPF_ST, 5),
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),        // X = pkt[0]
+        BPF_STMT(BPF_LD | BPF_MEM, 5),
+        BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    if (bpf_check(alu, PROG_LEN(alu)) != 0) {
+        printf("ALU program rejected\n");
+        return fails + 1;
+    }
+    for (uint32_t x = 0; x < 256; x++) {
+        pkt[0] = (uint8_t)x;
+        uint32_t want = x ? (100 * 3 + 7) / x : 0;
+        uint32_t got = bpf_run(alu, pkt, 100);
+        if (got != want) {
+            printf("ALU MISMATCH x=%u got=%u want=%u\n", x, got, want);
+            fails++;
+        }
+    }
+
+    printf("    storm filter dropped %u / 500000, dns filter matched %u\n", storm_drops, dns_hits);
+    return fails;
+}
+
+// ==================== 性能 ====================
+
+// 内核 string.c 的 memcpy（逐字节），旧路径丢包前就是用它把整帧拷进 netbuf
+static void __attribute__((noinline)) kernel_memcpy(void *dest_, const void *src_, uint32_t len) {
+    uint8_t *dest = dest_;
+    const uint8_t *src = src_;
+    for (; len != 0; len--) *dest++ = *src++;
+}
+
+#define BENCH_FRAMES 1024
+
+static void bench(int iters) {
+    static uint8_t frames[BENCH_FRAMES][1514];
+    static uint32_t lens[BENCH_FRAMES];
+    static uint8_t copy[1514];
+    volatile uint32_t sink = 0;
+
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        lens[i] = random_frame(frames[i]);
+    }
+
+    struct {
+        const char *name;
+        const sock_filter_t *prog;
+        uint32_t (*ref)(const uint8_t *, uint32_t);
+    } progs[] = {
+        { "storm", storm_filter, storm_ref },
+        { "udp dst 53", dns_filter, dns_ref },
+    };
+
+    printf("%-12s %10s %10s %14s\n", "filter", "bpf ns", "C ns", "copy+C ns");
+    for (int p = 0; p < 2; p++) {
+        double t0 = now_ns();
+        for (int i = 0; i < iters; i++) {
+            int f = i & (BENCH_FRAMES - 1);
+            sink += bpf_run(progs[p].prog, frames[f], lens[f]);
+        }
+        double t1 = now_ns();
+        for (int i = 0; i < iters; i++) {
+            int f = i & (BENCH_FRAMES - 1);
+            sink += progs[p].ref(frames[f], lens[f]);
+        }
+        double t2 = now_ns();
+        // 旧路径：不管要不要，先整帧拷进 netbuf 再判断
+        for (int i = 0; i < iters; i++) {
+            int f = i & (BENCH_FRAMES - 1);
+            kernel_memcpy(copy, frames[f], lens[f]);
+            sink += progs[p].ref(copy, lens[f]);
+        }
+        double t3 = now_ns();
+
+        printf("%-12s %10.1f %10.1f %14.1f\n", progs[p].name,
+               (t1 - t0) / iters, (t2 - t1) / iters, (t3 - t2) / iters);
+    }
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    int iters = argc > 1 ? atoi(argv[1]) : 2000000;
+
+    int fails = check_verifier();
+    printf("%s: verifier, %d mismatches\n", fails ? "FAIL" : "OK", fails);
+    int interp_fails = check_interp();
+    printf("%s: interpreter vs C reference, %d mismatches\n",
+           interp_fails ? "FAIL" : "OK", interp_fails);
+    if (fails || interp_fails) {
+        return 1;
+    }
+
+    bench(iters);
+    return 0;
+}
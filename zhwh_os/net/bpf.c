@@ -0,0 +1,301 @@
+/**
+ * @file bpf.c
+ * @brief 经典 BPF 校验器和解释器
+ *
+ * 校验在加载时一次做完，解释器里就不再检查操作码、跳转目标和 M[] 下标，
+ * 只剩包数据的越界检查。
+ */
+
+#include "bpf.h"
+
+// 包数据按网络字节序读取（越界由调用者检查）
+static inline uint32_t bpf_load_w(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t bpf_load_h(const uint8_t *p) {
+    return ((uint32_t)p[0] << 8) | p[1];
+}
+
+// ld / ldx 的 ABS、IND 访问宽度
+static uint32_t bpf_size_bytes(uint16_t code) {
+    switch (BPF_SIZE(code)) {
+    case BPF_W: return 4;
+    case BPF_H: return 2;
+    case BPF_B: return 1;
+    default:    return 0;
+    }
+}
+
+/**
+ * @brief 单条指令的静态检查（不含 M[] 先写后读）
+ */
+static int bpf_check_insn(const sock_filter_t *in, uint32_t pc, uint32_t len) {
+    uint16_t code = in->code;
+
+    if (code > 0xFF) {
+        return -1;
+    }
+    switch (BPF_CLASS(code)) {
+    case BPF_LD:
+        switch (BPF_MODE(code)) {
+        case BPF_ABS:
+        case BPF_IND:
+            return bpf_size_bytes(code) ? 0 : -1;
+        case BPF_IMM:
+        case BPF_LEN:
+            return BPF_SIZE(code) == BPF_W ? 0 : -1;
+        case BPF_MEM:
+            return (BPF_SIZE(code) == BPF_W && in->k < BPF_MEMWORDS) ? 0 : -1;
+        default:
+            return -1;
+        }
+
+    case BPF_LDX:
+        switch (BPF_MODE(code)) {
+        case BPF_IMM:
+        case BPF_LEN:
+            return BPF_SIZE(code) == BPF_W ? 0 : -1;
+        case BPF_MEM:
+            return (BPF_SIZE(code) == BPF_W && in->k < BPF_MEMWORDS) ? 0 : -1;
+        case BPF_MSH:
+            return BPF_SIZE(code) == BPF_B ? 0 : -1;
+        default:
+            return -1;
+        }
+
+    case BPF_ST:
+    case BPF_STX:
+        return (code == BPF_CLASS(code) && in->k < BPF_MEMWORDS) ? 0 : -1;
+
+    case BPF_ALU:
+        switch (BPF_OP(code)) {
+        case BPF_ADD: case BPF_SUB: case BPF_MUL:
+        case BPF_OR:  case BPF_AND: case BPF_XOR:
+            return 0;
+        case BPF_DIV:
+        case BPF_MOD:
+            // 常量除数在这里拒绝 0；X 为 0 时运行时返回 0
+            return (BPF_SRC(code) == BPF_X || in->k != 0) ? 0 : -1;
+        case BPF_LSH:
+        case BPF_RSH:
+            return (BPF_SRC(code) == BPF_X || in->k < 32) ? 0 : -1;
+        case BPF_NEG:
+            return BPF_SRC(code) == BPF_K ? 0 : -1;
+        default:
+            return -1;
+        }
+
+    case BPF_JMP:
+        if (BPF_OP(code) == BPF_JA) {
+            if (BPF_SRC(code) != BPF_K) {
+                return -1;
+            }
+            // k 是 32 位，先和剩余指令数比较，避免 pc + 1 + k 回绕
+            return in->k < len - pc - 1 ? 0 : -1;
+        }
+        switch (BPF_OP(code)) {
+        case BPF_JEQ: case BPF_JGT: case BPF_JGE: case BPF_JSET:
+            break;
+        default:
+            return -1;
+        }
+        return (pc + 1 + in->jt < len && pc + 1 + in->jf < len) ? 0 : -1;
+
+    case BPF_RET:
+        return (code == (BPF_RET | BPF_K) || code == (BPF_RET | BPF_A)) ? 0 : -1;
+
+    case BPF_MISC:
+        return (code == (BPF_MISC | BPF_TAX) || code == (BPF_MISC | BPF_TXA)) ? 0 : -1;
+    }
+    return -1;
+}
+
+/**
+ * @brief 校验程序
+ *
+ * 跳转只能向前，所以按指令顺序走一遍就能算出每条指令入口处"哪些 M[] 一定写过"：
+ * 各条到达路径取交集，读没写过的 M[] 就拒绝（否则会读到上一个包留下的值）。
+ */
+int bpf_check(const sock_filter_t *insns, uint32_t len) {
+    if (!insns || len == 0 || len > BPF_MAXINSNS) {
+        return BPF_ERR_INVAL;
+    }
+    if (BPF_CLASS(insns[len - 1].code) != BPF_RET) {
+        return BPF_ERR_INVAL;
+    }
+
+    uint16_t masks[BPF_MAXINSNS];
+    for (uint32_t pc = 0; pc < len; pc++) {
+        masks[pc] = 0xFFFF;
+    }
+
+    uint16_t memvalid = 0;
+    for (uint32_t pc = 0; pc < len; pc++) {
+        const sock_filter_t *in = &insns[pc];
+        if (bpf_check_insn(in, pc, len) < 0) {
+            return BPF_ERR_INVAL;
+        }
+
+        memvalid &= masks[pc];
+        switch (BPF_CLASS(in->code)) {
+        case BPF_ST:
+        case BPF_STX:
+            memvalid |= 1u << in->k;
+            break;
+        case BPF_LD:
+        case BPF_LDX:
+            if (BPF_MODE(in->code) == BPF_MEM && !(memvalid & (1u << in->k))) {
+                return BPF_ERR_INVAL;
+            }
+            break;
+        case BPF_JMP:
+            if (BPF_OP(in->code) == BPF_JA) {
+                masks[pc + 1 + in->k] &= memvalid;
+            } else {
+                masks[pc + 1 + in->jt] &= memvalid;
+                masks[pc + 1 + in->jf] &= memvalid;
+            }
+            // 下一条只能从跳转到达
+            memvalid = 0xFFFF;
+            break;
+        case BPF_RET:
+            memvalid = 0xFFFF;
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 执行程序（必须已通过 bpf_check）
+ */
+uint32_t bpf_run(const sock_filter_t *insns, const uint8_t *pkt, uint32_t len) {
+    uint32_t A = 0, X = 0;
+    uint32_t M[BPF_MEMWORDS];
+    const sock_filter_t *in = insns;
+
+    for (;; in++) {
+        uint32_t k = in->k;
+        uint32_t off, size;
+
+        switch (in->code) {
+        // ---- 取包数据 ----
+        case BPF_LD | BPF_W | BPF_ABS:
+        case BPF_LD | BPF_H | BPF_ABS:
+        case BPF_LD | BPF_B | BPF_ABS:
+            off = k;
+            goto load;
+        case BPF_LD | BPF_W | BPF_IND:
+        case BPF_LD | BPF_H | BPF_IND:
+        case BPF_LD | BPF_B | BPF_IND:
+            off = X + k;
+            if (off < X) {
+                return 0;
+            }
+        load:
+            size = bpf_size_bytes(in->code);
+            if (off >= len || len - off < size) {
+                return 0;
+            }
+            A = size == 4 ? bpf_load_w(pkt + off)
+              : size == 2 ? bpf_load_h(pkt + off)
+              : pkt[off];
+            break;
+        case BPF_LD | BPF_W | BPF_LEN:
+            A = len;
+            break;
+        case BPF_LDX | BPF_W | BPF_LEN:
+            X = len;
+            break;
+        case BPF_LD | BPF_IMM:
+            A = k;
+            break;
+        case BPF_LDX | BPF_IMM:
+            X = k;
+            break;
+        case BPF_LD | BPF_MEM:
+            A = M[k];
+            break;
+        case BPF_LDX | BPF_MEM:
+            X = M[k];
+            break;
+        case BPF_LDX | BPF_B | BPF_MSH:
+            if (k >= len) {
+                return 0;
+            }
+            X = (pkt[k] & 0xF) << 2;
+            break;
+        case BPF_ST:
+            M[k] = A;
+            break;
+        case BPF_STX:
+            M[k] = X;
+            break;
+
+        // ---- 运算 ----
+        case BPF_ALU | BPF_ADD | BPF_K: A += k; break;
+        case BPF_ALU | BPF_ADD | BPF_X: A += X; break;
+        case BPF_ALU | BPF_SUB | BPF_K: A -= k; break;
+        case BPF_ALU | BPF_SUB | BPF_X: A -= X; break;
+        case BPF_ALU | BPF_MUL | BPF_K: A *= k; break;
+        case BPF_ALU | BPF_MUL | BPF_X: A *= X; break;
+        case BPF_ALU | BPF_DIV | BPF_K: A /= k; break;
+        case BPF_ALU | BPF_DIV | BPF_X:
+            if (X == 0) {
+                return 0;
+            }
+            A /= X;
+            break;
+        case BPF_ALU | BPF_MOD | BPF_K: A %= k; break;
+        case BPF_ALU | BPF_MOD | BPF_X:
+            if (X == 0) {
+                return 0;
+            }
+            A %= X;
+            break;
+        case BPF_ALU | BPF_OR | BPF_K:  A |= k; break;
+        case BPF_ALU | BPF_OR | BPF_X:  A |= X; break;
+        case BPF_ALU | BPF_AND | BPF_K: A &= k; break;
+        case BPF_ALU | BPF_AND | BPF_X: A &= X; break;
+        case BPF_ALU | BPF_XOR | BPF_K: A ^= k; break;
+        case BPF_ALU | BPF_XOR | BPF_X: A ^= X; break;
+        case BPF_ALU | BPF_LSH | BPF_K: A <<= k; break;
+        case BPF_ALU | BPF_LSH | BPF_X: A = X < 32 ? A << X : 0; break;
+        case BPF_ALU | BPF_RSH | BPF_K: A >>= k; break;
+        case BPF_ALU | BPF_RSH | BPF_X: A = X < 32 ? A >> X : 0; break;
+        case BPF_ALU | BPF_NEG:         A = -A; break;
+
+        // ---- 跳转（只向前） ----
+        case BPF_JMP | BPF_JA:
+            in += k;
+            break;
+        case BPF_JMP | BPF_JEQ | BPF_K:  in += (A == k) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JEQ | BPF_X:  in += (A == X) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JGT | BPF_K:  in += (A > k) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JGT | BPF_X:  in += (A > X) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JGE | BPF_K:  in += (A >= k) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JGE | BPF_X:  in += (A >= X) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JSET | BPF_K: in += (A & k) ? in->jt : in->jf; break;
+        case BPF_JMP | BPF_JSET | BPF_X: in += (A & X) ? in->jt : in->jf; break;
+
+        // ---- 返回 ----
+        case BPF_RET | BPF_K:
+            return k;
+        case BPF_RET | BPF_A:
+            return A;
+
+        case BPF_MISC | BPF_TAX:
+            X = A;
+            break;
+        case BPF_MISC | BPF_TXA:
+            A = X;
+            break;
+
+        default:
+            // 校验过的程序不会走到这里
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,278 @@
+/**
+ * @file bypass.c
+ * @brief 内核旁路：网卡收发环映射给用户进程，fd 关闭时交还协议栈
+ *
+ * 区域用 pmm_alloc_pages 分配（普通内存，网卡直接 DMA），第一次旁路时分配，
+ * 之后一直保留给下一次用；内核通过 phys_to_virt / map_highmem_physical 访问。
+ * 和抓包环一样映射在内核页目录里、登记成 usermap，只有发起旁路的进程运行时
+ * 才带 PTE_U。用户写的描述符能让网卡 DMA 到任意物理地址，所以只给特权进程；
+ * 结束旁路时把用户映射（尤其是门铃寄存器）全部撤掉。
+ *
+ * 同一时间只有一个旁路：用户映射的地址是固定的。
+ */
+
+#include "net.h"
+#include "bypass.h"
+#include "mm.h"
+#include "highmem_mapping.h"
+#include "lapic.h"
+#include "usermap.h"
+#include "printf.h"
+#include "string.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+extern uint32_t kernel_page_directory_phys;
+extern void map_page(uint32_t pde_phys, uint32_t vaddr, uint32_t paddr, uint32_t flags);
+extern task_t *current_task[];
+
+#define BYPASS_MAP_PTE      0x3     // PTE_P | PTE_W；PTE_U 由 usermap 只给属主打开
+#define BYPASS_MMIO_PTE     0x1B    // 再加 PWT | PCD：寄存器不能走缓存
+#define BYPASS_WAIT_MS      1000    // read 最多等这么久，没有中断返回 0
+
+static int bypass_file_close(file_t *file);
+static int bypass_file_read(file_t *file, char *buf, uint32_t size);
+
+static file_operations_t bypass_fops = {
+    .close = bypass_file_close,
+    .read  = bypass_file_read,
+};
+
+static net_bypass_t bypass;
+static usermap_t bypass_map_user;       // 数据区 + 门铃页，属主是 bypass.pid
+static uint8_t *region = NULL;          // 内核访问区域的地址，分配后不释放
+static uint32_t region_pa = 0;
+
+static inline uint32_t bypass_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void bypass_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static int bypass_region_alloc(void) {
+    uint32_t size = NET_BYPASS_PAGES * PAGE_SIZE;
+    uint32_t pa = pmm_alloc_pages(NET_BYPASS_PAGES);
+    if (!pa) {
+        return -12;
+    }
+
+    uint8_t *kva;
+    if (pa + size <= 0x800000) {
+        kva = (uint8_t *)phys_to_virt(pa);
+    } else {
+        kva = (uint8_t *)map_highmem_physical(pa, size, 0x3);
+    }
+    if (!kva) {
+        pmm_free_pages(pa, NET_BYPASS_PAGES);
+        return -12;
+    }
+    region = kva;
+    region_pa = pa;
+    return 0;
+}
+
+// 清空区域并填好和驱动无关的字段
+static void bypass_region_reset(net_device_t *dev) {
+    memset(region, 0, NET_BYPASS_PAGES * PAGE_SIZE);
+
+    net_bypass_info_t *info = (net_bypass_info_t *)region;
+    info->magic = NET_BYPASS_MAGIC;
+    memcpy(info->ifname, dev->name, sizeof(info->ifname));
+    info->ifname[sizeof(info->ifname) - 1] = '\0';
+    memcpy(info->mac, dev->mac_addr, ETH_ALEN);
+    info->mtu = dev->mtu;
+    info->dma_base = region_pa;
+    info->rx_ring_offset = PAGE_SIZE;
+    info->tx_ring_offset = PAGE_SIZE + NET_BYPASS_RING_SIZE;
+    info->buf_offset = PAGE_SIZE + 2 * NET_BYPASS_RING_SIZE;
+    info->buf_size = NET_BYPASS_BUF_SIZE;
+    info->buf_nr = NET_BYPASS_BUF_NR;
+    info->doorbell_offset = NET_BYPASS_PAGES * PAGE_SIZE;
+}
+
+static void bypass_map(uint32_t va, uint32_t pa, uint32_t pages, uint32_t flags) {
+    for (uint32_t i = 0; i < pages; i++) {
+        map_page(kernel_page_directory_phys, va + i * PAGE_SIZE, pa + i * PAGE_SIZE, flags);
+        __asm__ volatile("invlpg (%0)" : : "r"(va + i * PAGE_SIZE) : "memory");
+    }
+}
+
+// 清掉 PTE（页表留着，下次旁路复用）
+static void bypass_unmap(uint32_t va, uint32_t pages) {
+    uint32_t *pd = (uint32_t *)phys_to_virt(kernel_page_directory_phys);
+
+    for (uint32_t i = 0; i < pages; i++) {
+        uint32_t a = va + i * PAGE_SIZE;
+        uint32_t pde = pd[a >> 22];
+        if (!(pde & PTE_P)) {
+            continue;
+        }
+        uint32_t *pt = (uint32_t *)phys_to_virt(pde & ~0xFFF);
+        pt[(a >> 12) & 0x3FF] = 0;
+        __asm__ volatile("invlpg (%0)" : : "r"(a) : "memory");
+    }
+}
+
+static void bypass_unmap_all(void) {
+    bypass_unmap(NET_BYPASS_VADDR, NET_BYPASS_PAGES + NET_BYPASS_DOORBELL_MAX);
+}
+
+/**
+ * @brief 驱动收到接收中断（已屏蔽 RX 中断）：记一次通知，等 read 取走
+ */
+void net_bypass_notify(net_device_t *dev) {
+    net_bypass_t *bp = dev->bypass;
+    if (!bp) {
+        return;
+    }
+    bp->pending++;
+    bp->info->irq_count++;
+}
+
+// 以下条件在关中断状态下由 clock_wait_event 调用
+static int bypass_notified(void *arg) {
+    return ((net_bypass_t *)arg)->pending != 0;
+}
+
+/**
+ * @brief read(fd)：打开接收中断等通知，返回 4 字节的通知次数（超时为 0）
+ */
+static int bypass_file_read(file_t *file, char *buf, uint32_t size) {
+    net_bypass_t *bp = (net_bypass_t *)file->f_private;
+    net_device_t *dev = bp->dev;
+
+    if (size < sizeof(uint32_t)) {
+        return -22;
+    }
+
+    uint32_t flags = bypass_lock();
+    if (!bp->pending) {
+        dev->bypass_irq(dev, 1);
+    }
+    bypass_unlock(flags);
+
+    clock_wait_event(clock_ms() + BYPASS_WAIT_MS, bypass_notified, bp);
+
+    flags = bypass_lock();
+    uint32_t n = bp->pending;
+    bp->pending = 0;
+    bypass_unlock(flags);
+
+    memcpy(buf, &n, sizeof(n));
+    return sizeof(n);
+}
+
+/**
+ * @brief 最后一次 close（或进程退出）：驱动换回自己的环，撤掉用户映射
+ */
+static int bypass_file_close(file_t *file) {
+    net_bypass_t *bp = (net_bypass_t *)file->f_private;
+    net_device_t *dev = bp->dev;
+
+    uint32_t flags = bypass_lock();
+    dev->bypass_detach(dev);
+    dev->bypass = NULL;
+    bp->dev = NULL;
+    bypass_unlock(flags);
+
+    usermap_del(&bypass_map_user);
+    bypass_unmap_all();
+    printf("[bypass] %s returned to the kernel stack (pid %d, %u notifications)\n",
+           dev->name, bp->pid, bp->info->irq_count);
+
+    // 旁路期间 qdisc 里攒下的包继续发
+    net_tx_wake(dev);
+    return 0;
+}
+
+/**
+ * @brief SYS_NET_BYPASS：把网卡的收发环交给当前进程
+ * @return fd；-1 不是特权进程，-19 没有设备，-95 驱动不支持，-16 已有旁路，
+ *         -12 内存不足，-24 文件表满
+ */
+int sys_net_bypass(const char *ifname) {
+    task_t *task = current_task[logical_cpu_id()];
+
+    if (!ifname) {
+        return -22;
+    }
+    if (!task || !task_privileged()) {
+        return -1;
+    }
+
+    char name[16];
+    strncpy(name, ifname, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    net_device_t *dev = net_device_get(name);
+    if (!dev) {
+        return -19;
+    }
+    if (!dev->bypass_attach || !dev->bypass_detach || !dev->bypass_irq) {
+        return -95;
+    }
+
+    uint32_t flags = bypass_lock();
+    if (bypass.dev) {
+        bypass_unlock(flags);
+        return -16;
+    }
+    bypass.dev = dev;           // 先占住，区域分配和映射在开中断下做
+    bypass_unlock(flags);
+
+    if (!region && bypass_region_alloc() < 0) {
+        bypass.dev = NULL;
+        return -12;
+    }
+    bypass_region_reset(dev);
+
+    bypass.info = (net_bypass_info_t *)region;
+    bypass.pa = region_pa;
+    bypass.doorbell_pa = 0;
+    bypass.doorbell_pages = 0;
+    bypass.pid = task->pid;
+    bypass.pending = 0;
+    memset(&bypass.file, 0, sizeof(bypass.file));
+    bypass.file.f_op = &bypass_fops;
+    bypass.file.f_flags = O_RDWR;
+    bypass.file.f_count = 1;
+    bypass.file.f_private = &bypass;
+
+    flags = bypass_lock();
+    dev->bypass = &bypass;
+    int ret = dev->bypass_attach(dev, &bypass);
+    if (ret < 0 || !bypass.doorbell_pages || bypass.doorbell_pages > NET_BYPASS_DOORBELL_MAX) {
+        if (ret == 0) {
+            dev->bypass_detach(dev);
+            ret = -22;
+        }
+        dev->bypass = NULL;
+        bypass.dev = NULL;
+        bypass_unlock(flags);
+        return ret;
+    }
+    bypass_unlock(flags);
+
+    bypass_map(NET_BYPASS_VADDR, region_pa, NET_BYPASS_PAGES, BYPASS_MAP_PTE);
+    bypass_map(NET_BYPASS_VADDR + NET_BYPASS_PAGES * PAGE_SIZE, bypass.doorbell_pa,
+               bypass.doorbell_pages, BYPASS_MMIO_PTE);
+    usermap_add(&bypass_map_user, NET_BYPASS_VADDR,
+                NET_BYPASS_PAGES + bypass.doorbell_pages, task->pid);
+
+    int fd = fd_install(&bypass.file);
+    if (fd < 0) {
+        bypass_file_close(&bypass.file);
+        return -24;
+    }
+
+    printf("[bypass] %s detached to pid %d: %u RX / %u TX descriptors, %u buffers at 0x%x\n",
+           dev->name, task->pid, bypass.info->rx_desc_nr, bypass.info->tx_desc_nr,
+           bypass.info->buf_nr, NET_BYPASS_VADDR);
+    return fd;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file capture.c
+ * @brief 抓包环：收发路径把帧拷进和用户态共享的环形缓冲区
+ *
+ * 环用 pmm_alloc_pages 分配（普通可缓存内存，不占 DMA 区），内核通过
+ * map_highmem_physical 访问，用户态映射在 CAPTURE_RING_VADDR。
+ * 所有进程共用内核页目录，映射登记成 usermap：只有最近一次 setup 的进程
+ * 运行时页才带 PTE_U，其他进程读不到抓到的帧；
+ * 环不释放，重复 setup 只是复位并换属主。
+ *
+ * 写帧在关中断下完成：接收在软中断里，发送可能在进程上下文也可能在软中断里，
+ * 一帧最多拷 CAPTURE_SNAPLEN 字节，关中断的时间很短。
+ *
+ * 环头和帧槽用户都能写，内核只从里面读各槽的 status：环的几何参数、写指针和
+ * 计数都在内核自己的变量里，环头上的只是给用户看的副本，改了也不影响内核。
+ * 建立环和打开抓包只给特权进程（task_privileged）。
+ */
+
+#include "net.h"
+#include "capture.h"
+#include "mm.h"
+#include "highmem_mapping.h"
+#include "lapic.h"
+#include "usermap.h"
+#include "printf.h"
+#include "string.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+extern uint32_t kernel_page_directory_phys;
+extern void map_page(uint32_t pde_phys, uint32_t vaddr, uint32_t paddr, uint32_t flags);
+extern task_t *current_task[];
+
+#define CAPTURE_MAP_PTE     0x3     // PTE_P | PTE_W；PTE_U 由 usermap 只给属主打开
+
+#define CAPTURE_FRAME_NR    ((CAPTURE_RING_PAGES * PAGE_SIZE - CAPTURE_FRAME_SIZE) / CAPTURE_FRAME_SIZE)
+
+static capture_ring_t *ring = NULL;     // 内核访问环的地址
+static uint32_t ring_head = 0;          // 内核下一个要写的帧槽
+static uint32_t ring_packets = 0;       // 环头上 packets / drops 的内核副本
+static uint32_t ring_drops = 0;
+static usermap_t ring_map;              // 用户态映射，属主是最近一次 setup 的进程
+
+static inline uint32_t capture_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void capture_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static inline capture_frame_t *capture_slot(uint32_t i) {
+    return (capture_frame_t *)((uint8_t *)ring + CAPTURE_FRAME_SIZE + i * CAPTURE_FRAME_SIZE);
+}
+
+// 所有帧槽还给内核，计数清零（调用者已关中断）
+static void capture_reset(void) {
+    ring->magic = CAPTURE_RING_MAGIC;
+    ring->frame_size = CAPTURE_FRAME_SIZE;
+    ring->frame_offset = CAPTURE_FRAME_SIZE;
+    ring->frame_nr = CAPTURE_FRAME_NR;
+    ring->snaplen = CAPTURE_SNAPLEN;
+    ring->packets = 0;
+    ring->drops = 0;
+    for (uint32_t i = 0; i < CAPTURE_FRAME_NR; i++) {
+        capture_slot(i)->status = CAPTURE_STATUS_KERNEL;
+    }
+    ring_head = 0;
+    ring_packets = 0;
+    ring_drops = 0;
+}
+
+/**
+ * @brief 分配环并映射到用户空间（只做一次）
+ * @return 0 成功，-12 内存不足
+ */
+static int capture_ring_create(void) {
+    uint32_t pa = pmm_alloc_pages(CAPTURE_RING_PAGES);
+    if (!pa) {
+        return -12;
+    }
+
+    uint32_t size = CAPTURE_RING_PAGES * PAGE_SIZE;
+    capture_ring_t *kva;
+    if (pa + size <= 0x800000) {
+        kva = (capture_ring_t *)phys_to_virt(pa);
+    } else {
+        kva = (capture_ring_t *)map_highmem_physical(pa, size, 0x3);
+    }
+    if (!kva) {
+        pmm_free_pages(pa, CAPTURE_RING_PAGES);
+        return -12;
+    }
+    memset(kva, 0, size);
+
+    for (uint32_t i = 0; i < CAPTURE_RING_PAGES; i++) {
+        uint32_t va = CAPTURE_RING_VADDR + i * PAGE_SIZE;
+        map_page(kernel_page_directory_phys, va, pa + i * PAGE_SIZE, CAPTURE_MAP_PTE);
+        __asm__ volatile("invlpg (%0)" : : "r"(va) : "memory");
+    }
+
+    printf("[capture] ring at phys 0x%x, user 0x%x, %u frames\n",
+           pa, CAPTURE_RING_VADDR, CAPTURE_FRAME_NR);
+
+    uint32_t flags = capture_lock();
+    ring = kva;
+    capture_reset();
+    capture_unlock(flags);
+    return 0;
+}
+
+// 占用下一个空闲帧槽并填好帧头（调用者已关中断），环满返回 NULL；
+// 要拷的长度通过 caplen 返回，不再从用户可写的帧头里读
+static capture_frame_t *capture_claim(net_device_t *dev, int dir, uint32_t len, uint32_t *caplen) {
+    capture_frame_t *f = capture_slot(ring_head);
+    if (f->status != CAPTURE_STATUS_KERNEL) {
+        ring->drops = ++ring_drops;
+        return NULL;
+    }
+    ring_head = (ring_head + 1) % CAPTURE_FRAME_NR;
+
+    *caplen = len < CAPTURE_SNAPLEN ? len : CAPTURE_SNAPLEN;
+    f->len = len;
+    f->caplen = *caplen;
+    clock_timestamp(&f->tv_sec, &f->tv_usec);
+    f->dir = (uint8_t)dir;
+    memcpy(f->ifname, dev->name, sizeof(f->ifname));
+    f->ifname[sizeof(f->ifname) - 1] = '\0';
+    return f;
+}
+
+// 数据写完后交给用户态
+static inline void capture_publish(capture_frame_t *f) {
+    __asm__ volatile("" ::: "memory");
+    f->status = CAPTURE_STATUS_USER;
+    ring->packets = ++ring_packets;
+}
+
+/**
+ * @brief 把一段连续的帧数据写进环
+ */
+void net_capture_frame(net_device_t *dev, int dir, const uint8_t *data, uint32_t len) {
+    if (!ring) {
+        return;
+    }
+
+    uint32_t flags = capture_lock();
+    uint32_t caplen;
+    capture_frame_t *f = capture_claim(dev, dir, len, &caplen);
+    if (f) {
+        memcpy((uint8_t *)(f + 1), data, caplen);
+        capture_publish(f);
+    }
+    capture_unlock(flags);
+}
+
+/**
+ * @brief 把 netbuf（包括发送方向的 frag 链）写进环
+ */
+void net_capture_netbuf(net_device_t *dev, int dir, netbuf_t *nb) {
+    if (!ring) {
+        return;
+    }
+
+    uint32_t flags = capture_lock();
+    uint32_t left;
+    capture_frame_t *f = capture_claim(dev, dir, netbuf_total_len(nb), &left);
+    if (f) {
+        uint8_t *dst = (uint8_t *)(f + 1);
+        for (netbuf_t *p = nb; p && left; p = p->frag) {
+            uint32_t n = p->len < left ? p->len : left;
+            memcpy(dst, p->data, n);
+            dst += n;
+            left -= n;
+        }
+        capture_publish(f);
+    }
+    capture_unlock(flags);
+}
+
+static void net_capture_dump(void) {
+    int count = net_get_device_count();
+    net_device_t **devs = net_get_all_devices();
+
+    printf("Device   Capture\n");
+    for (int i = 0; i < count; i++) {
+        uint8_t c = devs[i]->capture;
+        printf("%-8s %s%s%s\n", devs[i]->name,
+               (c & CAPTURE_RX) ? "rx " : "", (c & CAPTURE_TX) ? "tx" : "",
+               c ? "" : "-");
+    }
+    if (ring) {
+        printf("ring: %u frames x %u bytes, packets %u, drops %u\n",
+               CAPTURE_FRAME_NR, CAPTURE_FRAME_SIZE, ring_packets, ring_drops);
+    } else {
+        printf("ring: not set up\n");
+    }
+}
+
+/**
+ * @brief SYS_NET_CAPTURE：建立环 / 设置设备抓包方向 / 显示状态
+ * @return SETUP 返回环的用户态地址（只对调用者可见）；-1 不是特权进程，
+ *         -19 没有设备，-22 参数错误
+ */
+int sys_net_capture(int cmd, const char *ifname, uint32_t arg) {
+    task_t *task = current_task[logical_cpu_id()];
+
+    if (cmd == NET_CAPTURE_SHOW) {
+        net_capture_dump();
+        return 0;
+    }
+    if (cmd != NET_CAPTURE_SETUP && cmd != NET_CAPTURE_ENABLE) {
+        return -22;
+    }
+    if (!task_privileged()) {
+        return -1;
+    }
+
+    if (cmd == NET_CAPTURE_SETUP) {
+        if (!ring) {
+            int ret = capture_ring_create();
+            if (ret < 0) {
+                return ret;
+            }
+        } else {
+            uint32_t flags = capture_lock();
+            capture_reset();
+            capture_unlock(flags);
+        }
+        usermap_del(&ring_map);
+        usermap_add(&ring_map, CAPTURE_RING_VADDR, CAPTURE_RING_PAGES, task->pid);
+        return (int)CAPTURE_RING_VADDR;
+    }
+    if (!ifname) {
+        return -22;
+    }
+
+    char name[16];
+    strncpy(name, ifname, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    net_device_t *dev = net_device_get(name);
+    if (!dev) {
+        return -19;
+    }
+    if ((arg & (CAPTURE_RX | CAPTURE_TX)) && !ring) {
+        return -22;
+    }
+    dev->capture = (uint8_t)(arg & (CAPTURE_RX | CAPTURE_TX));
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file checksum.c
+ * @brief Internet 校验和实现
+ *
+ * 原来的实现每次循环只加一个 16 位字并在 32 位累加器里攒进位。
+ * 这里按 32 位字读，累加到 64 位累加器里（32 位字的和模 0xFFFF 与
+ * 16 位字的和相同），一次循环展开 8 个字（32 字节），最后才把进位
+ * 折回来，循环里没有任何分支和进位处理。
+ *
+ * 注意：内核 -m32 下 types.h 的 uint64_t 只有 32 位，累加器必须用
+ * unsigned long long。
+ */
+
+#include "checksum.h"
+
+// 允许非对齐访问的别名类型（x86 硬件支持非对齐读）
+typedef uint32_t __attribute__((may_alias, aligned(1))) csum_u32_t;
+typedef uint16_t __attribute__((may_alias, aligned(1))) csum_u16_t;
+
+// 64 位累加器折叠成 32 位部分和
+static inline uint32_t csum_from64(unsigned long long acc) {
+    acc = (acc & 0xFFFFFFFFULL) + (acc >> 32);
+    acc = (acc & 0xFFFFFFFFULL) + (acc >> 32);
+    return (uint32_t)acc;
+}
+
+/**
+ * @brief 累加 len 字节，返回 32 位部分和（未折叠、未取反）
+ */
+uint32_t csum_partial(const void *buf, uint32_t len, uint32_t sum) {
+    const uint8_t *p = (const uint8_t *)buf;
+    unsigned long long acc = sum;
+
+    while (len >= 32) {
+        const csum_u32_t *w = (const csum_u32_t *)p;
+        acc += w[0];
+        acc += w[1];
+        acc += w[2];
+        acc += w[3];
+        acc += w[4];
+        acc += w[5];
+        acc += w[6];
+        acc += w[7];
+        p += 32;
+        len -= 32;
+    }
+
+    while (len >= 4) {
+        acc += *(const csum_u32_t *)p;
+        p += 4;
+        len -= 4;
+    }
+
+    if (len >= 2) {
+        acc += *(const csum_u16_t *)p;
+        p += 2;
+        len -= 2;
+    }
+
+    // 奇数结尾：小端下最后一个字节落在 16 位字的低半部分
+    if (len) {
+        acc += *p;
+    }
+
+    return csum_from64(acc);
+}
+
+/**
+ * @brief IP 头校验和（ihl 为 32 位字数，至少 5）
+ * @return 计算发送值时先把 ip_sum 清零；校验接收时头部完好返回 0
+ */
+uint16_t ip_fast_csum(const void *iph, uint32_t ihl) {
+    const csum_u32_t *w = (const csum_u32_t *)iph;
+    unsigned long long acc = (unsigned long long)w[0] + w[1] + w[2] + w[3] + w[4];
+
+    for (uint32_t i = 5; i < ihl; i++) {
+        acc += w[i];
+    }
+    return csum_fold(csum_from64(acc));
+}
+
+/**
+ * @brief 把 TCP/UDP 伪头部加进部分和
+ *
+ * 伪头部在内存里是 saddr, daddr, 0, proto, htons(len)，
+ * 直接按这个布局把各字段加进去，不需要拼出伪头部缓冲区。
+ */
+uint32_t csum_tcpudp_nofold(uint32_t saddr, uint32_t daddr, uint32_t len,
+                            uint8_t proto, uint32_t sum) {
+    unsigned long long acc = sum;
+
+    acc += saddr;
+    acc += daddr;
+    // 小端：{0, proto} -> proto << 8，htons(len) -> 字节交换
+    acc += (uint32_t)proto << 8;
+    acc += ((len & 0xFF) << 8) | ((len >> 8) & 0xFF);
+    return csum_from64(acc);
+}
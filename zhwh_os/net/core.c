@@ -7,18 +7,30 @@
 #include "../include/printf.h"
 #include "../include/string.h"
 #include "../include/kmalloc.h"
+#include "checksum.h"
+#include "socket.h"
+#include "neigh.h"
+#include "route.h"
+#include "capture.h"
+#include "qdisc.h"
+#include "ipfrag.h"
+#include "softirq.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
 
 extern void vga_setcolor(uint8_t fg, uint8_t bg);
 #define SET_COLOR_RED()     vga_setcolor(4, 0)   // 红字黑底
 #define SET_COLOR_GREEN()     vga_setcolor(2, 0)   // 绿字黑底
 
+// 逐包的调试输出（收发路径上每个包都会走到，默认关闭）
+#define NET_DEBUG 0
+#define net_dbg(fmt, ...) \
+    do { if (NET_DEBUG) printf("[net] " fmt, ##__VA_ARGS__); } while (0)
+
 // 网络设备列表
 static net_device_t *net_devices[16];
 static int num_devices = 0;
 
-// ARP缓存表
-static arp_entry_t arp_table[ARP_TABLE_SIZE];  // 🔥 改为全局可见，方便 dump_rx 访问
-
 // 网络统计
 net_stats_t net_stats;
 
@@ -30,14 +42,13 @@ static uint32_t gateway = 0xC0A80001;   // 192.168.0.1 (网关)
 // 🔥 本机 MAC 地址（全局变量，用于接收包过滤）
 uint8_t local_mac[ETH_ALEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};  // 默认值，会被设备初始化覆盖
 
-// 🔥 当前选择的网络设备名称（从 syscall.c 导入）
-extern char current_net_device[];
-
 // 以太网广播地址
 uint8_t eth_broadcast[ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 // 前向声明
-static void arp_cache_update(uint32_t ip_addr, uint8_t *mac_addr);
+void arp_handle_request(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp);
+void arp_handle_reply(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp);
+static void net_rx_softirq(void);
 
 /**
  * @brief 网络初始化
@@ -49,19 +60,27 @@ void net_init(void) {
     memset(net_devices, 0, sizeof(net_devices));
     num_devices = 0;
 
-    // 清零ARP表
-    memset(arp_table, 0, sizeof(arp_table));
+    open_softirq(NET_RX_SOFTIRQ, net_rx_softirq);
+    // 发送排队规则（NET_TX_SOFTIRQ）和 IP 分片重组
+    qdisc_init();
+    ipfrag_init();
+
+    // 邻居表（ARP 缓存）和路由表
+    neigh_init();
+    route_init();
 
     // 清零统计信息
     memset(&net_stats, 0, sizeof(net_stats));
 
+    // 数据包缓冲池
+    netbuf_pool_init();
+
     // 🔥 预绑定：192.168.0.145 -> D8:D0:90:15:E2:68
     uint32_t target_ip = 0xC0A80091;  // 192.168.0.145 (主机字节序)
     uint8_t target_mac[6] = {0xD8, 0xD0, 0x90, 0x15, 0xE2, 0x68};
 
-    arp_table[0].ip = target_ip;
-    memcpy(arp_table[0].mac, target_mac, 6);
-    arp_table[0].valid = 1;
+    // 此时还没有注册设备：静态表项对所有设备有效
+    neigh_add_permanent(NULL, target_ip, target_mac);
 
     printf("[net] Pre-populated ARP cache:\n");
     printf("[net]   %d.%d.%d.%d -> %02x:%02x:%02x:%02x:%02x:%02x\n",
@@ -87,13 +106,19 @@ int net_device_register(net_device_t *dev) {
         return -1;
     }
 
-    dev->ip_addr = local_ip;
-    dev->netmask = netmask;
-    dev->gateway = gateway;  // 设置网关
     dev->mtu = ETH_MTU;
+    if (!dev->max_mtu) {
+        dev->max_mtu = ETH_MTU;
+    }
 
     net_devices[num_devices++] = dev;
 
+    // 默认 FIFO 排队规则（之后用 SYS_NET_QDISC 改）
+    qdisc_attach(dev);
+
+    // 默认地址配置，同时生成直连路由和默认路由（驱动可以之后再用 net_device_set_addr 改）
+    net_device_set_addr(dev, local_ip, netmask, gateway);
+
     // printf("[net] Registered device: %s\n", dev->name);
     // printf("[net]   MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
     //        dev->mac_addr[0], dev->mac_addr[1], dev->mac_addr[2],
@@ -124,6 +149,18 @@ net_device_t *net_device_get_default(void) {
     return NULL;
 }
 
+/**
+ * @brief 选择发往 dst_ip 的出口设备（查路由表，没有路由返回 NULL）
+ */
+net_device_t *net_output_device(uint32_t dst_ip) {
+    dst_cache_t rt;
+
+    if (route_lookup(dst_ip, NULL, &rt) < 0) {
+        return NULL;
+    }
+    return rt.dev;
+}
+
 /**
  * @brief 获取当前网络设备数量
  */
@@ -138,6 +175,50 @@ net_device_t **net_get_all_devices(void) {
     return net_devices;
 }
 
+/**
+ * @brief 修改设备 MTU
+ *
+ * 驱动提供 change_mtu 时先让它按新 MTU 配置接收，失败则保持原 MTU。
+ * 调小 MTU 时，已建立的 TCP 连接在下一次 tcp_output 把 MSS 收紧到新 MTU 之内；
+ * 调大 MTU 不会放大握手时协商的 MSS。其他超过新 MTU 的 IP 包在 ip_output_dst 分片。
+ * @return 0 成功，-22 超出 ETH_MIN_MTU ~ dev->max_mtu
+ */
+int net_device_set_mtu(net_device_t *dev, uint32_t mtu) {
+    if (!dev || mtu < ETH_MIN_MTU || mtu > dev->max_mtu) {
+        return -22;
+    }
+    if (mtu == dev->mtu) {
+        return 0;
+    }
+    if (dev->change_mtu) {
+        int ret = dev->change_mtu(dev, (uint16_t)mtu);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    dev->mtu = (uint16_t)mtu;
+    printf("[net] %s: MTU %d (max %d)\n", dev->name, dev->mtu, dev->max_mtu);
+    return 0;
+}
+
+/**
+ * @brief SYS_NET_MTU：按名字修改设备 MTU
+ */
+int sys_net_mtu(const char *ifname, uint32_t mtu) {
+    if (!ifname) {
+        return -22;
+    }
+
+    char name[16];
+    strncpy(name, ifname, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    net_device_t *dev = net_device_get(name);
+    if (!dev) {
+        return -19;
+    }
+    return net_device_set_mtu(dev, mtu);
+}
+
 
 /**
  * @brief 检查是否是有效的以太网类型
@@ -157,79 +238,60 @@ static int is_valid_eth_type(uint16_t eth_type) {
 }
 
 /**
- * @brief 接收数据包
+ * @brief 接收数据包（拷贝型驱动入口）
+ *
+ * 驱动自己的接收缓冲区（比如 RTL8139 的环形缓冲区）不能交给协议栈，
+ * 这里拷贝一次到 netbuf，之后整条接收路径都在这个 netbuf 上原地处理。
+ * 接收过滤在拷贝之前执行，被丢弃的帧不占用 netbuf。
  */
 int net_rx_packet(net_device_t *dev, uint8_t *data, uint32_t len) {
-    // 🔥 解析以太网帧头
-    eth_hdr_t *eth = (eth_hdr_t *)data;
-    uint16_t eth_type = ntohs(eth->eth_type);
-
-    // 🔥🔥 过滤：检查是否是有效的以太网类型
-    if (!is_valid_eth_type(eth_type)) {
-        printf("[net] DROP: Invalid EtherType 0x%04x (not IP/ARP/VLAN)\n", eth_type);
+    if (!dev || !data || len < ETH_HDR_LEN || len > NETBUF_DATA_SIZE) {
+        net_stats.rx_errors++;
+        return -1;
+    }
+    if (net_rx_filter(dev, data, len) == NET_RX_FILTER_DROP) {
         net_stats.rx_dropped++;
         return -1;
     }
 
-    // 🔥🔥 优先处理 ARP 包（在最前面）
-    if (eth_type == ETH_P_ARP) {
-        printf("[net] -> Calling arp_handle\n");
-        arp_handle(dev, data, len);
-        return 0;
+    netbuf_t *nb = netbuf_from(data, len, 0);
+    if (!nb) {
+        printf("[net] DROP: netbuf pool exhausted\n");
+        net_stats.rx_dropped++;
+        return -1;
     }
 
-    // 🔥🔥 调试：显示前 64 字节（限制输出长度）
-    printf("[net] RAW %d bytes: ", len > 64 ? 64 : len);
-    for (int i = 0; i < 64 && i < len; i++) {
-        printf("%02x ", data[i]);
-    }
-    printf("\n");
+    return net_rx_netbuf(dev, nb);
+}
 
-    SET_COLOR_RED();
-    printf("[net] GOT PACKET len=%d\n", len);
-    printf("[net]   dst MAC: %02x:%02x:%02x:%02x:%02x:%02x (our MAC: ",
-           eth->eth_dst[0], eth->eth_dst[1], eth->eth_dst[2],
-           eth->eth_dst[3], eth->eth_dst[4], eth->eth_dst[5]);
+/**
+ * @brief 接收过滤并交给以太网层（不释放 nb）
+ */
+static int net_rx_dispatch(net_device_t *dev, netbuf_t *nb) {
+    uint8_t *data = nb->data;
+    uint32_t len = nb->len;
 
-    // 显示我们的 MAC 用于对比
-    extern uint8_t local_mac[ETH_ALEN];
-    printf("%02x:%02x:%02x:%02x:%02x:%02x)\n",
-           local_mac[0], local_mac[1], local_mac[2],
-           local_mac[3], local_mac[4], local_mac[5]);
+    if (!dev || len < ETH_HDR_LEN) {
+        //printf("[net] ERROR: Invalid parameters! dev=%p, data=%p, len=%d\n", dev, data, len);
+        net_stats.rx_errors++;
+        return -1;
+    }
 
-    printf("[net]   src MAC: %02x:%02x:%02x:%02x:%02x:%02x",
-           eth->eth_src[0], eth->eth_src[1], eth->eth_src[2],
-           eth->eth_src[3], eth->eth_src[4], eth->eth_src[5]);
+    // 🔥 解析以太网帧头
+    eth_hdr_t *eth = (eth_hdr_t *)data;
+    uint16_t eth_type = ntohs(eth->eth_type);
 
-    // 显示协议类型（eth_type 已在前面定义）
-    if (eth_type == ETH_P_IP) {
-        printf(" (IP)");
-    } else if (eth_type == ETH_P_ARP) {
-        printf(" (ARP)");
-    } else {
-        printf(" (type=0x%04x)", eth_type);
+    // 🔥🔥 过滤：检查是否是有效的以太网类型
+    if (!is_valid_eth_type(eth_type)) {
+        net_dbg("DROP: Invalid EtherType 0x%04x (not IP/ARP/VLAN)\n", eth_type);
+        net_stats.rx_dropped++;
+        return -1;
     }
 
-    // 如果是 IP 包（EtherType 0x0800），追加显示源 IP 和目标 IP
-    if (eth_type == ETH_P_IP) {
-        ip_hdr_t *ip = (ip_hdr_t *)(data + sizeof(eth_hdr_t));
-        printf("\n[net]   src IP: %d.%d.%d.%d -> dst IP: %d.%d.%d.%d",
-               (ntohl(ip->ip_src) >> 24) & 0xFF,
-               (ntohl(ip->ip_src) >> 16) & 0xFF,
-               (ntohl(ip->ip_src) >> 8) & 0xFF,
-               ntohl(ip->ip_src) & 0xFF,
-               (ntohl(ip->ip_dst) >> 24) & 0xFF,
-               (ntohl(ip->ip_dst) >> 16) & 0xFF,
-               (ntohl(ip->ip_dst) >> 8) & 0xFF,
-               ntohl(ip->ip_dst) & 0xFF);
-    }
-    printf("\n");
-    SET_COLOR_GREEN();
-
-    if (!dev || !data || len < ETH_HDR_LEN) {
-        //printf("[net] ERROR: Invalid parameters! dev=%p, data=%p, len=%d\n", dev, data, len);
-        net_stats.rx_errors++;
-        return -1;
+    // 🔥🔥 优先处理 ARP 包（在最前面）
+    if (eth_type == ETH_P_ARP) {
+        net_dbg("-> Calling arp_input\n");
+        return eth_input(dev, nb);
     }
 
     // 🔥🔥 过滤：检查目标 MAC 是否匹配本机（广播、多播、本机 MAC）
@@ -237,34 +299,29 @@ int net_rx_packet(net_device_t *dev, uint8_t *data, uint32_t len) {
     if (eth->eth_dst[0] == 0xFF && eth->eth_dst[1] == 0xFF &&
         eth->eth_dst[2] == 0xFF && eth->eth_dst[3] == 0xFF &&
         eth->eth_dst[4] == 0xFF && eth->eth_dst[5] == 0xFF) {
-        printf("[net] RX: Broadcast packet\n");
+        net_dbg("RX: Broadcast packet\n");
     }
-    // 检查本机 MAC（使用全局 local_mac）
-    else if (memcmp(eth->eth_dst, local_mac, ETH_ALEN) == 0) {
-        printf("[net] RX: Unicast to us\n");
+    // 检查本机 MAC（收包设备的 MAC，或全局 local_mac）
+    else if (memcmp(eth->eth_dst, dev->mac_addr, ETH_ALEN) == 0 ||
+             memcmp(eth->eth_dst, local_mac, ETH_ALEN) == 0) {
+        net_dbg("RX: Unicast to us\n");
     }
     // 多播 MAC（01:00:5E 开头或 33:33 开头）
     else if (eth->eth_dst[0] == 0x01 || eth->eth_dst[0] == 0x33) {
-        printf("[net] RX: Multicast packet\n");
+        net_dbg("RX: Multicast packet\n");
     }
     // 不是给我们的包
     else {
-        printf("[net] RX: NOT for us, dropping packet\n");
+        net_dbg("RX: NOT for us, dropping packet\n");
         return 0;  // 不是错误，只是不是给我们的
     }
 
     // 🔥 如果是 IP 包，检查目标 IP 是否匹配本机
-    if (ntohs(eth->eth_type) == ETH_P_IP) {
+    if (eth_type == ETH_P_IP && len >= ETH_HDR_LEN + IP_HDR_LEN) {
         ip_hdr_t *ip = (ip_hdr_t *)(data + sizeof(eth_hdr_t));
 
         uint32_t dst_ip = ntohl(ip->ip_dst);
-        uint32_t our_ip = local_ip;  // ✅ local_ip 已经是主机字节序
-
-        // printf("[net] RX: dst IP=%d.%d.%d.%d, our IP=%d.%d.%d.%d\n",
-        //        (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
-        //        (dst_ip >> 8) & 0xFF, dst_ip & 0xFF,
-        //        (our_ip >> 24) & 0xFF, (our_ip >> 16) & 0xFF,
-        //        (our_ip >> 8) & 0xFF, our_ip & 0xFF);
+        uint32_t our_ip = dev->ip_addr;  // ✅ 收包设备的地址（主机字节序），多网卡时各自不同
 
         // 如果目标 IP 不是本机 IP，且不是广播 (255.255.255.255)
         if (dst_ip != our_ip && dst_ip != 0xFFFFFFFF) {
@@ -273,107 +330,486 @@ int net_rx_packet(net_device_t *dev, uint8_t *data, uint32_t len) {
         }
     }
 
-    printf("[net] === net_rx_packet ENTRY ===\n");
-    printf("[net] param dev = 0x%x\n", (uint32_t)dev);
-    printf("[net] param data = 0x%x\n", (uint32_t)data);
-    printf("[net] param len = %u\n", len);
-    printf("[net] dev->name = %s\n", dev ? dev->name : "NULL");
-    printf("[net] ===========================\n");
-
     net_stats.rx_packets++;
     net_stats.rx_bytes += len;
-    printf("[net] Stats updated: rx_packets=%d, rx_bytes=%d\n",
-           net_stats.rx_packets, net_stats.rx_bytes);
 
-    
-    
     // 解析以太网帧
-    return eth_input(dev, data, len);
+    return eth_input(dev, nb);
 }
 
 /**
- * @brief 发送数据包
+ * @brief 接收数据包（netbuf 入口，接管 nb）
+ */
+int net_rx_netbuf(net_device_t *dev, netbuf_t *nb) {
+    if (!nb) {
+        return -1;
+    }
+
+    nb->dev = dev;
+    if (dev) {
+        net_capture_rx(dev, nb);
+    }
+    int ret = net_rx_dispatch(dev, nb);
+    netbuf_free(nb);
+    return ret;
+}
+
+// ==================== 接收积压队列 / NAPI 轮询 ====================
+//
+// 零拷贝驱动在中断里只做"摘下 netbuf、补新缓冲区、挂到队列"，
+// 或者干脆屏蔽 RX 中断后用 net_napi_schedule() 把自己挂到轮询链表上；
+// 两者都会置 NET_RX_SOFTIRQ，协议处理和驱动 poll 在软中断 net_rx_action() 里开中断执行。
+
+#define NET_RX_BACKLOG_MAX  NETBUF_POOL_SIZE
+#define NET_NAPI_WEIGHT     64    // 每个设备每次 poll 最多收的包数
+#define NET_RX_BUDGET       300   // 每次 net_rx_action 最多收的包数，剩下的等下一个时钟中断
+
+// 按 nb->rx_queue 分队列，编号大的先处理（BPF 过滤器可以把控制流量放进高优先级队列）
+typedef struct {
+    netbuf_t *head;
+    netbuf_t *tail;
+} rx_backlog_t;
+
+static rx_backlog_t rx_backlog[NET_RX_QUEUES];
+static uint32_t rx_backlog_len = 0;
+static napi_t *poll_list_head = NULL;
+static napi_t *poll_list_tail = NULL;
+static volatile int rx_action_running = 0;
+static int tx_batch_depth = 0;   // net_tx_batch_begin 嵌套深度
+
+static inline uint32_t net_irq_save(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void net_irq_restore(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// 挂到 nb->rx_queue 对应的积压队列并置软中断（接管 nb）
+static int rx_backlog_add(net_device_t *dev, netbuf_t *nb) {
+    nb->dev = dev;
+    nb->next = NULL;
+    if (nb->rx_queue >= NET_RX_QUEUES) {
+        nb->rx_queue = NET_RX_QUEUES - 1;
+    }
+
+    uint32_t flags = net_irq_save();
+    if (rx_backlog_len >= NET_RX_BACKLOG_MAX) {
+        net_stats.rx_dropped++;
+        net_irq_restore(flags);
+        netbuf_free(nb);
+        return -1;
+    }
+    rx_backlog_t *q = &rx_backlog[nb->rx_queue];
+    if (q->tail) {
+        q->tail->next = nb;
+    } else {
+        q->head = nb;
+    }
+    q->tail = nb;
+    rx_backlog_len++;
+    net_irq_restore(flags);
+    raise_softirq(NET_RX_SOFTIRQ);
+    return 0;
+}
+
+/**
+ * @brief 把收到的帧挂到积压队列（可在中断上下文调用，接管 nb）
+ */
+int net_rx_enqueue(net_device_t *dev, netbuf_t *nb) {
+    if (!nb) {
+        return -1;
+    }
+    nb->protocol = 0;   // 以太网帧，由 eth_input 解析
+    return rx_backlog_add(dev, nb);
+}
+
+/**
+ * @brief 把三层包挂到积压队列（回环快速路径，接管 nb）
+ *
+ * protocol 非 0 就是积压队列里"data 已指向三层头"的标记，
+ * 软中断里跳过抓包和以太网层直接交给协议输入函数。
+ * 放进队列而不是直接调用 ip_input：应答（ACK、ICMP 应答）会再次经过回环，
+ * 同步递交会在发送路径里一层层递归下去。
+ */
+int net_rx_enqueue_l3(net_device_t *dev, netbuf_t *nb, uint16_t protocol) {
+    if (!nb || !protocol) {
+        if (nb) {
+            netbuf_free(nb);
+        }
+        return -1;
+    }
+    nb->protocol = protocol;
+    nb->mac_hdr = NULL;
+    return rx_backlog_add(dev, nb);
+}
+
+// 三层包直接交给协议层（nb->data 指向 nb->protocol 对应的头部），之后释放
+static int net_rx_l3(net_device_t *dev, netbuf_t *nb) {
+    int ret = -1;
+
+    net_stats.rx_packets++;
+    net_stats.rx_bytes += netbuf_total_len(nb);
+    if (nb->protocol == ETH_P_IP) {
+        ret = ip_input(dev, nb);
+    } else {
+        net_stats.rx_dropped++;
+    }
+    netbuf_free(nb);
+    return ret;
+}
+
+// 调用者已关中断
+static void poll_list_append(napi_t *napi) {
+    napi->poll_next = NULL;
+    if (poll_list_tail) {
+        poll_list_tail->poll_next = napi;
+    } else {
+        poll_list_head = napi;
+    }
+    poll_list_tail = napi;
+}
+
+/**
+ * @brief 请求轮询一个上下文（驱动中断处理程序调用，调用前应已屏蔽对应的 RX 中断）
+ */
+void napi_schedule(napi_t *napi) {
+    if (!napi || !napi->poll) {
+        return;
+    }
+
+    uint32_t flags = net_irq_save();
+    if (!napi->scheduled) {
+        napi->scheduled = 1;
+        poll_list_append(napi);
+        raise_softirq(NET_RX_SOFTIRQ);
+    }
+    net_irq_restore(flags);
+}
+
+/**
+ * @brief 结束轮询（驱动在 poll 收空接收环时调用，之后才能重新打开 RX 中断）
+ */
+void napi_complete(napi_t *napi) {
+    uint32_t flags = net_irq_save();
+    napi->scheduled = 0;
+    net_irq_restore(flags);
+}
+
+// 设备默认上下文：转给驱动的 dev->poll
+static int net_dev_napi_poll(napi_t *napi, int budget) {
+    return napi->dev->poll(napi->dev, budget);
+}
+
+/**
+ * @brief 请求轮询设备的默认上下文
+ */
+void net_napi_schedule(net_device_t *dev) {
+    if (!dev || !dev->poll) {
+        return;
+    }
+    // 中断可能早于 net_device_register 到来，这里顺手把上下文填好
+    dev->napi.dev = dev;
+    dev->napi.poll = net_dev_napi_poll;
+    napi_schedule(&dev->napi);
+}
+
+void net_napi_complete(net_device_t *dev) {
+    napi_complete(&dev->napi);
+}
+
+// 取积压队列里优先级最高的一帧（调用者已关中断）
+static netbuf_t *rx_backlog_pop(void) {
+    for (int i = NET_RX_QUEUES - 1; i >= 0; i--) {
+        rx_backlog_t *q = &rx_backlog[i];
+        netbuf_t *nb = q->head;
+        if (nb) {
+            q->head = nb->next;
+            if (!q->head) {
+                q->tail = NULL;
+            }
+            rx_backlog_len--;
+            return nb;
+        }
+    }
+    return NULL;
+}
+
+// 处理积压队列中最多 limit 帧（调用者已关中断，处理每帧时临时开中断）
+static int net_rx_backlog_drain(int limit) {
+    int done = 0;
+    netbuf_t *nb;
+    while (done < limit && (nb = rx_backlog_pop()) != NULL) {
+        nb->next = NULL;
+
+        sti();
+        if (nb->protocol) {
+            net_rx_l3(nb->dev, nb);
+        } else {
+            net_rx_netbuf(nb->dev, nb);
+        }
+        cli();
+        done++;
+    }
+    return done;
+}
+
+/**
+ * @brief 接收下半部：轮询已调度的设备并处理积压队列
+ *
+ * NET_RX_SOFTIRQ 的处理函数（也可以在轮询路径上直接调用），处理期间打开中断，
+ * 网卡可以继续把新帧挂进来；嵌套调用直接返回，由外层循环接着处理。
+ * 设备 poll 用满 NET_NAPI_WEIGHT 说明环上还有包，放回链表尾部继续轮询；
+ * 积压队列的帧同样计入预算：回环上每递交一个段都可能马上挂回一个应答/新段，
+ * 不计的话本地大流量会一直在这里转下去。
+ * 整轮用满 NET_RX_BUDGET 就先退出，把 CPU 让给别人，并重新置位软中断，
+ * 剩下的由 do_softirq 下一轮或 ksoftirqd 接着处理。
+ * @return 本次处理的帧数
+ */
+int net_rx_action(void) {
+    uint32_t flags = net_irq_save();
+    if (rx_action_running || (!poll_list_head && !rx_backlog_len)) {
+        net_irq_restore(flags);
+        return 0;
+    }
+    rx_action_running = 1;
+    // 处理接收时产生的应答（ICMP、ARP、ACK）攒成一批，最后统一写门铃
+    tx_batch_depth++;
+
+    int budget = NET_RX_BUDGET;
+    int done = net_rx_backlog_drain(budget);
+    budget -= done;
+
+    while (poll_list_head && budget > 0) {
+        napi_t *napi = poll_list_head;
+        poll_list_head = napi->poll_next;
+        if (!poll_list_head) {
+            poll_list_tail = NULL;
+        }
+        napi->poll_next = NULL;
+
+        int weight = budget < NET_NAPI_WEIGHT ? budget : NET_NAPI_WEIGHT;
+        sti();
+        int work = napi->poll(napi, weight);
+        cli();
+
+        // 用满配额：驱动没有 complete，继续排队
+        if (work >= weight) {
+            poll_list_append(napi);
+        }
+        budget -= work;
+
+        if (budget > 0) {
+            int n = net_rx_backlog_drain(budget);
+            budget -= n;
+            done += n;
+        }
+    }
+
+    rx_action_running = 0;
+    if (poll_list_head || rx_backlog_len) {
+        raise_softirq(NET_RX_SOFTIRQ);
+    }
+    net_irq_restore(flags);
+    net_tx_batch_end();
+    return done;
+}
+
+static void net_rx_softirq(void) {
+    net_rx_action();
+}
+
+/**
+ * @brief 发送数据包（裸缓冲区入口）：拷进 netbuf 后走 net_tx_netbuf，同样经过 qdisc
  */
 int net_tx_packet(net_device_t *dev, uint8_t *data, uint32_t len) {
-    if (!dev || !data || len > ETH_MAX_FRAME || len < ETH_HDR_LEN) {
+    if (!dev || !data || len > ETH_HDR_LEN + dev->mtu || len < ETH_HDR_LEN) {
+        net_stats.tx_errors++;
+        return -1;
+    }
+
+    netbuf_t *nb = netbuf_from_chain(data, len, 0);
+    if (!nb) {
+        net_stats.tx_dropped++;
+        return -1;
+    }
+    return net_tx_netbuf(dev, nb);
+}
+
+/**
+ * @brief 发送数据包（netbuf 入口，接管 nb）
+ *
+ * 校验并按设备能力整理好 netbuf 后交给设备的 qdisc 排队（见 net/sched.c），
+ * 由 qdisc 出队时调用 net_dev_xmit。带 frag 链的 netbuf 交给不支持
+ * NETIF_F_SG 的设备前先合并成一块。
+ */
+int net_tx_netbuf(net_device_t *dev, netbuf_t *nb) {
+    if (!nb) {
+        return -1;
+    }
+
+    uint32_t len = netbuf_total_len(nb);
+    // TSO 请求由网卡切成 MTU 大小，这里不限制总长
+    if (!dev || (len > ETH_HDR_LEN + dev->mtu && !nb->gso_size) || len < ETH_HDR_LEN) {
         net_stats.tx_errors++;
+        netbuf_free(nb);
         return -1;
     }
 
-    if (!dev->send) {
+    if (!dev->xmit && !dev->send) {
         printf("[net] Device has no send function\n");
         net_stats.tx_errors++;
+        netbuf_free(nb);
         return -1;
     }
 
-    net_stats.tx_packets++;
-    net_stats.tx_bytes += len;
+    if (nb->frag && (!dev->xmit || !(dev->features & NETIF_F_SG)) &&
+        netbuf_linearize(nb) < 0) {
+        net_stats.tx_dropped++;
+        netbuf_free(nb);
+        return -1;
+    }
 
-    return dev->send(dev, data, len);
+    nb->dev = dev;
+    return qdisc_enqueue(dev, nb);
 }
 
 /**
- * @brief 构建以太网帧并发送
+ * @brief 把 netbuf 交给驱动（qdisc 出队时调用）
+ *
+ * 驱动提供 xmit 时直接把 netbuf 交给驱动（驱动在 DMA 完成后释放），
+ * 否则退回 send 并在返回后释放。xmit 返回 NET_XMIT_BUSY 时 nb 仍归调用者，
+ * 这时不计统计也不抓包，等 qdisc 重新出队。
+ * 网卡旁路给用户进程期间（dev->bypass）发送环不归内核，直接丢弃。
  */
-static int eth_send(net_device_t *dev, uint8_t *dst_mac, uint16_t eth_type,
-                    uint8_t *data, uint32_t len) {
-    // 分配以太网帧缓冲区
-    uint8_t *frame = (uint8_t *)kmalloc(ETH_HDR_LEN + len);
-    if (!frame) {
-        printf("[net] Failed to allocate Ethernet frame\n");
+int net_dev_xmit(net_device_t *dev, netbuf_t *nb) {
+    uint32_t len = netbuf_total_len(nb);
+
+    if (dev->bypass) {
+        net_stats.tx_dropped++;
+        netbuf_free(nb);
         return -1;
     }
 
-    eth_hdr_t *eth = (eth_hdr_t *)frame;
+    if (!dev->xmit) {
+        net_capture_tx(dev, nb);
+        int ret = dev->send(dev, nb->data, nb->len);
+        net_stats.tx_packets++;
+        net_stats.tx_bytes += len;
+        netbuf_free(nb);
+        return ret < 0 ? ret : 0;
+    }
+
+    // 抓包要在驱动接受之后，先多拿一个引用，免得 DMA 完成后 nb 已被回收
+    int capture = dev->capture & CAPTURE_TX;
+    if (capture) {
+        netbuf_get(nb);
+    }
+    int ret = dev->xmit(dev, nb);
+    if (ret != NET_XMIT_BUSY) {
+        net_stats.tx_packets++;
+        net_stats.tx_bytes += len;
+        if (capture && ret == 0) {
+            net_capture_netbuf(dev, CAPTURE_TX, nb);
+        }
+    }
+    if (capture) {
+        netbuf_free(nb);
+    }
+    return ret;
+}
+
+// ==================== 批量发送 ====================
+
+/**
+ * @brief 开始一批发送：之后的 xmit 只挂描述符，不写门铃寄存器
+ */
+void net_tx_batch_begin(void) {
+    uint32_t flags = net_irq_save();
+    tx_batch_depth++;
+    net_irq_restore(flags);
+}
+
+/**
+ * @brief 结束一批发送：最外层 end 时让每个设备把积攒的描述符一次交给硬件
+ */
+void net_tx_batch_end(void) {
+    uint32_t flags = net_irq_save();
+    int depth = --tx_batch_depth;
+    net_irq_restore(flags);
+
+    if (depth > 0) {
+        return;
+    }
+    for (int i = 0; i < num_devices; i++) {
+        if (net_devices[i]->tx_flush) {
+            net_devices[i]->tx_flush(net_devices[i]);
+        }
+    }
+}
+
+/**
+ * @brief 当前是否处于批量发送中（驱动 xmit 据此决定是否立即写门铃）
+ */
+int net_tx_batching(void) {
+    return tx_batch_depth > 0;
+}
+
+/**
+ * @brief 在 netbuf 前面加上以太网头并发送（接管 nb）
+ */
+int eth_output(net_device_t *dev, const uint8_t *dst_mac, uint16_t eth_type,
+               netbuf_t *nb) {
+    eth_hdr_t *eth = (eth_hdr_t *)netbuf_push(nb, ETH_HDR_LEN);
+    if (!eth) {
+        printf("[net] eth_output: no headroom for Ethernet header\n");
+        net_stats.tx_errors++;
+        netbuf_free(nb);
+        return -1;
+    }
 
     // 填充以太网头部
     memcpy(eth->eth_dst, dst_mac, ETH_ALEN);
     memcpy(eth->eth_src, dev->mac_addr, ETH_ALEN);
     eth->eth_type = htons(eth_type);
 
-    // 复制数据
-    memcpy(frame + ETH_HDR_LEN, data, len);
-
-    // 🔥 打印完整的以太网帧（16 进制）
-    SET_COLOR_RED();
-    printf("[net] eth_send: %d bytes\n", ETH_HDR_LEN + len);
-    for (uint32_t i = 0; i < ETH_HDR_LEN + len; i++) {
-        printf("%02x ", frame[i]);
-        if ((i + 1) % 16 == 0) printf("\n");
-    }
-    if ((ETH_HDR_LEN + len) % 16 != 0) printf("\n");
-    SET_COLOR_GREEN();
-
     // 发送
-    int ret = net_tx_packet(dev, frame, ETH_HDR_LEN + len);
-
-    kfree(frame);
-    return ret;
+    return net_tx_netbuf(dev, nb);
 }
 
 /**
  * @brief 以太网输入处理
  */
-int eth_input(net_device_t *dev, uint8_t *data, uint32_t len) {
-    if (len < ETH_HDR_LEN)
+int eth_input(net_device_t *dev, netbuf_t *nb) {
+    if (nb->len < ETH_HDR_LEN)
         return -1;
-    eth_hdr_t *eth = (eth_hdr_t *)data;
+    eth_hdr_t *eth = (eth_hdr_t *)nb->data;
+
+    nb->mac_hdr = nb->data;
+    nb->protocol = ntohs(eth->eth_type);
 
-    printf("[net] Eth frame: type=0x%04x, len=%d, dst=%02x:%02x:%02x:%02x:%02x:%02x\n",
-           ntohs(eth->eth_type), len,
-           eth->eth_dst[0], eth->eth_dst[1], eth->eth_dst[2],
-           eth->eth_dst[3], eth->eth_dst[4], eth->eth_dst[5]);
+    net_dbg("Eth frame: type=0x%04x, len=%d, dst=%02x:%02x:%02x:%02x:%02x:%02x\n",
+           nb->protocol, nb->len,
+            eth->eth_dst[0], eth->eth_dst[1], eth->eth_dst[2],
+            eth->eth_dst[3], eth->eth_dst[4], eth->eth_dst[5]);
+
+    netbuf_pull(nb, ETH_HDR_LEN);
 
     // 根据以太网类型分发
-    switch (ntohs(eth->eth_type)) {
+    switch (nb->protocol) {
         case ETH_P_IP:
-            printf("[net] -> Calling ip_input\n");
-            return ip_input(dev, data + ETH_HDR_LEN, len - ETH_HDR_LEN);
+            net_dbg("-> Calling ip_input\n");
+            return ip_input(dev, nb);
         case ETH_P_ARP:
-            printf("[net] -> Calling arp_input\n");
-            return arp_input(dev, data + ETH_HDR_LEN, len - ETH_HDR_LEN);
+            net_dbg("-> Calling arp_input\n");
+            return arp_input(dev, nb);
         default:
-            printf("[net] Unknown eth type: 0x%x\n", ntohs(eth->eth_type));
+            net_dbg("Unknown eth type: 0x%x\n", nb->protocol);
+            net_stats.rx_dropped++;
             return -1;
     }
 
@@ -383,15 +819,39 @@ int eth_input(net_device_t *dev, uint8_t *data, uint32_t len) {
 /**
  * @brief IP输入处理
  */
-int ip_input(net_device_t *dev, uint8_t *data, uint32_t len) {
-    ip_hdr_t *ip = (ip_hdr_t *)data;
+int ip_input(net_device_t *dev, netbuf_t *nb) {
+    if (nb->len < IP_HDR_LEN) {
+        printf("[net] IP packet too short\n");
+        return -1;
+    }
+
+    ip_hdr_t *ip = (ip_hdr_t *)nb->data;
+    uint32_t hdr_len = (ip->ip_verhlen & 0x0F) * 4;
+    uint32_t total_len = ntohs(ip->ip_len);
+    uint32_t frame_len = netbuf_total_len(nb);   // 巨型帧跨多个接收缓冲区，挂在 frag 链上
+
+    if (hdr_len < IP_HDR_LEN || hdr_len > nb->len || total_len < hdr_len || total_len > frame_len) {
+        printf("[net] Bad IP header (hlen=%d, total=%d, frame=%d)\n",
+               hdr_len, total_len, frame_len);
+        return -1;
+    }
+
+    // 网卡没有校验过就软件校验 IP 头
+    if (nb->ip_summed != NETBUF_CSUM_UNNECESSARY &&
+        ip_fast_csum(ip, hdr_len / 4) != 0) {
+        printf("[net] Bad IP header checksum, dropping\n");
+        net_stats.rx_errors++;
+        return -1;
+    }
 
-    printf("[net] IP packet: proto=%d, src=%d.%d.%d.%d, dst=%d.%d.%d.%d\n",
-           ip->ip_proto,
-           (ip->ip_src >> 24) & 0xFF, (ip->ip_src >> 16) & 0xFF,
-           (ip->ip_src >> 8) & 0xFF, ip->ip_src & 0xFF,
-           (ip->ip_dst >> 24) & 0xFF, (ip->ip_dst >> 16) & 0xFF,
-           (ip->ip_dst >> 8) & 0xFF, ip->ip_dst & 0xFF);
+    nb->net_hdr = nb->data;
+
+    net_dbg("IP packet: proto=%d, src=%d.%d.%d.%d, dst=%d.%d.%d.%d\n",
+            ip->ip_proto,
+            (ip->ip_src >> 24) & 0xFF, (ip->ip_src >> 16) & 0xFF,
+            (ip->ip_src >> 8) & 0xFF, ip->ip_src & 0xFF,
+            (ip->ip_dst >> 24) & 0xFF, (ip->ip_dst >> 16) & 0xFF,
+            (ip->ip_dst >> 8) & 0xFF, ip->ip_dst & 0xFF);
 
     // 检查目标IP是否匹配
     uint32_t dst_ip = ntohl(ip->ip_dst);
@@ -406,127 +866,102 @@ int ip_input(net_device_t *dev, uint8_t *data, uint32_t len) {
         return -1;
     }
 
+    // 去掉以太网最小帧填充
+    netbuf_trim_total(nb, total_len);
+
+    // 分片交给重组队列，凑齐了才往上交；重组出来的数据报归这里释放
+    netbuf_t *whole = NULL;
+    if (ip->ip_off & htons(IP_MF | IP_OFFMASK)) {
+        whole = ip_defrag(nb);
+        if (!whole) {
+            return 0;
+        }
+        nb = whole;
+        ip = (ip_hdr_t *)nb->data;
+        hdr_len = (ip->ip_verhlen & 0x0F) * 4;
+    }
+
+    // 剥掉 IP 头
+    netbuf_pull(nb, hdr_len);
+
     // 根据协议分发
+    int ret = 0;
     switch (ip->ip_proto) {
         case IPPROTO_ICMP:
-            printf("[net] -> Calling icmp_input\n");
-            return icmp_input(dev, data + (ip->ip_verhlen & 0x0F) * 4,
-                             len - (ip->ip_verhlen & 0x0F) * 4);
+            net_dbg("-> Calling icmp_input\n");
+            ret = icmp_input(dev, nb);
+            break;
         case IPPROTO_UDP:
-            printf("[net] -> Calling udp_input\n");
-            return udp_input(dev, data + (ip->ip_verhlen & 0x0F) * 4,
-                             len - (ip->ip_verhlen & 0x0F) * 4);
+            net_dbg("-> Calling udp_input\n");
+            ret = udp_input(dev, nb);
+            break;
         case IPPROTO_TCP:
-            printf("[net] -> Calling tcp_input\n");
-            return tcp_input(dev, data + (ip->ip_verhlen & 0x0F) * 4,
-                             len - (ip->ip_verhlen & 0x0F) * 4);
+            net_dbg("-> Calling tcp_input\n");
+            ret = tcp_input(dev, nb);
+            break;
         default:
             printf("[net] Unknown IP protocol: %d\n", ip->ip_proto);
             break;
     }
 
-    return 0;
+    if (whole) {
+        netbuf_free(whole);
+    }
+    return ret;
 }
 
 /**
- * @brief IP输出处理
+ * @brief IP输出处理（nb->data 指向 IP 负载，接管 nb）
+ * @param dev 非 NULL 时只走经过该设备的路由
  */
 int ip_output(net_device_t *dev, uint32_t dst_ip, uint8_t protocol,
-              uint8_t *data, uint32_t len) {
-    printf("[net] IP output: dst=%d.%d.%d.%d, proto=%d, len=%d\n",
-           (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
-           (dst_ip >> 8) & 0xFF, dst_ip & 0xFF, protocol, len);
-
-    // 检查是否在同一子网
-    uint32_t net_dst = dst_ip;
-    uint32_t dst_network = dst_ip & dev->netmask;
-    uint32_t local_network = dev->ip_addr & dev->netmask;
-
-    printf("[net] Device IP: 0x%x (%d.%d.%d.%d)\n", dev->ip_addr,
-           (dev->ip_addr >> 24) & 0xFF, (dev->ip_addr >> 16) & 0xFF,
-           (dev->ip_addr >> 8) & 0xFF, dev->ip_addr & 0xFF);
-    printf("[net] Netmask: 0x%x (%d.%d.%d.%d)\n", dev->netmask,
-           (dev->netmask >> 24) & 0xFF, (dev->netmask >> 16) & 0xFF,
-           (dev->netmask >> 8) & 0xFF, dev->netmask & 0xFF);
-    printf("[net] Subnet check: dst_network=%d.%d.%d.%d, local_network=%d.%d.%d.%d\n",
-           (dst_network >> 24) & 0xFF, (dst_network >> 16) & 0xFF,
-           (dst_network >> 8) & 0xFF, dst_network & 0xFF,
-           (local_network >> 24) & 0xFF, (local_network >> 16) & 0xFF,
-           (local_network >> 8) & 0xFF, local_network & 0xFF);
-
-    if (dst_network != local_network) {
-        // 不同子网，使用网关
-        printf("[net] Different subnet detected!\n");
-        if (dev->gateway != 0) {
-            printf("[net] Using gateway: %d.%d.%d.%d\n",
-                   (dev->gateway >> 24) & 0xFF, (dev->gateway >> 16) & 0xFF,
-                   (dev->gateway >> 8) & 0xFF, dev->gateway & 0xFF);
-            net_dst = dev->gateway;
-        } else {
-            printf("[net] ERROR: Different subnet but no gateway configured\n");
-            return -1;
-        }
-    } else {
-        printf("[net] Same subnet, direct delivery\n");
-    }
-
-    // 🔥 解析目标MAC地址（使用新的 ARP cache lookup）
-    uint8_t *dst_mac = arp_cache_lookup(net_dst);
-
-    if (!dst_mac) {
-        // 没有 MAC，先发送 ARP 请求
-        printf("[net] ARP cache miss, sending request for %d.%d.%d.%d\n",
-               (net_dst >> 24) & 0xFF, (net_dst >> 16) & 0xFF,
-               (net_dst >> 8) & 0xFF, net_dst & 0xFF);
-        arp_send_request(dev, net_dst);
-
-        // 🔥 等待 ARP reply（中断驱动）
-        printf("[net] Waiting for ARP reply (interrupt-driven)...\n");
+              netbuf_t *nb) {
+    dst_cache_t rt;
 
-        for (int retry = 0; retry < 5; retry++) {
-            // 等待一段时间（约 100ms）
-            for (volatile int i = 0; i < 10000000; i++) {
-                asm volatile("nop");
-            }
-
-            // 检查 ARP 表（中断处理程序会更新）
-            dst_mac = arp_cache_lookup(net_dst);
-            if (dst_mac) {
-                printf("[net] ARP resolved after %d retries!\n", retry + 1);
-                break;
-            }
+    if (route_lookup(dst_ip, dev, &rt) < 0) {
+        printf("[net] ip_output: no route to %d.%d.%d.%d\n",
+               (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
+               (dst_ip >> 8) & 0xFF, dst_ip & 0xFF);
+        netbuf_free(nb);
+        return -1;
+    }
+    return ip_output_dst(&rt, dst_ip, protocol, nb);
+}
 
-            printf("[net] ARP retry %d/5...\n", retry + 1);
-        }
+// IP 标识：每个发出的数据报一个
+static uint16_t ip_next_id(void) {
+    static uint16_t ip_id = 1;
+    uint32_t flags = net_irq_save();
+    uint16_t id = ip_id++;
+    net_irq_restore(flags);
+    return id;
+}
 
-        // 如果还是没有 MAC，放弃
-        if (!dst_mac) {
-            printf("[net] ARP resolution timeout, packet queued\n");
-            return -1;
-        }
-    } else {
-        printf("[net] ARP cache hit: %d.%d.%d.%d -> %02x:%02x:%02x:%02x:%02x:%02x\n",
-               (net_dst >> 24) & 0xFF, (net_dst >> 16) & 0xFF,
-               (net_dst >> 8) & 0xFF, net_dst & 0xFF,
-               dst_mac[0], dst_mac[1], dst_mac[2],
-               dst_mac[3], dst_mac[4], dst_mac[5]);
-    }
-
-    // 分配IP包缓冲区
-    uint32_t total_len = sizeof(ip_hdr_t) + len;
-    uint8_t *packet = (uint8_t *)kmalloc(total_len);
-    if (!packet) {
-        printf("[net] Failed to allocate IP packet\n");
+/**
+ * @brief 按已查好的路由发送（nb->data 指向 IP 负载，接管 nb）
+ */
+int ip_output_dst(const dst_cache_t *rt, uint32_t dst_ip, uint8_t protocol,
+                  netbuf_t *nb) {
+    net_device_t *dev = rt->dev;
+
+    net_dbg("IP output: dst=%d.%d.%d.%d via %s, proto=%d, len=%d\n",
+            (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
+            (dst_ip >> 8) & 0xFF, dst_ip & 0xFF, dev->name, protocol, nb->len);
+
+    // 在负载前面加上 IP 头（原地，不拷贝负载）
+    ip_hdr_t *ip = (ip_hdr_t *)netbuf_push(nb, sizeof(ip_hdr_t));
+    if (!ip) {
+        printf("[net] ip_output: no headroom for IP header\n");
+        netbuf_free(nb);
         return -1;
     }
-
-    ip_hdr_t *ip = (ip_hdr_t *)packet;
+    nb->net_hdr = (uint8_t *)ip;
 
     // 填充IP头部
     ip->ip_verhlen = 0x45;  // Version=4, IHL=5 (20 bytes)
-    ip->ip_tos = 0;
-    ip->ip_len = htons(total_len);
-    ip->ip_id = htons(1);  // 简单的ID
+    ip->ip_tos = nb->tos;
+    ip->ip_len = htons(netbuf_total_len(nb));
+    ip->ip_id = htons(ip_next_id());  // 分片重组靠 (src, dst, id, proto) 区分数据报
     ip->ip_off = 0;
     ip->ip_ttl = IP_TTL;
     ip->ip_proto = protocol;
@@ -534,25 +969,36 @@ int ip_output(net_device_t *dev, uint32_t dst_ip, uint8_t protocol,
     ip->ip_src = htonl(dev->ip_addr);  // 🔥 转换为网络字节序
     ip->ip_dst = htonl(dst_ip);         // 🔥 转换为网络字节序
 
-    // 计算IP校验和
-    ip->ip_sum = internet_checksum((uint16_t *)ip, sizeof(ip_hdr_t));
+    // 计算IP校验和（CSUM_PARTIAL 时由网卡和 L4 校验和一起插入；回环不出本机，不用算）
+    if (nb->ip_summed != NETBUF_CSUM_PARTIAL && !(dev->features & NETIF_F_LOOPBACK)) {
+        ip->ip_sum = ip_fast_csum(ip, sizeof(ip_hdr_t) / 4);
+    }
 
-    // 复制数据
-    memcpy(packet + sizeof(ip_hdr_t), data, len);
+    // 回环：不分片、不查邻居、不加以太网头，整个 netbuf 直接进接收队列
+    if (dev->features & NETIF_F_LOOPBACK) {
+        return loopback_output(dev, nb);
+    }
 
-    // 通过以太网发送
-    printf("[net] -> Calling eth_send (IP packet)\n");
-    int ret = eth_send(dev, dst_mac, ETH_P_IP, packet, total_len);
+    // 超过出口 MTU 就分片（TSO 请求由网卡切分）
+    if (!nb->gso_size && netbuf_total_len(nb) > dev->mtu) {
+        return ip_fragment(dev, rt->next_hop, nb);
+    }
 
-    kfree(packet);
-    return ret;
+    // 交给邻居子系统：已解析就直接发，否则挂起等 ARP 应答（不等待）
+    return neigh_output(dev, rt->next_hop, nb);
 }
 
 /**
  * @brief ICMP输入处理
  */
-int icmp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
-    icmp_hdr_t *icmp = (icmp_hdr_t *)data;
+int icmp_input(net_device_t *dev, netbuf_t *nb) {
+    if (nb->len < sizeof(icmp_hdr_t)) {
+        printf("[net] ICMP packet too short\n");
+        return -1;
+    }
+
+    icmp_hdr_t *icmp = (icmp_hdr_t *)nb->data;
+    nb->trans_hdr = nb->data;
 
     printf("[net] ICMP: type=%d, code=%d\n", icmp->icmp_type, icmp->icmp_code);
 
@@ -561,43 +1007,25 @@ int icmp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
             SET_COLOR_RED();
             printf("[net] Ping request received, sending reply\n");
 
-            // 获取IP头部（需要回退到IP层）
-            // 注意：data 指向 ICMP 头，前面是 IP 头
-            ip_hdr_t *ip = (ip_hdr_t *)((uint8_t *)data - sizeof(ip_hdr_t));
+            // IP 头由 ip_input 记录在 nb->net_hdr
+            ip_hdr_t *ip = (ip_hdr_t *)nb->net_hdr;
 
             // 🔥 调试：验证 IP 头位置
             printf("[net]   IP header located at: 0x%x (data at 0x%x)\n",
-                   (uint32_t)ip, (uint32_t)data);
+                   (uint32_t)ip, (uint32_t)nb->data);
             printf("[net]   IP src (network): 0x%08x\n", ip->ip_src);
             printf("[net]   IP dst (network): 0x%08x\n", ip->ip_dst);
 
-            // 打印原始 ICMP 包信息
-            icmp_hdr_t *icmp_req = (icmp_hdr_t *)data;
             printf("[net]   ICMP id=0x%04x, seq=%d\n",
-                   ntohs(icmp_req->icmp_id), ntohs(icmp_req->icmp_seq));
-
-            // 构造ICMP应答
-            uint16_t icmp_len = len;
-            uint8_t *reply_buf = (uint8_t *)kmalloc(icmp_len);
-            if (!reply_buf) {
-                printf("[net] Failed to allocate ICMP reply\n");
-                return -1;
-            }
-
-            icmp_hdr_t *icmp_reply = (icmp_hdr_t *)reply_buf;
-
-            // 复制原始ICMP包并修改类型
-            memcpy(reply_buf, data, icmp_len);
-            icmp_reply->icmp_type = ICMP_ECHO_REPLY;
-            icmp_reply->icmp_sum = 0;  // 清零校验和
+                   ntohs(icmp->icmp_id), ntohs(icmp->icmp_seq));
 
             // 🔥 调试：打印 payload 长度
-            uint16_t payload_len = icmp_len - sizeof(icmp_hdr_t);
+            uint16_t payload_len = nb->len - sizeof(icmp_hdr_t);
             printf("[net]   Payload len: %d bytes\n", payload_len);
 
             // 🔥 调试：打印 payload 内容（前 16 字节）
             if (payload_len > 0) {
-                uint8_t *payload = reply_buf + sizeof(icmp_hdr_t);
+                uint8_t *payload = nb->data + sizeof(icmp_hdr_t);
                 printf("[net]   Payload: ");
                 for (int i = 0; i < 16 && i < payload_len; i++) {
                     printf("%02x ", payload[i]);
@@ -605,26 +1033,27 @@ int icmp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
                 printf("\n");
             }
 
-            // 计算新的校验和
-            icmp_reply->icmp_sum = internet_checksum((uint16_t *)reply_buf, icmp_len);
+            // 原地把请求改成应答：只改类型和校验和，负载不动
+            uint32_t src_ip = ntohl(ip->ip_src);  // 🔥 先取出源 IP，IP 头马上会被覆盖
+            // 类型和代码同在第一个 16 位字里，按 RFC 1624 增量更新校验和
+            uint16_t old_word = *(uint16_t *)icmp;
+            uint16_t icmp_sum = icmp->icmp_sum;
+            icmp->icmp_type = ICMP_ECHO_REPLY;
+            csum_replace2(&icmp_sum, old_word, *(uint16_t *)icmp);
+            icmp->icmp_sum = icmp_sum;
 
-            printf("[net]   ICMP checksum: 0x%04x\n", ntohs(icmp_reply->icmp_sum));
+            printf("[net]   ICMP checksum: 0x%04x\n", ntohs(icmp->icmp_sum));
             printf("[net]   Reply ICMP id=0x%04x, seq=%d\n",
-                   ntohs(icmp_reply->icmp_id), ntohs(icmp_reply->icmp_seq));
+                   ntohs(icmp->icmp_id), ntohs(icmp->icmp_seq));
 
-            // 通过IP发送应答（使用网络字节序的 IP 地址）
-            uint32_t src_ip = ntohl(ip->ip_src);  // 🔥 从 IP 头获取源 IP（网络字节序）
-            printf("[net]   Sending reply to %d.%d.%d.%d (network: 0x%08x)\n",
+            printf("[net]   Sending reply to %d.%d.%d.%d\n",
                    (src_ip >> 24) & 0xFF, (src_ip >> 16) & 0xFF,
-                   (src_ip >> 8) & 0xFF, src_ip & 0xFF, ip->ip_src);
+                   (src_ip >> 8) & 0xFF, src_ip & 0xFF);
             printf("[net] -> Calling ip_output (ICMP reply)\n");
-            ip_output(dev, src_ip, IPPROTO_ICMP, reply_buf, icmp_len);
 
-            // 🔥 暂时不释放 buffer（调试用）
-            // for (volatile int i = 0; i < 10000; i++) {
-            //     asm volatile("nop");
-            // }
-            // kfree(reply_buf);
+            // 剥掉的以太网头和 IP 头正好留作应答的 headroom；
+            // ip_output 接管一个引用，net_rx_netbuf 仍释放自己那个
+            ip_output(dev, src_ip, IPPROTO_ICMP, netbuf_get(nb));
 
             SET_COLOR_GREEN();
             break;
@@ -644,14 +1073,15 @@ int icmp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
  * @brief 发送 ICMP Echo Request (Ping)
  */
 int icmp_send_echo(net_device_t *dev, uint32_t dst_ip, uint16_t id, uint16_t seq) {
-    // 分配 ICMP 包
+    // 分配 ICMP 包（前面预留各层头部空间）
     uint32_t icmp_len = sizeof(icmp_hdr_t) + 4;  // 头部 + 4 字节时间戳/数据
-    uint8_t *packet = (uint8_t *)kmalloc(icmp_len);
-    if (!packet) {
+    netbuf_t *nb = netbuf_alloc(NETBUF_HEADROOM);
+    if (!nb) {
         printf("[net] Failed to allocate ICMP echo packet\n");
         return -1;
     }
 
+    uint8_t *packet = netbuf_put(nb, icmp_len);
     icmp_hdr_t *icmp = (icmp_hdr_t *)packet;
 
     // 填充 ICMP 头部
@@ -670,314 +1100,213 @@ int icmp_send_echo(net_device_t *dev, uint32_t dst_ip, uint16_t id, uint16_t seq
 
     // 通过 IP 发送
     printf("[net] -> Calling ip_output (ICMP echo request)\n");
-    int ret = ip_output(dev, dst_ip, IPPROTO_ICMP, packet, icmp_len);
-
-    kfree(packet);
-    return ret;
+    return ip_output(dev, dst_ip, IPPROTO_ICMP, nb);
 }
 
 /**
- * @brief UDP输入处理
+ * @brief UDP输入处理：校验后交给套接字层
  */
-int udp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
-    udp_hdr_t *udp = (udp_hdr_t *)data;
+int udp_input(net_device_t *dev, netbuf_t *nb) {
+    udp_hdr_t *udp = (udp_hdr_t *)nb->data;
+    ip_hdr_t *ip = (ip_hdr_t *)nb->net_hdr;
 
-    if (len < sizeof(udp_hdr_t)) {
+    if (nb->len < sizeof(udp_hdr_t) || !ip) {
         printf("[net] UDP packet too short\n");
         return -1;
     }
 
-    printf("[net] UDP: sport=%d, dport=%d, len=%d\n",
-           ntohs(udp->udp_sport), ntohs(udp->udp_dport), ntohs(udp->udp_len));
-
-    // 提取UDP数据
-    uint8_t *udp_data = data + sizeof(udp_hdr_t);
-    uint32_t udp_data_len = len - sizeof(udp_hdr_t);
+    uint32_t udp_len = ntohs(udp->udp_len);
+    uint32_t ip_payload = netbuf_total_len(nb);
+    // 重组出来的数据报带 frag 链，长度必须和 IP 负载一致
+    if (udp_len < sizeof(udp_hdr_t) || udp_len > ip_payload ||
+        (nb->frag && udp_len != ip_payload)) {
+        printf("[net] Bad UDP length %d (payload %d)\n", udp_len, ip_payload);
+        net_stats.rx_errors++;
+        return -1;
+    }
+    netbuf_trim(nb, udp_len);
 
-    if (udp_data_len > 0) {
-        printf("[net] UDP data: ");
-        for (uint32_t i = 0; i < udp_data_len && i < 32; i++) {
-            printf("%c", udp_data[i]);
-        }
-        printf("\n");
+    // 校验和为 0 表示发送方没有计算
+    if (udp->udp_sum != 0 && nb->ip_summed != NETBUF_CSUM_UNNECESSARY &&
+        csum_fold(csum_netbuf(nb, csum_tcpudp_nofold(ip->ip_src, ip->ip_dst,
+                                                     udp_len, IPPROTO_UDP, 0))) != 0) {
+        printf("[net] Bad UDP checksum, dropping\n");
+        net_stats.rx_errors++;
+        return -1;
     }
 
-    // TODO: 将数据传递给应用层套接字
+    nb->trans_hdr = nb->data;
 
-    return 0;
+    net_dbg("UDP: sport=%d, dport=%d, len=%d\n",
+            ntohs(udp->udp_sport), ntohs(udp->udp_dport), udp_len);
+
+    netbuf_pull(nb, sizeof(udp_hdr_t));
+    return sock_udp_deliver(nb, ntohl(ip->ip_src), ntohs(udp->udp_sport),
+                            ntohl(ip->ip_dst), ntohs(udp->udp_dport));
 }
 
 /**
- * @brief UDP输出处理
+ * @brief UDP输出处理（拷贝用户数据到 netbuf，全程唯一一次拷贝）
  */
 int udp_output(net_device_t *dev, uint32_t dst_ip, uint16_t src_port,
                uint16_t dst_port, uint8_t *data, uint32_t len) {
-    printf("[net] UDP output: dst=%d.%d.%d.%d, sport=%d, dport=%d, len=%d\n",
-           (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
-           (dst_ip >> 8) & 0xFF, dst_ip & 0xFF,
-           src_port, dst_port, len);
-
-    // 分配UDP包缓冲区
-    uint32_t total_len = sizeof(udp_hdr_t) + len;
-    uint8_t *packet = (uint8_t *)kmalloc(total_len);
-    if (!packet) {
+    if (len > IP_MAX_LEN - IP_HDR_LEN - sizeof(udp_hdr_t)) {
+        printf("[net] UDP payload too large (%d)\n", len);
+        return -1;
+    }
+    // 超过 MTU 的数据报由 ip_output 分片
+    netbuf_t *nb = netbuf_from_chain(data, len, NETBUF_HEADROOM);
+    if (!nb) {
         printf("[net] Failed to allocate UDP packet\n");
         return -1;
     }
 
-    udp_hdr_t *udp = (udp_hdr_t *)packet;
-
-    // 填充UDP头部
-    udp->udp_sport = htons(src_port);
-    udp->udp_dport = htons(dst_port);
-    udp->udp_len = htons(total_len);
-    udp->udp_sum = 0;  // UDP校验和可选，这里设为0
-
-    // 复制数据
-    memcpy(packet + sizeof(udp_hdr_t), data, len);
-
-    // 通过IP发送
-    printf("[net] -> Calling ip_output (UDP)\n");
-    int ret = ip_output(dev, dst_ip, IPPROTO_UDP, packet, total_len);
-
-    kfree(packet);
-    return ret;
+    return udp_output_netbuf(dev, dst_ip, src_port, dst_port, nb);
 }
 
 /**
- * @brief TCP输入处理
+ * @brief UDP输出处理（nb->data 指向 UDP 负载，接管 nb）
+ * @param dev 非 NULL 时只走经过该设备的路由
  */
-int tcp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
-    tcp_hdr_t *tcp = (tcp_hdr_t *)data;
+int udp_output_netbuf(net_device_t *dev, uint32_t dst_ip, uint16_t src_port,
+                      uint16_t dst_port, netbuf_t *nb) {
+    dst_cache_t rt;
 
-    if (len < sizeof(tcp_hdr_t)) {
-        printf("[net] TCP packet too short\n");
+    if (route_lookup(dst_ip, dev, &rt) < 0) {
+        netbuf_free(nb);
         return -1;
     }
+    return udp_output_dst(&rt, dst_ip, src_port, dst_port, nb);
+}
 
-    uint8_t tcp_hdr_len = (tcp->tcp_off >> 4) * 4;
-
-    printf("[net] TCP: sport=%d, dport=%d, flags=0x%x, seq=%d, ack=%d\n",
-           ntohs(tcp->tcp_sport), ntohs(tcp->tcp_dport),
-           tcp->tcp_flags, ntohl(tcp->tcp_seq), ntohl(tcp->tcp_ack));
-
-    // 处理TCP标志位
-    if (tcp->tcp_flags & TCP_SYN) {
-        printf("[net] TCP SYN received\n");
-        // TODO: 发送 SYN-ACK
-    }
-
-    if (tcp->tcp_flags & TCP_ACK) {
-        printf("[net] TCP ACK received\n");
-    }
-
-    if (tcp->tcp_flags & TCP_FIN) {
-        printf("[net] TCP FIN received\n");
-        // TODO: 关闭连接
+/**
+ * @brief 按已查好的路由发送 UDP（套接字用自己缓存的路由）
+ */
+int udp_output_dst(const dst_cache_t *rt, uint32_t dst_ip, uint16_t src_port,
+                   uint16_t dst_port, netbuf_t *nb) {
+    net_device_t *dev = rt->dev;
+
+    net_dbg("UDP output: dst=%d.%d.%d.%d, sport=%d, dport=%d, len=%d\n",
+            (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
+            (dst_ip >> 8) & 0xFF, dst_ip & 0xFF,
+            src_port, dst_port, nb->len);
+
+    udp_hdr_t *udp = (udp_hdr_t *)netbuf_push(nb, sizeof(udp_hdr_t));
+    if (!udp) {
+        printf("[net] udp_output: no headroom for UDP header\n");
+        netbuf_free(nb);
+        return -1;
     }
+    nb->trans_hdr = (uint8_t *)udp;
 
-    if (tcp->tcp_flags & TCP_PSH) {
-        printf("[net] TCP PSH (data) received\n");
-
-        // 提取TCP数据
-        uint8_t *tcp_data = data + tcp_hdr_len;
-        uint32_t tcp_data_len = len - tcp_hdr_len;
-
-        if (tcp_data_len > 0) {
-            printf("[net] TCP data: ");
-            for (uint32_t i = 0; i < tcp_data_len && i < 32; i++) {
-                printf("%c", tcp_data[i]);
-            }
-            printf("\n");
-        }
+    // 填充UDP头部
+    udp->udp_sport = htons(src_port);
+    udp->udp_dport = htons(dst_port);
+    udp->udp_len = htons(netbuf_total_len(nb));
+    udp->udp_sum = 0;  // UDP校验和可选，软件路径设为0
+
+    // 网卡能插入校验和就顺手带上：校验和字段先放伪头部和；
+    // 要分片的数据报网卡插不了，软件算，接收端靠它发现重组出错
+    uint32_t udp_len = netbuf_total_len(nb);
+    if (IP_HDR_LEN + udp_len > dev->mtu) {
+        uint16_t sum = csum_fold(csum_netbuf(nb, csum_tcpudp_nofold(htonl(dev->ip_addr), htonl(dst_ip),
+                                                                    udp_len, IPPROTO_UDP, 0)));
+        udp->udp_sum = sum ? sum : 0xFFFF;
+    } else if (dev->features & NETIF_F_IP_CSUM) {
+        nb->ip_summed = NETBUF_CSUM_PARTIAL;
+        nb->csum_offset = 6;  // udp_sum
+        udp->udp_sum = (uint16_t)~csum_fold(csum_tcpudp_nofold(htonl(dev->ip_addr), htonl(dst_ip),
+                                                               netbuf_total_len(nb), IPPROTO_UDP, 0));
     }
 
-    // TODO: 将数据传递给应用层套接字
-
-    return 0;
+    // 通过IP发送
+    net_dbg("-> Calling ip_output (UDP)\n");
+    return ip_output_dst(rt, dst_ip, IPPROTO_UDP, nb);
 }
 
 /**
- * @brief 计算TCP校验和（包含伪头部）
+ * @brief 累加整个分片链
+ *
+ * 前面各段总长为奇数时，本段的字节落在 16 位字的高半部分，
+ * 把本段的和按字节交换后再加即可。
  */
-static uint16_t tcp_checksum(net_device_t *dev, uint32_t dst_ip,
-                              uint8_t *data, uint32_t len) {
-    // TCP伪头部
-    struct {
-        uint32_t src_ip;
-        uint32_t dst_ip;
-        uint8_t  zero;
-        uint8_t  protocol;
-        uint16_t tcp_len;
-    } pseudo_hdr;
-
-    pseudo_hdr.src_ip = dev->ip_addr;
-    pseudo_hdr.dst_ip = dst_ip;
-    pseudo_hdr.zero = 0;
-    pseudo_hdr.protocol = IPPROTO_TCP;
-    pseudo_hdr.tcp_len = htons(len);
-
-    // 分配临时缓冲区
-    uint32_t total_len = sizeof(pseudo_hdr) + len;
-    uint16_t *buffer = (uint16_t *)kmalloc(total_len);
-    if (!buffer) {
-        return 0;
+uint32_t csum_netbuf(const netbuf_t *nb, uint32_t sum) {
+    int odd = 0;
+
+    for (; nb; nb = nb->frag) {
+        uint32_t part = csum_partial(nb->data, nb->len, 0);
+        if (odd) {
+            // 32 位部分和按字节轮转 8 位，等价于 16 位和字节交换（模 0xFFFF）
+            part = (part << 8) | (part >> 24);
+        }
+        sum = csum_add(sum, part);
+        odd ^= nb->len & 1;
     }
-
-    // 复制伪头部和数据
-    memcpy(buffer, &pseudo_hdr, sizeof(pseudo_hdr));
-    memcpy((uint8_t *)buffer + sizeof(pseudo_hdr), data, len);
-
-    // 计算校验和
-    uint16_t sum = internet_checksum(buffer, total_len);
-
-    kfree(buffer);
     return sum;
 }
 
 /**
- * @brief TCP输出处理
+ * @brief ARP输入处理（nb->data 指向 ARP 头）
  */
-int tcp_output(net_device_t *dev, uint32_t dst_ip, uint16_t src_port,
-               uint16_t dst_port, uint32_t seq, uint32_t ack,
-               uint8_t flags, uint8_t *data, uint32_t len) {
-    printf("[net] TCP output: dst=%d.%d.%d.%d, sport=%d, dport=%d, flags=0x%x\n",
-           (dst_ip >> 24) & 0xFF, (dst_ip >> 16) & 0xFF,
-           (dst_ip >> 8) & 0xFF, dst_ip & 0xFF,
-           src_port, dst_port, flags);
-
-    // 计算TCP头部长度（至少20字节）
-    uint8_t tcp_hdr_len = 5;  // 5 * 4 = 20 bytes
-
-    // 分配TCP包缓冲区
-    uint32_t total_len = tcp_hdr_len * 4 + len;
-    uint8_t *packet = (uint8_t *)kmalloc(total_len);
-    if (!packet) {
-        printf("[net] Failed to allocate TCP packet\n");
+int arp_input(net_device_t *dev, netbuf_t *nb) {
+    if (nb->len < sizeof(arp_hdr_t) || !nb->mac_hdr) {
+        printf("[arp] packet too short\n");
         return -1;
     }
 
-    tcp_hdr_t *tcp = (tcp_hdr_t *)packet;
-
-    // 填充TCP头部
-    tcp->tcp_sport = htons(src_port);
-    tcp->tcp_dport = htons(dst_port);
-    tcp->tcp_seq = htonl(seq);
-    tcp->tcp_ack = htonl(ack);
-    tcp->tcp_off = (tcp_hdr_len << 4);  // 数据偏移
-    tcp->tcp_flags = flags;
-    tcp->tcp_win = htons(8192);  // 窗口大小
-    tcp->tcp_urg = 0;
-    tcp->tcp_sum = 0;
+    eth_hdr_t *eth = (eth_hdr_t *)nb->mac_hdr;
+    arp_hdr_t *arp = (arp_hdr_t *)nb->data;
+    nb->net_hdr = nb->data;
 
-    // 复制数据
-    if (data && len > 0) {
-        memcpy(packet + tcp_hdr_len * 4, data, len);
+    // 检查硬件类型和协议类型
+    if (ntohs(arp->arp_hrd) != ARPHRD_ETHER || ntohs(arp->arp_pro) != ETH_P_IP) {
+        printf("[arp] unsupported hardware or protocol\n");
+        return -1;
     }
 
-    // 计算TCP校验和（包含伪头部）
-    tcp->tcp_sum = tcp_checksum(dev, dst_ip, packet, total_len);
+    uint16_t oper = ntohs(arp->arp_op);
 
-    // 通过IP发送
-    printf("[net] -> Calling ip_output (TCP)\n");
-    int ret = ip_output(dev, dst_ip, IPPROTO_TCP, packet, total_len);
+    // 分两种情况处理
+    if (oper == ARPOP_REQUEST) {
+        // ARP request：别人问我
+        arp_handle_request(dev, eth, arp);
+    } else if (oper == ARPOP_REPLY) {
+        // ARP reply：别人告诉我
+        arp_handle_reply(dev, eth, arp);
+    } else {
+        printf("[arp] unknown oper=%d\n", oper);
+    }
 
-    kfree(packet);
-    return ret;
+    return 0;
 }
 
 /**
- * @brief ARP输入处理
+ * @brief 分配一个 ARP 包（nb->data 指向 ARP 头），填好固定字段
  */
-int arp_input(net_device_t *dev, uint8_t *data, uint32_t len) {
-    if (len < sizeof(arp_hdr_t)) {
-        printf("[net] ARP packet too short\n");
-        return -1;
+static netbuf_t *arp_alloc(uint16_t oper, arp_hdr_t **out) {
+    netbuf_t *nb = netbuf_alloc(NETBUF_HEADROOM);
+    if (!nb) {
+        printf("[arp] Failed to allocate ARP packet\n");
+        return NULL;
     }
 
-    arp_hdr_t *arp = (arp_hdr_t *)data;
-
-    printf("[net] ARP: op=%d\n", ntohs(arp->arp_op));
-    printf("[net]   Sender:    MAC=%02x:%02x:%02x:%02x:%02x:%02x, IP=%d.%d.%d.%d\n",
-           arp->arp_sha[0], arp->arp_sha[1], arp->arp_sha[2],
-           arp->arp_sha[3], arp->arp_sha[4], arp->arp_sha[5],
-           (ntohl(arp->arp_spa) >> 24) & 0xFF, (ntohl(arp->arp_spa) >> 16) & 0xFF,
-           (ntohl(arp->arp_spa) >> 8) & 0xFF, ntohl(arp->arp_spa) & 0xFF);
-    printf("[net]   Target:    MAC=%02x:%02x:%02x:%02x:%02x:%02x, IP=%d.%d.%d.%d\n",
-           arp->arp_tha[0], arp->arp_tha[1], arp->arp_tha[2],
-           arp->arp_tha[3], arp->arp_tha[4], arp->arp_tha[5],
-           (ntohl(arp->arp_tpa) >> 24) & 0xFF, (ntohl(arp->arp_tpa) >> 16) & 0xFF,
-           (ntohl(arp->arp_tpa) >> 8) & 0xFF, ntohl(arp->arp_tpa) & 0xFF);
-
-    // 检查硬件类型和协议类型
-    if (ntohs(arp->arp_hrd) != ARPHRD_ETHER || ntohs(arp->arp_pro) != ETH_P_IP) {
-        printf("[net] ARP: unsupported hardware or protocol\n");
-        return -1;
-    }
-
-    // 处理ARP请求
-    if (ntohs(arp->arp_op) == ARPOP_REQUEST) {
-        // 🔥 检查是否询问我们的IP（使用全局 local_ip）
-        extern uint32_t local_ip;
-        uint32_t tpa = ntohl(arp->arp_tpa);  // 🔥 转换为主机字节序
-
-        if (tpa == local_ip) {
-            printf("[net] ARP request for our IP, sending reply\n");
-            printf("[net]   Target IP in ARP: %d.%d.%d.%d\n",
-                   (tpa >> 24) & 0xFF, (tpa >> 16) & 0xFF,
-                   (tpa >> 8) & 0xFF, tpa & 0xFF);
-            printf("[net]   Our local_ip: %d.%d.%d.%d\n",
-                   (local_ip >> 24) & 0xFF, (local_ip >> 16) & 0xFF,
-                   (local_ip >> 8) & 0xFF, local_ip & 0xFF);
-
-            // 构造ARP应答
-            arp_hdr_t arp_reply;
-            arp_reply.arp_hrd = htons(ARPHRD_ETHER);
-            arp_reply.arp_pro = htons(ETH_P_IP);
-            arp_reply.arp_hln = ETH_ALEN;
-            arp_reply.arp_pln = 4;
-            arp_reply.arp_op = htons(ARPOP_REPLY);
-
-            // 发送方MAC和IP（我们）- 使用全局 local_mac
-            extern uint8_t local_mac[ETH_ALEN];
-            memcpy(arp_reply.arp_sha, local_mac, ETH_ALEN);
-            arp_reply.arp_spa = local_ip;
-
-            // 目标MAC和IP（请求方）
-            memcpy(arp_reply.arp_tha, arp->arp_sha, ETH_ALEN);
-            arp_reply.arp_tpa = arp->arp_spa;
-
-            // 发送ARP应答
-            eth_send(dev, arp->arp_sha, ETH_P_ARP, (uint8_t *)&arp_reply, sizeof(arp_hdr_t));
-            printf("[net] ARP reply sent to %02x:%02x:%02x:%02x:%02x:%02x\n",
-                   arp->arp_sha[0], arp->arp_sha[1], arp->arp_sha[2],
-                   arp->arp_sha[3], arp->arp_sha[4], arp->arp_sha[5]);
-
-            // 同时更新ARP缓存（转换为主机字节序）
-            arp_cache_update(ntohl(arp->arp_spa), arp->arp_sha);
-        } else {
-            printf("[net] ARP request NOT for us (tpa=%08x, local_ip=%08x)\n",
-                   tpa, local_ip);
-        }
-    }
-    // 处理ARP应答
-    else if (ntohs(arp->arp_op) == ARPOP_REPLY) {
-        printf("[net] ARP reply received\n");
-        // 🔥 转换为主机字节序再存入缓存
-        arp_cache_update(ntohl(arp->arp_spa), arp->arp_sha);
-    }
-    else {
-        printf("[net] Unknown ARP operation: %d\n", ntohs(arp->arp_op));
-    }
+    arp_hdr_t *arp = (arp_hdr_t *)netbuf_put(nb, sizeof(arp_hdr_t));
+    memset(arp, 0, sizeof(arp_hdr_t));
+    arp->arp_hrd = htons(ARPHRD_ETHER);
+    arp->arp_pro = htons(ETH_P_IP);
+    arp->arp_hln = ETH_ALEN;
+    arp->arp_pln = 4;
+    arp->arp_op = htons(oper);
 
-    return 0;
+    *out = arp;
+    return nb;
 }
 
 /**
  * @brief 处理 ARP Request（别人问我"谁是某 IP"）
  */
 void arp_handle_request(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp) {
-    extern uint32_t local_ip;
+    uint32_t local_ip = dev->ip_addr;       // 多网卡时每块网卡只回答自己的地址
 
     // 🔍 调试：打印完整的 ARP request 包内容
     uint32_t spa = ntohl(arp->arp_spa);
@@ -993,10 +1322,12 @@ void arp_handle_request(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp) {
     // 检查是否是给我们的
     if (tpa != local_ip) {
         printf("[arp] request: not for us (tpa != local_ip)\n");
+        // 只刷新已有表项，不为别人的请求新建
+        neigh_update(dev, spa, arp->arp_sha, 0);
         return;
     }
 
-    extern uint8_t local_mac[ETH_ALEN];
+    const uint8_t *local_mac = dev->mac_addr;
     printf("[arp] REPLY from %d.%d.%d.%d (%02x:%02x:%02x:%02x:%02x:%02x) to %d.%d.%d.%d\n",
            (local_ip >> 24) & 0xFF, (local_ip >> 16) & 0xFF,
            (local_ip >> 8) & 0xFF, local_ip & 0xFF,
@@ -1005,23 +1336,11 @@ void arp_handle_request(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp) {
            (spa >> 24) & 0xFF, (spa >> 16) & 0xFF,
            (spa >> 8) & 0xFF, spa & 0xFF);
 
-    uint8_t buf[64];
-
-    eth_hdr_t *reth = (eth_hdr_t *)buf;
-    arp_hdr_t *rarp = (arp_hdr_t *)(buf + sizeof(eth_hdr_t));
-
-    // Ethernet header
-    memcpy(reth->eth_dst, arp->arp_sha, 6);   // 对方 MAC
-    extern uint8_t local_mac[ETH_ALEN];
-    memcpy(reth->eth_src, local_mac, 6);      // 我 MAC
-    reth->eth_type = htons(ETH_P_ARP);
-
-    // ARP header
-    rarp->arp_hrd = htons(1);
-    rarp->arp_pro = htons(ETH_P_IP);
-    rarp->arp_hln = 6;
-    rarp->arp_pln = 4;
-    rarp->arp_op = htons(2); // reply
+    arp_hdr_t *rarp;
+    netbuf_t *nb = arp_alloc(ARPOP_REPLY, &rarp);
+    if (!nb) {
+        return;
+    }
 
     memcpy(rarp->arp_sha, local_mac, 6);
     rarp->arp_spa = htonl(local_ip);        // 🔥 转换为网络字节序
@@ -1029,73 +1348,48 @@ void arp_handle_request(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp) {
     memcpy(rarp->arp_tha, arp->arp_sha, 6);
     rarp->arp_tpa = arp->arp_spa;            // ✅ 已经是网络字节序，直接复制
 
-    // 发送
-    dev->send(dev, buf, sizeof(eth_hdr_t) + sizeof(arp_hdr_t));
+    // 发送（对方 MAC）
+    eth_output(dev, arp->arp_sha, ETH_P_ARP, nb);
 
     printf("[arp] reply sent to %02x:%02x:%02x:%02x:%02x:%02x\n",
            arp->arp_sha[0], arp->arp_sha[1], arp->arp_sha[2],
            arp->arp_sha[3], arp->arp_sha[4], arp->arp_sha[5]);
+
+    // 同时记下请求方（转换为主机字节序）
+    neigh_update(dev, spa, arp->arp_sha, 1);
 }
 
 /**
- * @brief ARP cache 查找
- * @return MAC 地址指针，如果未找到返回 NULL
+ * @brief 发送 ARP 请求（谁是 target_ip）
+ * @param dst_mac 单播确认时为对方 MAC，NULL 表示广播
+ *
+ * 邻居子系统的重发定时器也走这里，所以不打印调试信息。
  */
-uint8_t *arp_cache_lookup(uint32_t ip) {
-    // 🔍 调试：打印查找的 IP（主机字节序）
-    printf("[arp] lookup ip=%08x (%d.%d.%d.%d)\n",
-           ip, (ip >> 24) & 0xFF, (ip >> 16) & 0xFF,
-           (ip >> 8) & 0xFF, ip & 0xFF);
-
-    for (int i = 0; i < ARP_TABLE_SIZE; i++) {
-        if (arp_table[i].valid) {
-            printf("[arp]   entry[%d]: ip=%08x -> %d.%d.%d.%d\n", i,
-                   arp_table[i].ip,
-                   (arp_table[i].ip >> 24) & 0xFF,
-                   (arp_table[i].ip >> 16) & 0xFF,
-                   (arp_table[i].ip >> 8) & 0xFF,
-                   arp_table[i].ip & 0xFF);
-        }
-        if (arp_table[i].valid && arp_table[i].ip == ip) {
-            printf("[arp] cache HIT!\n");
-            return arp_table[i].mac;
-        }
+void arp_solicit(net_device_t *dev, uint32_t target_ip, const uint8_t *dst_mac) {
+    arp_hdr_t *arp;
+    netbuf_t *nb = arp_alloc(ARPOP_REQUEST, &arp);
+    if (!nb) {
+        return;
     }
 
-    printf("[arp] cache MISS\n");
-    return NULL;
+    memcpy(arp->arp_sha, dev->mac_addr, ETH_ALEN);
+    arp->arp_spa = htonl(dev->ip_addr);
+
+    memset(arp->arp_tha, 0x00, 6);
+    arp->arp_tpa = htonl(target_ip);
+
+    eth_output(dev, dst_mac ? dst_mac : eth_broadcast, ETH_P_ARP, nb);
+    // 请求要尽快发出去，挂起的包在等它；不能留在批量发送里
+    if (!net_tx_batching() && dev->tx_flush) {
+        dev->tx_flush(dev);
+    }
 }
 
 /**
- * @brief 发送 ARP 请求（谁是 target_ip）
+ * @brief 发送 ARP 请求（广播）
  */
 void arp_send_request(net_device_t *dev, uint32_t target_ip) {
-    uint8_t buf[64];
-    memset(buf, 0, sizeof(buf));
-
-    eth_hdr_t *eth = (eth_hdr_t *)buf;
-    arp_hdr_t *arp = (arp_hdr_t *)(buf + sizeof(eth_hdr_t));
-
-    // Ethernet header
-    memset(eth->eth_dst, 0xFF, 6);          // broadcast
-    extern uint8_t local_mac[ETH_ALEN];
-    memcpy(eth->eth_src, local_mac, 6);
-    eth->eth_type = htons(ETH_P_ARP);
-
-    // ARP header
-    arp->arp_hrd = htons(1);                  // Ethernet
-    arp->arp_pro = htons(ETH_P_IP);           // IPv4
-    arp->arp_hln = 6;
-    arp->arp_pln = 4;
-    arp->arp_op = htons(1);                  // request
-
-    memcpy(arp->arp_sha, local_mac, 6);
-    arp->arp_spa = htonl(local_ip);          // 🔥 转换为网络字节序
-
-    memset(arp->arp_tha, 0x00, 6);
-    arp->arp_tpa = htonl(target_ip);         // 🔥 转换为网络字节序
-
-    dev->send(dev, buf, sizeof(eth_hdr_t) + sizeof(arp_hdr_t));
+    arp_solicit(dev, target_ip, NULL);
 
     printf("[arp] send request: who-has %d.%d.%d.%d\n",
            (target_ip >> 24) & 0xFF, (target_ip >> 16) & 0xFF,
@@ -1106,7 +1400,7 @@ void arp_send_request(net_device_t *dev, uint32_t target_ip) {
  * @brief 处理 ARP Reply（别人告诉我"某 IP 的 MAC 是多少"）
  */
 void arp_handle_reply(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp) {
-    extern uint32_t local_ip;
+    uint32_t local_ip = dev->ip_addr;
 
     // 🔥 验证：ARP reply 的目标必须是我们
     if (ntohl(arp->arp_tpa) != local_ip) {
@@ -1133,58 +1427,8 @@ void arp_handle_reply(net_device_t *dev, eth_hdr_t *eth, arp_hdr_t *arp) {
            arp->arp_sha[0], arp->arp_sha[1], arp->arp_sha[2],
            arp->arp_sha[3], arp->arp_sha[4], arp->arp_sha[5]);
 
-    // 🔥 使用主机字节序存入 ARP 表
-    arp_cache_update(spa, arp->arp_sha);
-}
-
-/**
- * @brief 简化的 ARP 处理函数（专注于发送 Reply）
- */
-void arp_handle(net_device_t *dev, uint8_t *data, uint32_t len) {
-    if (len < sizeof(eth_hdr_t) + sizeof(arp_hdr_t)) {
-        printf("[arp] packet too short\n");
-        return;
-    }
-
-    eth_hdr_t *eth = (eth_hdr_t *)data;
-    arp_hdr_t *arp = (arp_hdr_t *)(data + sizeof(eth_hdr_t));
-
-    uint16_t oper = ntohs(arp->arp_op);
-
-    // 分两种情况处理
-    if (oper == 1) {
-        // ARP request：别人问我
-        arp_handle_request(dev, eth, arp);
-    } else if (oper == 2) {
-        // ARP reply：别人告诉我
-        arp_handle_reply(dev, eth, arp);
-    } else {
-        printf("[arp] unknown oper=%d\n", oper);
-    }
-}
-
-/**
- * @brief 更新ARP缓存
- */
-static void arp_cache_update(uint32_t ip_addr, uint8_t *mac_addr) {
-    // 🔍 调试：打印存入的 IP（主机字节序）
-    printf("[arp] cache insert ip=%08x (%d.%d.%d.%d) -> %02x:%02x:%02x:%02x:%02x:%02x\n",
-           ip_addr,
-           (ip_addr >> 24) & 0xFF, (ip_addr >> 16) & 0xFF,
-           (ip_addr >> 8) & 0xFF, ip_addr & 0xFF,
-           mac_addr[0], mac_addr[1], mac_addr[2],
-           mac_addr[3], mac_addr[4], mac_addr[5]);
-
-    // 查找空闲位置或更新已存在项
-    for (int i = 0; i < ARP_TABLE_SIZE; i++) {
-        if (!arp_table[i].valid || arp_table[i].ip == ip_addr) {
-            arp_table[i].ip = ip_addr;
-            memcpy(arp_table[i].mac, mac_addr, 6);
-            arp_table[i].valid = 1;
-            return;
-        }
-    }
-    printf("[arp] cache full!\n");
+    // 🔥 使用主机字节序更新邻居表（挂起的包随之发出）
+    neigh_update(dev, spa, arp->arp_sha, 1);
 }
 
 /**
@@ -1200,21 +1444,12 @@ static int arp_request_broadcast(net_device_t *dev, uint32_t ip_addr) {
     }
 
     // 构造 ARP 请求包
-    uint8_t packet[ETH_HDR_LEN + ARP_HDR_LEN];
-    eth_hdr_t *eth = (eth_hdr_t *)packet;
-    arp_hdr_t *arp = (arp_hdr_t *)(packet + ETH_HDR_LEN);
-
-    // 以太网头部
-    memset(eth->eth_dst, 0xFF, ETH_ALEN);  // 广播 MAC
-    memcpy(eth->eth_src, dev->mac_addr, ETH_ALEN);
-    eth->eth_type = htons(ETH_P_ARP);
+    arp_hdr_t *arp;
+    netbuf_t *nb = arp_alloc(ARPOP_REQUEST, &arp);
+    if (!nb) {
+        return -1;
+    }
 
-    // ARP 头部
-    arp->arp_hrd = htons(ARPHRD_ETHER);
-    arp->arp_pro = htons(ETH_P_IP);
-    arp->arp_hln = ETH_ALEN;
-    arp->arp_pln = 4;
-    arp->arp_op = htons(ARPOP_REQUEST);
     memcpy(arp->arp_sha, dev->mac_addr, ETH_ALEN);
     arp->arp_spa = htonl(dev->ip_addr);
     memset(arp->arp_tha, 0, ETH_ALEN);
@@ -1233,7 +1468,8 @@ static int arp_request_broadcast(net_device_t *dev, uint32_t ip_addr) {
            (ntohl(arp->arp_tpa) >> 8) & 0xFF,
            ntohl(arp->arp_tpa) & 0xFF);
 
-    return dev->send(dev, packet, sizeof(packet));
+    // 广播 MAC
+    return eth_output(dev, eth_broadcast, ETH_P_ARP, nb);
 }
 
 /**
@@ -1289,57 +1525,15 @@ void arp_show_cache(net_device_t *dev, int scan_and_update) {
         }
     }
 
-    // 显示 ARP 缓存表
-    printf("%-18s %-17s %s\n", "IP Address", "MAC Address", "Status");
-    printf("----------------- ----------------- ------\n");
-
-    int count = 0;
-    for (int i = 0; i < ARP_TABLE_SIZE; i++) {
-        if (arp_table[i].valid) {
-            printf("%d.%d.%d.%d    %02x:%02x:%02x:%02x:%02x:%02x  %s\n",
-                   (arp_table[i].ip >> 24) & 0xFF,
-                   (arp_table[i].ip >> 16) & 0xFF,
-                   (arp_table[i].ip >> 8) & 0xFF,
-                   arp_table[i].ip & 0xFF,
-                   arp_table[i].mac[0],
-                   arp_table[i].mac[1],
-                   arp_table[i].mac[2],
-                   arp_table[i].mac[3],
-                   arp_table[i].mac[4],
-                   arp_table[i].mac[5],
-                   "VALID");
-            count++;
-        }
-    }
-
-    if (count == 0) {
-        printf("(No entries)\n");
-    }
-
-    printf("----------------- ----------------- ------\n");
-    printf("Total: %d entries\n\n", count);
+    // 显示邻居表
+    neigh_dump(dev);
 }
 
 /**
  * @brief 计算互联网校验和
  */
 uint16_t internet_checksum(uint16_t *data, uint32_t len) {
-    uint32_t sum = 0;
-
-    while (len > 1) {
-        sum += *data++;
-        len -= 2;
-    }
-
-    if (len == 1) {
-        sum += *(uint8_t *)data;
-    }
-
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
-
-    return ~sum;
+    return csum_fold(csum_partial(data, len, 0));
 }
 
 /**
@@ -1368,9 +1562,12 @@ int net_set_ipaddr(uint32_t ip) {
            (ip >> 24) & 0xFF, (ip >> 16) & 0xFF,
            (ip >> 8) & 0xFF, ip & 0xFF);
 
-    // 更新所有设备的IP
+    // 更新所有设备的IP（回环设备除外），直连路由随之重建
     for (int i = 0; i < num_devices; i++) {
-        net_devices[i]->ip_addr = ip;
+        net_device_t *dev = net_devices[i];
+        if (strcmp(dev->name, "lo") != 0) {
+            net_device_set_addr(dev, ip, dev->netmask, dev->gateway);
+        }
     }
 
     return 0;
@@ -1386,7 +1583,10 @@ int net_set_netmask(uint32_t mask) {
            (mask >> 8) & 0xFF, mask & 0xFF);
 
     for (int i = 0; i < num_devices; i++) {
-        net_devices[i]->netmask = mask;
+        net_device_t *dev = net_devices[i];
+        if (strcmp(dev->name, "lo") != 0) {
+            net_device_set_addr(dev, dev->ip_addr, mask, dev->gateway);
+        }
     }
 
     return 0;
@@ -1401,9 +1601,12 @@ int net_set_gateway(uint32_t gw) {
            (gw >> 24) & 0xFF, (gw >> 16) & 0xFF,
            (gw >> 8) & 0xFF, gw & 0xFF);
 
-    // 更新所有设备的网关
+    // 更新所有设备的网关（替换默认路由）
     for (int i = 0; i < num_devices; i++) {
-        net_devices[i]->gateway = gw;
+        net_device_t *dev = net_devices[i];
+        if (strcmp(dev->name, "lo") != 0) {
+            net_device_set_addr(dev, dev->ip_addr, dev->netmask, gw);
+        }
     }
 
     return 0;
@@ -1422,6 +1625,7 @@ void net_poll_rx(net_device_t *dev) {
     // 直接调用 E1000 的轮询函数
     extern void e1000_debug_poll_rx(void);
     e1000_debug_poll_rx();
+    net_rx_action();
     // extern void e1000_poll_rx(net_device_t *dev);
     // e1000_poll_rx(dev);
 }
@@ -1451,35 +1655,24 @@ void net_dump_rx_regs(net_device_t *dev) {
     printf("[net] TX errors:  %d\n", net_stats.tx_errors);
     printf("[net] RX dropped: %d\n", net_stats.rx_dropped);
     printf("[net] TX dropped: %d\n", net_stats.tx_dropped);
+
+    netbuf_stats_t nbs;
+    netbuf_get_stats(&nbs);
+    printf("[net] Netbuf:     %d/%d free, %d allocs, %d failures\n",
+           nbs.free, nbs.total, nbs.alloc_count, nbs.fail_count);
+
+    ipfrag_stats_t ifs;
+    ipfrag_get_stats(&ifs);
+    printf("[net] IP reasm:   %d frags, %d OK, %d failed, %d timed out, %d evicted\n",
+           ifs.reasm_reqds, ifs.reasm_oks, ifs.reasm_fails, ifs.reasm_timeouts,
+           ifs.reasm_evictions);
+    printf("[net] IP frag:    %d datagrams -> %d fragments, %d failed\n",
+           ifs.frag_oks, ifs.frag_creates, ifs.frag_fails);
     printf("[net] ===============================================\n");
 
     // 🔥 添加 ARP 缓存表
     printf("\n[net] ============== ARP Cache Table ==============\n");
-    printf("[net] %-18s %-17s %s\n", "IP Address", "MAC Address", "Status");
-    printf("[net] ----------------- ----------------- ------\n");
-
-    extern arp_entry_t arp_table[];
-    int count = 0;
-    for (int i = 0; i < 32; i++) {  // ARP_TABLE_SIZE
-        if (arp_table[i].valid) {
-            printf("[net] %d.%d.%d.%d    %02x:%02x:%02x:%02x:%02x:%02x  VALID\n",
-                   (arp_table[i].ip >> 24) & 0xFF,
-                   (arp_table[i].ip >> 16) & 0xFF,
-                   (arp_table[i].ip >> 8) & 0xFF,
-                   arp_table[i].ip & 0xFF,
-                   arp_table[i].mac[0], arp_table[i].mac[1],
-                   arp_table[i].mac[2], arp_table[i].mac[3],
-                   arp_table[i].mac[4], arp_table[i].mac[5]);
-            count++;
-        }
-    }
-
-    if (count == 0) {
-        printf("[net] (No entries)\n");
-    }
-
-    printf("[net] ----------------- ----------------- ------\n");
-    printf("[net] Total: %d entries\n", count);
+    neigh_dump(dev);
     printf("[net] ===========================================\n\n");
     e1000_dump_rx_regs();
 }
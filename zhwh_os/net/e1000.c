@@ -7,15 +7,18 @@
  */
 
 #include "net.h"
+#include "bypass.h"
 #include "e1000.h"
+#include "e1000e.h"
 #include "../include/printf.h"
 #include "../include/string.h"
 #include "../include/kmalloc.h"
 #include "../include/pci.h"
 #include "../include/highmem_mapping.h"
 #include "../include/page.h"
-#include "../include/io.h"
 #include "../include/pci_msi.h"
+#include "x86/io.h"   // 超集：含 ../include/io.h 的端口操作和 cli/sti（两者共用头文件保护宏）
+#include "x86/mmu.h"
 
 // 类型定义
 #ifndef size_t
@@ -56,7 +59,7 @@ int e1000_irq = 0;
 #define e1000_reg_write32(reg, val) e1000_write32(reg, val)
 
 // 全局变量（兼容旧代码）
-// 🔥 注意：已废弃，使用 e1000_priv.rx_buffers 代替
+// 🔥 注意：已废弃，RX 缓冲区改为 e1000_priv.rx_netbufs
 // static uint8_t *e1000_rx_buffers[E1000_NUM_RX_DESC];
 static e1000_tx_desc_t *e1000_tx_desc;
 
@@ -90,8 +93,208 @@ static void print_ip_addr(uint32_t ip) {
            ip & 0xFF);
 }
 
+// TX 环状态会被 xmit（普通上下文）和 TX 完成中断同时访问，关中断保护
+static inline uint32_t e1000_tx_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void e1000_tx_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// TX 环上还能用的描述符数（留一个空位区分满和空）
+static inline uint16_t e1000_tx_unused(void) {
+    return (e1000_priv.tx_dirty + E1000_NUM_TX_DESC - e1000_priv.tx_cur - 1)
+           % E1000_NUM_TX_DESC;
+}
+
+/**
+ * @brief 批量回收已发送完成的描述符（TX 完成中断或空间不够时调用）
+ *
+ * 只有每个包最后一个描述符带 RS，按包检查它的 DD 位，
+ * 完成后释放这个包的 netbuf（连同 frag 链）。调用者已关中断。
+ * @return 回收的描述符数
+ */
+static int e1000_tx_clean_locked(void) {
+    int cleaned = 0;
+
+    while (e1000_priv.tx_dirty != e1000_priv.tx_cur) {
+        uint16_t first = e1000_priv.tx_dirty;
+        uint16_t eop = e1000_priv.tx_eop[first];
+
+        if (!(e1000_priv.tx_desc[eop].status & E1000_TXD_STAT_DD)) {
+            break;
+        }
+
+        if (e1000_priv.tx_netbufs[eop]) {
+            netbuf_free(e1000_priv.tx_netbufs[eop]);
+            e1000_priv.tx_netbufs[eop] = NULL;
+        }
+        cleaned += (eop + E1000_NUM_TX_DESC - first) % E1000_NUM_TX_DESC + 1;
+        e1000_priv.tx_dirty = (eop + 1) % E1000_NUM_TX_DESC;
+    }
+    return cleaned;
+}
+
+static int e1000_tx_clean(void) {
+    uint32_t flags = e1000_tx_lock();
+    int cleaned = e1000_tx_clean_locked();
+    e1000_tx_unlock(flags);
+    return cleaned;
+}
+
+/**
+ * @brief 写门铃：把已挂好的描述符一次交给硬件（调用者已关中断）
+ */
+static void e1000_tx_kick_locked(void) {
+    if (e1000_priv.tx_tail == e1000_priv.tx_cur) {
+        return;
+    }
+
+    // 描述符内容必须先于 TDT 对硬件可见
+    asm volatile("sfence" ::: "memory");
+    e1000_write32(E1000_TDT, e1000_priv.tx_cur);
+    e1000_priv.tx_tail = e1000_priv.tx_cur;
+    e1000_priv.tx_pending = 0;
+    e1000_priv.tx_doorbells++;
+}
+
+/**
+ * @brief 批量发送结束时由 net_tx_batch_end() 调用
+ */
+static void e1000_tx_flush(net_device_t *dev) {
+    uint32_t flags = e1000_tx_lock();
+    e1000_tx_kick_locked();
+    e1000_tx_unlock(flags);
+}
+
+/**
+ * @brief 给 n 个描述符腾出空间（先回收，不够返回 -1）。调用者已关中断。
+ */
+static int e1000_tx_reserve_locked(uint16_t n) {
+    if (e1000_tx_unused() < n) {
+        e1000_tx_clean_locked();
+    }
+    if (e1000_tx_unused() < n) {
+        // 环满：先把攒着的描述符交给硬件
+        e1000_tx_kick_locked();
+        e1000_priv.tx_busy++;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 挂好一个包之后决定是否立即写门铃
+ *
+ * 不在批量发送中就立即写；批量发送中攒够 E1000_TX_BATCH 个包
+ * 或者环快满了也写一次，避免硬件空等。
+ */
+static void e1000_tx_commit_locked(uint16_t first, uint16_t last, netbuf_t *nb) {
+    e1000_priv.tx_eop[first] = last;
+    e1000_priv.tx_netbufs[last] = nb;
+    e1000_priv.tx_pending++;
+
+    if (!net_tx_batching() || e1000_priv.tx_pending >= E1000_TX_BATCH ||
+        e1000_tx_unused() < E1000_TX_BATCH) {
+        e1000_tx_kick_locked();
+    }
+}
+
+// 填一个数据描述符，返回它的下标
+// popts 非 0 时使用扩展数据描述符（校验和插入 / TSO），否则用 legacy 格式
+static uint16_t e1000_tx_fill_locked(uint32_t buf_dma, uint16_t len, uint8_t cmd,
+                                     uint8_t popts) {
+    uint16_t idx = e1000_priv.tx_cur;
+    e1000_tx_desc_t *tx_desc = &e1000_priv.tx_desc[idx];
+
+    tx_desc->buffer_addr = buf_dma;
+    tx_desc->padding = 0;  // 槽位上次可能是上下文描述符
+    tx_desc->length = len;
+    tx_desc->vlan = 0;
+    // IDE：完成中断按 TIDV 延迟合并
+    cmd |= E1000_TXD_CMD_IFCS | E1000_TXD_CMD_IDE;
+    if (popts) {
+        tx_desc->cso = E1000_TXD_DTYP_D;
+        tx_desc->cmd = cmd | E1000_TXD_CMD_DEXT;
+        tx_desc->css = popts;
+    } else {
+        tx_desc->cso = 0;
+        tx_desc->cmd = cmd;
+        tx_desc->css = 0;
+    }
+    tx_desc->status = 0;  // 清除 DD 位
+
+    e1000_priv.tx_cur = (idx + 1) % E1000_NUM_TX_DESC;
+    return idx;
+}
+
+/**
+ * @brief 为校验和插入 / TSO 准备上下文描述符
+ *
+ * 区间都按以太网帧起始计算：IP 头校验和覆盖 [net_hdr, trans_hdr)，
+ * L4 校验和从 trans_hdr 到包尾，结果写到 trans_hdr + csum_offset。
+ * 非 TSO 包的区间和上一个相同时不重发（网卡会保留上下文）。
+ * @return 占用的描述符数（0 或 1）
+ */
+static int e1000_tx_ctx_locked(netbuf_t *nb) {
+    uint8_t ipcss = (uint8_t)(nb->net_hdr - nb->data);
+    uint8_t tucss = (uint8_t)(nb->trans_hdr - nb->data);
+    uint8_t tucso = tucss + nb->csum_offset;
+    ip_hdr_t *ip = (ip_hdr_t *)nb->net_hdr;
+    uint8_t tucmd = E1000_TXD_CTX_IP | E1000_TXD_CTX_DEXT;
+    uint32_t paylen = 0;
+    uint8_t hdr_len = 0;
+
+    if (ip->ip_proto == IPPROTO_TCP) {
+        tucmd |= E1000_TXD_CTX_TCP;
+    }
+
+    if (nb->gso_size) {
+        tcp_hdr_t *tcp = (tcp_hdr_t *)nb->trans_hdr;
+        hdr_len = tucss + (tcp->tcp_off >> 4) * 4;
+        paylen = netbuf_total_len(nb) - hdr_len;
+        tucmd |= E1000_TXD_CTX_TSE;
+        // 总长和 IP 头校验和由网卡按每个分段重新填写
+        ip->ip_len = 0;
+        ip->ip_sum = 0;
+        e1000_priv.tx_tso_count++;
+    } else {
+        uint32_t key = ipcss | (tucss << 8) | (tucso << 16) | (tucmd << 24);
+        if (key == e1000_priv.tx_ctx_key) {
+            return 0;
+        }
+        e1000_priv.tx_ctx_key = key;
+    }
+
+    uint16_t idx = e1000_priv.tx_cur;
+    e1000_ctx_desc_t *ctx = (e1000_ctx_desc_t *)&e1000_priv.tx_desc[idx];
+    ctx->ipcss = ipcss;
+    ctx->ipcso = ipcss + 10;  // ip_sum
+    ctx->ipcse = tucss - 1;
+    ctx->tucss = tucss;
+    ctx->tucso = tucso;
+    ctx->tucse = 0;
+    ctx->cmd_and_length = paylen | ((uint32_t)(tucmd | E1000_TXD_CMD_IDE) << 24);
+    ctx->status = 0;
+    ctx->hdr_len = hdr_len;
+    ctx->mss = nb->gso_size;
+
+    // TSO 上下文带着本包的 PAYLEN，下一个普通包必须重发上下文
+    if (nb->gso_size) {
+        e1000_priv.tx_ctx_key = 0;
+    }
+
+    e1000_priv.tx_cur = (idx + 1) % E1000_NUM_TX_DESC;
+    return 1;
+}
+
 /**
- * @brief E1000 发送函数
+ * @brief E1000 发送函数（裸缓冲区，拷贝到槽位自己的 TX 缓冲区）
  */
 static int e1000_send(net_device_t *dev, uint8_t *data, uint32_t len) {
     if (!data || len == 0 || len > E1000_TX_BUF_SIZE) {
@@ -99,56 +302,178 @@ static int e1000_send(net_device_t *dev, uint8_t *data, uint32_t len) {
         return -1;
     }
 
-    // 🔥 调试：检查链路状态
-    uint32_t status = e1000_read32(E1000_STATUS);
-    if (!(status & E1000_STATUS_LU)) {
-        printf("[e1000] WARNING: Link is DOWN! Packet may not be sent.\n");
+    uint32_t flags = e1000_tx_lock();
+    if (e1000_tx_reserve_locked(1) < 0) {
+        e1000_tx_unlock(flags);
+        return -1;
     }
 
-    // 检查 TX 描述符是否可用
-    e1000_tx_desc_t *tx_desc = &e1000_priv.tx_desc[e1000_priv.tx_cur];
+    uint16_t idx = e1000_priv.tx_cur;
+    memcpy(e1000_priv.tx_buffers[idx], data, len);
+    e1000_tx_fill_locked(e1000_priv.tx_buffers_dma[idx], (uint16_t)len,
+                         E1000_TXD_CMD_EOP | E1000_TXD_CMD_RS, 0);
+    e1000_tx_commit_locked(idx, idx, NULL);
+    e1000_tx_unlock(flags);
+    return 0;
+}
 
-    // 🔥 调试：打印发送前描述符状态
-    printf("[e1000] TX desc %d: status=0x%x (before send)\n",
-           e1000_priv.tx_cur, tx_desc->status);
+/**
+ * @brief E1000 netbuf 发送函数（零拷贝：描述符直接指向 netbuf 数据）
+ *
+ * 头 netbuf 和 frag 链上的每一段各占一个描述符（分散/聚集），
+ * 只有最后一个带 EOP|RS。CSUM_PARTIAL 的包前面加一个上下文描述符，
+ * 数据描述符用扩展格式让网卡插入校验和；gso_size 非 0 时整条链是
+ * 一个 TSO 请求，由网卡切成 MSS 大小的分段。netbuf 由驱动持有，
+ * 直到硬件写回 DD 后在 e1000_tx_clean 中释放。
+ */
+static int e1000_xmit(net_device_t *dev, netbuf_t *nb) {
+    uint16_t nsegs = 0;
+    uint32_t total = 0;
+    for (netbuf_t *seg = nb; seg; seg = seg->frag) {
+        if (seg->len) {
+            nsegs++;
+            total += seg->len;
+        }
+    }
 
-    // 检查描述符是否已完成 (DD 位)
-    if (!(tx_desc->status & E1000_TXD_STAT_DD)) {
-        printf("[e1000] TX descriptor %d busy (DD=0)\n", e1000_priv.tx_cur);
+    uint32_t max_len = nb->gso_size ? NETBUF_HEADROOM + dev->gso_max_size : ETH_HDR_LEN + dev->mtu;
+    if (!nsegs || total > max_len || nsegs >= E1000_NUM_TX_DESC / 2) {
+        printf("[e1000] Invalid xmit length %d (%d segments)\n", total, nsegs);
+        netbuf_free(nb);
         return -1;
     }
 
-    printf("[e1000] Sending %d bytes (desc %d)\n", len, e1000_priv.tx_cur);
+    int offload = nb->ip_summed == NETBUF_CSUM_PARTIAL;
+    uint8_t popts = 0;
+    uint8_t tse = 0;
+    if (offload) {
+        popts = E1000_TXD_POPTS_IXSM | E1000_TXD_POPTS_TXSM;
+        tse = nb->gso_size ? E1000_TXD_CMD_TSE : 0;
+    }
 
-    // 🔥 打印前 16 字节（以太网头）
-    printf("[e1000] TX data: ");
-    for (int i = 0; i < 16 && i < len; i++) {
-        printf("%02x ", data[i]);
+    uint32_t flags = e1000_tx_lock();
+    if (e1000_tx_reserve_locked(nsegs + offload) < 0) {
+        // 环满：nb 还给 qdisc，回收描述符后由 net_tx_wake 重新出队
+        e1000_tx_unlock(flags);
+        return NET_XMIT_BUSY;
     }
-    printf("\n");
 
-    // 复制数据到发送缓冲区
-    memcpy(e1000_priv.tx_buffers[e1000_priv.tx_cur], data, len);
+    uint16_t first = e1000_priv.tx_cur;
+    uint16_t last = first;
+    uint16_t left = nsegs;
+    if (offload) {
+        e1000_tx_ctx_locked(nb);
+    }
+    for (netbuf_t *seg = nb; seg; seg = seg->frag) {
+        if (!seg->len) {
+            continue;
+        }
+        uint8_t cmd = tse;
+        if (--left == 0) {
+            cmd |= E1000_TXD_CMD_EOP | E1000_TXD_CMD_RS;
+        }
+        last = e1000_tx_fill_locked(netbuf_dma(seg), (uint16_t)seg->len, cmd, popts);
+    }
+    e1000_tx_commit_locked(first, last, nb);
+    e1000_tx_unlock(flags);
+    return 0;
+}
 
-    // 🔥 设置 TX 描述符（使用 DMA 物理地址）
-    tx_desc->buffer_addr = e1000_priv.tx_buffers_dma[e1000_priv.tx_cur];
-    tx_desc->length = (uint16_t)len;
-    tx_desc->cmd = E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS;
-    tx_desc->status = 0;  // 清除 DD 位
+/**
+ * @brief RCTL 的缓冲区大小编码（BSIZE，4096 以上要加 BSEX）
+ */
+static uint32_t e1000_rctl_bsize(uint32_t size) {
+    switch (size) {
+    case 16384: return E1000_RCTL_BSIZE_16384;
+    case 8192:  return E1000_RCTL_BSIZE_8192;
+    case 4096:  return E1000_RCTL_BSIZE_4096;
+    case 1024:  return E1000_RCTL_BSIZE_1024;
+    case 512:   return E1000_RCTL_BSIZE_512;
+    case 256:   return E1000_RCTL_BSIZE_256;
+    default:    return E1000_RCTL_BSIZE_2048;
+    }
+}
 
-    // 内存屏障
-    asm volatile("mfence" ::: "memory");
+/**
+ * @brief 修改 MTU（net_device_set_mtu 调用）：超过标准以太网帧时打开 LPE
+ *
+ * RX 缓冲区仍是 netbuf 的 2048 字节数据区，不换成 BSEX 的大缓冲区
+ * （那样每个槽位都要占一块连续的大 DMA 内存）：长帧由网卡依次写进
+ * 相邻的几个描述符，e1000_recv 把它们串成 frag 链交给协议栈。
+ */
+static int e1000_change_mtu(net_device_t *dev, uint16_t new_mtu) {
+    uint32_t rctl = e1000_read32(E1000_RCTL);
+    if (new_mtu > ETH_MTU) {
+        rctl |= E1000_RCTL_LPE;
+    } else {
+        rctl &= ~E1000_RCTL_LPE;
+    }
+    rctl = (rctl & ~E1000_RCTL_BSIZE_MASK) | e1000_rctl_bsize(E1000_RX_BUF_SIZE);
+    e1000_write32(E1000_RCTL, rctl);
+    return 0;
+}
 
-    // 更新 TDT (Tail) 寄存器
-    e1000_priv.tx_cur = (e1000_priv.tx_cur + 1) % E1000_NUM_TX_DESC;
-    e1000_write32(E1000_TDT, e1000_priv.tx_cur);
+/**
+ * @brief 根据 RX 描述符的校验和状态标记 netbuf
+ *
+ * 错误位已在调用前过滤。IP 头校验过、且 TCP/UDP 包的 L4 也校验过时
+ * 标成 CSUM_UNNECESSARY，协议栈跳过软件校验；其他情况交给软件。
+ */
+static void e1000_rx_csum(const e1000_rx_desc_t *rx_desc, netbuf_t *nb) {
+    uint8_t status = rx_desc->status;
+
+    if (!(e1000_dev.features & NETIF_F_RXCSUM) ||
+        (status & E1000_RXD_STAT_IXSM) || !(status & E1000_RXD_STAT_IPCS)) {
+        return;
+    }
+
+    eth_hdr_t *eth = (eth_hdr_t *)nb->data;
+    if (eth->eth_type != htons(ETH_P_IP) || nb->len < ETH_HDR_LEN + IP_HDR_LEN) {
+        return;
+    }
+    ip_hdr_t *ip = (ip_hdr_t *)(nb->data + ETH_HDR_LEN);
+    if ((ip->ip_proto == IPPROTO_TCP || ip->ip_proto == IPPROTO_UDP) &&
+        !(status & E1000_RXD_STAT_TCPCS)) {
+        return;
+    }
+    nb->ip_summed = NETBUF_CSUM_UNNECESSARY;
+}
 
-    // 🔥 调试：打印发送后的 TDT/TDH
-    uint32_t tdt = e1000_read32(E1000_TDT);
-    uint32_t tdh = e1000_read32(E1000_TDH);
-    printf("[e1000] After send: TDT=%d, TDH=%d\n", tdt, tdh);
+// 丢掉正在拼的长帧
+static void e1000_rx_chain_drop(void) {
+    if (e1000_priv.rx_chain) {
+        netbuf_free(e1000_priv.rx_chain);
+    }
+    e1000_priv.rx_chain = NULL;
+    e1000_priv.rx_chain_tail = NULL;
+    e1000_priv.rx_chain_len = 0;
+}
 
-    return 0;//len;
+/**
+ * @brief 长帧的 EOP 描述符到了：过滤后把整条链交给协议栈
+ *
+ * 过滤程序只看得到第一个缓冲区里的数据（以太网 / IP / 传输层头都在里面），
+ * 校验和状态以 EOP 描述符上的为准。
+ */
+static void e1000_rx_chain_done(net_device_t *dev, const e1000_rx_desc_t *rx_desc) {
+    netbuf_t *head = e1000_priv.rx_chain;
+    uint32_t len = e1000_priv.rx_chain_len;
+
+    e1000_priv.rx_chain = NULL;
+    e1000_priv.rx_chain_tail = NULL;
+    e1000_priv.rx_chain_len = 0;
+
+    int queue = net_rx_filter(dev, head->data, head->len);
+    if (queue == NET_RX_FILTER_DROP) {
+        e1000_priv.rx_filtered++;
+        netbuf_free(head);
+        return;
+    }
+    head->rx_queue = (uint8_t)queue;
+    e1000_rx_csum(rx_desc, head);
+    net_rx_enqueue(dev, head);
+    e1000_priv.rx_multi_desc++;
+    e1000_priv.itr_bytes += len;
 }
 
 /**
@@ -159,91 +484,104 @@ static int e1000_send(net_device_t *dev, uint8_t *data, uint32_t len) {
  * - 不要用 RDH/RDT 判断是否有包
  * - 只检查描述符的 DD 位
  * - 使用软件维护的 rx_cur 指针
+ *
+ * 零拷贝：每个 RX 描述符挂着一个 netbuf，收到包后把它整个摘下来交给
+ * 协议栈（挂到接收积压队列，不在这里做协议处理），槽位从缓冲池补一个新的。
+ * 缓冲池耗尽时丢弃本包，旧缓冲区留在环上继续用。RDT 每批只写一次。
+ * 打开 LPE 后超过一个缓冲区的帧占用连续几个描述符，只有最后一个带 EOP，
+ * 前面各段先串在 rx_chain 上（可能跨越两次调用），EOP 到达时整条链一起交出。
+ * @param budget 本次最多处理的描述符数
+ * @return 处理的描述符数
  */
-static void e1000_recv(net_device_t *dev) {
+static int e1000_recv(net_device_t *dev, int budget) {
     uint32_t total_packets = 0;
 
+    // 旁路期间硬件用的是用户环，内核环不能碰
+    if (dev->bypass) {
+        return 0;
+    }
+
     // 🔥 统计：记录调用次数
     e1000_priv.recv_call_count++;
 
-    printf("[e1000] recv: rx_cur=%d\n", e1000_priv.rx_cur);
-
     // 🔥 Intel 推荐方式：从软件 rx_cur 开始，只检查 DD 位
-    while (1) {
-        // 🔥 内存屏障：确保读取到硬件最新写入的数据
-        asm volatile("mfence" ::: "memory");
-
-        e1000_rx_desc_t *rx_desc = &e1000_priv.rx_desc[e1000_priv.rx_cur];
+    while (total_packets < (uint32_t)budget) {
+        uint16_t idx = e1000_priv.rx_cur;
+        e1000_rx_desc_t *rx_desc = &e1000_priv.rx_desc[idx];
 
         // ✅ 唯一可靠的判断：DD 位
         if (!(rx_desc->status & E1000_RXD_STAT_DD)) {
-            // 描述符未就绪，没有更多包了
-            printf("[e1000] RX desc %d not ready (DD=0)\n", e1000_priv.rx_cur);
             break;
         }
 
-        printf("[e1000] RX desc %d: status=0x%x, len=%d\n",
-               e1000_priv.rx_cur, rx_desc->status, rx_desc->length);
+        // 🔥 读屏障：先看到 DD，再读长度和数据
+        asm volatile("lfence" ::: "memory");
 
-        // 获取有效长度
         uint16_t pkt_len = rx_desc->length;
-        SET_COLOR_RED();
-        // 打印 raw 数据（使用 e1000_priv.rx_buffers）
-        for (int i = 0; i < pkt_len; i++) {
-            printf("%02x ", e1000_priv.rx_buffers[e1000_priv.rx_cur][i]);
-        }
-        SET_COLOR_GREEN();
-        printf("\n");
-
-        // 检查长度
-        if (rx_desc->length < ETH_HDR_LEN || rx_desc->length > ETH_MAX_FRAME) {
-            printf("[e1000] Invalid packet length: %d, dropping\n", rx_desc->length);
-            // 🔥 清除 DD 位，归还描述符给硬件
-            rx_desc->status = 0;
-            e1000_priv.rx_cur = (e1000_priv.rx_cur + 1) % E1000_NUM_RX_DESC;
-            total_packets++;
-            continue;
-        }
-
-        // 🔥 检查以太网类型（在驱动层就过滤掉无效包）
-        uint8_t *data = e1000_priv.rx_buffers[e1000_priv.rx_cur];
-
-        // 🔥 再次内存屏障，确保读取最新数据
-        asm volatile("mfence" ::: "memory");
-
-        uint16_t eth_type = (data[12] << 8) | data[13];
-
-        // 有效的以太网类型：IPv4 (0x0800), ARP (0x0806), IPv6 (0x86DD), VLAN (0x8100)
-        if (eth_type != 0x0800 && eth_type != 0x0806 &&
-            eth_type != 0x86DD && eth_type != 0x8100) {
-            printf("[e1000] DROP: Invalid EtherType 0x%04x (not IPv4/ARP/IPv6/VLAN)\n", eth_type);
-            printf("[e1000]   data[12]=0x%02x, data[13]=0x%02x\n", data[12], data[13]);
-
-            // 🔥 调试：显示前 16 字节
-            printf("[e1000]   Raw data: ");
-            for (int i = 0; i < 16 && i < rx_desc->length; i++) {
-                printf("%02x ", data[i]);
+        int eop = (rx_desc->status & E1000_RXD_STAT_EOP) != 0;
+        uint32_t frame_len = e1000_priv.rx_chain_len + pkt_len;
+        netbuf_t *nb = e1000_priv.rx_netbufs[idx];
+        netbuf_t *fresh = NULL;
+        int queue = 0;
+
+        if (e1000_priv.rx_discard) {
+            // 同一帧前面的描述符已经出错：一直丢到 EOP
+            e1000_priv.rx_discard = !eop;
+        } else if (pkt_len == 0 || pkt_len > E1000_RX_BUF_SIZE || frame_len < ETH_HDR_LEN ||
+                   frame_len > ETH_HDR_LEN + dev->mtu || rx_desc->errors) {
+            // 长度非法、超过 MTU 或硬件报错：整帧丢弃
+            if (rx_desc->errors & (E1000_RXD_ERR_IPE | E1000_RXD_ERR_TCPE)) {
+                e1000_priv.rx_csum_errors++;
             }
-            printf("\n");
-
-            // 🔥 清除 DD 位，归还描述符给硬件
-            rx_desc->status = 0;
-            e1000_priv.rx_cur = (e1000_priv.rx_cur + 1) % E1000_NUM_RX_DESC;
-            total_packets++;
-            continue;
+            e1000_priv.rx_dropped++;
+            e1000_rx_chain_drop();
+            e1000_priv.rx_discard = !eop;
+        } else if (!eop || e1000_priv.rx_chain) {
+            // 长帧的一段：换上新缓冲区，旧的挂到链尾
+            if (!(fresh = netbuf_alloc(0))) {
+                e1000_priv.rx_dropped++;
+                e1000_rx_chain_drop();
+                e1000_priv.rx_discard = !eop;
+            } else {
+                e1000_priv.rx_netbufs[idx] = fresh;
+                rx_desc->buffer_addr = fresh->dma;
+
+                netbuf_put(nb, pkt_len);
+                if (e1000_priv.rx_chain_tail) {
+                    e1000_priv.rx_chain_tail->frag = nb;
+                } else {
+                    e1000_priv.rx_chain = nb;
+                }
+                e1000_priv.rx_chain_tail = nb;
+                e1000_priv.rx_chain_len = frame_len;
+                if (eop) {
+                    e1000_rx_chain_done(dev, rx_desc);
+                }
+            }
+        } else if ((queue = net_rx_filter(dev, nb->data, pkt_len)) == NET_RX_FILTER_DROP) {
+            // 过滤程序丢弃：缓冲区原地留在环上
+            e1000_priv.rx_filtered++;
+        } else if (!(fresh = netbuf_alloc(0))) {
+            // 缓冲池耗尽：丢包，保留旧缓冲区
+            e1000_priv.rx_dropped++;
+        } else {
+            // 摘下已填充的 netbuf，槽位换上新缓冲区
+            e1000_priv.rx_netbufs[idx] = fresh;
+            rx_desc->buffer_addr = fresh->dma;
+
+            netbuf_put(nb, pkt_len);
+            nb->rx_queue = (uint8_t)queue;
+            e1000_rx_csum(rx_desc, nb);
+            net_rx_enqueue(dev, nb);
+            e1000_priv.itr_bytes += pkt_len;
         }
 
-        // 传递给网络栈
-        printf("[e1000] -> Calling net_rx_packet: len=%d, type=0x%04x\n", rx_desc->length, eth_type);
-        net_rx_packet(dev, data, rx_desc->length);
-        printf("[e1000] net_rx_packet returned\n");
-
         // 🔥 关键：必须清除 DD 位，归还描述符给硬件
         // Intel 手册：Software must clear the DD bit to make the descriptor available again
         rx_desc->status = 0;
 
         // 移动到下一个描述符
-        e1000_priv.rx_cur = (e1000_priv.rx_cur + 1) % E1000_NUM_RX_DESC;
+        e1000_priv.rx_cur = (idx + 1) % E1000_NUM_RX_DESC;
         total_packets++;
     }
 
@@ -255,14 +593,215 @@ static void e1000_recv(net_device_t *dev) {
             ? (E1000_NUM_RX_DESC - 1)
             : (e1000_priv.rx_cur - 1);
 
-        printf("[e1000] Updating RDT to %d (processed %d packets)\n", new_rdt, total_packets);
+        // 描述符写回必须先于 RDT 对硬件可见
+        asm volatile("sfence" ::: "memory");
         e1000_write32(E1000_RDT, new_rdt);
 
         e1000_priv.packets_processed += total_packets;
-        printf("[e1000] Processed %d packets\n", total_packets);
+        e1000_priv.itr_packets += total_packets;
     } else {
         e1000_priv.empty_recv_count++;
     }
+    return (int)total_packets;
+}
+
+/**
+ * @brief 按上一轮中断的包数 / 字节数估计负载档位（移植自 Linux e1000_update_itr）
+ *
+ * 小包、零星流量 -> 最低延迟；大包、持续流量 -> 批量，中间为低延迟。
+ */
+static int e1000_itr_class(int cur, uint32_t packets, uint32_t bytes) {
+    if (packets == 0) {
+        return cur;
+    }
+
+    switch (cur) {
+    case E1000_ITR_LOWEST_LATENCY:
+    case E1000_ITR_LOW_LATENCY:
+        if (bytes > 10000) {
+            if (bytes / packets > 8000) {
+                return E1000_ITR_BULK_LATENCY;
+            }
+            if (packets < 10 || bytes / packets > 1200) {
+                return cur == E1000_ITR_LOWEST_LATENCY
+                    ? E1000_ITR_LOW_LATENCY : E1000_ITR_BULK_LATENCY;
+            }
+            if (packets > 35) {
+                return E1000_ITR_LOWEST_LATENCY;
+            }
+        } else if (bytes / packets > 2000) {
+            return E1000_ITR_BULK_LATENCY;
+        } else if (packets <= 2 && bytes < 512) {
+            return E1000_ITR_LOWEST_LATENCY;
+        }
+        break;
+    case E1000_ITR_BULK_LATENCY:
+        if (bytes > 25000) {
+            if (packets > 35) {
+                return E1000_ITR_LOW_LATENCY;
+            }
+        } else if (bytes < 6000) {
+            return E1000_ITR_LOW_LATENCY;
+        }
+        break;
+    }
+    return cur;
+}
+
+/**
+ * @brief 根据观测到的负载调整 ITR / RDTR / TIDV
+ *
+ * 在一轮轮询结束（重新打开中断）时调用。档位不变时不碰寄存器。
+ */
+static void e1000_update_itr(void) {
+    static const uint16_t itr_val[] = {
+        [E1000_ITR_LOWEST_LATENCY] = E1000_ITR_INTERVAL(70000),
+        [E1000_ITR_LOW_LATENCY]    = E1000_ITR_INTERVAL(20000),
+        [E1000_ITR_BULK_LATENCY]   = E1000_ITR_INTERVAL(4000),
+    };
+    // RX / TX 中断延迟（单位 1.024us），批量时攒一攒再报
+    static const uint16_t rdtr_val[] = { 0, 8, 32 };
+    static const uint16_t tidv_val[] = { 8, 16, 64 };
+
+    int cls = e1000_itr_class(e1000_priv.itr_class,
+                              e1000_priv.itr_packets, e1000_priv.itr_bytes);
+    e1000_priv.itr_packets = 0;
+    e1000_priv.itr_bytes = 0;
+
+    if (cls == e1000_priv.itr_class) {
+        return;
+    }
+    e1000_priv.itr_class = cls;
+    e1000_write32(E1000_ITR, itr_val[cls]);
+    e1000_write32(E1000_RDTR, rdtr_val[cls]);
+    e1000_write32(E1000_TIDV, tidv_val[cls]);
+}
+
+/**
+ * @brief NAPI 轮询：最多收 budget 个包，收空后重新打开 RX 中断
+ */
+static int e1000_poll(net_device_t *dev, int budget) {
+    // 旁路前已经调度的轮询：直接收尾，RX 中断交给 bypass_irq 管
+    if (dev->bypass) {
+        net_napi_complete(dev);
+        return 0;
+    }
+
+    int work = e1000_recv(dev, budget);
+
+    if (work < budget) {
+        e1000_priv.poll_complete_count++;
+        e1000_update_itr();
+        net_napi_complete(dev);
+        // 屏蔽期间到达的包已经置了 ICR，打开后会立即再来一次中断
+        e1000_write32(E1000_IMS, E1000_IMS_RX);
+    }
+    return work;
+}
+
+
+// 正常工作时打开的中断（与 e1000_init_dev 一致）
+#define E1000_IMS_DEFAULT  (E1000_ICR_TXDW | E1000_ICR_RXDMT0 | E1000_ICR_RXT0 | E1000_ICR_LSC)
+
+static void e1000_rxtx_enable(int enable) {
+    uint32_t rctl = e1000_read32(E1000_RCTL);
+    uint32_t tctl = e1000_read32(E1000_TCTL);
+    e1000_write32(E1000_RCTL, enable ? rctl | E1000_RCTL_EN : rctl & ~E1000_RCTL_EN);
+    e1000_write32(E1000_TCTL, enable ? tctl | E1000_TCTL_EN : tctl & ~E1000_TCTL_EN);
+}
+
+/**
+ * @brief 内核旁路：收发环换成用户环（sys_net_bypass 在关中断下调用）
+ *
+ * 先停收发、屏蔽全部中断，释放内核 TX 环上还没回收的 netbuf，再把基址寄存器
+ * 指向用户环。两个环都从空开始，用户填好 RX 描述符后自己写 RDT。
+ * 内核 RX 环上的 netbuf 原样留着，detach 时直接换回去。
+ * 门铃是 RDT / TDT 所在的两页寄存器（同页里还有环基址等寄存器，所以只给特权进程）。
+ */
+static int e1000_bypass_attach(net_device_t *dev, net_bypass_t *bp) {
+    uint32_t db_base = E1000_RDT & ~(PAGE_SIZE - 1);
+
+    e1000_write32(E1000_IMC, 0xFFFFFFFF);
+    e1000_rxtx_enable(0);
+
+    for (int i = 0; i < E1000_NUM_TX_DESC; i++) {
+        if (e1000_priv.tx_netbufs[i]) {
+            netbuf_free(e1000_priv.tx_netbufs[i]);
+            e1000_priv.tx_netbufs[i] = NULL;
+        }
+    }
+    e1000_priv.tx_cur = 0;
+    e1000_priv.tx_dirty = 0;
+    e1000_priv.tx_tail = 0;
+    e1000_priv.tx_pending = 0;
+    e1000_priv.tx_ctx_key = 0;
+    e1000_rx_chain_drop();
+    e1000_priv.rx_discard = 0;
+
+    e1000_write32(E1000_RDBAL, net_bypass_rx_ring(bp));
+    e1000_write32(E1000_RDBAH, 0);
+    e1000_write32(E1000_RDLEN, E1000_BYPASS_DESC * sizeof(e1000_rx_desc_t));
+    e1000_write32(E1000_RDH, 0);
+    e1000_write32(E1000_RDT, 0);
+    e1000_write32(E1000_TDBAL, net_bypass_tx_ring(bp));
+    e1000_write32(E1000_TDBAH, 0);
+    e1000_write32(E1000_TDLEN, E1000_BYPASS_DESC * sizeof(e1000_tx_desc_t));
+    e1000_write32(E1000_TDH, 0);
+    e1000_write32(E1000_TDT, 0);
+    e1000_read32(E1000_ICR);    // 清掉挂起的中断
+
+    bp->info->rx_desc_nr = E1000_BYPASS_DESC;
+    bp->info->tx_desc_nr = E1000_BYPASS_DESC;
+    bp->info->rx_doorbell = E1000_RDT - db_base;
+    bp->info->tx_doorbell = E1000_TDT - db_base;
+    bp->doorbell_pa = e1000_priv.mmio_base + db_base;
+    bp->doorbell_pages = (E1000_TDT - db_base) / PAGE_SIZE + 1;
+
+    e1000_rxtx_enable(1);
+    return 0;
+}
+
+/**
+ * @brief 结束旁路：换回驱动自己的环（进程关闭 fd 或退出时，关中断下调用）
+ *
+ * 用户环上没发完的包直接丢弃；内核 RX 环的描述符重新指向原来的 netbuf，
+ * TX 环清空，中断恢复成正常工作时的设置。
+ */
+static void e1000_bypass_detach(net_device_t *dev) {
+    e1000_write32(E1000_IMC, 0xFFFFFFFF);
+    e1000_rxtx_enable(0);
+
+    for (int i = 0; i < E1000_NUM_RX_DESC; i++) {
+        memset(&e1000_priv.rx_desc[i], 0, sizeof(e1000_rx_desc_t));
+        e1000_priv.rx_desc[i].buffer_addr = e1000_priv.rx_netbufs[i]->dma;
+    }
+    e1000_priv.rx_cur = 0;
+    for (int i = 0; i < E1000_NUM_TX_DESC; i++) {
+        memset(&e1000_priv.tx_desc[i], 0, sizeof(e1000_tx_desc_t));
+        e1000_priv.tx_desc[i].status = E1000_TXD_STAT_DD;
+    }
+
+    e1000_write32(E1000_RDBAL, e1000_priv.rx_desc_phys);
+    e1000_write32(E1000_RDBAH, 0);
+    e1000_write32(E1000_RDLEN, E1000_NUM_RX_DESC * sizeof(e1000_rx_desc_t));
+    e1000_write32(E1000_RDH, 0);
+    e1000_write32(E1000_RDT, E1000_NUM_RX_DESC - 1);
+    e1000_write32(E1000_TDBAL, e1000_priv.tx_desc_phys);
+    e1000_write32(E1000_TDBAH, 0);
+    e1000_write32(E1000_TDLEN, E1000_NUM_TX_DESC * sizeof(e1000_tx_desc_t));
+    e1000_write32(E1000_TDH, 0);
+    e1000_write32(E1000_TDT, 0);
+    e1000_read32(E1000_ICR);
+
+    e1000_rxtx_enable(1);
+    e1000_write32(E1000_IMS, E1000_IMS_DEFAULT);
+}
+
+/**
+ * @brief 旁路期间打开 / 屏蔽接收中断（read 等通知前打开，中断到达时 ISR 屏蔽）
+ */
+static void e1000_bypass_irq(net_device_t *dev, int enable) {
+    e1000_write32(enable ? E1000_IMS : E1000_IMC, E1000_IMS_RX);
 }
 
 
@@ -275,50 +814,42 @@ void e1000_isr(void) {
 
     // 🔥 统计中断次数
     e1000_priv.intr_count++;
-    printf("[e1000] MSI ISR ENTER <<<\n");
-    printf("[e1000] ISR: dev=0x%x, dev->name=%s\n", (uint32_t)dev, dev->name ? dev->name : "NULL");
 
     // 🔥 读取中断原因寄存器（读取会自动清除）
     uint32_t icr = e1000_read32(E1000_ICR);
 
     if (icr == 0) {
-        // 不是我们的中断
-        printf("[e1000] ISR: ICR=0 (spurious interrupt)\n");
+        // 不是我们的中断（spurious interrupt）
         return;
     }
 
-    // 🔥 调试：打印每次中断
-    printf("[e1000] ISR: ICR=0x%08x\n", icr);
-
-    // 🔥 详细的中断位分析
-    if (icr & E1000_ICR_TXDW) printf("[e1000]   - TX Descriptor Written Back\n");
-    if (icr & E1000_ICR_RXT0) printf("[e1000]   - RX Timer interrupt (bit 7)\n");
-    if (icr & E1000_ICR_RXT0_ALT) printf("[e1000]   - RX Timer interrupt (bit 31)\n");
-    if (icr & E1000_ICR_RXDMT0) printf("[e1000]   - RX minimum threshold\n");
-    if (icr & E1000_ICR_RXO) printf("[e1000]   - RX overrun\n");
-    if (icr & E1000_ICR_LSC) printf("[e1000]   - Link status change\n");
+    if (icr & E1000_ICR_RXO) {
+        e1000_priv.rx_overruns++;
+    }
 
-    // 🔥 如果 ICR=0，这是虚假中断（spurious interrupt）
-    if (icr == 0) {
-        printf("[e1000] WARNING: Spurious interrupt (ICR=0)\n");
+    // 旁路：收发环归用户进程，接收中断只转成一次通知，屏蔽到用户下一次 read
+    if (dev->bypass) {
+        if (icr & (E1000_ICR_RXT0 | E1000_ICR_RXT0_ALT | E1000_ICR_RXDMT0 | E1000_ICR_RXO)) {
+            e1000_write32(E1000_IMC, E1000_IMS_RX);
+            net_bypass_notify(dev);
+        }
         return;
     }
 
     // 🔥🔥 Loopback 测试：检查 TX 完成中断
     if (icr & E1000_ICR_TXDW) {
-        // printf("[e1000] ISR: TX done interrupt!\n");
+        // 批量回收已发送完成的描述符，腾出空间后让 qdisc 继续出队
+        if (e1000_tx_clean() > 0) {
+            net_tx_wake(dev);
+        }
         loopback_tx_done = 1;  // 🔥 设置标志
     }
 
     // 处理接收中断（合并所有 RX 中断类型，包括 bit 7 和 bit 31）
     if (icr & (E1000_ICR_RXT0 | E1000_ICR_RXT0_ALT | E1000_ICR_RXDMT0 | E1000_ICR_RXO)) {
-        SET_COLOR_RED();
-        printf("[e1000] ISR: RX interrupt detected\n");
-        SET_COLOR_GREEN();
-    
-        // 🔥🔥 Loopback 测试：检查是否是我们的测试包
-        // 先调用接收函数（使用局部 dev 变量）
-        e1000_recv(dev);
+        // 屏蔽 RX 中断，交给 net_rx_action() 按预算轮询，收空后再打开
+        e1000_write32(E1000_IMC, E1000_IMS_RX);
+        net_napi_schedule(dev);
 
         // 🔥 设置标志：收到 RX 中断
         loopback_rx_received = 1;
@@ -331,7 +862,6 @@ void e1000_isr(void) {
     if (icr & E1000_ICR_LSC) {
        // printf("[e1000] ISR: Link status change\n");
     }
-    printf("[e1000] MSI ISR EXIT >>>\n");
 }
 
 /**
@@ -577,6 +1107,11 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
     /* 6. 初始化 RX ring（使用 Linux 风格 DMA API）*/
     printf("[e1000] Initializing RX ring with dma_alloc_coherent\n");
 
+    // RX 缓冲区来自 netbuf 缓冲池（net_init 已初始化，这里保证一下顺序）
+    if (netbuf_pool_init() < 0) {
+        return -1;
+    }
+
     // 分配 RX 描述符数组
     uint32_t rx_desc_dma;
     e1000_priv.rx_desc = dma_alloc_coherent(
@@ -593,25 +1128,21 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
     for (int i = 0; i < E1000_NUM_RX_DESC; i++) {
         memset(&e1000_priv.rx_desc[i], 0, sizeof(e1000_rx_desc_t));
 
-        // 分配 RX 缓冲区
-        uint32_t buf_dma;
-        e1000_priv.rx_buffers[i] = dma_alloc_coherent(E1000_RX_BUF_SIZE, &buf_dma);
-
-        if (!e1000_priv.rx_buffers[i]) {
-            printf("[e1000] ERROR: Failed to allocate RX buffer %d\n", i);
+        // RX 缓冲区直接用 netbuf，收包后整块交给协议栈
+        netbuf_t *nb = netbuf_alloc(0);
+        if (!nb) {
+            printf("[e1000] ERROR: Failed to allocate RX netbuf %d\n", i);
             return -1;
         }
-
-        // 🔹 清空 RX buffer，避免残留垃圾
-        memset(e1000_priv.rx_buffers[i], 0, E1000_RX_BUF_SIZE);
+        e1000_priv.rx_netbufs[i] = nb;
 
         // 设置缓冲区物理地址
-        e1000_priv.rx_desc[i].buffer_addr = buf_dma;
+        e1000_priv.rx_desc[i].buffer_addr = nb->dma;
 
         // 调试：打印前几个描述符的信息
         if (i < 3) {
             printf("[e1000] RX desc %d: buf_virt=0x%x, buf_dma=0x%x\n",
-                   i, (uint32_t)e1000_priv.rx_buffers[i], buf_dma);
+                   i, (uint32_t)nb->head, nb->dma);
         }
         // 🔹 确保描述符状态位初始化为 0 (DD=0)
         e1000_priv.rx_desc[i].status = 0;
@@ -619,6 +1150,7 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
 
     printf("[e1000] RX desc array: virt=0x%x, dma=0x%x\n",
            (uint32_t)e1000_priv.rx_desc, rx_desc_dma);
+    e1000_priv.rx_desc_phys = rx_desc_dma;
 
     // 设置 RX 描述符寄存器
     e1000_reg_write32(E1000_RDBAL, rx_desc_dma & 0xFFFFFFFF);
@@ -650,6 +1182,7 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
 
     printf("[e1000] TX desc array: virt=0x%x, dma=0x%x\n",
            (uint32_t)e1000_priv.tx_desc, tx_desc_dma);
+    e1000_priv.tx_desc_phys = tx_desc_dma;
 
     // 🔥 分配 TX 缓冲区（使用 DMA coherent memory）
     for (int i = 0; i < E1000_NUM_TX_DESC; i++) {
@@ -687,10 +1220,14 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
         // E1000_RCTL_MPE |  // ❌ Multicast Promiscuous - 已移除
         E1000_RCTL_BAM |      // Broadcast Accept Mode
         E1000_RCTL_SECRC |    // Strip CRC
-        E1000_RCTL_BSIZE_2048  // Buffer size 2048
+        e1000_rctl_bsize(E1000_RX_BUF_SIZE)  // 缓冲区大小与 netbuf 数据区一致
         /* DTYP bits [11:10] = 00 (Legacy descriptor, 默认) */
+        /* LPE 在 MTU 调大时由 e1000_change_mtu 打开 */
     );
 
+    /* 接收校验和卸载：硬件校验 IP 头和 TCP/UDP，结果写进 RX 描述符 */
+    e1000_reg_write32(E1000_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL);
+
     /* 9. 设置 TCTL */
     e1000_reg_write32(E1000_TCTL,
         E1000_TCTL_EN |
@@ -699,7 +1236,13 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
         (0x40 << E1000_TCTL_COLD_SHIFT)
     );
 
-    /* 10. 启用中断 */
+    /* 10. 中断节流：从低延迟档开始，之后由 e1000_update_itr 按负载调整 */
+    e1000_priv.itr_class = E1000_ITR_LOW_LATENCY;
+    e1000_reg_write32(E1000_ITR, E1000_ITR_INTERVAL(20000));
+    e1000_reg_write32(E1000_RDTR, 8);
+    e1000_reg_write32(E1000_TIDV, 16);
+
+    /* 11. 启用中断 */
     printf("[e1000] Enabling interrupts\n");
 
     // 清除所有挂起的中断
@@ -783,7 +1326,14 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
     printf("[e1000] =======================================================\n");
     // 注意: mmio_base 和 mmio_base_virt 已经在前面初始化了
     e1000_priv.tx_cur = 0;
+    e1000_priv.tx_dirty = 0;
+    e1000_priv.tx_tail = 0;
+    e1000_priv.tx_ctx_key = 0;
     e1000_priv.rx_cur = 0;
+    e1000_priv.rx_chain = NULL;
+    e1000_priv.rx_chain_tail = NULL;
+    e1000_priv.rx_chain_len = 0;
+    e1000_priv.rx_discard = 0;
 
     // 初始化私有数据（已经在 DMA 分配时设置好了）
 
@@ -792,8 +1342,19 @@ int e1000_init_dev(pci_dev_t *pci_dev, const char *dev_name)
     strcpy(e1000_dev.name, dev_name);
     memcpy(e1000_dev.mac_addr, mac, 6);
     e1000_dev.mtu = ETH_MTU;
+    e1000_dev.max_mtu = ETH_JUMBO_MTU;
+    e1000_dev.change_mtu = e1000_change_mtu;
     e1000_dev.send = e1000_send;
+    e1000_dev.xmit = e1000_xmit;
     e1000_dev.recv = NULL;
+    e1000_dev.poll = e1000_poll;
+    e1000_dev.tx_flush = e1000_tx_flush;
+    e1000_dev.features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_RXCSUM | NETIF_F_TSO;
+    // 一个 TSO 请求最多 16 个满 netbuf，描述符数远小于 TX 环的一半
+    e1000_dev.gso_max_size = 16 * NETBUF_DATA_SIZE;
+    e1000_dev.bypass_attach = e1000_bypass_attach;
+    e1000_dev.bypass_detach = e1000_bypass_detach;
+    e1000_dev.bypass_irq = e1000_bypass_irq;
     e1000_dev.ioctl = NULL;
     e1000_dev.priv = &e1000_priv;
     e1000_dev.pci_dev = pci_dev;
@@ -842,6 +1403,17 @@ int e1000_probe(pci_dev_t **devices, unsigned num_devices, const char *dev_name)
     for (unsigned i = 0; i < num_devices; i++) {
         pci_dev_t *dev = devices[i];
 
+        // 82574 走多队列驱动（e1000e.c）
+        if (dev->header.vendor_id == E1000_VENDOR_ID &&
+            dev->header.device_id == E1000E_DEVICE_ID_82574L) {
+            printf("[e1000] Found 82574 at %d:%d.%d, using e1000e driver\n",
+                   dev->bus_id, dev->dev_id, dev->fn_id);
+            if (e1000e_init_dev(dev, dev_name) == 0) {
+                return 0;
+            }
+            continue;
+        }
+
         if (dev->header.vendor_id == E1000_VENDOR_ID &&
             (dev->header.device_id == E1000_DEVICE_ID ||
              dev->header.device_id == E1000_DEVICE_ID_I82545 ||
@@ -893,7 +1465,7 @@ int e1000_init(const char *dev_name) {
  * @brief E1000 轮询接收函数
  */
 void e1000_poll_rx(net_device_t *dev) {
-    e1000_recv(dev);
+    e1000_recv(dev, E1000_NUM_RX_DESC);
 }
 
 /**
@@ -1001,6 +1573,14 @@ void e1000_dump_rx_regs(void) {
     printf("[e1000] e1000_recv() called:      %d\n", e1000_priv.recv_call_count);
     printf("[e1000] Empty receives (cur=RDH): %d\n", e1000_priv.empty_recv_count);
     printf("[e1000] Packets processed:        %d\n", e1000_priv.packets_processed);
+    printf("[e1000] Poll rounds completed:    %d\n", e1000_priv.poll_complete_count);
+    printf("[e1000] TX doorbells: %d, ring-full drops: %d (cur=%d, dirty=%d)\n",
+           e1000_priv.tx_doorbells, e1000_priv.tx_busy,
+           e1000_priv.tx_cur, e1000_priv.tx_dirty);
+    printf("[e1000] TSO requests: %d, RX checksum errors: %d\n",
+           e1000_priv.tx_tso_count, e1000_priv.rx_csum_errors);
+    printf("[e1000] ITR class: %d (ITR=%d, RDTR=%d, TIDV=%d)\n", e1000_priv.itr_class,
+           e1000_read32(E1000_ITR), e1000_read32(E1000_RDTR), e1000_read32(E1000_TIDV));
 
     // 🔥 读取 ICR 寄存器（查看是否有挂起的中断）
     uint32_t icr = e1000_read32(E1000_ICR);
@@ -1205,7 +1785,7 @@ int e1000_loopback_test(void) {
             printf("\n");
 
             // 验证数据
-            uint8_t *rx_buf = e1000_priv.rx_buffers[e1000_priv.rx_cur];
+            uint8_t *rx_buf = e1000_priv.rx_netbufs[e1000_priv.rx_cur]->head;
             printf("[e1000]   First 16 bytes: ");
             for (int j = 0; j < 16 && j < desc->length; j++) {
                 printf("%02x ", rx_buf[j]);
@@ -1286,7 +1866,6 @@ restore:
 // E1000 描述符配置
 #define E1000_NUM_TX_DESC 1
 #define E1000_NUM_RX_DESC 16   // 🔥 增加到 16 个 RX 描述符，确保 RX 中断能正确触发
-#define E1000_RX_BUF_SIZE 2048
 
 
 
@@ -1585,7 +2164,7 @@ void e1000_debug_poll_rx(void) {
 
         // 如果 DD 位设置了，显示前 16 字节
         if (desc->status & E1000_RXD_STAT_DD) {
-            uint8_t *data = e1000_priv.rx_buffers[i];
+            uint8_t *data = e1000_priv.rx_netbufs[i]->head;
             printf("[e1000]     Data: ");
             for (int j = 0; j < 16 && j < desc->length; j++) {
                 printf("%02x ", data[j]);
@@ -1597,7 +2176,10 @@ void e1000_debug_poll_rx(void) {
     // 尝试接收
     extern net_device_t e1000_dev;
     printf("[e1000] Attempting to receive packets...\n");
-    e1000_recv(&e1000_dev);
+    e1000_recv(&e1000_dev, E1000_NUM_RX_DESC);
+    printf("[e1000] Dropped: %d, filtered: %d, overruns: %d, multi-desc frames: %d\n",
+           e1000_priv.rx_dropped, e1000_priv.rx_filtered, e1000_priv.rx_overruns,
+           e1000_priv.rx_multi_desc);
 
     printf("[e1000] ==============================\n");
 }
\ No newline at end of file
@@ -0,0 +1,742 @@
+/**
+ * @file e1000e.c
+ * @brief Intel 82574 (e1000e) 多队列网卡驱动实现
+ *
+ * 接收：两个队列各一个扩展描述符环，RSS 把流分到队列；每个队列一个 MSI-X 向量
+ * 和一个 NAPI 上下文，中断时按 IAM 自动屏蔽本队列，轮询收空后写 IMS 只打开本队列。
+ * 发送：按 IP 地址 / 端口哈希选队列，同一条流总走同一个队列，保持顺序；
+ * 描述符格式、校验和 / TSO 上下文与 e1000 相同，只是每个队列各有一份状态。
+ * 没有 MSI-X 时退回单个 MSI 向量，ISR 读 ICR 后调度所有队列。
+ */
+
+#include "net.h"
+#include "e1000e.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+#include "../include/pci.h"
+#include "../include/pci_msi.h"
+#include "../include/highmem_mapping.h"
+#include "../include/mp.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+extern void *dma_alloc_coherent(uint32_t size, uint32_t *dma_handle);
+extern uint8_t lapicid2(void);
+
+static net_device_t e1000e_dev;
+static e1000e_priv_t e1000e_priv;
+
+#define e1000e_read32(reg)          (e1000e_priv.mmio[(reg) / 4])
+#define e1000e_write32(reg, val)    (e1000e_priv.mmio[(reg) / 4] = (val))
+
+// RSS 密钥：微软 RSS 规范里的验证密钥，和 Linux / DPDK 默认值相同
+static const uint8_t e1000e_rss_key[40] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+// 每个队列的环只被本队列的中断和发送路径访问，关中断保护即可
+static inline uint32_t e1000e_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void e1000e_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// ==================== 发送 ====================
+
+// 环上还能用的描述符数（留一个空位区分满和空）
+static inline uint16_t e1000e_tx_unused(const e1000e_tx_ring_t *ring) {
+    return (ring->dirty + E1000E_NUM_TX_DESC - ring->cur - 1) % E1000E_NUM_TX_DESC;
+}
+
+/**
+ * @brief 回收已发送完成的包（只有每个包的最后一个描述符带 RS）。调用者已关中断。
+ */
+static int e1000e_tx_clean_locked(e1000e_tx_ring_t *ring) {
+    int cleaned = 0;
+
+    while (ring->dirty != ring->cur) {
+        uint16_t first = ring->dirty;
+        uint16_t eop = ring->eop[first];
+
+        if (!(ring->desc[eop].status & E1000_TXD_STAT_DD)) {
+            break;
+        }
+        if (ring->netbufs[eop]) {
+            netbuf_free(ring->netbufs[eop]);
+            ring->netbufs[eop] = NULL;
+        }
+        cleaned += (eop + E1000E_NUM_TX_DESC - first) % E1000E_NUM_TX_DESC + 1;
+        ring->dirty = (eop + 1) % E1000E_NUM_TX_DESC;
+    }
+    return cleaned;
+}
+
+static void e1000e_tx_kick_locked(e1000e_tx_ring_t *ring) {
+    if (ring->tail == ring->cur) {
+        return;
+    }
+    // 描述符内容必须先于 TDT 对硬件可见
+    asm volatile("sfence" ::: "memory");
+    e1000e_write32(E1000E_TDT(ring->index), ring->cur);
+    ring->tail = ring->cur;
+    ring->pending = 0;
+    ring->doorbells++;
+}
+
+/**
+ * @brief 批量发送结束时由 net_tx_batch_end() 调用，每个队列各写一次门铃
+ */
+static void e1000e_tx_flush(net_device_t *dev) {
+    for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+        uint32_t flags = e1000e_lock();
+        e1000e_tx_kick_locked(&e1000e_priv.tx[q]);
+        e1000e_unlock(flags);
+    }
+}
+
+static int e1000e_tx_reserve_locked(e1000e_tx_ring_t *ring, uint16_t n) {
+    if (e1000e_tx_unused(ring) < n) {
+        e1000e_tx_clean_locked(ring);
+    }
+    if (e1000e_tx_unused(ring) < n) {
+        e1000e_tx_kick_locked(ring);
+        ring->busy++;
+        return -1;
+    }
+    return 0;
+}
+
+static void e1000e_tx_commit_locked(e1000e_tx_ring_t *ring, uint16_t first, uint16_t last,
+                                    netbuf_t *nb) {
+    ring->eop[first] = last;
+    ring->netbufs[last] = nb;
+    ring->pending++;
+    ring->packets++;
+
+    if (!net_tx_batching() || ring->pending >= E1000E_TX_BATCH ||
+        e1000e_tx_unused(ring) < E1000E_TX_BATCH) {
+        e1000e_tx_kick_locked(ring);
+    }
+}
+
+// 填一个数据描述符；popts 非 0 时用扩展数据描述符（校验和插入 / TSO）
+static uint16_t e1000e_tx_fill_locked(e1000e_tx_ring_t *ring, uint32_t buf_dma, uint16_t len,
+                                      uint8_t cmd, uint8_t popts) {
+    uint16_t idx = ring->cur;
+    e1000_tx_desc_t *desc = &ring->desc[idx];
+
+    desc->buffer_addr = buf_dma;
+    desc->padding = 0;
+    desc->length = len;
+    desc->vlan = 0;
+    cmd |= E1000_TXD_CMD_IFCS | E1000_TXD_CMD_IDE;
+    if (popts) {
+        desc->cso = E1000_TXD_DTYP_D;
+        desc->cmd = cmd | E1000_TXD_CMD_DEXT;
+        desc->css = popts;
+    } else {
+        desc->cso = 0;
+        desc->cmd = cmd;
+        desc->css = 0;
+    }
+    desc->status = 0;
+
+    ring->cur = (idx + 1) % E1000E_NUM_TX_DESC;
+    return idx;
+}
+
+/**
+ * @brief 校验和插入 / TSO 的上下文描述符（同 e1000_tx_ctx_locked，上下文按队列缓存）
+ * @return 占用的描述符数（0 或 1）
+ */
+static int e1000e_tx_ctx_locked(e1000e_tx_ring_t *ring, netbuf_t *nb) {
+    uint8_t ipcss = (uint8_t)(nb->net_hdr - nb->data);
+    uint8_t tucss = (uint8_t)(nb->trans_hdr - nb->data);
+    uint8_t tucso = tucss + nb->csum_offset;
+    ip_hdr_t *ip = (ip_hdr_t *)nb->net_hdr;
+    uint8_t tucmd = E1000_TXD_CTX_IP | E1000_TXD_CTX_DEXT;
+    uint32_t paylen = 0;
+    uint8_t hdr_len = 0;
+
+    if (ip->ip_proto == IPPROTO_TCP) {
+        tucmd |= E1000_TXD_CTX_TCP;
+    }
+
+    if (nb->gso_size) {
+        tcp_hdr_t *tcp = (tcp_hdr_t *)nb->trans_hdr;
+        hdr_len = tucss + (tcp->tcp_off >> 4) * 4;
+        paylen = netbuf_total_len(nb) - hdr_len;
+        tucmd |= E1000_TXD_CTX_TSE;
+        ip->ip_len = 0;
+        ip->ip_sum = 0;
+        ring->tso_count++;
+    } else {
+        uint32_t key = ipcss | (tucss << 8) | (tucso << 16) | (tucmd << 24);
+        if (key == ring->ctx_key) {
+            return 0;
+        }
+        ring->ctx_key = key;
+    }
+
+    uint16_t idx = ring->cur;
+    e1000_ctx_desc_t *ctx = (e1000_ctx_desc_t *)&ring->desc[idx];
+    ctx->ipcss = ipcss;
+    ctx->ipcso = ipcss + 10;  // ip_sum
+    ctx->ipcse = tucss - 1;
+    ctx->tucss = tucss;
+    ctx->tucso = tucso;
+    ctx->tucse = 0;
+    ctx->cmd_and_length = paylen | ((uint32_t)(tucmd | E1000_TXD_CMD_IDE) << 24);
+    ctx->status = 0;
+    ctx->hdr_len = hdr_len;
+    ctx->mss = nb->gso_size;
+
+    if (nb->gso_size) {
+        ring->ctx_key = 0;
+    }
+
+    ring->cur = (idx + 1) % E1000E_NUM_TX_DESC;
+    return 1;
+}
+
+/**
+ * @brief 按流选发送队列：IPv4 地址和 TCP/UDP 端口的哈希，非 IP 包走队列 0
+ */
+static int e1000e_tx_queue(const netbuf_t *nb) {
+    const eth_hdr_t *eth = (const eth_hdr_t *)nb->data;
+    if (nb->len < ETH_HDR_LEN + IP_HDR_LEN || eth->eth_type != htons(ETH_P_IP)) {
+        return 0;
+    }
+
+    const ip_hdr_t *ip = (const ip_hdr_t *)(nb->data + ETH_HDR_LEN);
+    uint32_t hash = ip->ip_src ^ ip->ip_dst;
+    uint32_t ihl = (ip->ip_verhlen & 0x0F) * 4;
+
+    // 分片只有第一片带端口，整条流都只按地址哈希会更稳定，但这里的分片很少，忽略
+    if ((ip->ip_proto == IPPROTO_TCP || ip->ip_proto == IPPROTO_UDP) &&
+        nb->len >= ETH_HDR_LEN + ihl + 4) {
+        const uint16_t *ports = (const uint16_t *)(nb->data + ETH_HDR_LEN + ihl);
+        hash ^= ((uint32_t)ports[0] << 16) | ports[1];
+    }
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+    return hash % E1000E_NUM_QUEUES;
+}
+
+/**
+ * @brief netbuf 发送（零拷贝，分散/聚集，同 e1000_xmit）
+ */
+static int e1000e_xmit(net_device_t *dev, netbuf_t *nb) {
+    uint16_t nsegs = 0;
+    uint32_t total = 0;
+    for (netbuf_t *seg = nb; seg; seg = seg->frag) {
+        if (seg->len) {
+            nsegs++;
+            total += seg->len;
+        }
+    }
+
+    uint32_t max_len = nb->gso_size ? NETBUF_HEADROOM + dev->gso_max_size : E1000_TX_BUF_SIZE;
+    if (!nsegs || total > max_len || nsegs >= E1000E_NUM_TX_DESC / 2) {
+        printf("[e1000e] Invalid xmit length %d (%d segments)\n", total, nsegs);
+        netbuf_free(nb);
+        return -1;
+    }
+
+    int offload = nb->ip_summed == NETBUF_CSUM_PARTIAL;
+    uint8_t popts = 0;
+    uint8_t tse = 0;
+    if (offload) {
+        popts = E1000_TXD_POPTS_IXSM | E1000_TXD_POPTS_TXSM;
+        tse = nb->gso_size ? E1000_TXD_CMD_TSE : 0;
+    }
+
+    e1000e_tx_ring_t *ring = &e1000e_priv.tx[e1000e_tx_queue(nb)];
+    uint32_t flags = e1000e_lock();
+    if (e1000e_tx_reserve_locked(ring, nsegs + offload) < 0) {
+        // 环满：nb 还给 qdisc，等 TX 中断回收后重新出队
+        e1000e_unlock(flags);
+        return NET_XMIT_BUSY;
+    }
+
+    uint16_t first = ring->cur;
+    uint16_t last = first;
+    uint16_t left = nsegs;
+    if (offload) {
+        e1000e_tx_ctx_locked(ring, nb);
+    }
+    for (netbuf_t *seg = nb; seg; seg = seg->frag) {
+        if (!seg->len) {
+            continue;
+        }
+        uint8_t cmd = tse;
+        if (--left == 0) {
+            cmd |= E1000_TXD_CMD_EOP | E1000_TXD_CMD_RS;
+        }
+        last = e1000e_tx_fill_locked(ring, netbuf_dma(seg), (uint16_t)seg->len, cmd, popts);
+    }
+    e1000e_tx_commit_locked(ring, first, last, nb);
+    e1000e_unlock(flags);
+    return 0;
+}
+
+// ==================== 接收 ====================
+
+// 把描述符重新交给硬件：写回格式会覆盖整个描述符，缓冲区地址每次都要重写
+static inline void e1000e_rx_arm(e1000e_rx_desc_t *desc, const netbuf_t *nb) {
+    desc->read.buffer_addr = nb->dma;
+    desc->read.buffer_addr_hi = 0;
+    desc->read.reserved[0] = 0;
+    desc->read.reserved[1] = 0;     // 清掉 DD
+}
+
+/**
+ * @brief 按扩展状态标记校验和（错误位已在调用前过滤）
+ */
+static void e1000e_rx_csum(uint32_t status, netbuf_t *nb) {
+    if (!(e1000e_dev.features & NETIF_F_RXCSUM) ||
+        (status & E1000E_RXD_STAT_IXSM) || !(status & E1000E_RXD_STAT_IPCS)) {
+        return;
+    }
+
+    eth_hdr_t *eth = (eth_hdr_t *)nb->data;
+    if (eth->eth_type != htons(ETH_P_IP) || nb->len < ETH_HDR_LEN + IP_HDR_LEN) {
+        return;
+    }
+    ip_hdr_t *ip = (ip_hdr_t *)(nb->data + ETH_HDR_LEN);
+    if ((ip->ip_proto == IPPROTO_TCP || ip->ip_proto == IPPROTO_UDP) &&
+        !(status & E1000E_RXD_STAT_TCPCS)) {
+        return;
+    }
+    nb->ip_summed = NETBUF_CSUM_UNNECESSARY;
+}
+
+/**
+ * @brief 收一个队列：最多 budget 个描述符，零拷贝换缓冲区，RDT 每批写一次
+ */
+static int e1000e_rx_clean(e1000e_rx_ring_t *ring, int budget) {
+    int done = 0;
+
+    while (done < budget) {
+        uint16_t idx = ring->cur;
+        e1000e_rx_desc_t *desc = &ring->desc[idx];
+        uint32_t status = desc->wb.status_error;
+
+        if (!(status & E1000E_RXD_STAT_DD)) {
+            break;
+        }
+        // 先看到 DD，再读长度和数据
+        asm volatile("lfence" ::: "memory");
+
+        uint16_t pkt_len = desc->wb.length;
+        netbuf_t *nb = ring->netbufs[idx];
+        netbuf_t *fresh = NULL;
+        int queue = 0;
+
+        if (pkt_len < ETH_HDR_LEN || pkt_len > ETH_MAX_FRAME ||
+            !(status & E1000E_RXD_STAT_EOP) ||
+            (status & (E1000E_RXD_ERR_FRAME | E1000E_RXD_ERR_TCPE | E1000E_RXD_ERR_IPE))) {
+            if (status & (E1000E_RXD_ERR_TCPE | E1000E_RXD_ERR_IPE)) {
+                ring->csum_errors++;
+            }
+            ring->dropped++;
+            e1000e_rx_arm(desc, nb);
+        } else if ((queue = net_rx_filter(&e1000e_dev, nb->data, pkt_len)) == NET_RX_FILTER_DROP) {
+            // 过滤程序丢弃：缓冲区原地还给网卡
+            ring->filtered++;
+            e1000e_rx_arm(desc, nb);
+        } else if (!(fresh = netbuf_alloc(0))) {
+            ring->dropped++;
+            e1000e_rx_arm(desc, nb);
+        } else {
+            ring->netbufs[idx] = fresh;
+            e1000e_rx_arm(desc, fresh);
+
+            netbuf_put(nb, pkt_len);
+            nb->rx_queue = (uint8_t)queue;
+            e1000e_rx_csum(status, nb);
+            net_rx_enqueue(&e1000e_dev, nb);
+            ring->packets++;
+            ring->bytes += pkt_len;
+        }
+
+        ring->cur = (idx + 1) % E1000E_NUM_RX_DESC;
+        done++;
+    }
+
+    if (done > 0) {
+        uint16_t rdt = ring->cur ? ring->cur - 1 : E1000E_NUM_RX_DESC - 1;
+        asm volatile("sfence" ::: "memory");
+        e1000e_write32(E1000E_RDT(ring->index), rdt);
+    }
+    return done;
+}
+
+static e1000e_rx_ring_t *e1000e_napi_ring(napi_t *napi) {
+    for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+        if (&e1000e_priv.rx[q].napi == napi) {
+            return &e1000e_priv.rx[q];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 队列的 NAPI 轮询：收空后只打开本队列的中断
+ */
+static int e1000e_poll(napi_t *napi, int budget) {
+    e1000e_rx_ring_t *ring = e1000e_napi_ring(napi);
+    int work = e1000e_rx_clean(ring, budget);
+
+    if (work < budget) {
+        napi_complete(napi);
+        // 屏蔽期间到达的包已经置了原因位，打开后会立即再来一次中断
+        e1000e_write32(E1000_IMS, ring->ims);
+    }
+    return work;
+}
+
+// ==================== 中断 ====================
+
+static void e1000e_tx_irq(e1000e_tx_ring_t *ring) {
+    uint32_t flags = e1000e_lock();
+    ring->intr_count++;
+    int cleaned = e1000e_tx_clean_locked(ring);
+    e1000e_unlock(flags);
+
+    if (cleaned > 0) {
+        net_tx_wake(&e1000e_dev);
+    }
+}
+
+/**
+ * @brief 单个 MSI 向量：读 ICR 分派到所有队列
+ */
+static void e1000e_msi_isr(void) {
+    uint32_t icr = e1000e_read32(E1000_ICR);
+    if (icr == 0) {
+        return;
+    }
+
+    if (icr & E1000_IMS_RX) {
+        e1000e_write32(E1000_IMC, E1000_IMS_RX);
+        for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+            e1000e_priv.rx[q].intr_count++;
+            napi_schedule(&e1000e_priv.rx[q].napi);
+        }
+    }
+    if (icr & E1000_ICR_TXDW) {
+        for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+            e1000e_tx_irq(&e1000e_priv.tx[q]);
+        }
+    }
+    if (icr & E1000_ICR_LSC) {
+        e1000e_priv.other_count++;
+    }
+}
+
+/**
+ * @brief e1000e 中断入口（向量 E1000E_VECTOR_BASE + entry）
+ *
+ * MSI-X 下每个表项只对应一个原因：接收队列的原因位已被 EIAC 清掉、
+ * 按 IAM 自动屏蔽，这里只需调度该队列；发送队列回收后重新打开；
+ * "其他"向量不自动清除，读 ICR 应答。
+ */
+void e1000e_msix_isr(int entry) {
+    if (!e1000e_priv.mmio) {
+        return;
+    }
+    if (!e1000e_priv.msix) {
+        e1000e_msi_isr();
+        return;
+    }
+
+    if (entry < E1000E_NUM_QUEUES) {
+        e1000e_rx_ring_t *ring = &e1000e_priv.rx[entry];
+        ring->intr_count++;
+        napi_schedule(&ring->napi);
+    } else if (entry < E1000E_MSIX_OTHER) {
+        int q = entry - E1000E_NUM_QUEUES;
+        e1000e_tx_irq(&e1000e_priv.tx[q]);
+        e1000e_write32(E1000_IMS, E1000E_ICR_TXQ(q));
+    } else if (entry == E1000E_MSIX_OTHER) {
+        e1000e_read32(E1000_ICR);
+        e1000e_priv.other_count++;
+        e1000e_write32(E1000_IMS, E1000E_ICR_OTHER | E1000_ICR_LSC);
+    }
+}
+
+// ==================== 初始化 ====================
+
+static int e1000e_setup_rx_ring(e1000e_rx_ring_t *ring, int q) {
+    ring->index = (uint8_t)q;
+    ring->desc = dma_alloc_coherent(sizeof(e1000e_rx_desc_t) * E1000E_NUM_RX_DESC,
+                                    &ring->desc_dma);
+    if (!ring->desc) {
+        return -1;
+    }
+    for (int i = 0; i < E1000E_NUM_RX_DESC; i++) {
+        netbuf_t *nb = netbuf_alloc(0);
+        if (!nb) {
+            printf("[e1000e] ERROR: out of netbufs for RX queue %d\n", q);
+            return -1;
+        }
+        ring->netbufs[i] = nb;
+        e1000e_rx_arm(&ring->desc[i], nb);
+    }
+    ring->cur = 0;
+    ring->napi.dev = &e1000e_dev;
+    ring->napi.poll = e1000e_poll;
+
+    e1000e_write32(E1000E_RDBAL(q), ring->desc_dma);
+    e1000e_write32(E1000E_RDBAH(q), 0);
+    e1000e_write32(E1000E_RDLEN(q), E1000E_NUM_RX_DESC * sizeof(e1000e_rx_desc_t));
+    e1000e_write32(E1000E_RDH(q), 0);
+    e1000e_write32(E1000E_RDT(q), E1000E_NUM_RX_DESC - 1);
+    return 0;
+}
+
+static int e1000e_setup_tx_ring(e1000e_tx_ring_t *ring, int q) {
+    ring->index = (uint8_t)q;
+    ring->desc = dma_alloc_coherent(sizeof(e1000_tx_desc_t) * E1000E_NUM_TX_DESC,
+                                    &ring->desc_dma);
+    if (!ring->desc) {
+        return -1;
+    }
+    memset(ring->desc, 0, sizeof(e1000_tx_desc_t) * E1000E_NUM_TX_DESC);
+    ring->cur = ring->tail = ring->dirty = 0;
+
+    e1000e_write32(E1000E_TDBAL(q), ring->desc_dma);
+    e1000e_write32(E1000E_TDBAH(q), 0);
+    e1000e_write32(E1000E_TDLEN(q), E1000E_NUM_TX_DESC * sizeof(e1000_tx_desc_t));
+    e1000e_write32(E1000E_TDH(q), 0);
+    e1000e_write32(E1000E_TDT(q), 0);
+    // 描述符写回按单个描述符粒度，队列 1 也要单独打开
+    e1000e_write32(E1000E_TXDCTL(q), E1000E_TXDCTL_GRAN | E1000E_TXDCTL_WTHRESH(1));
+    return 0;
+}
+
+/**
+ * @brief RSS：写哈希密钥和重定向表，按 IPv4 / IPv4+TCP 哈希分到两个队列
+ */
+static void e1000e_setup_rss(void) {
+    for (int i = 0; i < 10; i++) {
+        const uint8_t *k = &e1000e_rss_key[i * 4];
+        e1000e_write32(E1000E_RSSRK(i), k[0] | (k[1] << 8) | (k[2] << 16) | ((uint32_t)k[3] << 24));
+    }
+
+    // 128 项交替指向队列 0 / 1（每个双字 4 项）
+    for (int i = 0; i < E1000E_RETA_ENTRIES / 4; i++) {
+        uint32_t reta = 0;
+        for (int j = 0; j < 4; j++) {
+            uint8_t entry = ((i * 4 + j) % E1000E_NUM_QUEUES) ? E1000E_RETA_QUEUE1 : 0;
+            reta |= (uint32_t)entry << (j * 8);
+        }
+        e1000e_write32(E1000E_RETA(i), reta);
+    }
+
+    // PCSD：描述符里写回 RSS 哈希；IP / L4 校验结果仍在扩展状态里
+    e1000e_write32(E1000_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL | E1000E_RXCSUM_PCSD);
+    e1000e_write32(E1000E_MRQC, E1000E_MRQC_RSS_EN | E1000E_MRQC_IPV4 | E1000E_MRQC_TCP_IPV4);
+}
+
+/**
+ * @brief 中断：优先 MSI-X（每队列一个向量，分到不同 CPU），否则单个 MSI 向量
+ */
+static int e1000e_setup_irq(pci_dev_t *pci_dev) {
+    uint8_t vectors[E1000E_MSIX_NVEC];
+    uint8_t self = lapicid2();
+
+    for (int i = 0; i < E1000E_MSIX_NVEC; i++) {
+        vectors[i] = E1000E_VECTOR_BASE + i;
+        // 队列 q 的收发向量都投递到第 q 个 CPU，"其他"向量留给当前 CPU
+        int apicid = i < E1000E_MSIX_OTHER ? mp_cpu_apicid(i % E1000E_NUM_QUEUES) : -1;
+        e1000e_priv.apic_ids[i] = apicid < 0 ? self : (uint8_t)apicid;
+    }
+
+    if (pci_enable_msix_affinity(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id,
+                                 vectors, e1000e_priv.apic_ids, E1000E_MSIX_NVEC) == 0) {
+        e1000e_priv.msix = 1;
+
+        uint32_t ivar = E1000E_IVAR_INT_ALLOC |
+                        ((E1000E_IVAR_VALID | E1000E_MSIX_OTHER) << E1000E_IVAR_OTHER);
+        for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+            ivar |= (uint32_t)(E1000E_IVAR_VALID | E1000E_MSIX_RX(q)) << E1000E_IVAR_RX(q);
+            ivar |= (uint32_t)(E1000E_IVAR_VALID | E1000E_MSIX_TX(q)) << E1000E_IVAR_TX(q);
+            e1000e_priv.rx[q].ims = E1000E_ICR_RXQ(q);
+        }
+        e1000e_write32(E1000E_IVAR, ivar);
+
+        // 队列原因位在发 MSI-X 消息时自动清除并屏蔽，"其他"原因靠读 ICR 应答
+        e1000e_write32(E1000E_EIAC, E1000E_ICR_QUEUES);
+        e1000e_write32(E1000E_IAM, E1000E_ICR_QUEUES);
+        uint32_t ctrl_ext = e1000e_read32(E1000_CTRL_EXT);
+        ctrl_ext |= E1000E_CTRL_EXT_PBA_CLR | E1000E_CTRL_EXT_EIAME;
+        ctrl_ext &= ~E1000E_CTRL_EXT_IAME;
+        e1000e_write32(E1000_CTRL_EXT, ctrl_ext);
+
+        for (int i = 0; i < E1000E_MSIX_NVEC; i++) {
+            e1000e_write32(E1000E_EITR(i), E1000E_EITR_DEFAULT);
+        }
+        return 0;
+    }
+
+    if (pci_enable_msi(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id,
+                       E1000E_VECTOR_BASE) == 0) {
+        e1000e_priv.msix = 0;
+        for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+            e1000e_priv.rx[q].ims = E1000_IMS_RX;
+        }
+        e1000e_write32(E1000_ITR, E1000E_EITR_DEFAULT);
+        return 0;
+    }
+    return -1;
+}
+
+static void e1000e_read_mac(void) {
+    uint32_t ral = e1000e_read32(E1000_RAL(0));
+    uint32_t rah = e1000e_read32(E1000_RAH(0));
+    uint8_t *mac = e1000e_priv.mac_addr;
+
+    if ((ral == 0 || ral == 0xFFFFFFFF) && ((rah & 0xFFFF) == 0 || (rah & 0xFFFF) == 0xFFFF)) {
+        // 没有有效地址：用临时地址（Intel OUI）并写回 RAR0
+        static const uint8_t tmp[ETH_ALEN] = { 0x00, 0x15, 0x17, 0x00, 0x00, 0x02 };
+        memcpy(mac, tmp, ETH_ALEN);
+        e1000e_write32(E1000_RAL(0), mac[0] | (mac[1] << 8) | (mac[2] << 16) | ((uint32_t)mac[3] << 24));
+        e1000e_write32(E1000_RAH(0), mac[4] | (mac[5] << 8) | 0x80000000);    // AV
+        return;
+    }
+
+    mac[0] = ral & 0xFF;
+    mac[1] = (ral >> 8) & 0xFF;
+    mac[2] = (ral >> 16) & 0xFF;
+    mac[3] = (ral >> 24) & 0xFF;
+    mac[4] = rah & 0xFF;
+    mac[5] = (rah >> 8) & 0xFF;
+}
+
+/**
+ * @brief 初始化 82574：复位、两个收发队列、RSS、MSI-X，注册网络设备
+ */
+int e1000e_init_dev(pci_dev_t *pci_dev, const char *dev_name) {
+    printf("[e1000e] Initializing 82574 as %s\n", dev_name);
+
+    if (e1000e_priv.mmio) {
+        printf("[e1000e] Already initialized\n");
+        return -1;
+    }
+    if (netbuf_pool_init() < 0) {
+        return -1;
+    }
+
+    uint32_t bar0 = pci_read_config_dword(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id,
+                                          PCI_BAR0) & ~0xF;
+    volatile uint32_t *mmio = map_highmem_physical(bar0, 0x20000, 0);
+    if (!mmio) {
+        printf("[e1000e] ERROR: Failed to map MMIO 0x%x\n", bar0);
+        return -1;
+    }
+    e1000e_priv.mmio = mmio;
+    e1000e_priv.mmio_phys = bar0;
+
+    uint16_t cmd = pci_read_config_word(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, PCI_COMMAND);
+    cmd |= (1 << 2);    // Bus Master Enable
+    pci_write_config_word(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, PCI_COMMAND, cmd);
+
+    // 复位前后都屏蔽所有中断
+    e1000e_write32(E1000_IMC, 0xFFFFFFFF);
+    e1000e_write32(E1000_CTRL, e1000e_read32(E1000_CTRL) | E1000_CTRL_RST);
+    for (volatile int i = 0; i < 1000000; i++);
+    e1000e_write32(E1000_IMC, 0xFFFFFFFF);
+    e1000e_read32(E1000_ICR);
+
+    e1000e_read_mac();
+    e1000e_write32(E1000_CTRL, e1000e_read32(E1000_CTRL) | E1000_CTRL_SLU | E1000_CTRL_ASDE);
+
+    for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+        if (e1000e_setup_rx_ring(&e1000e_priv.rx[q], q) < 0 ||
+            e1000e_setup_tx_ring(&e1000e_priv.tx[q], q) < 0) {
+            printf("[e1000e] ERROR: Failed to set up queue %d\n", q);
+            return -1;
+        }
+    }
+
+    e1000e_setup_rss();
+    e1000e_write32(E1000E_RFCTL, E1000E_RFCTL_EXTEN | E1000E_RFCTL_ACK_DIS);
+
+    if (e1000e_setup_irq(pci_dev) < 0) {
+        printf("[e1000e] ERROR: neither MSI-X nor MSI available\n");
+        return -1;
+    }
+
+    e1000e_write32(E1000_RCTL, E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC |
+                               E1000_RCTL_BSIZE_2048);
+    e1000e_write32(E1000_TCTL, E1000_TCTL_EN | E1000_TCTL_PSP |
+                               (0x10 << E1000_TCTL_CT_SHIFT) | (0x40 << E1000_TCTL_COLD_SHIFT));
+
+    memset(&e1000e_dev, 0, sizeof(e1000e_dev));
+    strcpy(e1000e_dev.name, dev_name);
+    memcpy(e1000e_dev.mac_addr, e1000e_priv.mac_addr, ETH_ALEN);
+    e1000e_dev.mtu = ETH_MTU;
+    e1000e_dev.send = NULL;
+    e1000e_dev.xmit = e1000e_xmit;
+    e1000e_dev.poll = NULL;     // 轮询按队列，由各自的 napi_t 调度
+    e1000e_dev.tx_flush = e1000e_tx_flush;
+    e1000e_dev.features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_RXCSUM | NETIF_F_TSO;
+    e1000e_dev.gso_max_size = 16 * NETBUF_DATA_SIZE;
+    e1000e_dev.priv = &e1000e_priv;
+    e1000e_dev.pci_dev = pci_dev;
+
+    if (net_device_register(&e1000e_dev) < 0) {
+        printf("[e1000e] Failed to register device\n");
+        return -1;
+    }
+
+    // 最后打开中断
+    uint32_t ims = E1000_ICR_LSC;
+    if (e1000e_priv.msix) {
+        ims |= E1000E_ICR_QUEUES | E1000E_ICR_OTHER;
+    } else {
+        ims |= E1000_IMS_RX | E1000_ICR_TXDW;
+    }
+    e1000e_write32(E1000_IMS, ims);
+
+    printf("[e1000e] %s: MAC %02x:%02x:%02x:%02x:%02x:%02x, %d queues, %s\n", dev_name,
+           e1000e_priv.mac_addr[0], e1000e_priv.mac_addr[1], e1000e_priv.mac_addr[2],
+           e1000e_priv.mac_addr[3], e1000e_priv.mac_addr[4], e1000e_priv.mac_addr[5],
+           E1000E_NUM_QUEUES, e1000e_priv.msix ? "MSI-X" : "MSI");
+    return 0;
+}
+
+/**
+ * @brief 打印每个队列的统计
+ */
+void e1000e_dump(void) {
+    if (!e1000e_priv.mmio) {
+        printf("[e1000e] not initialized\n");
+        return;
+    }
+    printf("\n=== e1000e %s (%s) ===\n", e1000e_dev.name, e1000e_priv.msix ? "MSI-X" : "MSI");
+    for (int q = 0; q < E1000E_NUM_QUEUES; q++) {
+        e1000e_rx_ring_t *rx = &e1000e_priv.rx[q];
+        e1000e_tx_ring_t *tx = &e1000e_priv.tx[q];
+        printf("RX%d -> LAPIC %d: irq=%u pkts=%u bytes=%u drop=%u filtered=%u csum_err=%u RDH=%u RDT=%u\n",
+               q, e1000e_priv.apic_ids[E1000E_MSIX_RX(q)], rx->intr_count, rx->packets,
+               rx->bytes, rx->dropped, rx->filtered, rx->csum_errors,
+               e1000e_read32(E1000E_RDH(q)), e1000e_read32(E1000E_RDT(q)));
+        printf("TX%d -> LAPIC %d: irq=%u pkts=%u doorbells=%u busy=%u tso=%u\n",
+               q, e1000e_priv.apic_ids[E1000E_MSIX_TX(q)], tx->intr_count, tx->packets,
+               tx->doorbells, tx->busy, tx->tso_count);
+    }
+    printf("other=%u\n\n", e1000e_priv.other_count);
+}
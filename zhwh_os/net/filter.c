@@ -0,0 +1,162 @@
+/**
+ * @file filter.c
+ * @brief 设备接收过滤：把经典 BPF 程序挂到网卡上
+ *
+ * 程序在驱动接收路径上直接跑在 DMA 缓冲区里的原始帧上：零拷贝驱动在换新缓冲区之前，
+ * 拷贝型驱动（net_rx_packet）在拷进 netbuf 之前。被丢弃的帧不分配任何东西，
+ * 缓冲区原地还给网卡，广播风暴、不认识的协议这类流量代价只有一次解释执行。
+ *
+ * 程序来自固定大小的程序池；替换时先在关中断下换指针再归还旧程序。
+ * 接收在软中断里执行，不会被进程上下文打断，所以换下来的旧程序不会还有人在跑。
+ */
+
+#include "net.h"
+#include "bpf.h"
+#include "printf.h"
+#include "string.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+#define NET_FILTER_PROG_MAX 8       // 程序池大小（每块网卡最多挂一个）
+
+static bpf_prog_t filter_progs[NET_FILTER_PROG_MAX];
+
+static inline uint32_t filter_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void filter_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static bpf_prog_t *filter_prog_alloc(void) {
+    uint32_t flags = filter_lock();
+    for (int i = 0; i < NET_FILTER_PROG_MAX; i++) {
+        if (!filter_progs[i].in_use) {
+            filter_progs[i].in_use = 1;
+            filter_unlock(flags);
+            return &filter_progs[i];
+        }
+    }
+    filter_unlock(flags);
+    return NULL;
+}
+
+static void filter_prog_free(bpf_prog_t *prog) {
+    if (prog) {
+        prog->in_use = 0;
+    }
+}
+
+/**
+ * @brief 执行设备的接收过滤程序（由 net_rx_filter 在挂了程序时调用）
+ */
+int net_rx_filter_run(net_device_t *dev, const uint8_t *data, uint32_t len) {
+    bpf_prog_t *prog = dev->rx_filter;
+    if (!prog) {
+        return 0;
+    }
+
+    uint32_t ret = bpf_run(prog->insns, data, len);
+    prog->runs++;
+    if (ret == BPF_RET_DROP) {
+        prog->drops++;
+        return NET_RX_FILTER_DROP;
+    }
+    if (BPF_RET_IS_QUEUE(ret)) {
+        uint32_t q = ret & 0xFF;
+        return q < NET_RX_QUEUES ? (int)q : NET_RX_QUEUES - 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 校验并挂上过滤程序（替换已有的）
+ * @return 0 成功，BPF_ERR_INVAL 程序不合法，-12 程序池已满
+ */
+int net_filter_attach(net_device_t *dev, const sock_filter_t *insns, uint32_t len) {
+    if (!dev || !insns || len == 0 || len > BPF_MAXINSNS) {
+        return BPF_ERR_INVAL;
+    }
+
+    bpf_prog_t *prog = filter_prog_alloc();
+    if (!prog) {
+        return -12;
+    }
+    // 校验拷贝后的程序：insns 可能是用户态内存
+    memcpy(prog->insns, insns, len * sizeof(sock_filter_t));
+    if (bpf_check(prog->insns, len) < 0) {
+        filter_prog_free(prog);
+        return BPF_ERR_INVAL;
+    }
+    prog->len = (uint16_t)len;
+    prog->runs = 0;
+    prog->drops = 0;
+
+    uint32_t flags = filter_lock();
+    bpf_prog_t *old = dev->rx_filter;
+    dev->rx_filter = prog;
+    filter_unlock(flags);
+
+    filter_prog_free(old);
+    return 0;
+}
+
+void net_filter_detach(net_device_t *dev) {
+    uint32_t flags = filter_lock();
+    bpf_prog_t *old = dev->rx_filter;
+    dev->rx_filter = NULL;
+    filter_unlock(flags);
+
+    filter_prog_free(old);
+}
+
+static void net_filter_dump(void) {
+    int count = net_get_device_count();
+    net_device_t **devs = net_get_all_devices();
+
+    printf("Device   Insns  Runs        Drops\n");
+    for (int i = 0; i < count; i++) {
+        bpf_prog_t *prog = devs[i]->rx_filter;
+        if (prog) {
+            printf("%-8s %-6d %-11u %u\n", devs[i]->name, prog->len, prog->runs, prog->drops);
+        } else {
+            printf("%-8s -\n", devs[i]->name);
+        }
+    }
+}
+
+/**
+ * @brief SYS_NET_FILTER：挂上 / 卸下 / 显示接收过滤程序
+ */
+int sys_net_filter(int cmd, const char *ifname, const void *insns, uint32_t len) {
+    if (cmd == NET_FILTER_SHOW) {
+        net_filter_dump();
+        return 0;
+    }
+    if (!ifname) {
+        return BPF_ERR_INVAL;
+    }
+
+    char name[16];
+    strncpy(name, ifname, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    net_device_t *dev = net_device_get(name);
+    if (!dev) {
+        return -19;
+    }
+
+    switch (cmd) {
+    case NET_FILTER_ATTACH:
+        return net_filter_attach(dev, (const sock_filter_t *)insns, len);
+    case NET_FILTER_DETACH:
+        net_filter_detach(dev);
+        return 0;
+    default:
+        return BPF_ERR_INVAL;
+    }
+}
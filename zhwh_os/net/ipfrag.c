@@ -0,0 +1,529 @@
+/**
+ * @file ipfrag.c
+ * @brief IPv4 分片与重组（见 ipfrag.h）
+ *
+ * 重组队列、哈希表和内存计数都在关中断下修改：分片在 NET_RX_SOFTIRQ 里到达，
+ * 超时在内核定时器回调里处理。数据报凑齐后先把队列摘下来，
+ * 串 frag 链、改写 IP 头在开中断下完成。
+ *
+ * 队列持有每个分片的一个引用，分片的 data 指向负载，net_hdr 仍指向
+ * 它自己的 IP 头（片偏移从这里读），next 串成按偏移排序的链表。
+ * 巨型帧收到的分片本身可能带 frag 链，内存按链上的 netbuf 数计。
+ */
+
+#include "net.h"
+#include "ipfrag.h"
+#include "neigh.h"
+#include "checksum.h"
+#include "timer.h"
+#include "time.h"
+#include "printf.h"
+#include "string.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+#define IPFRAG_HOLE_INF     IP_MAX_LEN  // 还没收到最后一片时，尾部空洞的右端
+
+typedef struct {
+    uint32_t first;             // 缺的第一个字节（负载偏移）
+    uint32_t last;              // 缺的最后一个字节
+} ipfrag_hole_t;
+
+typedef struct ipfrag_queue {
+    struct ipfrag_queue *hnext; // 哈希桶链
+    uint8_t  in_use;
+    uint8_t  proto;
+    uint8_t  last_seen;         // 收到了 MF 为 0 的最后一片，total 有效
+    uint8_t  nholes;
+    uint16_t id;                // 以下地址和 id 都是网络字节序，直接和 IP 头比较
+    uint32_t src;
+    uint32_t dst;
+    uint32_t total;             // 负载总长
+    uint32_t mem;               // 本队列计入全局内存的字节数
+    uint32_t created;           // 第一个分片到达的时间（淘汰时先淘汰最老的）
+    netbuf_t *frags;            // 按片偏移排序
+    ipfrag_hole_t holes[IPFRAG_MAX_HOLES];
+    ktimer_t timer;
+} ipfrag_queue_t;
+
+static ipfrag_queue_t ipq_pool[IPFRAG_QUEUES];
+static ipfrag_queue_t *ipq_hash[IPFRAG_HASH_SIZE];
+static uint32_t ipfrag_mem = 0;
+static ipfrag_stats_t ipfrag_stats;
+
+static inline uint32_t ipfrag_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void ipfrag_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static void ipq_expire(ktimer_t *t);
+
+void ipfrag_init(void) {
+    memset(ipq_pool, 0, sizeof(ipq_pool));
+    memset(ipq_hash, 0, sizeof(ipq_hash));
+    memset(&ipfrag_stats, 0, sizeof(ipfrag_stats));
+    ipfrag_mem = 0;
+    for (int i = 0; i < IPFRAG_QUEUES; i++) {
+        timer_setup(&ipq_pool[i].timer, ipq_expire, &ipq_pool[i]);
+    }
+}
+
+static inline uint32_t ipq_hashfn(uint32_t src, uint32_t dst, uint16_t id, uint8_t proto) {
+    uint32_t h = src ^ dst ^ id ^ proto;
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h & (IPFRAG_HASH_SIZE - 1);
+}
+
+// 分片在数据报负载中的偏移
+static inline uint32_t ipfrag_offset(const netbuf_t *nb) {
+    const ip_hdr_t *ip = (const ip_hdr_t *)nb->net_hdr;
+    return (ntohs(ip->ip_off) & IP_OFFMASK) * 8;
+}
+
+// 分片（连同 frag 链）占用的缓冲区内存
+static inline uint32_t ipfrag_truesize(const netbuf_t *nb) {
+    uint32_t size = 0;
+    for (; nb; nb = nb->frag) {
+        size += NETBUF_DATA_SIZE;
+    }
+    return size;
+}
+
+// ==================== 队列管理（调用者已关中断） ====================
+
+static ipfrag_queue_t *ipq_find(const ip_hdr_t *ip) {
+    uint32_t h = ipq_hashfn(ip->ip_src, ip->ip_dst, ip->ip_id, ip->ip_proto);
+    for (ipfrag_queue_t *q = ipq_hash[h]; q; q = q->hnext) {
+        if (q->id == ip->ip_id && q->src == ip->ip_src &&
+            q->dst == ip->ip_dst && q->proto == ip->ip_proto) {
+            return q;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 摘下队列：从哈希表移除、归还内存计数，返回它持有的分片链（调用者释放）
+ */
+static netbuf_t *ipq_detach(ipfrag_queue_t *q) {
+    uint32_t h = ipq_hashfn(q->src, q->dst, q->id, q->proto);
+    for (ipfrag_queue_t **pp = &ipq_hash[h]; *pp; pp = &(*pp)->hnext) {
+        if (*pp == q) {
+            *pp = q->hnext;
+            break;
+        }
+    }
+    timer_del(&q->timer);
+
+    netbuf_t *frags = q->frags;
+    ipfrag_mem -= q->mem;
+    q->frags = NULL;
+    q->mem = 0;
+    q->hnext = NULL;
+    q->in_use = 0;
+    return frags;
+}
+
+// 释放按 next 串起来的分片
+static void ipfrag_free_list(netbuf_t *nb) {
+    while (nb) {
+        netbuf_t *next = nb->next;
+        nb->next = NULL;
+        netbuf_free(nb);
+        nb = next;
+    }
+}
+
+// 把队列摘下来的分片链接到 *list 前面，稍后在开中断时一起释放
+static void ipfrag_list_add(netbuf_t **list, netbuf_t *frags) {
+    if (!frags) {
+        return;
+    }
+    netbuf_t *t = frags;
+    while (t->next) {
+        t = t->next;
+    }
+    t->next = *list;
+    *list = frags;
+}
+
+// 淘汰最老的队列（except 除外），分片挂到 *list；没有可淘汰的返回 0
+static int ipq_evict_oldest(ipfrag_queue_t *except, netbuf_t **list) {
+    ipfrag_queue_t *oldest = NULL;
+    for (int i = 0; i < IPFRAG_QUEUES; i++) {
+        ipfrag_queue_t *q = &ipq_pool[i];
+        if (q->in_use && q != except &&
+            (!oldest || (int32_t)(q->created - oldest->created) < 0)) {
+            oldest = q;
+        }
+    }
+    if (!oldest) {
+        return 0;
+    }
+    ipfrag_stats.reasm_evictions++;
+    ipfrag_list_add(list, ipq_detach(oldest));
+    return 1;
+}
+
+static ipfrag_queue_t *ipq_create(const ip_hdr_t *ip, netbuf_t **evicted) {
+    ipfrag_queue_t *q = NULL;
+    for (int i = 0; i < IPFRAG_QUEUES; i++) {
+        if (!ipq_pool[i].in_use) {
+            q = &ipq_pool[i];
+            break;
+        }
+    }
+    if (!q) {
+        // 队列池满：淘汰最老的数据报，它多半已经丢了分片
+        ipq_evict_oldest(NULL, evicted);
+        for (int i = 0; i < IPFRAG_QUEUES; i++) {
+            if (!ipq_pool[i].in_use) {
+                q = &ipq_pool[i];
+                break;
+            }
+        }
+    }
+
+    q->in_use = 1;
+    q->proto = ip->ip_proto;
+    q->id = ip->ip_id;
+    q->src = ip->ip_src;
+    q->dst = ip->ip_dst;
+    q->last_seen = 0;
+    q->total = 0;
+    q->mem = 0;
+    q->frags = NULL;
+    q->created = clock_ms();
+    q->nholes = 1;
+    q->holes[0].first = 0;
+    q->holes[0].last = IPFRAG_HOLE_INF;
+
+    uint32_t h = ipq_hashfn(q->src, q->dst, q->id, q->proto);
+    q->hnext = ipq_hash[h];
+    ipq_hash[h] = q;
+    timer_mod(&q->timer, q->created + IPFRAG_TIMEOUT);
+    return q;
+}
+
+static void ipq_expire(ktimer_t *t) {
+    ipfrag_queue_t *q = (ipfrag_queue_t *)t->data;
+    netbuf_t *frags = NULL;
+
+    uint32_t flags = ipfrag_lock();
+    if (q->in_use) {
+        ipfrag_stats.reasm_timeouts++;
+        frags = ipq_detach(q);
+    }
+    ipfrag_unlock(flags);
+
+    ipfrag_free_list(frags);
+}
+
+// ==================== 空洞描述符（RFC 815） ====================
+
+/**
+ * @brief 把 [first, last] 填进队列的空洞
+ * @return 0 成功；1 这段数据已经全部收到过（重复分片）；-1 与已收数据部分重叠或空洞表溢出
+ */
+static int ipq_fill(ipfrag_queue_t *q, uint32_t first, uint32_t last, int more) {
+    int h;
+    for (h = 0; h < q->nholes; h++) {
+        if (first >= q->holes[h].first && last <= q->holes[h].last) {
+            break;
+        }
+    }
+    if (h == q->nholes) {
+        for (int i = 0; i < q->nholes; i++) {
+            if (first <= q->holes[i].last && last >= q->holes[i].first) {
+                return -1;
+            }
+        }
+        return 1;
+    }
+
+    ipfrag_hole_t hole = q->holes[h];
+    q->holes[h] = q->holes[--q->nholes];
+
+    if (first > hole.first) {
+        q->holes[q->nholes].first = hole.first;
+        q->holes[q->nholes].last = first - 1;
+        q->nholes++;
+    }
+    if (last < hole.last && more) {
+        if (q->nholes >= IPFRAG_MAX_HOLES) {
+            return -1;
+        }
+        q->holes[q->nholes].first = last + 1;
+        q->holes[q->nholes].last = hole.last;
+        q->nholes++;
+    }
+    return 0;
+}
+
+// 按片偏移插入（调用者已关中断）
+static void ipq_insert(ipfrag_queue_t *q, netbuf_t *nb, uint32_t offset) {
+    netbuf_t **pp = &q->frags;
+    while (*pp && ipfrag_offset(*pp) < offset) {
+        pp = &(*pp)->next;
+    }
+    nb->next = *pp;
+    *pp = nb;
+}
+
+// ==================== 重组 ====================
+
+/**
+ * @brief 把排好序的分片串成一个数据报（开中断执行）
+ *
+ * 第一片的 IP 头原地改成整个数据报的头，后面各片只留负载挂在 frag 链上
+ * （分片自己带 frag 链时接在它的链尾后面）。
+ */
+static netbuf_t *ipfrag_reasm(netbuf_t *frags, uint32_t total) {
+    netbuf_t *head = frags;
+    netbuf_t *tail = head;
+    for (netbuf_t *f = head->next; f; f = f->next) {
+        while (tail->frag) {
+            tail = tail->frag;
+        }
+        tail->frag = f;
+        tail = f;
+        f->ip_summed = NETBUF_CSUM_NONE;
+    }
+    for (netbuf_t *f = head; f; ) {
+        netbuf_t *next = f->next;
+        f->next = NULL;
+        f = next;
+    }
+
+    ip_hdr_t *ip = (ip_hdr_t *)head->net_hdr;
+    uint32_t hdr_len = (ip->ip_verhlen & 0x0F) * 4;
+    netbuf_push(head, hdr_len);
+    head->ip_summed = NETBUF_CSUM_NONE;
+
+    ip->ip_len = htons(hdr_len + total);
+    ip->ip_off = 0;
+    ip->ip_sum = 0;
+    ip->ip_sum = ip_fast_csum(ip, hdr_len / 4);
+    return head;
+}
+
+/**
+ * @brief 接收一个分片（见 ipfrag.h）
+ */
+netbuf_t *ip_defrag(netbuf_t *nb) {
+    ip_hdr_t *ip = (ip_hdr_t *)nb->data;
+    uint32_t hdr_len = (ip->ip_verhlen & 0x0F) * 4;
+    uint16_t off = ntohs(ip->ip_off);
+    uint32_t first = (off & IP_OFFMASK) * 8;
+    uint32_t len = netbuf_total_len(nb) - hdr_len;
+    uint32_t truesize = ipfrag_truesize(nb);
+    int more = (off & IP_MF) != 0;
+    netbuf_t *dropped = NULL;
+    netbuf_t *done = NULL;
+    uint32_t total = 0;
+
+    ipfrag_stats.reasm_reqds++;
+
+    // 空分片、超过 IP 最大长度、非最后一片却不是 8 字节的整数倍：都是非法的
+    if (len == 0 || hdr_len + first + len > IP_MAX_LEN || (more && (len & 7))) {
+        ipfrag_stats.reasm_fails++;
+        return NULL;
+    }
+    uint32_t last = first + len - 1;
+
+    uint32_t flags = ipfrag_lock();
+    ipfrag_queue_t *q = ipq_find(ip);
+    if (!q) {
+        q = ipq_create(ip, &dropped);
+    }
+
+    // 已知总长时，分片不能越过末尾，最后一片也不能改总长
+    if (q->last_seen && (last >= q->total || (!more && last + 1 != q->total))) {
+        goto bad;
+    }
+    // 最后一片：之前不能收到过越过它的分片
+    if (!more && q->frags) {
+        netbuf_t *f = q->frags;
+        while (f->next) {
+            f = f->next;
+        }
+        if (ipfrag_offset(f) + netbuf_total_len(f) > last + 1) {
+            goto bad;
+        }
+    }
+
+    // 内存不够先淘汰别的数据报；只剩这个数据报自己时丢掉这一片，等对方重传
+    while (ipfrag_mem + truesize > IPFRAG_MEM_MAX) {
+        if (!ipq_evict_oldest(q, &dropped)) {
+            ipfrag_stats.reasm_fails++;
+            ipfrag_unlock(flags);
+            ipfrag_free_list(dropped);
+            return NULL;
+        }
+    }
+
+    int ret = ipq_fill(q, first, last, more);
+    if (ret < 0) {
+        goto bad;
+    }
+    if (ret > 0) {
+        // 重复分片：已经有了，忽略
+        ipfrag_unlock(flags);
+        ipfrag_free_list(dropped);
+        return NULL;
+    }
+    if (!more) {
+        // 总长确定后，末尾之后的空洞不再存在
+        q->last_seen = 1;
+        q->total = last + 1;
+        for (int i = 0; i < q->nholes; ) {
+            if (q->holes[i].first > last) {
+                q->holes[i] = q->holes[--q->nholes];
+            } else {
+                i++;
+            }
+        }
+    }
+
+    netbuf_pull(netbuf_get(nb), hdr_len);
+    ipq_insert(q, nb, first);
+    q->mem += truesize;
+    ipfrag_mem += truesize;
+
+    if (q->last_seen && q->nholes == 0) {
+        total = q->total;
+        done = ipq_detach(q);
+        ipfrag_stats.reasm_oks++;
+    }
+    ipfrag_unlock(flags);
+
+    ipfrag_free_list(dropped);
+    return done ? ipfrag_reasm(done, total) : NULL;
+
+bad:
+    // 非法分片：整个数据报作废
+    ipfrag_stats.reasm_fails++;
+    ipfrag_list_add(&dropped, ipq_detach(q));
+    ipfrag_unlock(flags);
+    ipfrag_free_list(dropped);
+    return NULL;
+}
+
+// ==================== 分片 ====================
+
+/**
+ * @brief 从 (*seg, *off) 处拷出 len 字节并前移游标（跨 frag 链）
+ */
+static void ipfrag_copy(netbuf_t **seg, uint32_t *off, uint8_t *dst, uint32_t len) {
+    while (len > 0) {
+        netbuf_t *s = *seg;
+        if (*off >= s->len) {
+            *seg = s->frag;
+            *off = 0;
+            continue;
+        }
+        uint32_t n = s->len - *off;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dst, s->data + *off, n);
+        dst += n;
+        *off += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief 把 IP 包切成不超过 dev->mtu 的分片发往 next_hop（见 ipfrag.h）
+ *
+ * 每片是一个新分配的 netbuf：拷一份 IP 头（我们自己发的包没有选项），
+ * 再从原包（可能带 frag 链）顺序拷出一段负载；巨型帧 MTU 下一个 netbuf
+ * 放不下的部分挂在该片的 frag 链上。L4 校验和必须已经算好，
+ * 网卡没法在分片上插入校验和。
+ */
+int ip_fragment(net_device_t *dev, uint32_t next_hop, netbuf_t *nb) {
+    ip_hdr_t *ip = (ip_hdr_t *)nb->data;
+    uint32_t hdr_len = (ip->ip_verhlen & 0x0F) * 4;
+    uint32_t payload = netbuf_total_len(nb) - hdr_len;
+    uint32_t chunk = (dev->mtu - hdr_len) & ~7u;
+    uint16_t off_flags = ntohs(ip->ip_off);
+
+    if ((off_flags & IP_DF) || nb->ip_summed == NETBUF_CSUM_PARTIAL || chunk == 0) {
+        ipfrag_stats.frag_fails++;
+        netbuf_free(nb);
+        return -1;
+    }
+
+    netbuf_t *seg = nb;
+    uint32_t seg_off = hdr_len;
+    uint32_t base = (off_flags & IP_OFFMASK) * 8;   // 转发已经是分片的包时保留原偏移
+    int ret = 0;
+
+    for (uint32_t off = 0; off < payload; off += chunk) {
+        uint32_t n = payload - off < chunk ? payload - off : chunk;
+        netbuf_t *f = netbuf_alloc(NETBUF_HEADROOM);
+        if (!f) {
+            ipfrag_stats.frag_fails++;
+            ret = -1;
+            break;
+        }
+
+        ip_hdr_t *fip = (ip_hdr_t *)netbuf_put(f, hdr_len);
+        memcpy(fip, ip, hdr_len);
+        netbuf_t *tail = f;
+        uint32_t left = n;
+        while (left > 0) {
+            if (!netbuf_tailroom(tail)) {
+                netbuf_t *more = netbuf_alloc(0);
+                if (!more) {
+                    break;
+                }
+                netbuf_frag_append(f, more);
+                tail = more;
+            }
+            uint32_t m = left < netbuf_tailroom(tail) ? left : netbuf_tailroom(tail);
+            ipfrag_copy(&seg, &seg_off, netbuf_put(tail, m), m);
+            left -= m;
+        }
+        if (left) {
+            netbuf_free(f);
+            ipfrag_stats.frag_fails++;
+            ret = -1;
+            break;
+        }
+
+        uint16_t frag_off = (uint16_t)((base + off) >> 3);
+        if (off + n < payload || (off_flags & IP_MF)) {
+            frag_off |= IP_MF;
+        }
+        fip->ip_len = htons(hdr_len + n);
+        fip->ip_off = htons(frag_off);
+        fip->ip_sum = 0;
+        fip->ip_sum = ip_fast_csum(fip, hdr_len / 4);
+        f->net_hdr = (uint8_t *)fip;
+        f->tos = nb->tos;
+
+        ipfrag_stats.frag_creates++;
+        neigh_output(dev, next_hop, f);
+    }
+
+    if (ret == 0) {
+        ipfrag_stats.frag_oks++;
+    }
+    netbuf_free(nb);
+    return ret;
+}
+
+void ipfrag_get_stats(ipfrag_stats_t *stats) {
+    uint32_t flags = ipfrag_lock();
+    *stats = ipfrag_stats;
+    ipfrag_unlock(flags);
+}
@@ -2,37 +2,61 @@
  * @file loopback.c
  * @brief 回环网络设备实现
  *
- * 用于测试网络协议栈，发送的数据包会立即被接收
+ * IP 层发往回环的包走快速路径：ip_output_dst 看到 NETIF_F_LOOPBACK 就把
+ * 填好 IP 头的 netbuf 交给 loopback_output，不加以太网头、不算校验和，
+ * 同一个 netbuf 挂到接收积压队列，在 NET_RX_SOFTIRQ 里直接交给 ip_input。
+ * 原始以太网帧（net_tx_packet 等）仍走 xmit/send，同样推迟到软中断接收。
  */
 
 #include "net.h"
+#include "route.h"
+#include "softirq.h"
+#include "x86/io.h"
 #include "../include/printf.h"
 #include "../include/string.h"
-#include "../include/kmalloc.h"
+
+#define LOOPBACK_MTU  65535     // IP 数据报上限，TCP/UDP 在回环上不用分段/分片
+
+extern net_stats_t net_stats;
 
 static net_device_t loopback_dev;
 static uint8_t loopback_mac[ETH_ALEN] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
 
 /**
- * @brief 回环设备发送函数（直接调用接收）
+ * @brief 回环设备发送函数（拷进 netbuf 后挂到接收队列）
  */
 static int loopback_send(net_device_t *dev, uint8_t *data, uint32_t len) {
-    printf("[loopback] Sending %d bytes\n", len);
-
-    // 分配缓冲区并复制数据
-    uint8_t *buf = (uint8_t *)kmalloc(len);
-    if (!buf) {
-        printf("[loopback] Failed to allocate buffer\n");
+    netbuf_t *nb = netbuf_from_chain(data, len, 0);
+    if (!nb) {
+        printf("[loopback] Failed to allocate netbuf\n");
         return -1;
     }
+    return net_rx_enqueue(dev, nb);
+}
 
-    memcpy(buf, data, len);
-
-    // 直接调用接收函数
-    int ret = net_rx_packet(dev, buf, len);
-
-    kfree(buf);
+/**
+ * @brief 回环设备 netbuf 发送（零拷贝：同一个 netbuf 挂到接收队列，软中断里再接收）
+ */
+static int loopback_xmit(net_device_t *dev, netbuf_t *nb) {
+    return net_rx_enqueue(dev, nb);
+}
 
+/**
+ * @brief 回环快速路径（ip_output_dst 调用，nb->data 指向 IP 头，接管 nb）
+ *
+ * 包不离开本机：CSUM_PARTIAL 留下的伪头部和不用补全，接收端按已校验处理；
+ * 不经过 qdisc 和驱动，发送统计在这里记。
+ * 进程上下文（开着中断）发送时接着把接收软中断跑掉，不等 1ms 定时器；
+ * 关着中断的调用者（tcp_lock 内）由系统调用返回前的 softirq_run_pending 处理。
+ */
+int loopback_output(net_device_t *dev, netbuf_t *nb) {
+    nb->ip_summed = NETBUF_CSUM_UNNECESSARY;
+    nb->gso_size = 0;
+
+    net_stats.tx_packets++;
+    net_stats.tx_bytes += netbuf_total_len(nb);
+    int ret = net_rx_enqueue_l3(dev, nb, ETH_P_IP);
+    softirq_run_pending(readeflags());
     return ret;
 }
 
@@ -46,8 +70,10 @@ int loopback_init(void) {
 
     strcpy(loopback_dev.name, "lo");
     memcpy(loopback_dev.mac_addr, loopback_mac, ETH_ALEN);
-    loopback_dev.mtu = ETH_MTU;
+    loopback_dev.max_mtu = LOOPBACK_MTU;
+    loopback_dev.features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_RXCSUM | NETIF_F_LOOPBACK;
     loopback_dev.send = loopback_send;
+    loopback_dev.xmit = loopback_xmit;
     loopback_dev.recv = NULL;
     loopback_dev.ioctl = NULL;
     loopback_dev.priv = NULL;
@@ -58,10 +84,11 @@ int loopback_init(void) {
         return -1;
     }
 
-    // 设置loopback设备的IP为127.0.0.1
-    loopback_dev.ip_addr = 0x7F000001;  // 127.0.0.1
-    loopback_dev.netmask = 0xFF000000;   // 255.0.0.0
-    loopback_dev.gateway = 0;            // 无网关
+    // 注册时 MTU 被重置为 ETH_MTU
+    net_device_set_mtu(&loopback_dev, LOOPBACK_MTU);
+
+    // 设置loopback设备的IP为127.0.0.1/8，无网关（替换注册时生成的默认路由）
+    net_device_set_addr(&loopback_dev, 0x7F000001, 0xFF000000, 0);
 
     printf("[loopback] Loopback device ready (IP: 127.0.0.1)\n");
     return 0;
@@ -0,0 +1,399 @@
+/**
+ * @file neigh.c
+ * @brief 邻居子系统：ARP 缓存、挂起队列、重发和老化
+ *
+ * 所有表项操作都在关中断下进行（发包路径、net_rx_action 和定时器回调
+ * 都会进来）；真正发包（eth_output / ARP 请求）放在解锁之后。
+ */
+
+#include "neigh.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+
+static neighbour_t neigh_pool[NEIGH_MAX];
+static neighbour_t *neigh_free_list;
+static neighbour_t *neigh_hash[NEIGH_HASH_SIZE];
+static neigh_stats_t neigh_stats;
+static ktimer_t neigh_gc_timer;
+static uint32_t neigh_dynamic;      // 需要老化的表项数（不含 PERMANENT）
+
+static inline uint32_t neigh_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void neigh_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static inline uint32_t neigh_hashfn(uint32_t ip) {
+    return (ip * 0x9E3779B1u) >> 24;    // NEIGH_HASH_SIZE == 256
+}
+
+// 调用者已加锁；dev 为 NULL 的静态表项对所有设备有效
+static neighbour_t *neigh_lookup(net_device_t *dev, uint32_t ip) {
+    for (neighbour_t *n = neigh_hash[neigh_hashfn(ip)]; n; n = n->next) {
+        if (n->ip == ip && (n->dev == dev || n->dev == NULL)) {
+            return n;
+        }
+    }
+    return NULL;
+}
+
+// 调用者已加锁；返回摘下来的挂起队列，由调用者在解锁后处理
+static netbuf_t *neigh_destroy(neighbour_t *n) {
+    neighbour_t **pp = &neigh_hash[neigh_hashfn(n->ip)];
+    netbuf_t *queue = n->queue;
+
+    while (*pp && *pp != n) {
+        pp = &(*pp)->next;
+    }
+    if (*pp) {
+        *pp = n->next;
+    }
+    timer_del(&n->timer);
+    if (n->state != NUD_PERMANENT) {
+        neigh_dynamic--;
+    }
+
+    n->queue = NULL;
+    n->qlen = 0;
+    n->state = NUD_NONE;
+    n->next = neigh_free_list;
+    neigh_free_list = n;
+    neigh_stats.entries--;
+    return queue;
+}
+
+static void neigh_free_queue(netbuf_t *queue) {
+    while (queue) {
+        netbuf_t *next = queue->next;
+        queue->next = NULL;
+        netbuf_free(queue);
+        queue = next;
+    }
+}
+
+static void neigh_timer(ktimer_t *t);
+static void neigh_gc(ktimer_t *t);
+
+// 调用者已加锁；表满时回收最久没用的 STALE 表项
+static neighbour_t *neigh_alloc(net_device_t *dev, uint32_t ip, uint8_t state,
+                                netbuf_t **evicted) {
+    neighbour_t *n = neigh_free_list;
+
+    *evicted = NULL;
+    if (!n) {
+        neighbour_t *victim = NULL;
+        uint32_t now = clock_ms();
+        for (int i = 0; i < NEIGH_MAX; i++) {
+            neighbour_t *c = &neigh_pool[i];
+            if (c->state == NUD_STALE &&
+                (!victim || now - c->used > now - victim->used)) {
+                victim = c;
+            }
+        }
+        if (!victim) {
+            neigh_stats.table_full++;
+            return NULL;
+        }
+        *evicted = neigh_destroy(victim);
+        n = neigh_free_list;
+    }
+    neigh_free_list = n->next;
+
+    memset(n, 0, sizeof(*n));
+    n->dev = dev;
+    n->ip = ip;
+    n->state = state;
+    n->used = n->confirmed = clock_ms();
+    timer_setup(&n->timer, neigh_timer, n);
+
+    uint32_t h = neigh_hashfn(ip);
+    n->next = neigh_hash[h];
+    neigh_hash[h] = n;
+    neigh_stats.entries++;
+
+    if (state != NUD_PERMANENT) {
+        neigh_dynamic++;
+        if (!timer_pending(&neigh_gc_timer)) {
+            timer_mod(&neigh_gc_timer, clock_ms() + NEIGH_GC_INTERVAL_MS);
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief 初始化表项池
+ */
+void neigh_init(void) {
+    memset(neigh_pool, 0, sizeof(neigh_pool));
+    memset(neigh_hash, 0, sizeof(neigh_hash));
+    memset(&neigh_stats, 0, sizeof(neigh_stats));
+    neigh_free_list = NULL;
+    for (int i = NEIGH_MAX - 1; i >= 0; i--) {
+        neigh_pool[i].next = neigh_free_list;
+        neigh_free_list = &neigh_pool[i];
+    }
+    neigh_dynamic = 0;
+    timer_setup(&neigh_gc_timer, neigh_gc, NULL);
+}
+
+// INCOMPLETE 表项的重发定时器
+static void neigh_timer(ktimer_t *t) {
+    neighbour_t *n = (neighbour_t *)t->data;
+    netbuf_t *dropped = NULL;
+    net_device_t *dev = n->dev;
+    uint32_t ip = n->ip;
+    int resend = 0;
+
+    uint32_t flags = neigh_lock();
+    if (n->state == NUD_INCOMPLETE) {
+        if (n->probes >= NEIGH_MAX_PROBES) {
+            neigh_stats.res_failed++;
+            neigh_stats.queue_drops += n->qlen;
+            dropped = neigh_destroy(n);
+        } else {
+            n->probes++;
+            n->probed = clock_ms();
+            timer_mod(&n->timer, n->probed + NEIGH_RETRANS_MS);
+            resend = 1;
+        }
+    }
+    neigh_unlock(flags);
+
+    if (dropped) {
+        printf("[arp] %d.%d.%d.%d unreachable, dropping queued packets\n",
+               (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+        neigh_free_queue(dropped);
+    }
+    if (resend) {
+        arp_solicit(dev, ip, NULL);
+    }
+}
+
+// 老化：REACHABLE 过期降为 STALE，STALE 长期不用或确认失败就回收
+static void neigh_gc(ktimer_t *t) {
+    netbuf_t *dropped = NULL;
+    uint32_t flags = neigh_lock();
+    uint32_t now = clock_ms();
+
+    for (int i = 0; i < NEIGH_HASH_SIZE; i++) {
+        neighbour_t *n = neigh_hash[i];
+        while (n) {
+            neighbour_t *next = n->next;
+            if (n->state == NUD_REACHABLE && now - n->confirmed >= NEIGH_REACHABLE_MS) {
+                n->state = NUD_STALE;
+                n->probes = 0;
+            } else if (n->state == NUD_STALE &&
+                       (now - n->used >= NEIGH_GC_STALE_MS || n->probes >= NEIGH_MAX_PROBES)) {
+                // STALE 表项不会有挂起队列
+                dropped = neigh_destroy(n);
+            }
+            n = next;
+        }
+    }
+
+    if (neigh_dynamic) {
+        timer_mod(t, now + NEIGH_GC_INTERVAL_MS);
+    }
+    neigh_unlock(flags);
+    neigh_free_queue(dropped);
+}
+
+/**
+ * @brief 发送 IP 包到下一跳
+ *
+ * 已解析（REACHABLE / STALE / PERMANENT）直接交给以太网层；
+ * 否则把包挂在 INCOMPLETE 表项上（满了丢最早的一个），必要时发出 ARP 请求后立即返回。
+ */
+int neigh_output(net_device_t *dev, uint32_t next_hop, netbuf_t *nb) {
+    uint8_t mac[ETH_ALEN];
+    netbuf_t *evicted = NULL;
+    netbuf_t *dropped = NULL;
+    int solicit = 0;
+    int have_mac = 0;
+    int unicast_probe = 0;
+
+    uint32_t flags = neigh_lock();
+    uint32_t now = clock_ms();
+    neigh_stats.lookups++;
+
+    neighbour_t *n = neigh_lookup(dev, next_hop);
+    if (n && n->state != NUD_INCOMPLETE) {
+        neigh_stats.hits++;
+        memcpy(mac, n->mac, ETH_ALEN);
+        have_mac = 1;
+        n->used = now;
+        // STALE：照常发送，同时（每个重发间隔最多一次）单播请求确认
+        if (n->state == NUD_STALE && now - n->probed >= NEIGH_RETRANS_MS) {
+            n->probed = now;
+            n->probes++;
+            unicast_probe = 1;
+        }
+    } else {
+        if (!n) {
+            n = neigh_alloc(dev, next_hop, NUD_INCOMPLETE, &evicted);
+            if (n) {
+                n->probed = now;
+                timer_mod(&n->timer, now + NEIGH_RETRANS_MS);
+                solicit = 1;
+            }
+        }
+        if (!n) {
+            neigh_stats.queue_drops++;
+            dropped = nb;
+        } else {
+            if (n->qlen >= NEIGH_QUEUE_MAX) {
+                dropped = n->queue;
+                n->queue = dropped->next;
+                dropped->next = NULL;
+                n->qlen--;
+                neigh_stats.queue_drops++;
+            }
+            nb->next = NULL;
+            netbuf_t **pp = &n->queue;
+            while (*pp) {
+                pp = &(*pp)->next;
+            }
+            *pp = nb;
+            n->qlen++;
+        }
+    }
+    neigh_unlock(flags);
+
+    neigh_free_queue(evicted);
+    neigh_free_queue(dropped);
+
+    if (have_mac) {
+        if (unicast_probe) {
+            arp_solicit(dev, next_hop, mac);
+        }
+        return eth_output(dev, mac, ETH_P_IP, nb);
+    }
+    if (solicit) {
+        arp_solicit(dev, next_hop, NULL);
+    }
+    return dropped == nb ? -1 : 0;
+}
+
+/**
+ * @brief 收到 (ip, mac) 的 ARP：确认表项，解析完成时发出挂起的包
+ * @param create 表中没有时是否新建（只有发给我们的 ARP 才新建）
+ */
+void neigh_update(net_device_t *dev, uint32_t ip, const uint8_t *mac, int create) {
+    netbuf_t *queue = NULL;
+    netbuf_t *evicted = NULL;
+
+    uint32_t flags = neigh_lock();
+    neighbour_t *n = neigh_lookup(dev, ip);
+
+    if (!n && create) {
+        n = neigh_alloc(dev, ip, NUD_REACHABLE, &evicted);
+    }
+    if (n && n->state != NUD_PERMANENT) {
+        if (n->state == NUD_INCOMPLETE) {
+            timer_del(&n->timer);
+            queue = n->queue;
+            n->queue = NULL;
+            n->qlen = 0;
+        }
+        memcpy(n->mac, mac, ETH_ALEN);
+        n->state = NUD_REACHABLE;
+        n->probes = 0;
+        n->confirmed = clock_ms();
+    }
+    neigh_unlock(flags);
+
+    neigh_free_queue(evicted);
+
+    // 挂起的包在一个批量里发出，每个设备只敲一次门铃
+    if (queue) {
+        net_tx_batch_begin();
+        while (queue) {
+            netbuf_t *next = queue->next;
+            queue->next = NULL;
+            eth_output(dev, mac, ETH_P_IP, queue);
+            queue = next;
+        }
+        net_tx_batch_end();
+    }
+}
+
+/**
+ * @brief 添加静态表项（dev 为 NULL 表示对所有设备有效）
+ */
+int neigh_add_permanent(net_device_t *dev, uint32_t ip, const uint8_t *mac) {
+    netbuf_t *evicted = NULL;
+    netbuf_t *queue = NULL;
+    uint32_t flags = neigh_lock();
+    neighbour_t *n = neigh_lookup(dev, ip);
+
+    if (n) {
+        queue = neigh_destroy(n);
+    }
+    n = neigh_alloc(dev, ip, NUD_PERMANENT, &evicted);
+    if (n) {
+        memcpy(n->mac, mac, ETH_ALEN);
+    }
+    neigh_unlock(flags);
+
+    neigh_free_queue(queue);
+    neigh_free_queue(evicted);
+    return n ? 0 : -1;
+}
+
+static const char *neigh_state_name(uint8_t state) {
+    switch (state) {
+    case NUD_INCOMPLETE: return "INCOMPLETE";
+    case NUD_REACHABLE:  return "REACHABLE";
+    case NUD_STALE:      return "STALE";
+    case NUD_PERMANENT:  return "PERMANENT";
+    default:             return "NONE";
+    }
+}
+
+/**
+ * @brief 打印 dev 上的表项（dev 为 NULL 时打印全部），类似 arp -a
+ */
+void neigh_dump(net_device_t *dev) {
+    int count = 0;
+
+    printf("%-18s %-17s %s\n", "IP Address", "MAC Address", "State");
+    printf("----------------- ----------------- ----------\n");
+
+    for (int i = 0; i < NEIGH_HASH_SIZE; i++) {
+        for (neighbour_t *n = neigh_hash[i]; n; n = n->next) {
+            if (dev && n->dev && n->dev != dev) {
+                continue;
+            }
+            printf("%d.%d.%d.%d    %02x:%02x:%02x:%02x:%02x:%02x  %s\n",
+                   (n->ip >> 24) & 0xFF, (n->ip >> 16) & 0xFF,
+                   (n->ip >> 8) & 0xFF, n->ip & 0xFF,
+                   n->mac[0], n->mac[1], n->mac[2],
+                   n->mac[3], n->mac[4], n->mac[5],
+                   neigh_state_name(n->state));
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        printf("(No entries)\n");
+    }
+    printf("----------------- ----------------- ----------\n");
+    printf("Total: %d entries (lookups %u, hits %u, failed %u, queue drops %u)\n\n",
+           count, neigh_stats.lookups, neigh_stats.hits,
+           neigh_stats.res_failed, neigh_stats.queue_drops);
+}
+
+void neigh_get_stats(neigh_stats_t *stats) {
+    uint32_t flags = neigh_lock();
+    *stats = neigh_stats;
+    neigh_unlock(flags);
+}
@@ -0,0 +1,261 @@
+/**
+ * @file netbuf.c
+ * @brief 网络数据包缓冲池
+ *
+ * mm/slab.c 目前未启用，而且普通 kmalloc 拿不到网卡可用的物理地址，
+ * 所以这里自己维护一个定长对象的 slab：初始化时从 DMA coherent 区域
+ * 一次性切出 NETBUF_POOL_SIZE 块 NETBUF_DATA_SIZE 字节的数据区，
+ * netbuf 描述符放在静态数组里，空闲对象挂在单链表上，分配/回收都是 O(1)。
+ */
+
+#include "net.h"
+#include "netbuf.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+
+// DMA 函数声明（在 page.c 中实现）
+extern void *dma_alloc_coherent(uint32_t size, uint32_t *dma_handle);
+
+static netbuf_t netbuf_pool[NETBUF_POOL_SIZE];
+static netbuf_t *netbuf_free_list = NULL;
+static netbuf_stats_t netbuf_stats;
+
+// 空闲链表会被中断上下文（网卡 ISR）和普通上下文同时访问，关中断保护
+static inline uint32_t netbuf_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void netbuf_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+/**
+ * @brief 初始化缓冲池（可重复调用，只初始化一次）
+ */
+int netbuf_pool_init(void) {
+    if (netbuf_stats.total) {
+        return 0;
+    }
+
+    uint32_t slab_dma;
+    uint8_t *slab = dma_alloc_coherent(NETBUF_POOL_SIZE * NETBUF_DATA_SIZE, &slab_dma);
+    if (!slab) {
+        printf("[netbuf] ERROR: Failed to allocate buffer slab\n");
+        return -1;
+    }
+
+    netbuf_free_list = NULL;
+    for (int i = NETBUF_POOL_SIZE - 1; i >= 0; i--) {
+        netbuf_t *nb = &netbuf_pool[i];
+        memset(nb, 0, sizeof(*nb));
+        nb->head = slab + i * NETBUF_DATA_SIZE;
+        nb->end = nb->head + NETBUF_DATA_SIZE;
+        nb->dma = slab_dma + i * NETBUF_DATA_SIZE;
+        nb->next = netbuf_free_list;
+        netbuf_free_list = nb;
+    }
+
+    netbuf_stats.total = NETBUF_POOL_SIZE;
+    netbuf_stats.free = NETBUF_POOL_SIZE;
+
+    printf("[netbuf] Pool ready: %d x %d bytes (dma=0x%x)\n",
+           NETBUF_POOL_SIZE, NETBUF_DATA_SIZE, slab_dma);
+    return 0;
+}
+
+/**
+ * @brief 从缓冲池分配一个 netbuf
+ * @param headroom data 前预留的字节数
+ * @return netbuf 指针（refcnt = 1, len = 0），池耗尽返回 NULL
+ */
+netbuf_t *netbuf_alloc(uint32_t headroom) {
+    if (headroom > NETBUF_DATA_SIZE) {
+        return NULL;
+    }
+
+    uint32_t flags = netbuf_lock();
+    netbuf_t *nb = netbuf_free_list;
+    if (nb) {
+        netbuf_free_list = nb->next;
+        netbuf_stats.free--;
+        netbuf_stats.alloc_count++;
+    } else {
+        netbuf_stats.fail_count++;
+    }
+    netbuf_unlock(flags);
+
+    if (!nb) {
+        return NULL;
+    }
+
+    nb->next = NULL;
+    nb->data = nb->head + headroom;
+    nb->tail = nb->data;
+    nb->len = 0;
+    nb->dev = NULL;
+    nb->protocol = 0;
+    nb->refcnt = 1;
+    nb->mac_hdr = NULL;
+    nb->net_hdr = NULL;
+    nb->trans_hdr = NULL;
+    nb->frag = NULL;
+    nb->ip_summed = NETBUF_CSUM_NONE;
+    nb->csum_offset = 0;
+    nb->gso_size = 0;
+    nb->rx_queue = 0;
+    nb->tos = 0;
+    return nb;
+}
+
+/**
+ * @brief 分配 netbuf 并拷入数据（整条路径上唯一的一次拷贝）
+ */
+netbuf_t *netbuf_from(const void *src, uint32_t len, uint32_t headroom) {
+    netbuf_t *nb = netbuf_alloc(headroom);
+    if (!nb) {
+        return NULL;
+    }
+
+    uint8_t *p = netbuf_put(nb, len);
+    if (!p) {
+        netbuf_free(nb);
+        return NULL;
+    }
+    if (len) {
+        memcpy(p, src, len);
+    }
+    return nb;
+}
+
+/**
+ * @brief 同 netbuf_from，但数据可以超过一个 netbuf：放不下的部分依次挂在 frag 链上
+ *
+ * 用于要在 IP 层分片的大数据报，失败时整条链一起释放。
+ */
+netbuf_t *netbuf_from_chain(const void *src, uint32_t len, uint32_t headroom) {
+    netbuf_t *head = netbuf_alloc(headroom);
+    if (!head) {
+        return NULL;
+    }
+
+    const uint8_t *p = (const uint8_t *)src;
+    netbuf_t *nb = head;
+    for (;;) {
+        uint32_t n = len < netbuf_tailroom(nb) ? len : netbuf_tailroom(nb);
+        if (n) {
+            memcpy(netbuf_put(nb, n), p, n);
+        }
+        p += n;
+        len -= n;
+        if (len == 0) {
+            return head;
+        }
+        nb = netbuf_alloc(0);
+        if (!nb) {
+            netbuf_free(head);
+            return NULL;
+        }
+        netbuf_frag_append(head, nb);
+    }
+}
+
+/**
+ * @brief 增加引用计数
+ */
+netbuf_t *netbuf_get(netbuf_t *nb) {
+    if (nb) {
+        uint32_t flags = netbuf_lock();
+        nb->refcnt++;
+        netbuf_unlock(flags);
+    }
+    return nb;
+}
+
+/**
+ * @brief 减少引用计数，归零时回收到缓冲池（连同分片链）
+ */
+void netbuf_free(netbuf_t *nb) {
+    while (nb) {
+        netbuf_t *frag = NULL;
+
+        uint32_t flags = netbuf_lock();
+        if (nb->refcnt == 0) {
+            netbuf_unlock(flags);
+            printf("[netbuf] WARNING: double free of netbuf 0x%x\n", (uint32_t)nb);
+            return;
+        }
+        if (--nb->refcnt == 0) {
+            frag = nb->frag;
+            nb->frag = NULL;
+            nb->next = netbuf_free_list;
+            netbuf_free_list = nb;
+            netbuf_stats.free++;
+        }
+        netbuf_unlock(flags);
+
+        nb = frag;
+    }
+}
+
+/**
+ * @brief 把 frag 挂到 nb 的分片链尾部（接管 frag）
+ */
+void netbuf_frag_append(netbuf_t *nb, netbuf_t *frag) {
+    while (nb->frag) {
+        nb = nb->frag;
+    }
+    nb->frag = frag;
+}
+
+/**
+ * @brief 把分片链拷回头 netbuf 尾部（给不支持分散/聚集的设备用）
+ * @return 0 成功；头 netbuf 的 tailroom 放不下时返回 -1，nb 保持不变
+ */
+int netbuf_linearize(netbuf_t *nb) {
+    if (!nb->frag) {
+        return 0;
+    }
+    if (netbuf_total_len(nb->frag) > netbuf_tailroom(nb)) {
+        return -1;
+    }
+
+    for (netbuf_t *f = nb->frag; f; f = f->frag) {
+        memcpy(netbuf_put(nb, f->len), f->data, f->len);
+    }
+    netbuf_t *frag = nb->frag;
+    nb->frag = NULL;
+    netbuf_free(frag);
+    return 0;
+}
+
+/**
+ * @brief 把整条分片链截断为 len 字节，截掉之后不再有数据的分片随即释放
+ */
+void netbuf_trim_total(netbuf_t *nb, uint32_t len) {
+    while (nb && len > nb->len) {
+        len -= nb->len;
+        nb = nb->frag;
+    }
+    if (!nb) {
+        return;
+    }
+    netbuf_trim(nb, len);
+    netbuf_t *frag = nb->frag;
+    nb->frag = NULL;
+    netbuf_free(frag);
+}
+
+/**
+ * @brief 获取缓冲池统计
+ */
+void netbuf_get_stats(netbuf_stats_t *stats) {
+    uint32_t flags = netbuf_lock();
+    *stats = netbuf_stats;
+    netbuf_unlock(flags);
+}
@@ -0,0 +1,357 @@
+/**
+ * @file route.c
+ * @brief IPv4 路由表：按前缀长度分组的哈希表，最长前缀匹配
+ *
+ * 路由表只在配置时修改，查找在发包路径上（包括中断上下文），
+ * 所有操作都在关中断下进行。
+ */
+
+#include "route.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+
+static route_t route_pool[ROUTE_MAX];
+static route_t *route_free_list;
+static route_t *route_hash[33][ROUTE_HASH_SIZE];    // 下标是前缀长度
+static uint16_t route_plen_count[33];              // 每个前缀长度上的路由数，0 时查找直接跳过
+
+uint32_t route_genid = 1;       // 从 1 开始，清零的 dst_cache_t 天然无效
+
+static inline uint32_t route_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void route_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static inline uint32_t route_mask(uint8_t plen) {
+    return plen ? 0xFFFFFFFFu << (32 - plen) : 0;
+}
+
+static inline uint32_t route_hashfn(uint32_t key) {
+    return (key * 0x9E3779B1u) >> 28;   // ROUTE_HASH_SIZE == 16
+}
+
+// 连续的子网掩码返回前缀长度，否则返回 -1
+static int route_mask_len(uint32_t mask) {
+    int plen = 0;
+    while (plen < 32 && (mask & (0x80000000u >> plen))) {
+        plen++;
+    }
+    return mask == route_mask(plen) ? plen : -1;
+}
+
+/**
+ * @brief 初始化路由表
+ */
+void route_init(void) {
+    memset(route_pool, 0, sizeof(route_pool));
+    memset(route_hash, 0, sizeof(route_hash));
+    memset(route_plen_count, 0, sizeof(route_plen_count));
+    route_free_list = NULL;
+    for (int i = ROUTE_MAX - 1; i >= 0; i--) {
+        route_pool[i].next = route_free_list;
+        route_free_list = &route_pool[i];
+    }
+    route_genid++;
+}
+
+// 调用者已加锁
+static void route_unlink(route_t **pp) {
+    route_t *r = *pp;
+    *pp = r->next;
+    route_plen_count[r->prefix_len]--;
+    r->next = route_free_list;
+    route_free_list = r;
+}
+
+/**
+ * @brief 添加路由
+ * @param gateway 0 表示直连
+ * @return 0 成功，ROUTE_ERR_* 失败
+ */
+int route_add(uint32_t dst, uint8_t prefix_len, uint32_t gateway,
+              net_device_t *dev, uint16_t metric, uint16_t flags) {
+    if (!dev || prefix_len > 32) {
+        return ROUTE_ERR_INVAL;
+    }
+    dst &= route_mask(prefix_len);
+
+    uint32_t lf = route_lock();
+    route_t **pp = &route_hash[prefix_len][route_hashfn(dst)];
+    for (; *pp; pp = &(*pp)->next) {
+        route_t *r = *pp;
+        if (r->dst == dst && r->dev == dev && r->gateway == gateway) {
+            route_unlock(lf);
+            return ROUTE_ERR_EXIST;
+        }
+    }
+
+    route_t *r = route_free_list;
+    if (!r) {
+        route_unlock(lf);
+        return ROUTE_ERR_NOMEM;
+    }
+    route_free_list = r->next;
+
+    memset(r, 0, sizeof(*r));
+    r->dst = dst;
+    r->prefix_len = prefix_len;
+    r->gateway = gateway;
+    r->dev = dev;
+    r->metric = metric;
+    r->flags = flags | RTF_UP;
+    if (gateway) {
+        r->flags |= RTF_GATEWAY;
+    }
+    if (prefix_len == 32) {
+        r->flags |= RTF_HOST;
+    }
+
+    // 挂在链尾：度量值相同时先加的优先
+    *pp = r;
+    route_plen_count[prefix_len]++;
+    route_genid++;
+    route_unlock(lf);
+    return 0;
+}
+
+/**
+ * @brief 删除路由（gateway 为 0、dev 为 NULL 时不作为匹配条件）
+ */
+int route_del(uint32_t dst, uint8_t prefix_len, uint32_t gateway, net_device_t *dev) {
+    if (prefix_len > 32) {
+        return ROUTE_ERR_INVAL;
+    }
+    dst &= route_mask(prefix_len);
+
+    uint32_t lf = route_lock();
+    for (route_t **pp = &route_hash[prefix_len][route_hashfn(dst)]; *pp; pp = &(*pp)->next) {
+        route_t *r = *pp;
+        if (r->dst == dst && (!gateway || r->gateway == gateway) &&
+            (!dev || r->dev == dev)) {
+            route_unlink(pp);
+            route_genid++;
+            route_unlock(lf);
+            return 0;
+        }
+    }
+    route_unlock(lf);
+    return ROUTE_ERR_NOENT;
+}
+
+/**
+ * @brief 删除设备上的路由（flags 为 0 时删除全部）
+ */
+void route_flush_dev(net_device_t *dev, uint16_t flags) {
+    uint32_t lf = route_lock();
+    for (int plen = 0; plen <= 32; plen++) {
+        if (!route_plen_count[plen]) {
+            continue;
+        }
+        for (int h = 0; h < ROUTE_HASH_SIZE; h++) {
+            route_t **pp = &route_hash[plen][h];
+            while (*pp) {
+                route_t *r = *pp;
+                if (r->dev == dev && (!flags || (r->flags & flags))) {
+                    route_unlink(pp);
+                } else {
+                    pp = &r->next;
+                }
+            }
+        }
+    }
+    route_genid++;
+    route_unlock(lf);
+}
+
+/**
+ * @brief 最长前缀匹配
+ * @param oif 非 NULL 时只考虑经过该设备的路由
+ * @return 0 找到（结果写入 res，并带上当前代数），ROUTE_ERR_NETUNREACH 没有路由
+ */
+int route_lookup(uint32_t dst, net_device_t *oif, dst_cache_t *res) {
+    uint32_t lf = route_lock();
+
+    for (int plen = 32; plen >= 0; plen--) {
+        if (!route_plen_count[plen]) {
+            continue;
+        }
+        uint32_t key = dst & route_mask(plen);
+        route_t *best = NULL;
+        for (route_t *r = route_hash[plen][route_hashfn(key)]; r; r = r->next) {
+            if (r->dst != key || r->prefix_len != plen || (oif && r->dev != oif)) {
+                continue;
+            }
+            if (!best || r->metric < best->metric) {
+                best = r;
+            }
+        }
+        if (best) {
+            best->use++;
+            res->genid = route_genid;
+            res->dst = dst;
+            res->dev = best->dev;
+            res->next_hop = (best->flags & RTF_GATEWAY) ? best->gateway : dst;
+            route_unlock(lf);
+            return 0;
+        }
+    }
+
+    route_unlock(lf);
+    res->dev = NULL;
+    return ROUTE_ERR_NETUNREACH;
+}
+
+/**
+ * @brief 配置接口地址，重建它的直连路由；网关在该网段内时同时加一条默认路由
+ */
+int net_device_set_addr(net_device_t *dev, uint32_t ip, uint32_t netmask, uint32_t gateway) {
+    int plen = route_mask_len(netmask);
+    if (!dev || plen < 0) {
+        return ROUTE_ERR_INVAL;
+    }
+    if (gateway && (gateway & netmask) != (ip & netmask)) {
+        return ROUTE_ERR_INVAL;
+    }
+
+    route_flush_dev(dev, RTF_KERNEL);
+
+    dev->ip_addr = ip;
+    dev->netmask = netmask;
+    dev->gateway = gateway;
+    if (!ip) {
+        return 0;
+    }
+
+    int ret = route_add(ip, (uint8_t)plen, 0, dev, 0, RTF_KERNEL);
+    if (ret == 0 && gateway) {
+        ret = route_add(0, 0, gateway, dev, 100, RTF_KERNEL);
+    }
+    return ret;
+}
+
+static void route_print_ip(uint32_t ip) {
+    printf("%d.%d.%d.%d", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF,
+           (ip >> 8) & 0xFF, ip & 0xFF);
+}
+
+/**
+ * @brief 打印路由表（类似 route -n），按前缀从长到短
+ */
+void route_dump(void) {
+    int count = 0;
+
+    printf("\n=== Routing Table ===\n");
+    printf("%-18s %-16s %-6s %-6s %-8s %s\n",
+           "Destination", "Gateway", "Flags", "Metric", "Iface", "Use");
+
+    uint32_t lf = route_lock();
+    for (int plen = 32; plen >= 0; plen--) {
+        if (!route_plen_count[plen]) {
+            continue;
+        }
+        for (int h = 0; h < ROUTE_HASH_SIZE; h++) {
+            for (route_t *r = route_hash[plen][h]; r; r = r->next) {
+                route_print_ip(r->dst);
+                printf("/%-3d  ", r->prefix_len);
+                if (r->flags & RTF_GATEWAY) {
+                    route_print_ip(r->gateway);
+                } else {
+                    printf("0.0.0.0");
+                }
+                printf("  %c%c%c%c   %-6d %-8s %u\n",
+                       (r->flags & RTF_UP) ? 'U' : '-',
+                       (r->flags & RTF_GATEWAY) ? 'G' : '-',
+                       (r->flags & RTF_HOST) ? 'H' : '-',
+                       (r->flags & RTF_KERNEL) ? 'K' : '-',
+                       r->metric, r->dev->name, r->use);
+                count++;
+            }
+        }
+    }
+    route_unlock(lf);
+
+    if (count == 0) {
+        printf("(No routes)\n");
+    }
+    printf("Total: %d routes\n\n", count);
+}
+
+/**
+ * @brief SYS_ROUTE：添加 / 删除 / 显示路由
+ */
+int sys_route(int cmd, route_entry_t *entry) {
+    if (cmd == ROUTE_CMD_SHOW) {
+        route_dump();
+        return 0;
+    }
+    if (!entry || entry->prefix_len > 32) {
+        return ROUTE_ERR_INVAL;
+    }
+
+    net_device_t *dev = NULL;
+    char ifname[sizeof(entry->ifname)];
+    memcpy(ifname, entry->ifname, sizeof(ifname));
+    ifname[sizeof(ifname) - 1] = '\0';
+    if (ifname[0] != '\0') {
+        dev = net_device_get(ifname);
+        if (!dev) {
+            return ROUTE_ERR_NODEV;
+        }
+    }
+
+    switch (cmd) {
+    case ROUTE_CMD_ADD:
+        if (!dev) {
+            // 没指定设备：网关必须直连可达，出口就是到网关的那块网卡
+            dst_cache_t rt;
+            if (!entry->gateway || route_lookup(entry->gateway, NULL, &rt) < 0) {
+                return ROUTE_ERR_NETUNREACH;
+            }
+            dev = rt.dev;
+        }
+        return route_add(entry->dst, (uint8_t)entry->prefix_len, entry->gateway,
+                         dev, (uint16_t)entry->metric, 0);
+    case ROUTE_CMD_DEL:
+        return route_del(entry->dst, (uint8_t)entry->prefix_len, entry->gateway, dev);
+    default:
+        return ROUTE_ERR_INVAL;
+    }
+}
+
+/**
+ * @brief SYS_IFCONFIG_SET：配置接口地址
+ */
+int sys_ifconfig_set(const char *ifname, uint32_t ip, uint32_t netmask, uint32_t gateway) {
+    char name[16];
+    if (!ifname) {
+        return ROUTE_ERR_INVAL;
+    }
+    strncpy(name, ifname, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+
+    net_device_t *dev = net_device_get(name);
+    if (!dev) {
+        return ROUTE_ERR_NODEV;
+    }
+    int ret = net_device_set_addr(dev, ip, netmask, gateway);
+    if (ret == 0) {
+        printf("[route] %s: ", dev->name);
+        route_print_ip(ip);
+        printf("/%d", route_mask_len(netmask));
+        if (gateway) {
+            printf(" gw ");
+            route_print_ip(gateway);
+        }
+        printf("\n");
+    }
+    return ret;
+}
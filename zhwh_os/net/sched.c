@@ -0,0 +1,406 @@
+/**
+ * @file sched.c
+ * @brief 发送排队规则：FIFO / PRIO 队列 + 令牌桶整形（见 qdisc.h）
+ *
+ * qdisc 来自固定大小的池，net_device_register 时挂上默认 FIFO。
+ * 入队、出队和配置都在关中断下进行；交给驱动（net_dev_xmit）时开中断，
+ * running 保证同一时刻只有一个上下文在出队，期间别的上下文入队或
+ * 驱动回收描述符只置 rerun，由正在出队的那个再跑一轮。
+ */
+
+#include "net.h"
+#include "qdisc.h"
+#include "softirq.h"
+#include "time.h"
+#include "printf.h"
+#include "string.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+#define QDISC_RATE_MAX      0x3FFFFFFF  // 字节/秒和桶深上限，令牌计算不会溢出 int32
+#define QDISC_WATCHDOG_MAX  1000        // 令牌不够时最多等这么久（ms）
+#define QDISC_BUSY_RETRY    10          // 驱动忙时兜底重试间隔（ms），回收不产生中断的驱动靠它
+
+extern net_stats_t net_stats;
+
+static qdisc_t qdisc_pool[QDISC_MAX];
+static int qdisc_count = 0;
+static qdisc_t *sched_head = NULL;      // 等 NET_TX_SOFTIRQ 出队的 qdisc
+
+static inline uint32_t qdisc_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void qdisc_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static void net_tx_softirq(void);
+static void qdisc_watchdog(ktimer_t *t);
+
+void qdisc_init(void) {
+    memset(qdisc_pool, 0, sizeof(qdisc_pool));
+    qdisc_count = 0;
+    sched_head = NULL;
+    open_softirq(NET_TX_SOFTIRQ, net_tx_softirq);
+}
+
+/**
+ * @brief 给设备挂默认 FIFO
+ */
+int qdisc_attach(net_device_t *dev) {
+    uint32_t flags = qdisc_lock();
+    if (qdisc_count >= QDISC_MAX) {
+        qdisc_unlock(flags);
+        return -1;
+    }
+    qdisc_t *q = &qdisc_pool[qdisc_count++];
+    qdisc_unlock(flags);
+
+    memset(q, 0, sizeof(*q));
+    q->dev = dev;
+    q->kind = QDISC_FIFO;
+    q->nbands = 1;
+    q->limit = QDISC_DEFAULT_LIMIT;
+    timer_setup(&q->watchdog, qdisc_watchdog, q);
+    dev->qdisc = q;
+    return 0;
+}
+
+// ==================== 分类 ====================
+
+// 按 TOS 选 PRIO 队列（与 Linux 默认 priomap 的思路一致）
+static int qdisc_tos_band(uint8_t tos) {
+    if ((tos & IPTOS_LOWDELAY) || IPTOS_PREC(tos) >= 5) {
+        return QDISC_BAND_CONTROL;
+    }
+    if ((tos & IPTOS_THROUGHPUT) || IPTOS_PREC(tos) == 1) {
+        return QDISC_BAND_BULK;
+    }
+    return QDISC_BAND_DEFAULT;
+}
+
+// nb->data 指向以太网头
+static int qdisc_classify(const qdisc_t *q, const netbuf_t *nb) {
+    if (q->kind != QDISC_PRIO) {
+        return 0;
+    }
+    const eth_hdr_t *eth = (const eth_hdr_t *)nb->data;
+    if (nb->len < ETH_HDR_LEN + IP_HDR_LEN || eth->eth_type != htons(ETH_P_IP)) {
+        return QDISC_BAND_CONTROL;      // ARP 等控制流量
+    }
+    const ip_hdr_t *ip = (const ip_hdr_t *)(nb->data + ETH_HDR_LEN);
+    return qdisc_tos_band(ip->ip_tos);
+}
+
+// ==================== 令牌桶 ====================
+
+// 调用者已加锁
+static void qdisc_refill(qdisc_t *q, uint32_t now) {
+    uint32_t elapsed = now - q->t_last;
+    if (elapsed == 0) {
+        return;
+    }
+    q->t_last = now;
+    if (elapsed > 1000) {
+        elapsed = 1000;                 // 一秒的令牌已经超过任何合理的桶深
+    }
+
+    q->t_frac += elapsed * (q->rate % 1000);
+    uint32_t add = elapsed * (q->rate / 1000) + q->t_frac / 1000;
+    q->t_frac %= 1000;
+
+    int32_t tokens = q->tokens + (int32_t)add;
+    q->tokens = tokens > (int32_t)q->burst ? (int32_t)q->burst : tokens;
+}
+
+// 令牌补回正数还要多久（调用者已加锁，tokens <= 0）
+static uint32_t qdisc_delay_ms(const qdisc_t *q) {
+    uint32_t need = (uint32_t)(1 - q->tokens);
+    uint32_t ms = (need / q->rate) * 1000 + ((need % q->rate) * 1000 + q->rate - 1) / q->rate;
+    if (ms == 0) {
+        ms = 1;
+    }
+    return ms > QDISC_WATCHDOG_MAX ? QDISC_WATCHDOG_MAX : ms;
+}
+
+// ==================== 入队 / 出队 ====================
+
+// 调用者已加锁
+static qdisc_band_t *qdisc_peek_band(qdisc_t *q) {
+    for (int i = 0; i < q->nbands; i++) {
+        if (q->bands[i].head) {
+            return &q->bands[i];
+        }
+    }
+    return NULL;
+}
+
+static void qdisc_band_push_head(qdisc_band_t *b, netbuf_t *nb) {
+    nb->next = b->head;
+    b->head = nb;
+    if (!b->tail) {
+        b->tail = nb;
+    }
+    b->qlen++;
+    b->backlog += netbuf_total_len(nb);
+}
+
+/**
+ * @brief 入队并尝试出队（接管 nb）
+ */
+int qdisc_enqueue(net_device_t *dev, netbuf_t *nb) {
+    qdisc_t *q = dev->qdisc;
+    if (!q) {
+        // 没注册的设备没有 qdisc，直接交给驱动
+        if (net_dev_xmit(dev, nb) == NET_XMIT_BUSY) {
+            net_stats.tx_dropped++;
+            netbuf_free(nb);
+            return -1;
+        }
+        return 0;
+    }
+
+    uint32_t len = netbuf_total_len(nb);
+    uint32_t flags = qdisc_lock();
+    qdisc_band_t *b = &q->bands[qdisc_classify(q, nb)];
+    if (b->qlen >= q->limit) {
+        b->drops++;
+        net_stats.tx_dropped++;
+        qdisc_unlock(flags);
+        netbuf_free(nb);
+        return -1;
+    }
+    nb->next = NULL;
+    if (b->tail) {
+        b->tail->next = nb;
+    } else {
+        b->head = nb;
+    }
+    b->tail = nb;
+    b->qlen++;
+    b->backlog += len;
+    qdisc_unlock(flags);
+
+    qdisc_run(q);
+    return 0;
+}
+
+/**
+ * @brief 在驱动和令牌允许的范围内出队
+ */
+void qdisc_run(qdisc_t *q) {
+    uint32_t flags = qdisc_lock();
+    if (q->running) {
+        q->rerun = 1;
+        qdisc_unlock(flags);
+        return;
+    }
+    q->running = 1;
+
+    do {
+        q->rerun = 0;
+        qdisc_band_t *b;
+        while ((b = qdisc_peek_band(q)) != NULL) {
+            if (q->rate) {
+                qdisc_refill(q, clock_ms());
+                if (q->tokens <= 0) {
+                    q->overlimits++;
+                    timer_mod(&q->watchdog, clock_ms() + qdisc_delay_ms(q));
+                    break;
+                }
+            }
+
+            netbuf_t *nb = b->head;
+            uint32_t len = netbuf_total_len(nb);
+            b->head = nb->next;
+            if (!b->head) {
+                b->tail = NULL;
+            }
+            b->qlen--;
+            b->backlog -= len;
+            nb->next = NULL;
+            qdisc_unlock(flags);
+
+            int ret = net_dev_xmit(q->dev, nb);
+
+            flags = qdisc_lock();
+            if (ret == NET_XMIT_BUSY) {
+                // 驱动环满：放回队头，等 net_tx_wake；定时器兜底
+                qdisc_band_push_head(b, nb);
+                b->requeues++;
+                timer_mod(&q->watchdog, clock_ms() + QDISC_BUSY_RETRY);
+                break;
+            }
+            b->packets++;
+            b->bytes += len;
+            if (q->rate) {
+                q->tokens -= (int32_t)len;
+            }
+        }
+    } while (q->rerun);
+
+    q->running = 0;
+    qdisc_unlock(flags);
+}
+
+static void qdisc_watchdog(ktimer_t *t) {
+    qdisc_run((qdisc_t *)t->data);
+}
+
+/**
+ * @brief 驱动回收了发送描述符：还有积压就在 NET_TX_SOFTIRQ 里继续出队（任意上下文）
+ */
+void net_tx_wake(net_device_t *dev) {
+    qdisc_t *q = dev->qdisc;
+    if (!q) {
+        return;
+    }
+
+    uint32_t flags = qdisc_lock();
+    if (!q->scheduled && qdisc_peek_band(q)) {
+        q->scheduled = 1;
+        q->next_sched = sched_head;
+        sched_head = q;
+        qdisc_unlock(flags);
+        raise_softirq(NET_TX_SOFTIRQ);
+        return;
+    }
+    qdisc_unlock(flags);
+}
+
+static void net_tx_softirq(void) {
+    uint32_t flags = qdisc_lock();
+    qdisc_t *q = sched_head;
+    sched_head = NULL;
+    qdisc_unlock(flags);
+
+    while (q) {
+        qdisc_t *next = q->next_sched;
+        q->scheduled = 0;
+        qdisc_run(q);
+        q = next;
+    }
+}
+
+/**
+ * @brief 这类 TOS 的包现在能否入队（UDP 发送前检查）
+ */
+int qdisc_writable(net_device_t *dev, uint8_t tos) {
+    qdisc_t *q = dev->qdisc;
+    if (!q) {
+        return 1;
+    }
+    int band = q->kind == QDISC_PRIO ? qdisc_tos_band(tos) : 0;
+    return q->bands[band].qlen < q->limit;
+}
+
+// ==================== 配置 ====================
+
+// PRIO 改成 FIFO：按优先级把三个队列接成一个（调用者已加锁）
+static void qdisc_merge_bands(qdisc_t *q) {
+    qdisc_band_t *dst = &q->bands[0];
+    for (int i = 1; i < QDISC_BANDS; i++) {
+        qdisc_band_t *b = &q->bands[i];
+        if (!b->head) {
+            continue;
+        }
+        if (dst->tail) {
+            dst->tail->next = b->head;
+        } else {
+            dst->head = b->head;
+        }
+        dst->tail = b->tail;
+        dst->qlen += b->qlen;
+        dst->backlog += b->backlog;
+        b->head = b->tail = NULL;
+        b->qlen = 0;
+        b->backlog = 0;
+    }
+}
+
+static int qdisc_change(qdisc_t *q, const qdisc_conf_t *conf) {
+    if (conf->kind != QDISC_FIFO && conf->kind != QDISC_PRIO) {
+        return -22;
+    }
+    uint32_t limit = conf->limit ? conf->limit : QDISC_DEFAULT_LIMIT;
+    if (limit > QDISC_MAX_LIMIT || conf->rate > QDISC_RATE_MAX) {
+        return -22;
+    }
+    uint32_t burst = conf->burst ? conf->burst : conf->rate / 10;
+    // 至少能放下一个最大帧（按设备能支持的最大 MTU 算，之后调大 MTU 不用重配）
+    if (burst < ETH_HDR_LEN + q->dev->max_mtu) {
+        burst = ETH_HDR_LEN + q->dev->max_mtu;
+    }
+    if (burst > QDISC_RATE_MAX) {
+        burst = QDISC_RATE_MAX;
+    }
+
+    uint32_t flags = qdisc_lock();
+    if (conf->kind == QDISC_FIFO && q->kind == QDISC_PRIO) {
+        qdisc_merge_bands(q);
+    }
+    q->kind = (uint8_t)conf->kind;
+    q->nbands = conf->kind == QDISC_PRIO ? QDISC_BANDS : 1;
+    q->limit = limit;
+    q->rate = conf->rate;
+    q->burst = burst;
+    q->tokens = (int32_t)burst;
+    q->t_last = clock_ms();
+    q->t_frac = 0;
+    qdisc_unlock(flags);
+
+    if (!q->rate) {
+        timer_del(&q->watchdog);
+    }
+    // 积压的包按新规则出队
+    qdisc_run(q);
+    return 0;
+}
+
+static void qdisc_dump(void) {
+    for (int i = 0; i < qdisc_count; i++) {
+        qdisc_t *q = &qdisc_pool[i];
+        printf("%-8s %s limit %u", q->dev->name,
+               q->kind == QDISC_PRIO ? "prio" : "fifo", q->limit);
+        if (q->rate) {
+            printf(" rate %uB/s burst %u tokens %d overlimits %u",
+                   q->rate, q->burst, q->tokens, q->overlimits);
+        }
+        printf("\n  band qlen backlog   packets     bytes       drops    requeues\n");
+        for (int j = 0; j < q->nbands; j++) {
+            qdisc_band_t *b = &q->bands[j];
+            printf("  %-4d %-4u %-9u %-11u %-11u %-8u %u\n", j, b->qlen, b->backlog,
+                   b->packets, b->bytes, b->drops, b->requeues);
+        }
+    }
+}
+
+/**
+ * @brief SYS_NET_QDISC：设置 / 显示设备的排队规则
+ */
+int sys_net_qdisc(int cmd, const qdisc_conf_t *uconf) {
+    if (cmd == QDISC_CMD_SHOW) {
+        qdisc_dump();
+        return 0;
+    }
+    if (cmd != QDISC_CMD_SET || !uconf) {
+        return -22;
+    }
+
+    qdisc_conf_t conf;
+    memcpy(&conf, uconf, sizeof(conf));
+    conf.ifname[sizeof(conf.ifname) - 1] = '\0';
+    net_device_t *dev = net_device_get(conf.ifname);
+    if (!dev) {
+        return -19;
+    }
+    if (!dev->qdisc) {
+        return -22;
+    }
+    return qdisc_change(dev->qdisc, &conf);
+}
@@ -0,0 +1,720 @@
+/**
+ * @file socket.c
+ * @brief 套接字层：fd → UDP 接收队列 / TCP 连接，阻塞等待
+ *
+ * 套接字从静态池分配，file_t 嵌在 socket_t 里，close 时整体回收，
+ * 不占用 kmalloc 早期池。
+ *
+ * 阻塞等待用 clock_wait_event()：关中断检查条件，不满足就 "sti; hlt"，
+ * 网卡中断（net_rx_action）和内核定时器（TCP 重传等）处理完后
+ * 回到这里重新检查，所以协议层不需要显式唤醒。
+ */
+
+#include "socket.h"
+#include "qdisc.h"
+#include "ipfrag.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+
+#define SOCK_WAIT_SLICE_MS  1000        // 每轮最多睡这么久，醒来重新检查
+
+static socket_t sock_pool[SOCK_MAX];
+static socket_t *udp_hash[SOCK_UDP_HASH_SIZE];
+static uint16_t udp_next_port = SOCK_UDP_EPHEMERAL;
+static uint32_t udp_rq_bufs = 0;        // 所有 UDP 接收队列占用的 netbuf
+
+static int sock_file_close(file_t *file);
+static int sock_file_read(file_t *file, char *buf, uint32_t size);
+static int sock_file_write(file_t *file, const char *buf, uint32_t size);
+
+static file_operations_t sock_fops = {
+    .close = sock_file_close,
+    .read  = sock_file_read,
+    .write = sock_file_write,
+};
+
+static inline uint32_t sock_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void sock_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static inline uint32_t udp_hashfn(uint16_t port) {
+    return port & (SOCK_UDP_HASH_SIZE - 1);
+}
+
+// 数据报占用的 netbuf 个数（接收队列按这个记账）
+static inline uint32_t udp_truesize(const netbuf_t *nb) {
+    uint32_t n = 0;
+    for (; nb; nb = nb->frag) {
+        n++;
+    }
+    return n;
+}
+
+// ==================== 分配 / 回收 ====================
+
+static socket_t *sock_alloc(int type) {
+    uint32_t flags = sock_lock();
+    socket_t *s = NULL;
+
+    for (int i = 0; i < SOCK_MAX; i++) {
+        if (!sock_pool[i].in_use) {
+            s = &sock_pool[i];
+            memset(s, 0, sizeof(*s));
+            s->in_use = 1;
+            s->type = (uint8_t)type;
+            break;
+        }
+    }
+    sock_unlock(flags);
+
+    if (s) {
+        s->file.f_op = &sock_fops;
+        s->file.f_flags = O_RDWR;
+        s->file.f_count = 1;
+        s->file.f_private = s;
+    }
+    return s;
+}
+
+// 调用者已加锁
+static void udp_unhash(socket_t *s) {
+    socket_t **pp = &udp_hash[udp_hashfn(s->local_port)];
+
+    while (*pp && *pp != s) {
+        pp = &(*pp)->hnext;
+    }
+    if (*pp) {
+        *pp = s->hnext;
+    }
+    s->hnext = NULL;
+}
+
+static void sock_release(socket_t *s) {
+    netbuf_t *queue = NULL;
+
+    if (s->type == SOCK_STREAM) {
+        if (s->tp) {
+            tcp_close(s->tp);   // 连接在后台正常关闭，结束后 TCB 自动回收
+        }
+    }
+
+    uint32_t flags = sock_lock();
+    if (s->type == SOCK_DGRAM && s->local_port) {
+        udp_unhash(s);
+    }
+    queue = s->rq_head;
+    s->rq_head = s->rq_tail = NULL;
+    s->rq_len = 0;
+    udp_rq_bufs -= s->rq_bufs;
+    s->rq_bufs = 0;
+    s->tp = NULL;
+    s->in_use = 0;
+    sock_unlock(flags);
+
+    while (queue) {
+        netbuf_t *next = queue->next;
+        netbuf_free(queue);
+        queue = next;
+    }
+}
+
+// 包一层 fd；文件表满时回收套接字
+static int sock_install(socket_t *s) {
+    int fd = fd_install(&s->file);
+
+    if (fd < 0) {
+        sock_release(s);
+        return SOCK_ERR_MFILE;
+    }
+    return fd;
+}
+
+static int sock_from_fd(int fd, socket_t **sp) {
+    file_t *file = fd_get(fd);
+
+    if (!file) {
+        return SOCK_ERR_BADF;
+    }
+    if (file->f_op != &sock_fops) {
+        return SOCK_ERR_NOTSOCK;
+    }
+    *sp = (socket_t *)file->f_private;
+    return 0;
+}
+
+// ==================== 阻塞等待 ====================
+
+// 以下条件在关中断状态下由 clock_wait_event 调用
+static int udp_rx_ready(void *arg) {
+    return ((socket_t *)arg)->rq_head != NULL;
+}
+
+// 出口 qdisc 还能接收这个套接字 TOS 的包
+static int udp_tx_ready(void *arg) {
+    socket_t *s = (socket_t *)arg;
+    return qdisc_writable(s->dst.dev, s->tos);
+}
+
+static int tcp_rx_ready(void *arg) {
+    return tcp_readable(((socket_t *)arg)->tp) != 0;
+}
+
+static int tcp_tx_ready(void *arg) {
+    return tcp_writable(((socket_t *)arg)->tp) != 0;
+}
+
+static int tcp_connect_done(void *arg) {
+    return ((socket_t *)arg)->tp->state != TCP_SYN_SENT;
+}
+
+static inline int sock_would_block(socket_t *s, int flags) {
+    return s->nonblock || (flags & MSG_DONTWAIT);
+}
+
+static void sock_wait(socket_t *s, int (*ready)(void *arg)) {
+    clock_wait_event(clock_ms() + SOCK_WAIT_SLICE_MS, ready, s);
+}
+
+// ==================== UDP ====================
+
+// 调用者已加锁
+static int udp_port_in_use(uint32_t ip, uint16_t port) {
+    for (socket_t *s = udp_hash[udp_hashfn(port)]; s; s = s->hnext) {
+        if (s->local_port == port &&
+            (s->local_ip == ip || s->local_ip == INADDR_ANY || ip == INADDR_ANY)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 调用者已加锁；port 为 0 时自动分配
+static int udp_bind_locked(socket_t *s, uint32_t ip, uint16_t port) {
+    if (port == 0) {
+        for (uint32_t tries = 0; tries < 65536 - SOCK_UDP_EPHEMERAL; tries++) {
+            uint16_t p = udp_next_port;
+            udp_next_port = (p == 65535) ? SOCK_UDP_EPHEMERAL : p + 1;
+            if (!udp_port_in_use(ip, p)) {
+                port = p;
+                break;
+            }
+        }
+        if (port == 0) {
+            return SOCK_ERR_ADDRINUSE;
+        }
+    } else if (udp_port_in_use(ip, port)) {
+        return SOCK_ERR_ADDRINUSE;
+    }
+
+    s->local_ip = ip;
+    s->local_port = port;
+    uint32_t h = udp_hashfn(port);
+    s->hnext = udp_hash[h];
+    udp_hash[h] = s;
+    return 0;
+}
+
+/**
+ * @brief 把数据报放进匹配的 UDP 套接字的接收队列
+ *
+ * 匹配优先级：已 connect 且对端一致 > 绑定了具体地址 > INADDR_ANY。
+ * 已 connect 的套接字不接收其他对端的数据报。
+ * nb->data 指向 UDP 负载；队列持有一个新引用。
+ * 超过 SOCK_UDP_RCVQ_MAX 个数据报、套接字配额已用满或全局配额放不下时丢弃；
+ * 套接字配额和 Linux 的 rcvbuf 一样只看已占用的，没用满就能再放一个，
+ * 接近 64KB 的重组数据报（frag 链比配额长）也能收。
+ */
+int sock_udp_deliver(netbuf_t *nb, uint32_t src_ip, uint16_t sport,
+                     uint32_t dst_ip, uint16_t dport) {
+    uint32_t flags = sock_lock();
+    socket_t *best = NULL;
+    int best_score = -1;
+
+    for (socket_t *s = udp_hash[udp_hashfn(dport)]; s; s = s->hnext) {
+        if (s->local_port != dport) {
+            continue;
+        }
+        if (s->local_ip != INADDR_ANY && s->local_ip != dst_ip) {
+            continue;
+        }
+        if (s->connected && (s->remote_ip != src_ip || s->remote_port != sport)) {
+            continue;
+        }
+        int score = (s->connected ? 2 : 0) + (s->local_ip != INADDR_ANY ? 1 : 0);
+        if (score > best_score) {
+            best = s;
+            best_score = score;
+        }
+    }
+
+    if (!best) {
+        sock_unlock(flags);
+        return -1;
+    }
+
+    uint32_t size = udp_truesize(nb);
+    if (best->rq_len >= SOCK_UDP_RCVQ_MAX || best->rq_bufs >= SOCK_UDP_RCVBUF ||
+        udp_rq_bufs + size > SOCK_UDP_RCVBUF_ALL) {
+        best->rq_drops++;
+    } else {
+        nb = netbuf_get(nb);
+        nb->next = NULL;
+        if (best->rq_tail) {
+            best->rq_tail->next = nb;
+        } else {
+            best->rq_head = nb;
+        }
+        best->rq_tail = nb;
+        best->rq_len++;
+        best->rq_bufs += size;
+        udp_rq_bufs += size;
+    }
+    sock_unlock(flags);
+    return 0;
+}
+
+static int udp_sendmsg(socket_t *s, const void *buf, uint32_t len, int flags,
+                       const struct sockaddr_in *addr) {
+    uint32_t dst_ip;
+    uint16_t dport;
+
+    if (addr) {
+        if (addr->sin_family != AF_INET) {
+            return SOCK_ERR_AFNOSUPPORT;
+        }
+        dst_ip = ntohl(addr->sin_addr);
+        dport = ntohs(addr->sin_port);
+    } else if (s->connected) {
+        dst_ip = s->remote_ip;
+        dport = s->remote_port;
+    } else {
+        return SOCK_ERR_DESTADDRREQ;
+    }
+    if (dst_ip == 0 || dport == 0) {
+        return SOCK_ERR_INVAL;
+    }
+
+    // 请求/响应式的用法目的地址基本不变，路由查一次后缓存在套接字里
+    if (route_output(&s->dst, dst_ip, NULL) < 0) {
+        return SOCK_ERR_NETUNREACH;
+    }
+    net_device_t *dev = s->dst.dev;
+    // 超过 MTU 的数据报由 IP 层分片
+    if (len > IP_MAX_LEN - IP_HDR_LEN - sizeof(udp_hdr_t)) {
+        return SOCK_ERR_MSGSIZE;
+    }
+
+    if (!s->local_port) {
+        uint32_t eflags = sock_lock();
+        int ret = s->local_port ? 0 : udp_bind_locked(s, INADDR_ANY, 0);
+        sock_unlock(eflags);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    // 出口队列满：阻塞到 qdisc 出队腾出位置，非阻塞返回 AGAIN（而不是让包在队尾被丢掉）
+    while (!qdisc_writable(dev, s->tos)) {
+        if (sock_would_block(s, flags)) {
+            return SOCK_ERR_AGAIN;
+        }
+        sock_wait(s, udp_tx_ready);
+    }
+
+    netbuf_t *nb = netbuf_from_chain(buf, len, NETBUF_HEADROOM);
+    if (!nb) {
+        return SOCK_ERR_NOMEM;
+    }
+    nb->tos = s->tos;
+    if (udp_output_dst(&s->dst, dst_ip, s->local_port, dport, nb) < 0) {
+        return SOCK_ERR_NETUNREACH;
+    }
+    return (int)len;
+}
+
+static int udp_recvmsg(socket_t *s, void *buf, uint32_t len, int flags,
+                       struct sockaddr_in *addr) {
+    for (;;) {
+        uint32_t lf = sock_lock();
+        netbuf_t *nb = s->rq_head;
+        if (nb) {
+            s->rq_head = nb->next;
+            if (!s->rq_head) {
+                s->rq_tail = NULL;
+            }
+            s->rq_len--;
+            uint32_t size = udp_truesize(nb);
+            s->rq_bufs -= size;
+            udp_rq_bufs -= size;
+            nb->next = NULL;
+        }
+        sock_unlock(lf);
+
+        if (nb) {
+            // 缓冲区不够时截断，多余部分丢弃（数据报语义）；重组出来的数据报带 frag 链
+            uint32_t n = 0;
+            for (netbuf_t *seg = nb; seg && n < len; seg = seg->frag) {
+                uint32_t m = len - n < seg->len ? len - n : seg->len;
+                memcpy((uint8_t *)buf + n, seg->data, m);
+                n += m;
+            }
+            if (addr) {
+                const ip_hdr_t *ip = (const ip_hdr_t *)nb->net_hdr;
+                const udp_hdr_t *udp = (const udp_hdr_t *)nb->trans_hdr;
+                memset(addr, 0, sizeof(*addr));
+                addr->sin_family = AF_INET;
+                addr->sin_addr = ip->ip_src;
+                addr->sin_port = udp->udp_sport;
+            }
+            netbuf_free(nb);
+            return (int)n;
+        }
+
+        if (sock_would_block(s, flags)) {
+            return SOCK_ERR_AGAIN;
+        }
+        sock_wait(s, udp_rx_ready);
+    }
+}
+
+// ==================== TCP ====================
+
+static int tcp_sendmsg(socket_t *s, const void *buf, uint32_t len, int flags) {
+    uint32_t sent = 0;
+
+    // 阻塞模式下全部放进发送缓冲区才返回；非阻塞模式能放多少放多少
+    while (sent < len) {
+        int n = tcp_send(s->tp, (const uint8_t *)buf + sent, len - sent);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n != TCP_ERR_AGAIN || sock_would_block(s, flags)) {
+            return sent ? (int)sent : n;
+        }
+        sock_wait(s, tcp_tx_ready);
+    }
+    return (int)sent;
+}
+
+static int tcp_recvmsg(socket_t *s, void *buf, uint32_t len, int flags,
+                       struct sockaddr_in *addr) {
+    for (;;) {
+        int n = tcp_recv(s->tp, buf, len);
+        if (n != TCP_ERR_AGAIN) {
+            if (n >= 0 && addr) {
+                memset(addr, 0, sizeof(*addr));
+                addr->sin_family = AF_INET;
+                addr->sin_addr = htonl(s->tp->remote_ip);
+                addr->sin_port = htons(s->tp->remote_port);
+            }
+            return n;
+        }
+        if (sock_would_block(s, flags)) {
+            return SOCK_ERR_AGAIN;
+        }
+        sock_wait(s, tcp_rx_ready);
+    }
+}
+
+// ==================== 文件操作 ====================
+
+static int sock_file_close(file_t *file) {
+    sock_release((socket_t *)file->f_private);
+    return 0;
+}
+
+static int sock_file_read(file_t *file, char *buf, uint32_t size) {
+    socket_t *s = (socket_t *)file->f_private;
+
+    if (s->type == SOCK_STREAM) {
+        return tcp_recvmsg(s, buf, size, 0, NULL);
+    }
+    return udp_recvmsg(s, buf, size, 0, NULL);
+}
+
+static int sock_file_write(file_t *file, const char *buf, uint32_t size) {
+    socket_t *s = (socket_t *)file->f_private;
+
+    if (s->type == SOCK_STREAM) {
+        return tcp_sendmsg(s, buf, size, 0);
+    }
+    return udp_sendmsg(s, buf, size, 0, NULL);
+}
+
+// ==================== 系统调用 ====================
+
+/**
+ * @brief 创建套接字，返回 fd
+ */
+int sys_socket(int domain, int type, int protocol) {
+    int nonblock = (type & SOCK_NONBLOCK) != 0;
+    type &= ~SOCK_NONBLOCK;
+
+    if (domain != AF_INET) {
+        return SOCK_ERR_AFNOSUPPORT;
+    }
+    if (!(type == SOCK_STREAM && (protocol == 0 || protocol == IPPROTO_TCP)) &&
+        !(type == SOCK_DGRAM && (protocol == 0 || protocol == IPPROTO_UDP))) {
+        return SOCK_ERR_PROTONOSUPPORT;
+    }
+
+    socket_t *s = sock_alloc(type);
+    if (!s) {
+        return SOCK_ERR_NOMEM;
+    }
+    s->nonblock = (uint8_t)nonblock;
+
+    if (type == SOCK_STREAM) {
+        s->tp = tcp_socket();
+        if (!s->tp) {
+            sock_release(s);
+            return SOCK_ERR_NOMEM;
+        }
+        s->tp->owner = s;
+    }
+    return sock_install(s);
+}
+
+/**
+ * @brief 绑定本地地址（端口为 0 时自动分配）
+ */
+int sys_bind(int fd, const struct sockaddr_in *addr) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!addr) {
+        return SOCK_ERR_INVAL;
+    }
+    if (addr->sin_family != AF_INET) {
+        return SOCK_ERR_AFNOSUPPORT;
+    }
+
+    uint32_t ip = ntohl(addr->sin_addr);
+    uint16_t port = ntohs(addr->sin_port);
+
+    if (s->type == SOCK_STREAM) {
+        ret = tcp_bind(s->tp, ip, port);
+        if (ret == 0) {
+            s->local_ip = s->tp->local_ip;
+            s->local_port = s->tp->local_port;
+        }
+        return ret;
+    }
+
+    uint32_t flags = sock_lock();
+    ret = s->local_port ? SOCK_ERR_INVAL : udp_bind_locked(s, ip, port);
+    sock_unlock(flags);
+    return ret;
+}
+
+/**
+ * @brief UDP：设置默认对端（sin_family 为 0 时取消）；TCP：主动打开
+ *
+ * 阻塞的 TCP 套接字等到连接建立或失败才返回；
+ * 非阻塞的发出 SYN 后返回 SOCK_ERR_INPROGRESS，可写时即已建立。
+ */
+int sys_connect(int fd, const struct sockaddr_in *addr) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!addr) {
+        return SOCK_ERR_INVAL;
+    }
+
+    if (s->type == SOCK_DGRAM) {
+        uint32_t flags = sock_lock();
+        if (addr->sin_family == 0) {
+            s->connected = 0;
+        } else if (addr->sin_family != AF_INET) {
+            ret = SOCK_ERR_AFNOSUPPORT;
+        } else if (addr->sin_addr == 0 || addr->sin_port == 0) {
+            ret = SOCK_ERR_INVAL;
+        } else {
+            if (!s->local_port) {
+                ret = udp_bind_locked(s, INADDR_ANY, 0);
+            }
+            if (ret == 0) {
+                s->remote_ip = ntohl(addr->sin_addr);
+                s->remote_port = ntohs(addr->sin_port);
+                s->connected = 1;
+            }
+        }
+        sock_unlock(flags);
+        return ret;
+    }
+
+    if (addr->sin_family != AF_INET) {
+        return SOCK_ERR_AFNOSUPPORT;
+    }
+    if (s->tp->state != TCP_CLOSED) {
+        return s->tp->state == TCP_SYN_SENT ? SOCK_ERR_AGAIN : SOCK_ERR_ISCONN;
+    }
+
+    ret = tcp_connect(s->tp, ntohl(addr->sin_addr), ntohs(addr->sin_port));
+    if (ret < 0) {
+        return ret;
+    }
+    s->local_ip = s->tp->local_ip;
+    s->local_port = s->tp->local_port;
+    s->remote_ip = s->tp->remote_ip;
+    s->remote_port = s->tp->remote_port;
+
+    if (s->nonblock) {
+        return SOCK_ERR_INPROGRESS;
+    }
+    while (!tcp_connect_done(s)) {
+        sock_wait(s, tcp_connect_done);
+    }
+    if (s->tp->error) {
+        return s->tp->error;
+    }
+    return s->tp->state == TCP_CLOSED ? SOCK_ERR_NOTCONN : 0;
+}
+
+/**
+ * @brief TCP 进入监听（需要先 bind）
+ */
+int sys_listen(int fd, int backlog) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (s->type != SOCK_STREAM) {
+        return SOCK_ERR_OPNOTSUPP;
+    }
+    return tcp_listen(s->tp, backlog);
+}
+
+/**
+ * @brief 取出一条已建立的连接，返回新 fd（阻塞模式下等到有连接为止）
+ */
+int sys_accept(int fd, struct sockaddr_in *addr) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (s->type != SOCK_STREAM) {
+        return SOCK_ERR_OPNOTSUPP;
+    }
+
+    tcp_sock_t *child;
+    for (;;) {
+        child = tcp_accept(s->tp, &ret);
+        if (child) {
+            break;
+        }
+        if (ret != TCP_ERR_AGAIN || s->nonblock) {
+            return ret;
+        }
+        sock_wait(s, tcp_rx_ready);
+    }
+
+    socket_t *ns = sock_alloc(SOCK_STREAM);
+    if (!ns) {
+        tcp_abort(child);
+        return SOCK_ERR_NOMEM;
+    }
+    ns->tp = child;
+    child->owner = ns;
+    ns->local_ip = child->local_ip;
+    ns->local_port = child->local_port;
+    ns->remote_ip = child->remote_ip;
+    ns->remote_port = child->remote_port;
+
+    if (addr) {
+        memset(addr, 0, sizeof(*addr));
+        addr->sin_family = AF_INET;
+        addr->sin_addr = htonl(child->remote_ip);
+        addr->sin_port = htons(child->remote_port);
+    }
+    return sock_install(ns);
+}
+
+/**
+ * @brief 发送；addr 为 NULL 时发往 connect 设置的对端（即 send）
+ */
+int sys_sendto(int fd, const void *buf, uint32_t len, int flags,
+               const struct sockaddr_in *addr) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!buf && len) {
+        return SOCK_ERR_INVAL;
+    }
+    if (s->type == SOCK_STREAM) {
+        return tcp_sendmsg(s, buf, len, flags);   // 已连接，忽略 addr
+    }
+    return udp_sendmsg(s, buf, len, flags, addr);
+}
+
+/**
+ * @brief 接收；addr 不为 NULL 时填入来源地址（即 recvfrom）
+ * @return 字节数；TCP 返回 0 表示对端已关闭
+ */
+int sys_recvfrom(int fd, void *buf, uint32_t len, int flags,
+                 struct sockaddr_in *addr) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (!buf && len) {
+        return SOCK_ERR_INVAL;
+    }
+    if (s->type == SOCK_STREAM) {
+        return tcp_recvmsg(s, buf, len, flags, addr);
+    }
+    return udp_recvmsg(s, buf, len, flags, addr);
+}
+
+/**
+ * @brief 设置套接字选项（目前只支持 IPPROTO_IP / IP_TOS）
+ */
+int sys_setsockopt(int fd, int level, int optname, const void *optval, uint32_t optlen) {
+    socket_t *s;
+    int ret = sock_from_fd(fd, &s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (level != IPPROTO_IP || optname != IP_TOS) {
+        return SOCK_ERR_OPNOTSUPP;
+    }
+    if (!optval || optlen < sizeof(int)) {
+        return SOCK_ERR_INVAL;
+    }
+
+    uint8_t tos = (uint8_t)*(const int *)optval;
+    if (s->type == SOCK_STREAM) {
+        s->tp->tos = tos;
+    } else {
+        s->tos = tos;
+    }
+    return 0;
+}
@@ -0,0 +1,1784 @@
+/**
+ * @file tcp.c
+ * @brief TCP 协议实现
+ *
+ * 所有连接状态都由 tcp_lock()（关中断）保护：tcp_input 在接收下半部
+ * 开中断执行，定时器回调也在开中断状态下执行，用户调用来自系统调用，
+ * 三者都可能交错。
+ *
+ * 发送缓冲区保存从 snd_una 开始的全部数据（已发未确认 + 未发送），
+ * 重传直接从缓冲区重新切段；接收缓冲区的可读数据后面紧跟着接收窗口，
+ * 乱序到达的段直接写进窗口内的对应位置，只记录 [start, end) 区间，
+ * 空洞补上后一次性并入可读数据。
+ */
+
+#include "tcp.h"
+#include "qdisc.h"
+#include "checksum.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+#include "../include/kmalloc.h"
+
+#define TCP_DEBUG 0
+#define tcp_dbg(fmt, ...) \
+    do { if (TCP_DEBUG) printf("[tcp] " fmt, ##__VA_ARGS__); } while (0)
+
+// 序号比较（模 2^32）
+#define SEQ_LT(a, b)    ((int32_t)((a) - (b)) < 0)
+#define SEQ_LEQ(a, b)   ((int32_t)((a) - (b)) <= 0)
+#define SEQ_GT(a, b)    ((int32_t)((a) - (b)) > 0)
+#define SEQ_GEQ(a, b)   ((int32_t)((a) - (b)) >= 0)
+
+#define TCP_SNDBUF_MASK (TCP_SNDBUF_SIZE - 1)
+#define TCP_RCVBUF_MASK (TCP_RCVBUF_SIZE - 1)
+
+#define TCP_OPT_MSS     2
+#define TCP_EPHEMERAL_LO 49152
+
+extern net_stats_t net_stats;
+
+static tcp_sock_t tcp_socks[TCP_MAX_SOCKS];
+static tcp_sock_t *tcp_hash[TCP_HASH_SIZE];     // 非 LISTEN 状态的连接
+static tcp_sock_t *tcp_listeners = NULL;        // LISTEN 状态
+static tcp_stats_t tcp_stats;
+static uint16_t tcp_port_rover = TCP_EPHEMERAL_LO;
+
+static void tcp_output(tcp_sock_t *tp);
+static void tcp_rtx_timeout(ktimer_t *t);
+static void tcp_delack_timeout(ktimer_t *t);
+
+static inline uint32_t tcp_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void tcp_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+static inline uint32_t tcp_min(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+static inline uint32_t tcp_max(uint32_t a, uint32_t b) {
+    return a > b ? a : b;
+}
+
+static inline void tcp_notify(tcp_sock_t *tp) {
+    if (tp->notify) {
+        tp->notify(tp);
+    }
+}
+
+/**
+ * @brief 状态名（调试输出用）
+ */
+const char *tcp_state_name(int state) {
+    static const char *names[] = {
+        "CLOSED", "LISTEN", "SYN_SENT", "SYN_RCVD", "ESTABLISHED",
+        "FIN_WAIT1", "FIN_WAIT2", "CLOSE_WAIT", "CLOSING", "LAST_ACK", "TIME_WAIT"
+    };
+    if (state < 0 || state > TCP_TIME_WAIT) {
+        return "?";
+    }
+    return names[state];
+}
+
+// ==================== 连接表 ====================
+
+static inline uint32_t tcp_hashfn(uint32_t lip, uint16_t lport,
+                                  uint32_t rip, uint16_t rport) {
+    uint32_t h = lip ^ rip ^ (((uint32_t)lport << 16) | rport);
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h & (TCP_HASH_SIZE - 1);
+}
+
+static void tcp_hash_insert(tcp_sock_t *tp) {
+    uint32_t h = tcp_hashfn(tp->local_ip, tp->local_port, tp->remote_ip, tp->remote_port);
+    tp->hnext = tcp_hash[h];
+    tcp_hash[h] = tp;
+}
+
+static void tcp_unhash(tcp_sock_t *tp) {
+    tcp_sock_t **pp;
+
+    if (tp->state == TCP_LISTEN) {
+        pp = &tcp_listeners;
+    } else {
+        pp = &tcp_hash[tcp_hashfn(tp->local_ip, tp->local_port,
+                                  tp->remote_ip, tp->remote_port)];
+    }
+    while (*pp && *pp != tp) {
+        pp = &(*pp)->hnext;
+    }
+    if (*pp) {
+        *pp = tp->hnext;
+    }
+    tp->hnext = NULL;
+}
+
+static tcp_sock_t *tcp_lookup(uint32_t lip, uint16_t lport, uint32_t rip, uint16_t rport) {
+    for (tcp_sock_t *tp = tcp_hash[tcp_hashfn(lip, lport, rip, rport)]; tp; tp = tp->hnext) {
+        if (tp->local_port == lport && tp->remote_port == rport &&
+            tp->local_ip == lip && tp->remote_ip == rip) {
+            return tp;
+        }
+    }
+    return NULL;
+}
+
+static tcp_sock_t *tcp_lookup_listener(uint32_t lip, uint16_t lport) {
+    tcp_sock_t *wild = NULL;
+
+    for (tcp_sock_t *tp = tcp_listeners; tp; tp = tp->hnext) {
+        if (tp->local_port != lport) {
+            continue;
+        }
+        if (tp->local_ip == lip) {
+            return tp;
+        }
+        if (tp->local_ip == 0) {
+            wild = tp;
+        }
+    }
+    return wild;
+}
+
+// 端口是否被占用（TIME_WAIT 的连接不算，允许立即重新 bind）
+static int tcp_port_in_use(uint32_t ip, uint16_t port) {
+    for (int i = 0; i < TCP_MAX_SOCKS; i++) {
+        tcp_sock_t *tp = &tcp_socks[i];
+        if (!tp->in_use || tp->local_port != port || tp->state == TCP_TIME_WAIT) {
+            continue;
+        }
+        if (tp->local_ip == ip || tp->local_ip == 0 || ip == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint16_t tcp_ephemeral_port(uint32_t ip) {
+    for (uint32_t n = 0; n < 65536 - TCP_EPHEMERAL_LO; n++) {
+        uint16_t port = tcp_port_rover++;
+        if (tcp_port_rover == 0) {
+            tcp_port_rover = TCP_EPHEMERAL_LO;
+        }
+        if (!tcp_port_in_use(ip, port)) {
+            return port;
+        }
+    }
+    return 0;
+}
+
+// 初始序号：毫秒时钟 × 250（约每 4us 加 1，RFC 793）再混入四元组
+static uint32_t tcp_new_iss(tcp_sock_t *tp) {
+    return clock_ms() * 250 +
+           tcp_hashfn(tp->local_ip, tp->local_port, tp->remote_ip, tp->remote_port) * 0x01000193;
+}
+
+// ==================== TCB 分配 / 回收 ====================
+
+static tcp_sock_t *tcp_alloc(void) {
+    tcp_sock_t *tp = NULL;
+
+    for (int i = 0; i < TCP_MAX_SOCKS; i++) {
+        if (!tcp_socks[i].in_use) {
+            tp = &tcp_socks[i];
+            break;
+        }
+    }
+    if (!tp) {
+        return NULL;
+    }
+
+    // 缓冲区第一次使用时分配，TCB 回收后保留给下一条连接
+    if (!tp->sndbuf) {
+        tp->sndbuf = kmalloc(TCP_SNDBUF_SIZE);
+    }
+    if (!tp->rcvbuf) {
+        tp->rcvbuf = kmalloc(TCP_RCVBUF_SIZE);
+    }
+    if (!tp->sndbuf || !tp->rcvbuf) {
+        return NULL;
+    }
+
+    uint8_t *sndbuf = tp->sndbuf;
+    uint8_t *rcvbuf = tp->rcvbuf;
+    memset(tp, 0, sizeof(*tp));
+    tp->sndbuf = sndbuf;
+    tp->rcvbuf = rcvbuf;
+    tp->in_use = 1;
+    tp->state = TCP_CLOSED;
+    tp->mss = TCP_DEFAULT_MSS;
+    tp->rto = TCP_RTO_INIT;
+    tp->ssthresh = 0xFFFFFFFF;
+    timer_setup(&tp->rtx_timer, tcp_rtx_timeout, tp);
+    timer_setup(&tp->delack_timer, tcp_delack_timeout, tp);
+    return tp;
+}
+
+// 从监听套接字的完成队列里摘掉
+static void tcp_unlink_parent(tcp_sock_t *tp) {
+    tcp_sock_t *parent = tp->parent;
+    if (!parent) {
+        return;
+    }
+
+    tcp_sock_t **pp = &parent->accept_head;
+    while (*pp && *pp != tp) {
+        pp = &(*pp)->accept_next;
+    }
+    if (*pp) {
+        *pp = tp->accept_next;
+    }
+    tp->accept_next = NULL;
+    tp->parent = NULL;
+    if (parent->pending) {
+        parent->pending--;
+    }
+}
+
+static void tcp_free(tcp_sock_t *tp) {
+    timer_del(&tp->rtx_timer);
+    timer_del(&tp->delack_timer);
+    tcp_unlink_parent(tp);
+    tp->in_use = 0;
+}
+
+/**
+ * @brief 连接结束：进入 CLOSED，用户已经 close 过的直接回收
+ */
+static void tcp_done(tcp_sock_t *tp) {
+    timer_del(&tp->rtx_timer);
+    timer_del(&tp->delack_timer);
+    if (tp->state != TCP_CLOSED) {
+        tcp_unhash(tp);
+        tp->state = TCP_CLOSED;
+    }
+    tcp_notify(tp);
+    if (tp->flags & TCP_F_USER_CLOSED) {
+        tcp_free(tp);
+    }
+}
+
+static void tcp_set_state(tcp_sock_t *tp, int state) {
+    tcp_dbg("%d -> %d: %s -> %s\n", tp->local_port, tp->remote_port,
+            tcp_state_name(tp->state), tcp_state_name(state));
+    tp->state = (uint8_t)state;
+}
+
+// ==================== 缓冲区 ====================
+
+// 接收窗口：空闲空间（乱序数据写在窗口内，不额外占用）；
+// 避免糊涂窗口综合症：右沿只有涨了至少 min(缓冲区/2, MSS) 才往前推
+static uint32_t tcp_rcv_window(tcp_sock_t *tp) {
+    uint32_t free = TCP_RCVBUF_SIZE - tp->rcv_len;
+    uint32_t adv = SEQ_GT(tp->rcv_adv, tp->rcv_nxt) ? tp->rcv_adv - tp->rcv_nxt : 0;
+
+    if (free > adv && free - adv < tcp_min(TCP_RCVBUF_SIZE / 2, tp->mss)) {
+        return adv;
+    }
+    return tcp_min(free, 0xFFFF);
+}
+
+// 从发送缓冲区偏移 off 处拷 len 字节（处理回绕）
+static void tcp_sndbuf_read(tcp_sock_t *tp, uint32_t off, uint8_t *dst, uint32_t len) {
+    uint32_t pos = (tp->snd_head + off) & TCP_SNDBUF_MASK;
+    uint32_t first = tcp_min(len, TCP_SNDBUF_SIZE - pos);
+
+    memcpy(dst, tp->sndbuf + pos, first);
+    if (len > first) {
+        memcpy(dst + first, tp->sndbuf, len - first);
+    }
+}
+
+// 写进接收缓冲区：off 是相对 rcv_nxt 的偏移
+static void tcp_rcvbuf_copy(tcp_sock_t *tp, uint32_t off, const uint8_t *src, uint32_t len) {
+    uint32_t pos = (tp->rcv_head + tp->rcv_len + off) & TCP_RCVBUF_MASK;
+    uint32_t first = tcp_min(len, TCP_RCVBUF_SIZE - pos);
+
+    memcpy(tp->rcvbuf + pos, src, first);
+    if (len > first) {
+        memcpy(tp->rcvbuf, src + first, len - first);
+    }
+}
+
+// 同上，数据取自 nb 分片链上 src_off 处（巨型帧、重组出来的段不是线性的）
+static void tcp_rcvbuf_write(tcp_sock_t *tp, uint32_t off, const netbuf_t *nb,
+                             uint32_t src_off, uint32_t len) {
+    for (; nb && len > 0; nb = nb->frag) {
+        if (src_off >= nb->len) {
+            src_off -= nb->len;
+            continue;
+        }
+        uint32_t n = tcp_min(len, nb->len - src_off);
+        tcp_rcvbuf_copy(tp, off, nb->data + src_off, n);
+        off += n;
+        len -= n;
+        src_off = 0;
+    }
+}
+
+// ==================== 发送 ====================
+
+/**
+ * @brief 组 TCP 头并交给 IP 层（接管 nb，nb->data 指向负载）
+ *
+ * SYN 段带 MSS 选项。网卡支持校验和卸载时只填伪头部和，
+ * nb->gso_size 非 0 时交给网卡按 MSS 切分。
+ */
+static int tcp_emit(dst_cache_t *rt, net_device_t *oif, uint32_t dst_ip,
+                    uint16_t sport, uint16_t dport,
+                    uint32_t seq, uint32_t ack, uint8_t flags, uint16_t win,
+                    uint16_t mss_opt, netbuf_t *nb) {
+    uint32_t hdr_len = TCP_HDR_LEN + (mss_opt ? 4 : 0);
+
+    // 路由缓存失效时只在 oif 上重新查，连接不会换到另一块网卡（源地址会变）
+    if (route_output(rt, dst_ip, oif) < 0) {
+        netbuf_free(nb);
+        return TCP_ERR_NETUNREACH;
+    }
+    net_device_t *dev = rt->dev;
+
+    tcp_hdr_t *tcp = (tcp_hdr_t *)netbuf_push(nb, hdr_len);
+    if (!tcp) {
+        printf("[tcp] no headroom for TCP header\n");
+        netbuf_free(nb);
+        return -1;
+    }
+    nb->trans_hdr = (uint8_t *)tcp;
+
+    tcp->tcp_sport = htons(sport);
+    tcp->tcp_dport = htons(dport);
+    tcp->tcp_seq = htonl(seq);
+    tcp->tcp_ack = htonl(ack);
+    tcp->tcp_off = (uint8_t)((hdr_len / 4) << 4);
+    tcp->tcp_flags = flags;
+    tcp->tcp_win = htons(win);
+    tcp->tcp_urg = 0;
+    tcp->tcp_sum = 0;
+    if (mss_opt) {
+        uint8_t *opt = (uint8_t *)tcp + TCP_HDR_LEN;
+        opt[0] = TCP_OPT_MSS;
+        opt[1] = 4;
+        opt[2] = (uint8_t)(mss_opt >> 8);
+        opt[3] = (uint8_t)mss_opt;
+    }
+
+    if (nb->gso_size && !(dev->features & NETIF_F_TSO)) {
+        nb->gso_size = 0;
+    }
+
+    if (dev->features & NETIF_F_IP_CSUM) {
+        // 只填伪头部和，网卡从 TCP 头开始累加并插入；
+        // TSO 时伪头部不含长度，由网卡按每个分段补上
+        nb->ip_summed = NETBUF_CSUM_PARTIAL;
+        nb->csum_offset = 16;  // tcp_sum
+        tcp->tcp_sum = (uint16_t)~csum_fold(csum_tcpudp_nofold(
+            htonl(dev->ip_addr), htonl(dst_ip),
+            nb->gso_size ? 0 : netbuf_total_len(nb), IPPROTO_TCP, 0));
+    } else {
+        uint32_t sum = csum_tcpudp_nofold(htonl(dev->ip_addr), htonl(dst_ip),
+                                          netbuf_total_len(nb), IPPROTO_TCP, 0);
+        tcp->tcp_sum = csum_fold(csum_netbuf(nb, sum));
+    }
+
+    tcp_stats.out_segs++;
+    return ip_output_dst(rt, dst_ip, IPPROTO_TCP, nb);
+}
+
+// 把发送缓冲区 [off, off+len) 拷进 netbuf；超过一个 netbuf 时负载挂在 frag 链上（TSO）
+static netbuf_t *tcp_build_payload(tcp_sock_t *tp, uint32_t off, uint32_t len) {
+    netbuf_t *head = netbuf_alloc(NETBUF_HEADROOM);
+    if (!head) {
+        return NULL;
+    }
+
+    if (len <= netbuf_tailroom(head)) {
+        if (len) {
+            tcp_sndbuf_read(tp, off, netbuf_put(head, len), len);
+        }
+        return head;
+    }
+
+    while (len > 0) {
+        uint32_t n = tcp_min(len, NETBUF_DATA_SIZE);
+        netbuf_t *frag = netbuf_alloc(0);
+        if (!frag) {
+            netbuf_free(head);
+            return NULL;
+        }
+        tcp_sndbuf_read(tp, off, netbuf_put(frag, n), n);
+        netbuf_frag_append(head, frag);
+        off += n;
+        len -= n;
+    }
+    return head;
+}
+
+/**
+ * @brief 发送一个段：负载取自发送缓冲区 seq 处，ACK/窗口取当前接收状态
+ */
+static int tcp_xmit(tcp_sock_t *tp, uint32_t seq, uint32_t len, uint8_t flags) {
+    uint32_t off = seq - tp->snd_una;
+    netbuf_t *nb;
+
+    if (len && tp->state != TCP_SYN_SENT && tp->state != TCP_SYN_RCVD) {
+        nb = tcp_build_payload(tp, off, len);
+    } else {
+        len = 0;
+        nb = netbuf_alloc(NETBUF_HEADROOM);
+    }
+    if (!nb) {
+        return -1;
+    }
+    nb->tos = tp->tos;
+    if (len > tp->mss) {
+        nb->gso_size = tp->mss;
+    }
+
+    uint16_t mss_opt = 0;
+    if (flags & TCP_SYN) {
+        mss_opt = (uint16_t)(tp->dev->mtu - IP_HDR_LEN - TCP_HDR_LEN);
+    }
+
+    uint16_t win = 0;
+    if (tp->state != TCP_SYN_SENT || (flags & TCP_ACK)) {
+        win = (uint16_t)tcp_rcv_window(tp);
+        tp->rcv_adv = tp->rcv_nxt + win;
+    } else {
+        win = (uint16_t)tcp_min(TCP_RCVBUF_SIZE, 0xFFFF);
+    }
+
+    if (flags & TCP_ACK) {
+        tp->flags &= ~TCP_F_ACK_NOW;
+        tp->unacked_bytes = 0;
+        timer_del(&tp->delack_timer);
+    }
+    if (SEQ_LT(seq, tp->snd_max) && (len || (flags & (TCP_SYN | TCP_FIN)))) {
+        tcp_stats.retrans_segs++;
+    }
+
+    return tcp_emit(&tp->dst, tp->dev, tp->remote_ip, tp->local_port, tp->remote_port,
+                    seq, (flags & TCP_ACK) ? tp->rcv_nxt : 0, flags, win, mss_opt, nb);
+}
+
+static void tcp_send_ack(tcp_sock_t *tp) {
+    tcp_xmit(tp, tp->snd_nxt, 0, TCP_ACK);
+}
+
+static void tcp_reset_rtx_timer(tcp_sock_t *tp) {
+    timer_mod(&tp->rtx_timer, clock_ms() + tp->rto);
+}
+
+/**
+ * @brief 对没有连接的段回 RST（RFC 793 "If the connection does not exist"）
+ */
+static void tcp_send_reset(net_device_t *dev, uint32_t src_ip, const tcp_hdr_t *tcp,
+                           uint32_t seg_len) {
+    if (tcp->tcp_flags & TCP_RST) {
+        return;
+    }
+
+    netbuf_t *nb = netbuf_alloc(NETBUF_HEADROOM);
+    if (!nb) {
+        return;
+    }
+
+    uint32_t seq, ack;
+    uint8_t flags;
+    if (tcp->tcp_flags & TCP_ACK) {
+        seq = ntohl(tcp->tcp_ack);
+        ack = 0;
+        flags = TCP_RST;
+    } else {
+        seq = 0;
+        ack = ntohl(tcp->tcp_seq) + seg_len;
+        flags = TCP_RST | TCP_ACK;
+    }
+
+    dst_cache_t rt;
+    memset(&rt, 0, sizeof(rt));
+    tcp_stats.out_rsts++;
+    tcp_emit(&rt, dev, src_ip, ntohs(tcp->tcp_dport), ntohs(tcp->tcp_sport),
+             seq, ack, flags, 0, 0, nb);
+}
+
+// 当前能发出去的 FIN：已排队、数据全部发完、FIN 还没在路上
+static inline int tcp_fin_ready(tcp_sock_t *tp) {
+    return (tp->flags & TCP_F_FIN_QUEUED) &&
+           tp->snd_nxt == tp->snd_una + tp->snd_len;
+}
+
+/**
+ * @brief 在拥塞窗口和对端窗口允许的范围内把未发送数据发出去
+ *
+ * 满 MSS 的段直接发；不满一个 MSS 的尾巴按 Nagle 算法等前面的数据
+ * 都被确认后再发（TCP_F_NODELAY 关闭）。支持 TSO 的网卡一次交出
+ * 多个 MSS。没有数据可带时补发挂起的 ACK。
+ */
+static void tcp_output(tcp_sock_t *tp) {
+    int sent_any = 0;
+    int was_idle = (tp->snd_una == tp->snd_max);
+
+    if (tp->state < TCP_ESTABLISHED && tp->state != TCP_SYN_RCVD) {
+        return;
+    }
+    if (tp->state == TCP_SYN_RCVD || tp->state == TCP_TIME_WAIT) {
+        goto ack;
+    }
+
+    net_device_t *dev = tp->dev;
+    // 出口 MTU 在连接建立后被调小（SYS_NET_MTU）时跟着缩小 MSS，免得每个段都要 IP 分片
+    if (tp->mss > dev->mtu - IP_HDR_LEN - TCP_HDR_LEN) {
+        tp->mss = (uint16_t)(dev->mtu - IP_HDR_LEN - TCP_HDR_LEN);
+    }
+    uint32_t max_seg = tp->mss;
+    if ((dev->features & NETIF_F_TSO) && dev->gso_max_size > tp->mss) {
+        max_seg = dev->gso_max_size - dev->gso_max_size % tp->mss;
+    }
+
+    net_tx_batch_begin();
+    for (;;) {
+        uint32_t off = tp->snd_nxt - tp->snd_una;
+        uint32_t unsent = tp->snd_len > off ? tp->snd_len - off : 0;
+        uint32_t inflight = tp->snd_nxt - tp->snd_una;
+        uint32_t wnd = tcp_min(tp->snd_wnd, tp->cwnd);
+        uint32_t avail = wnd > inflight ? wnd - inflight : 0;
+        uint32_t len = tcp_min(tcp_min(unsent, avail), max_seg);
+
+        if (len == 0) {
+            if (unsent == 0 && tcp_fin_ready(tp)) {
+                if (tcp_xmit(tp, tp->snd_nxt, 0, TCP_FIN | TCP_ACK) < 0) {
+                    break;
+                }
+                tp->flags |= TCP_F_FIN_SENT;
+                tp->snd_nxt++;
+                if (SEQ_GT(tp->snd_nxt, tp->snd_max)) {
+                    tp->snd_max = tp->snd_nxt;
+                }
+                sent_any = 1;
+            }
+            break;
+        }
+
+        // Nagle：还有数据在路上时不发小段
+        if (len < tp->mss && len == unsent && inflight > 0 &&
+            !(tp->flags & (TCP_F_NODELAY | TCP_F_FIN_QUEUED))) {
+            break;
+        }
+        // 窗口只够发一小段而后面还有数据：等窗口张开（没有在途数据时由持续定时器探测）
+        if (len < tp->mss && len < unsent && inflight > 0) {
+            break;
+        }
+        // 出口队列满了就别再往里塞（塞进去也是被丢掉），等 ACK 回来再发
+        if (inflight > 0 && !qdisc_writable(dev, tp->tos)) {
+            break;
+        }
+
+        uint8_t flags = TCP_ACK;
+        int fin = (tp->flags & TCP_F_FIN_QUEUED) && off + len == tp->snd_len;
+        if (off + len == tp->snd_len) {
+            flags |= TCP_PSH;
+        }
+        if (fin) {
+            flags |= TCP_FIN;
+        }
+
+        // Karn：只对首次发送的段计时
+        if (!tp->rtt_active && tp->snd_nxt == tp->snd_max) {
+            tp->rtt_active = 1;
+            tp->rtt_seq = tp->snd_nxt;
+            tp->rtt_start = clock_ms();
+        }
+
+        if (tcp_xmit(tp, tp->snd_nxt, len, flags) < 0) {
+            break;
+        }
+        tp->snd_nxt += len;
+        if (fin) {
+            tp->flags |= TCP_F_FIN_SENT;
+            tp->snd_nxt++;
+        }
+        if (SEQ_GT(tp->snd_nxt, tp->snd_max)) {
+            tp->snd_max = tp->snd_nxt;
+        }
+        sent_any = 1;
+        if (fin) {
+            break;
+        }
+    }
+    net_tx_batch_end();
+
+    if (tp->snd_una != tp->snd_max) {
+        // 之前没有在途数据时挂着的可能是持续定时器，要按 RTO 重新计时
+        if (was_idle || !timer_pending(&tp->rtx_timer)) {
+            tcp_reset_rtx_timer(tp);
+        }
+    } else if (tp->snd_wnd == 0 && tp->snd_len > 0 && !timer_pending(&tp->rtx_timer)) {
+        // 对端窗口为 0 且没有在途数据：持续定时器负责探测
+        tcp_reset_rtx_timer(tp);
+    }
+
+ack:
+    if (!sent_any && (tp->flags & TCP_F_ACK_NOW)) {
+        tcp_send_ack(tp);
+    }
+}
+
+// 快速重传 / 部分 ACK：重发 snd_una 处的一个段，不动 snd_nxt
+static void tcp_retransmit_head(tcp_sock_t *tp) {
+    uint32_t len = tcp_min(tp->snd_len, tp->mss);
+    uint8_t flags = TCP_ACK;
+
+    if (len == 0) {
+        if (!(tp->flags & TCP_F_FIN_SENT)) {
+            return;
+        }
+        flags |= TCP_FIN;
+    }
+    tp->rtt_active = 0;
+    tcp_xmit(tp, tp->snd_una, len, flags);
+}
+
+// ==================== RTT / 拥塞控制 ====================
+
+// RFC 6298：SRTT/RTTVAR 更新，RTO = SRTT + max(G, 4 * RTTVAR)
+static void tcp_rtt_sample(tcp_sock_t *tp, uint32_t rtt) {
+    if (rtt == 0) {
+        rtt = 1;
+    }
+
+    if (tp->srtt8 == 0) {
+        tp->srtt8 = rtt << 3;
+        tp->rttvar4 = rtt << 1;
+    } else {
+        int32_t delta = (int32_t)rtt - (int32_t)(tp->srtt8 >> 3);
+        tp->srtt8 += delta;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        tp->rttvar4 = (uint32_t)((int32_t)tp->rttvar4 + delta - (int32_t)(tp->rttvar4 >> 2));
+    }
+
+    uint32_t rto = (tp->srtt8 >> 3) + tcp_max(1, tp->rttvar4);
+    tp->rto = tcp_min(tcp_max(rto, TCP_RTO_MIN), TCP_RTO_MAX);
+}
+
+// RFC 3390 初始窗口
+static void tcp_init_cwnd(tcp_sock_t *tp) {
+    tp->cwnd = tcp_min(4 * tp->mss, tcp_max(2 * tp->mss, 4380));
+    tp->bytes_acked = 0;
+    tp->dupacks = 0;
+}
+
+// 丢包后的 ssthresh：在途数据的一半，至少两个 MSS
+static uint32_t tcp_loss_ssthresh(tcp_sock_t *tp) {
+    return tcp_max((tp->snd_max - tp->snd_una) / 2, 2 * tp->mss);
+}
+
+// 新数据被确认：慢启动 / 拥塞避免（RFC 5681），快速恢复中按 RFC 6582 处理；
+// inflight 是这个 ACK 之前的在途字节数，没有用满 cwnd 时不再扩大窗口（RFC 7661）
+static void tcp_cong_ack(tcp_sock_t *tp, uint32_t ack, uint32_t acked, uint32_t inflight) {
+    if (tp->flags & TCP_F_IN_RECOVERY) {
+        if (SEQ_GEQ(ack, tp->recover)) {
+            // 完全确认：退出快速恢复，窗口收缩到 ssthresh
+            tp->cwnd = tcp_min(tp->ssthresh, tcp_max(tp->snd_max - ack, tp->mss) + tp->mss);
+            tp->flags &= ~TCP_F_IN_RECOVERY;
+        } else {
+            // 部分确认：重传下一个空洞，窗口减去确认量再加一个 MSS
+            tcp_retransmit_head(tp);
+            tp->cwnd = (tp->cwnd > acked ? tp->cwnd - acked : 0) + tp->mss;
+            tcp_reset_rtx_timer(tp);
+        }
+        tp->dupacks = 0;
+        return;
+    }
+
+    tp->dupacks = 0;
+    if (inflight + tp->mss < tp->cwnd) {
+        return;
+    }
+    if (tp->cwnd < tp->ssthresh) {
+        tp->cwnd += tcp_min(acked, tp->mss);
+    } else {
+        tp->bytes_acked += acked;
+        if (tp->bytes_acked >= tp->cwnd) {
+            tp->bytes_acked -= tp->cwnd;
+            tp->cwnd += tp->mss;
+        }
+    }
+}
+
+// 重复 ACK：第三个触发快速重传，之后每个把窗口撑大一个 MSS
+static void tcp_cong_dupack(tcp_sock_t *tp) {
+    tp->dupacks++;
+
+    if (tp->flags & TCP_F_IN_RECOVERY) {
+        tp->cwnd += tp->mss;
+        return;
+    }
+    if (tp->dupacks != 3) {
+        return;
+    }
+    // RFC 6582：上一次恢复覆盖到的数据引起的重复 ACK 不再触发
+    if (SEQ_LEQ(tp->snd_una, tp->recover) && tp->recover != tp->iss) {
+        return;
+    }
+
+    tcp_stats.fast_retrans++;
+    tp->ssthresh = tcp_loss_ssthresh(tp);
+    tp->recover = tp->snd_max;
+    tp->flags |= TCP_F_IN_RECOVERY;
+    tcp_retransmit_head(tp);
+    tp->cwnd = tp->ssthresh + 3 * tp->mss;
+    tcp_reset_rtx_timer(tp);
+}
+
+// ==================== 定时器 ====================
+
+static void tcp_rtx_timeout(ktimer_t *t) {
+    tcp_sock_t *tp = (tcp_sock_t *)t->data;
+    uint32_t flags = tcp_lock();
+
+    switch (tp->state) {
+    case TCP_CLOSED:
+    case TCP_LISTEN:
+        break;
+
+    case TCP_TIME_WAIT:
+    case TCP_FIN_WAIT2:
+        // 2MSL 结束 / 已关闭的连接等不到对端 FIN
+        tcp_done(tp);
+        break;
+
+    default:
+        if (tp->snd_una == tp->snd_max) {
+            // 持续定时器：对端窗口为 0，发一个字节探测
+            // （不计入 snd_nxt：对端收下这个字节时由 tcp_ack 接受）
+            if (tp->snd_wnd == 0 && tp->snd_len > 0) {
+                tcp_xmit(tp, tp->snd_una, 1, TCP_ACK);
+                tp->rto = tcp_min(tp->rto * 2, TCP_RTO_MAX);
+                tcp_reset_rtx_timer(tp);
+            }
+            break;
+        }
+
+        int syn = (tp->state == TCP_SYN_SENT || tp->state == TCP_SYN_RCVD);
+        if (++tp->retries > (syn ? TCP_SYN_RETRIES : TCP_MAX_RETRIES)) {
+            printf("[tcp] %d -> %d: retransmission limit reached, giving up\n",
+                   tp->local_port, tp->remote_port);
+            if (tp->state == TCP_SYN_SENT) {
+                tcp_stats.attempt_fails++;
+            }
+            tp->error = TCP_ERR_TIMEDOUT;
+            tcp_done(tp);
+            break;
+        }
+
+        tcp_stats.timeouts++;
+        tp->rto = tcp_min(tp->rto * 2, TCP_RTO_MAX);
+        tp->rtt_active = 0;
+
+        if (tp->state == TCP_SYN_SENT) {
+            tcp_xmit(tp, tp->iss, 0, TCP_SYN);
+        } else if (tp->state == TCP_SYN_RCVD) {
+            tcp_xmit(tp, tp->iss, 0, TCP_SYN | TCP_ACK);
+        } else {
+            // 超时说明网络拥塞严重：窗口回到一个 MSS，从 snd_una 开始重发
+            tp->ssthresh = tcp_loss_ssthresh(tp);
+            tp->cwnd = tp->mss;
+            tp->bytes_acked = 0;
+            tp->dupacks = 0;
+            tp->flags &= ~TCP_F_IN_RECOVERY;
+            tp->recover = tp->snd_max;
+            tp->snd_nxt = tp->snd_una;
+            tcp_output(tp);
+        }
+        tcp_reset_rtx_timer(tp);
+        break;
+    }
+
+    tcp_unlock(flags);
+}
+
+static void tcp_delack_timeout(ktimer_t *t) {
+    tcp_sock_t *tp = (tcp_sock_t *)t->data;
+    uint32_t flags = tcp_lock();
+
+    if (tp->state >= TCP_ESTABLISHED && tp->unacked_bytes) {
+        tcp_stats.delayed_acks++;
+        tcp_send_ack(tp);
+    }
+    tcp_unlock(flags);
+}
+
+// ==================== 接收 ====================
+
+// 解析 SYN 上的选项（只关心 MSS）
+static void tcp_parse_options(tcp_sock_t *tp, const tcp_hdr_t *tcp, uint32_t hdr_len) {
+    const uint8_t *opt = (const uint8_t *)tcp + TCP_HDR_LEN;
+    uint32_t len = hdr_len - TCP_HDR_LEN;
+    uint16_t our_mss = (uint16_t)(tp->dev->mtu - IP_HDR_LEN - TCP_HDR_LEN);
+    uint16_t peer_mss = TCP_DEFAULT_MSS;
+
+    while (len > 0) {
+        if (opt[0] == 0) {
+            break;
+        }
+        if (opt[0] == 1) {
+            opt++;
+            len--;
+            continue;
+        }
+        if (len < 2 || opt[1] < 2 || opt[1] > len) {
+            break;
+        }
+        if (opt[0] == TCP_OPT_MSS && opt[1] == 4) {
+            peer_mss = (uint16_t)((opt[2] << 8) | opt[3]);
+        }
+        len -= opt[1];
+        opt += opt[1];
+    }
+
+    if (peer_mss < 64) {
+        peer_mss = 64;
+    }
+    tp->mss = peer_mss < our_mss ? peer_mss : our_mss;
+}
+
+// 记录乱序区间 [start, end)，与已有区间重叠或相邻时合并；记不下时返回 -1
+static int tcp_ooo_add(tcp_sock_t *tp, uint32_t start, uint32_t end) {
+    for (int i = 0; i < tp->ooo_count; i++) {
+        if (SEQ_LEQ(start, tp->ooo_end[i]) && SEQ_GEQ(end, tp->ooo_start[i])) {
+            if (SEQ_LT(start, tp->ooo_start[i])) {
+                tp->ooo_start[i] = start;
+            }
+            if (SEQ_GT(end, tp->ooo_end[i])) {
+                tp->ooo_end[i] = end;
+            }
+            // 扩大后可能和其他区间连上
+            for (int j = 0; j < tp->ooo_count; j++) {
+                if (j == i || SEQ_GT(tp->ooo_start[j], tp->ooo_end[i]) ||
+                    SEQ_LT(tp->ooo_end[j], tp->ooo_start[i])) {
+                    continue;
+                }
+                if (SEQ_LT(tp->ooo_start[j], tp->ooo_start[i])) {
+                    tp->ooo_start[i] = tp->ooo_start[j];
+                }
+                if (SEQ_GT(tp->ooo_end[j], tp->ooo_end[i])) {
+                    tp->ooo_end[i] = tp->ooo_end[j];
+                }
+                tp->ooo_count--;
+                tp->ooo_start[j] = tp->ooo_start[tp->ooo_count];
+                tp->ooo_end[j] = tp->ooo_end[tp->ooo_count];
+                if (i == tp->ooo_count) {
+                    i = j;
+                }
+                j = -1;
+            }
+            return 0;
+        }
+    }
+
+    if (tp->ooo_count == TCP_OOO_MAX) {
+        return -1;
+    }
+    tp->ooo_start[tp->ooo_count] = start;
+    tp->ooo_end[tp->ooo_count] = end;
+    tp->ooo_count++;
+    return 0;
+}
+
+// rcv_nxt 前进后，把已经连上的乱序区间并入可读数据
+static void tcp_ooo_collapse(tcp_sock_t *tp) {
+    int merged = 1;
+
+    while (merged) {
+        merged = 0;
+        for (int i = 0; i < tp->ooo_count; i++) {
+            if (SEQ_GT(tp->ooo_start[i], tp->rcv_nxt)) {
+                continue;
+            }
+            if (SEQ_GT(tp->ooo_end[i], tp->rcv_nxt)) {
+                tp->rcv_len += tp->ooo_end[i] - tp->rcv_nxt;
+                tp->rcv_nxt = tp->ooo_end[i];
+            }
+            tp->ooo_count--;
+            tp->ooo_start[i] = tp->ooo_start[tp->ooo_count];
+            tp->ooo_end[i] = tp->ooo_end[tp->ooo_count];
+            merged = 1;
+            break;
+        }
+    }
+}
+
+// 按序收到 FIN
+static void tcp_rcv_fin(tcp_sock_t *tp) {
+    tp->rcv_nxt++;
+    tp->rcv_fin_ooo = 0;
+    tp->flags |= TCP_F_RCV_FIN | TCP_F_ACK_NOW;
+
+    switch (tp->state) {
+    case TCP_SYN_RCVD:
+    case TCP_ESTABLISHED:
+        tcp_set_state(tp, TCP_CLOSE_WAIT);
+        break;
+    case TCP_FIN_WAIT1:
+        // FIN 已被确认的情况在 ACK 处理里已经转到 FIN_WAIT2
+        tcp_set_state(tp, TCP_CLOSING);
+        break;
+    case TCP_FIN_WAIT2:
+        tcp_set_state(tp, TCP_TIME_WAIT);
+        timer_del(&tp->delack_timer);
+        timer_mod(&tp->rtx_timer, clock_ms() + 2 * TCP_MSL_MS);
+        break;
+    case TCP_TIME_WAIT:
+        timer_mod(&tp->rtx_timer, clock_ms() + 2 * TCP_MSL_MS);
+        break;
+    default:
+        break;
+    }
+    tcp_notify(tp);
+}
+
+/**
+ * @brief 处理段中的数据（已裁剪到接收窗口内，seq >= rcv_nxt）
+ */
+static void tcp_data_queue(tcp_sock_t *tp, uint32_t seq, const netbuf_t *nb,
+                           uint32_t data_off, uint32_t len, int fin) {
+    uint32_t off = seq - tp->rcv_nxt;
+
+    if (len == 0) {
+        if (fin) {
+            if (off == 0) {
+                tcp_rcv_fin(tp);
+            } else {
+                tp->rcv_fin_ooo = 1;
+                tp->rcv_fin_seq = seq;
+                tp->flags |= TCP_F_ACK_NOW;
+            }
+        }
+        return;
+    }
+
+    if (off == 0) {
+        int had_holes = tp->ooo_count > 0;
+
+        tcp_rcvbuf_write(tp, 0, nb, data_off, len);
+        tp->rcv_nxt += len;
+        tp->rcv_len += len;
+        tcp_ooo_collapse(tp);
+
+        tp->unacked_bytes += len;
+        // 每两个满段立即 ACK；补上空洞时立即 ACK 让对端尽快退出快速恢复
+        if (had_holes || tp->unacked_bytes >= 2u * tp->mss) {
+            tp->flags |= TCP_F_ACK_NOW;
+        } else if (!timer_pending(&tp->delack_timer)) {
+            timer_mod(&tp->delack_timer, clock_ms() + TCP_DELACK_MS);
+        }
+
+        if (fin) {
+            tp->rcv_fin_ooo = 1;
+            tp->rcv_fin_seq = seq + len;
+        }
+        if (tp->rcv_fin_ooo && tp->rcv_fin_seq == tp->rcv_nxt) {
+            tcp_rcv_fin(tp);
+        }
+        tcp_notify(tp);
+        return;
+    }
+
+    // 乱序：写进窗口内对应的位置，记下区间；立即 ACK（重复 ACK 驱动对端快速重传）
+    tcp_stats.ooo_segs++;
+    if (tcp_ooo_add(tp, seq, seq + len) == 0) {
+        tcp_rcvbuf_write(tp, off, nb, data_off, len);
+        if (fin) {
+            tp->rcv_fin_ooo = 1;
+            tp->rcv_fin_seq = seq + len;
+        }
+    }
+    tp->flags |= TCP_F_ACK_NOW;
+}
+
+/**
+ * @brief 处理确认号（同步状态下）
+ * @return 0 继续处理本段，-1 丢弃本段
+ */
+static int tcp_ack(tcp_sock_t *tp, uint32_t seq, uint32_t ack, uint32_t win,
+                   uint32_t data_len, uint8_t tcp_flags) {
+    if (SEQ_GT(ack, tp->snd_max)) {
+        if (ack == tp->snd_max + 1 && tp->snd_len > tp->snd_max - tp->snd_una) {
+            // 零窗口探测的那个字节被收下了
+            tp->snd_max = ack;
+            tp->snd_nxt = ack;
+        } else {
+            // 确认了还没发的数据
+            tp->flags |= TCP_F_ACK_NOW;
+            return -1;
+        }
+    }
+
+    // 窗口更新（RFC 793：只接受更新的段）
+    int win_changed = 0;
+    if (SEQ_LT(tp->snd_wl1, seq) ||
+        (tp->snd_wl1 == seq && SEQ_LEQ(tp->snd_wl2, ack))) {
+        win_changed = (tp->snd_wnd != win);
+        tp->snd_wnd = win;
+        tp->snd_wl1 = seq;
+        tp->snd_wl2 = ack;
+    }
+
+    if (SEQ_LEQ(ack, tp->snd_una)) {
+        if (ack == tp->snd_una && data_len == 0 && !win_changed &&
+            !(tcp_flags & (TCP_SYN | TCP_FIN)) && tp->snd_una != tp->snd_max) {
+            tcp_cong_dupack(tp);
+        }
+        return 0;
+    }
+
+    // 新确认
+    uint32_t acked = ack - tp->snd_una;
+    uint32_t data_acked = tcp_min(acked, tp->snd_len);
+    int fin_acked = (tp->flags & TCP_F_FIN_SENT) && acked > tp->snd_len;
+    uint32_t inflight = tp->snd_max - tp->snd_una;
+
+    tp->snd_head = (tp->snd_head + data_acked) & TCP_SNDBUF_MASK;
+    tp->snd_len -= data_acked;
+    tp->snd_una = ack;
+    if (SEQ_LT(tp->snd_nxt, tp->snd_una)) {
+        tp->snd_nxt = tp->snd_una;
+    }
+    tp->retries = 0;
+
+    if (tp->rtt_active && SEQ_GT(ack, tp->rtt_seq)) {
+        tp->rtt_active = 0;
+        tcp_rtt_sample(tp, clock_ms() - tp->rtt_start);
+    }
+
+    tcp_cong_ack(tp, ack, acked, inflight);
+
+    if (tp->snd_una == tp->snd_max) {
+        timer_del(&tp->rtx_timer);
+    } else if (!(tp->flags & TCP_F_IN_RECOVERY)) {
+        tcp_reset_rtx_timer(tp);
+    }
+
+    if (fin_acked) {
+        switch (tp->state) {
+        case TCP_FIN_WAIT1:
+            tcp_set_state(tp, TCP_FIN_WAIT2);
+            if (tp->flags & TCP_F_USER_CLOSED) {
+                timer_mod(&tp->rtx_timer, clock_ms() + TCP_FIN_WAIT2_MS);
+            }
+            break;
+        case TCP_CLOSING:
+            tcp_set_state(tp, TCP_TIME_WAIT);
+            timer_mod(&tp->rtx_timer, clock_ms() + 2 * TCP_MSL_MS);
+            break;
+        case TCP_LAST_ACK:
+            tcp_done(tp);
+            return -1;
+        default:
+            break;
+        }
+    }
+
+    if (data_acked) {
+        tcp_notify(tp);
+    }
+    return 0;
+}
+
+// 连接建立（主动打开收到 SYN-ACK，或被动打开收到第三次握手的 ACK）
+static void tcp_established(tcp_sock_t *tp) {
+    tcp_set_state(tp, TCP_ESTABLISHED);
+    tcp_init_cwnd(tp);
+    if (tp->retries) {
+        // RFC 6298 5.7：SYN 被重传过，初始窗口只用一个 MSS
+        tp->cwnd = tp->mss;
+        tp->rto = TCP_RTO_INIT;
+    }
+    tp->recover = tp->iss;
+    tp->retries = 0;
+    timer_del(&tp->rtx_timer);
+
+    tcp_sock_t *parent = tp->parent;
+    if (parent) {
+        tcp_sock_t **pp = &parent->accept_head;
+        while (*pp) {
+            pp = &(*pp)->accept_next;
+        }
+        *pp = tp;
+        tcp_notify(parent);
+    }
+    tcp_notify(tp);
+}
+
+// LISTEN 状态收到 SYN：创建半连接，回 SYN-ACK
+static void tcp_listen_input(tcp_sock_t *lp, net_device_t *dev, uint32_t src_ip,
+                             uint32_t dst_ip, const tcp_hdr_t *tcp, uint32_t hdr_len,
+                             uint32_t seg_len) {
+    uint8_t flags = tcp->tcp_flags;
+
+    if (flags & TCP_RST) {
+        return;
+    }
+    if (flags & TCP_ACK) {
+        tcp_send_reset(dev, src_ip, tcp, seg_len);
+        return;
+    }
+    if (!(flags & TCP_SYN)) {
+        return;
+    }
+    if (lp->pending >= lp->backlog) {
+        tcp_dbg("listen queue of port %d full, dropping SYN\n", lp->local_port);
+        return;
+    }
+
+    tcp_sock_t *tp = tcp_alloc();
+    if (!tp) {
+        return;
+    }
+
+    tp->dev = dev;
+    tp->local_ip = dst_ip;
+    tp->local_port = lp->local_port;
+    tp->remote_ip = src_ip;
+    tp->remote_port = ntohs(tcp->tcp_sport);
+    tp->parent = lp;
+    tp->tos = lp->tos;
+    tp->flags |= TCP_F_USER_CLOSED | (lp->flags & TCP_F_NODELAY);  // accept 之前无人持有
+    lp->pending++;
+
+    tcp_parse_options(tp, tcp, hdr_len);
+    tp->irs = ntohl(tcp->tcp_seq);
+    tp->rcv_nxt = tp->irs + 1;
+    tp->snd_wnd = ntohs(tcp->tcp_win);
+    tp->snd_wl1 = tp->irs;
+    tp->iss = tcp_new_iss(tp);
+    tp->snd_una = tp->iss;
+    tp->snd_nxt = tp->iss;
+    tp->snd_max = tp->iss;
+    tp->snd_wl2 = tp->iss;
+
+    tcp_set_state(tp, TCP_SYN_RCVD);
+    tcp_hash_insert(tp);
+    tcp_stats.passive_opens++;
+
+    tcp_xmit(tp, tp->iss, 0, TCP_SYN | TCP_ACK);
+    tp->snd_nxt = tp->iss + 1;
+    tp->snd_max = tp->snd_nxt;
+    tcp_reset_rtx_timer(tp);
+}
+
+// SYN_SENT 状态的段处理（RFC 793 第 66-68 页）
+static void tcp_syn_sent_input(tcp_sock_t *tp, const tcp_hdr_t *tcp, uint32_t hdr_len) {
+    uint8_t flags = tcp->tcp_flags;
+    uint32_t seq = ntohl(tcp->tcp_seq);
+    uint32_t ack = ntohl(tcp->tcp_ack);
+
+    if (flags & TCP_ACK) {
+        if (SEQ_LEQ(ack, tp->iss) || SEQ_GT(ack, tp->snd_max)) {
+            if (!(flags & TCP_RST)) {
+                tcp_send_reset(tp->dev, tp->remote_ip, tcp, 0);
+            }
+            return;
+        }
+    }
+    if (flags & TCP_RST) {
+        if (flags & TCP_ACK) {
+            tcp_stats.attempt_fails++;
+            tp->error = TCP_ERR_CONNREFUSED;
+            tcp_done(tp);
+        }
+        return;
+    }
+    if (!(flags & TCP_SYN)) {
+        return;
+    }
+
+    tcp_parse_options(tp, tcp, hdr_len);
+    tp->irs = seq;
+    tp->rcv_nxt = seq + 1;
+    tp->snd_wnd = ntohs(tcp->tcp_win);
+    tp->snd_wl1 = seq;
+    tp->snd_wl2 = ack;
+
+    if (flags & TCP_ACK) {
+        tp->snd_una = ack;
+        if (tp->rtt_active) {
+            tp->rtt_active = 0;
+            tcp_rtt_sample(tp, clock_ms() - tp->rtt_start);
+        }
+        tcp_established(tp);
+        tcp_send_ack(tp);
+    } else {
+        // 同时打开
+        tcp_set_state(tp, TCP_SYN_RCVD);
+        tcp_xmit(tp, tp->iss, 0, TCP_SYN | TCP_ACK);
+        tcp_reset_rtx_timer(tp);
+    }
+}
+
+/**
+ * @brief 同步状态下的段处理（RFC 793 "Otherwise" 分支）
+ */
+static void tcp_process(tcp_sock_t *tp, const tcp_hdr_t *tcp, const netbuf_t *nb,
+                        uint32_t data_off, uint32_t data_len) {
+    uint8_t flags = tcp->tcp_flags;
+    uint32_t seq = ntohl(tcp->tcp_seq);
+    uint32_t ack = ntohl(tcp->tcp_ack);
+    uint32_t win = ntohs(tcp->tcp_win);
+    int fin = (flags & TCP_FIN) != 0;
+
+    if (flags & TCP_SYN) {
+        // 序号空间已经同步，SYN 只能是重传或伪造：回一个 ACK（RFC 5961 challenge ACK）
+        if (tp->state == TCP_SYN_RCVD && seq == tp->irs) {
+            tcp_xmit(tp, tp->iss, 0, TCP_SYN | TCP_ACK);
+        } else {
+            tcp_send_ack(tp);
+        }
+        return;
+    }
+
+    // 第一步：序号可接受性检查，并裁剪到接收窗口
+    uint32_t rcv_wnd = TCP_RCVBUF_SIZE - tp->rcv_len;
+    uint32_t seg_len = data_len + fin;
+    int acceptable;
+
+    if (seg_len == 0) {
+        acceptable = rcv_wnd == 0 ? seq == tp->rcv_nxt
+                                  : SEQ_GEQ(seq, tp->rcv_nxt) && SEQ_LT(seq, tp->rcv_nxt + rcv_wnd);
+        // 窗口左侧紧邻的纯 ACK 也接受（例如零窗口探测的应答）
+        acceptable = acceptable || seq == tp->rcv_nxt;
+    } else if (rcv_wnd == 0) {
+        acceptable = 0;
+    } else {
+        uint32_t last = seq + seg_len - 1;
+        acceptable = (SEQ_GEQ(seq, tp->rcv_nxt) && SEQ_LT(seq, tp->rcv_nxt + rcv_wnd)) ||
+                     (SEQ_GEQ(last, tp->rcv_nxt) && SEQ_LT(last, tp->rcv_nxt + rcv_wnd));
+    }
+
+    if (!acceptable) {
+        if (!(flags & TCP_RST)) {
+            if (tp->state == TCP_TIME_WAIT && fin) {
+                // 对端重传 FIN：重新确认，2MSL 重新计时
+                timer_mod(&tp->rtx_timer, clock_ms() + 2 * TCP_MSL_MS);
+            }
+            tcp_send_ack(tp);
+        }
+        // 窗口为 0 时对端的探测段里也可能带着有用的 ACK
+        if (rcv_wnd == 0 && (flags & TCP_ACK) && tp->state != TCP_SYN_RCVD) {
+            tcp_ack(tp, seq, ack, win, 0, flags);
+            tcp_output(tp);
+        }
+        return;
+    }
+
+    if (SEQ_LT(seq, tp->rcv_nxt)) {
+        uint32_t dup = tp->rcv_nxt - seq;
+        if (dup > data_len) {
+            dup = data_len;
+        }
+        data_off += dup;
+        data_len -= dup;
+        seq += dup;
+        tp->flags |= TCP_F_ACK_NOW;  // 重复数据：尽快确认
+    }
+    if (data_len > rcv_wnd - (seq - tp->rcv_nxt)) {
+        data_len = rcv_wnd - (seq - tp->rcv_nxt);
+        fin = 0;
+    }
+
+    // 第二步：RST
+    if (flags & TCP_RST) {
+        if (tp->state == TCP_SYN_RCVD && tp->parent) {
+            tcp_done(tp);   // 被动打开：回到 LISTEN，直接丢掉半连接
+            return;
+        }
+        switch (tp->state) {
+        case TCP_SYN_RCVD:
+            tp->error = TCP_ERR_CONNREFUSED;
+            break;
+        case TCP_ESTABLISHED:
+        case TCP_FIN_WAIT1:
+        case TCP_FIN_WAIT2:
+        case TCP_CLOSE_WAIT:
+            tcp_stats.estab_resets++;
+            tp->error = TCP_ERR_CONNRESET;
+            break;
+        default:
+            break;
+        }
+        tcp_done(tp);
+        return;
+    }
+
+    // 第五步：ACK
+    if (!(flags & TCP_ACK)) {
+        return;
+    }
+
+    if (tp->state == TCP_SYN_RCVD) {
+        if (SEQ_LEQ(ack, tp->snd_una) || SEQ_GT(ack, tp->snd_max)) {
+            tcp_send_reset(tp->dev, tp->remote_ip, tcp, seg_len);
+            return;
+        }
+        tp->snd_una = ack;
+        tp->snd_wnd = win;
+        tp->snd_wl1 = seq;
+        tp->snd_wl2 = ack;
+        tcp_established(tp);
+    } else if (tcp_ack(tp, seq, ack, win, data_len, flags) < 0) {
+        if (tp->in_use && tp->state != TCP_CLOSED) {
+            tcp_output(tp);
+        }
+        return;
+    }
+
+    // 第七步：数据；第八步：FIN
+    switch (tp->state) {
+    case TCP_ESTABLISHED:
+    case TCP_FIN_WAIT1:
+    case TCP_FIN_WAIT2:
+        tcp_data_queue(tp, seq, nb, data_off, data_len, fin);
+        break;
+    case TCP_CLOSE_WAIT:
+    case TCP_CLOSING:
+    case TCP_LAST_ACK:
+    case TCP_TIME_WAIT:
+        // 对端已经发过 FIN，后面不会再有新数据
+        if (fin) {
+            tp->flags |= TCP_F_ACK_NOW;
+            if (tp->state == TCP_TIME_WAIT) {
+                timer_mod(&tp->rtx_timer, clock_ms() + 2 * TCP_MSL_MS);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (tp->in_use && tp->state != TCP_CLOSED) {
+        tcp_output(tp);
+    }
+}
+
+/**
+ * @brief TCP输入处理（nb->data 指向 TCP 头，不接管 nb）
+ */
+int tcp_input(net_device_t *dev, netbuf_t *nb) {
+    tcp_hdr_t *tcp = (tcp_hdr_t *)nb->data;
+    ip_hdr_t *ip = (ip_hdr_t *)nb->net_hdr;
+    uint32_t seg_total = netbuf_total_len(nb);
+
+    if (nb->len < sizeof(tcp_hdr_t) || !ip) {
+        tcp_stats.in_errs++;
+        return -1;
+    }
+
+    // 网卡没有校验过就软件校验（伪头部 + 整个 TCP 段）
+    if (nb->ip_summed != NETBUF_CSUM_UNNECESSARY &&
+        csum_fold(csum_netbuf(nb, csum_tcpudp_nofold(ip->ip_src, ip->ip_dst,
+                                                     seg_total, IPPROTO_TCP, 0))) != 0) {
+        printf("[net] Bad TCP checksum, dropping\n");
+        net_stats.rx_errors++;
+        tcp_stats.in_errs++;
+        return -1;
+    }
+
+    uint32_t hdr_len = (tcp->tcp_off >> 4) * 4;
+    if (hdr_len < TCP_HDR_LEN || hdr_len > nb->len) {
+        tcp_stats.in_errs++;
+        return -1;
+    }
+
+    nb->trans_hdr = nb->data;
+    tcp_stats.in_segs++;
+
+    uint32_t src_ip = ntohl(ip->ip_src);
+    uint32_t dst_ip = ntohl(ip->ip_dst);
+    uint16_t sport = ntohs(tcp->tcp_sport);
+    uint16_t dport = ntohs(tcp->tcp_dport);
+    // 负载从 TCP 头之后开始，可能延续到 frag 链上
+    uint32_t data_len = seg_total - hdr_len;
+    uint32_t seg_len = data_len + ((tcp->tcp_flags & TCP_SYN) ? 1 : 0) +
+                       ((tcp->tcp_flags & TCP_FIN) ? 1 : 0);
+
+    tcp_dbg("in %d -> %d flags=0x%x seq=%u ack=%u len=%d\n", sport, dport,
+            tcp->tcp_flags, ntohl(tcp->tcp_seq), ntohl(tcp->tcp_ack), data_len);
+
+    uint32_t flags = tcp_lock();
+
+    tcp_sock_t *tp = tcp_lookup(dst_ip, dport, src_ip, sport);
+    if (tp) {
+        if (tp->state == TCP_SYN_SENT) {
+            tcp_syn_sent_input(tp, tcp, hdr_len);
+        } else {
+            tcp_process(tp, tcp, nb, hdr_len, data_len);
+        }
+    } else {
+        tcp_sock_t *lp = tcp_lookup_listener(dst_ip, dport);
+        if (lp) {
+            tcp_listen_input(lp, dev, src_ip, dst_ip, tcp, hdr_len, seg_len);
+        } else {
+            tcp_send_reset(dev, src_ip, tcp, seg_len);
+        }
+    }
+
+    tcp_unlock(flags);
+    return 0;
+}
+
+// ==================== 用户接口 ====================
+
+/**
+ * @brief 分配一个 CLOSED 状态的 TCP 套接字
+ */
+tcp_sock_t *tcp_socket(void) {
+    uint32_t flags = tcp_lock();
+    tcp_sock_t *tp = tcp_alloc();
+    tcp_unlock(flags);
+    return tp;
+}
+
+/**
+ * @brief 绑定本地地址（ip 为 0 表示任意地址，port 为 0 自动分配）
+ */
+int tcp_bind(tcp_sock_t *tp, uint32_t ip, uint16_t port) {
+    uint32_t flags = tcp_lock();
+    int ret = 0;
+
+    if (tp->state != TCP_CLOSED || tp->local_port) {
+        ret = TCP_ERR_INVAL;
+    } else if (port == 0) {
+        port = tcp_ephemeral_port(ip);
+        if (!port) {
+            ret = TCP_ERR_ADDRINUSE;
+        }
+    } else if (tcp_port_in_use(ip, port)) {
+        ret = TCP_ERR_ADDRINUSE;
+    }
+
+    if (ret == 0) {
+        tp->local_ip = ip;
+        tp->local_port = port;
+    }
+    tcp_unlock(flags);
+    return ret;
+}
+
+/**
+ * @brief 进入 LISTEN（backlog 限制半连接 + 未 accept 的连接总数）
+ */
+int tcp_listen(tcp_sock_t *tp, int backlog) {
+    uint32_t flags = tcp_lock();
+    int ret = 0;
+
+    if (tp->state != TCP_CLOSED || !tp->local_port) {
+        ret = TCP_ERR_INVAL;
+    } else {
+        tp->backlog = (uint16_t)(backlog > 0 ? backlog : 1);
+        tp->pending = 0;
+        tp->accept_head = NULL;
+        tcp_set_state(tp, TCP_LISTEN);
+        tp->hnext = tcp_listeners;
+        tcp_listeners = tp;
+    }
+    tcp_unlock(flags);
+    return ret;
+}
+
+/**
+ * @brief 取出一条已建立的连接；没有时 *err = TCP_ERR_AGAIN
+ */
+tcp_sock_t *tcp_accept(tcp_sock_t *lp, int *err) {
+    uint32_t flags = tcp_lock();
+    tcp_sock_t *tp = NULL;
+
+    if (lp->state != TCP_LISTEN) {
+        *err = TCP_ERR_INVAL;
+    } else if (!lp->accept_head) {
+        *err = TCP_ERR_AGAIN;
+    } else {
+        tp = lp->accept_head;
+        tcp_unlink_parent(tp);
+        tp->flags &= ~TCP_F_USER_CLOSED;
+        *err = 0;
+    }
+    tcp_unlock(flags);
+    return tp;
+}
+
+/**
+ * @brief 主动打开：发 SYN 后立即返回，连接建立时 notify
+ */
+int tcp_connect(tcp_sock_t *tp, uint32_t ip, uint16_t port) {
+    dst_cache_t rt;
+    if (ip == 0 || port == 0) {
+        return TCP_ERR_INVAL;
+    }
+    if (route_lookup(ip, NULL, &rt) < 0) {
+        return TCP_ERR_NETUNREACH;
+    }
+    net_device_t *dev = rt.dev;
+
+    uint32_t flags = tcp_lock();
+
+    if (tp->state != TCP_CLOSED) {
+        tcp_unlock(flags);
+        return TCP_ERR_INVAL;
+    }
+    if (!tp->local_ip) {
+        tp->local_ip = dev->ip_addr;
+    }
+    if (!tp->local_port) {
+        tp->local_port = tcp_ephemeral_port(tp->local_ip);
+        if (!tp->local_port) {
+            tcp_unlock(flags);
+            return TCP_ERR_ADDRINUSE;
+        }
+    }
+    if (tcp_lookup(tp->local_ip, tp->local_port, ip, port)) {
+        tcp_unlock(flags);
+        return TCP_ERR_ADDRINUSE;
+    }
+
+    tp->dev = dev;
+    tp->dst = rt;
+    tp->remote_ip = ip;
+    tp->remote_port = port;
+    tp->error = 0;
+    tp->mss = (uint16_t)(dev->mtu - IP_HDR_LEN - TCP_HDR_LEN);
+    tp->iss = tcp_new_iss(tp);
+    tp->snd_una = tp->iss;
+    tp->snd_nxt = tp->iss;
+    tp->snd_max = tp->iss;
+    tp->snd_head = 0;
+    tp->snd_len = 0;
+    tp->rcv_head = 0;
+    tp->rcv_len = 0;
+
+    tcp_set_state(tp, TCP_SYN_SENT);
+    tcp_hash_insert(tp);
+    tcp_stats.active_opens++;
+
+    tp->rtt_active = 1;
+    tp->rtt_seq = tp->iss;
+    tp->rtt_start = clock_ms();
+    tcp_xmit(tp, tp->iss, 0, TCP_SYN);
+    tp->snd_nxt = tp->iss + 1;
+    tp->snd_max = tp->snd_nxt;
+    tcp_reset_rtx_timer(tp);
+
+    tcp_unlock(flags);
+    return 0;
+}
+
+/**
+ * @brief 把数据放进发送缓冲区并尽量发出
+ * @return 放进缓冲区的字节数；缓冲区满时 TCP_ERR_AGAIN
+ */
+int tcp_send(tcp_sock_t *tp, const void *data, uint32_t len) {
+    uint32_t flags = tcp_lock();
+    int ret;
+
+    if (tp->error) {
+        ret = tp->error;
+    } else if (tp->state == TCP_SYN_SENT || tp->state == TCP_SYN_RCVD) {
+        ret = TCP_ERR_AGAIN;
+    } else if ((tp->state != TCP_ESTABLISHED && tp->state != TCP_CLOSE_WAIT) ||
+               (tp->flags & TCP_F_FIN_QUEUED)) {
+        ret = tp->state == TCP_CLOSED ? TCP_ERR_NOTCONN : TCP_ERR_PIPE;
+    } else {
+        uint32_t n = tcp_min(len, TCP_SNDBUF_SIZE - tp->snd_len);
+        if (n == 0) {
+            ret = TCP_ERR_AGAIN;
+        } else {
+            uint32_t pos = (tp->snd_head + tp->snd_len) & TCP_SNDBUF_MASK;
+            uint32_t first = tcp_min(n, TCP_SNDBUF_SIZE - pos);
+            memcpy(tp->sndbuf + pos, data, first);
+            if (n > first) {
+                memcpy(tp->sndbuf, (const uint8_t *)data + first, n - first);
+            }
+            tp->snd_len += n;
+            tcp_output(tp);
+            ret = (int)n;
+        }
+    }
+
+    tcp_unlock(flags);
+    return ret;
+}
+
+/**
+ * @brief 从接收缓冲区读数据
+ * @return 读到的字节数；0 对端已关闭；没有数据时 TCP_ERR_AGAIN
+ */
+int tcp_recv(tcp_sock_t *tp, void *buf, uint32_t len) {
+    uint32_t flags = tcp_lock();
+    int ret;
+
+    if (tp->rcv_len > 0 && len > 0) {
+        uint32_t n = tcp_min(len, tp->rcv_len);
+        uint32_t first = tcp_min(n, TCP_RCVBUF_SIZE - tp->rcv_head);
+        memcpy(buf, tp->rcvbuf + tp->rcv_head, first);
+        if (n > first) {
+            memcpy((uint8_t *)buf + first, tp->rcvbuf, n - first);
+        }
+        tp->rcv_head = (tp->rcv_head + n) & TCP_RCVBUF_MASK;
+        tp->rcv_len -= n;
+        ret = (int)n;
+
+        // 窗口张开了至少两个 MSS（或张到一半缓冲区）就马上通告
+        uint32_t adv = SEQ_GT(tp->rcv_adv, tp->rcv_nxt) ? tp->rcv_adv - tp->rcv_nxt : 0;
+        uint32_t wnd = tcp_rcv_window(tp);
+        if (tp->state >= TCP_ESTABLISHED && tp->state != TCP_TIME_WAIT &&
+            wnd > adv && (wnd - adv >= 2u * tp->mss || wnd - adv >= TCP_RCVBUF_SIZE / 2)) {
+            tcp_send_ack(tp);
+        }
+    } else if (len == 0) {
+        ret = 0;
+    } else if (tp->error) {
+        ret = tp->error;
+    } else if (tp->flags & TCP_F_RCV_FIN) {
+        ret = 0;
+    } else if (tp->state == TCP_CLOSED || tp->state == TCP_LISTEN) {
+        ret = TCP_ERR_NOTCONN;
+    } else {
+        ret = TCP_ERR_AGAIN;
+    }
+
+    tcp_unlock(flags);
+    return ret;
+}
+
+/**
+ * @brief 可读字节数（对端关闭或出错时返回 1，读的时候会立即返回）
+ */
+uint32_t tcp_readable(const tcp_sock_t *tp) {
+    if (tp->state == TCP_LISTEN) {
+        return tp->accept_head != NULL;
+    }
+    if (tp->rcv_len) {
+        return tp->rcv_len;
+    }
+    return (tp->error || (tp->flags & TCP_F_RCV_FIN) || tp->state == TCP_CLOSED) ? 1 : 0;
+}
+
+/**
+ * @brief 发送缓冲区空闲字节数（不可写的状态下返回 1，写的时候会立即返回错误）
+ */
+uint32_t tcp_writable(const tcp_sock_t *tp) {
+    if (tp->state == TCP_SYN_SENT || tp->state == TCP_SYN_RCVD) {
+        return 0;
+    }
+    if (tp->state != TCP_ESTABLISHED && tp->state != TCP_CLOSE_WAIT) {
+        return 1;
+    }
+    return TCP_SNDBUF_SIZE - tp->snd_len;
+}
+
+// 向对端发 RST（用于 abort / 关闭时还有未读数据）
+static void tcp_send_rst_conn(tcp_sock_t *tp) {
+    if (tp->state < TCP_SYN_RCVD || tp->state == TCP_TIME_WAIT) {
+        return;
+    }
+    netbuf_t *nb = netbuf_alloc(NETBUF_HEADROOM);
+    if (!nb) {
+        return;
+    }
+    tcp_stats.out_rsts++;
+    tcp_emit(&tp->dst, tp->dev, tp->remote_ip, tp->local_port, tp->remote_port,
+             tp->snd_nxt, tp->rcv_nxt, TCP_RST | TCP_ACK, 0, 0, nb);
+}
+
+// 调用者已加锁
+static void tcp_abort_locked(tcp_sock_t *tp) {
+    if (tp->state == TCP_LISTEN) {
+        // 还没 accept 的连接一起丢掉
+        for (int i = 0; i < TCP_MAX_SOCKS; i++) {
+            tcp_sock_t *child = &tcp_socks[i];
+            if (child->in_use && child->parent == tp) {
+                tcp_send_rst_conn(child);
+                tcp_done(child);
+            }
+        }
+    } else {
+        tcp_send_rst_conn(tp);
+    }
+    tp->flags |= TCP_F_USER_CLOSED;
+    if (tp->state == TCP_CLOSED) {
+        tcp_free(tp);
+    } else {
+        tcp_done(tp);
+    }
+}
+
+/**
+ * @brief 立即终止连接（发 RST）并回收
+ */
+void tcp_abort(tcp_sock_t *tp) {
+    uint32_t flags = tcp_lock();
+    tcp_abort_locked(tp);
+    tcp_unlock(flags);
+}
+
+/**
+ * @brief 关闭：发完缓冲区里的数据后发 FIN，连接结束后自动回收
+ *
+ * 还有未读数据时按 RFC 2525 直接发 RST。
+ */
+int tcp_close(tcp_sock_t *tp) {
+    uint32_t flags = tcp_lock();
+
+    switch (tp->state) {
+    case TCP_CLOSED:
+        tcp_free(tp);
+        break;
+    case TCP_LISTEN:
+    case TCP_SYN_SENT:
+    case TCP_SYN_RCVD:
+        tcp_abort_locked(tp);
+        break;
+    case TCP_ESTABLISHED:
+    case TCP_CLOSE_WAIT:
+        if (tp->rcv_len > 0) {
+            tcp_abort_locked(tp);
+            break;
+        }
+        tp->flags |= TCP_F_USER_CLOSED | TCP_F_FIN_QUEUED;
+        tcp_set_state(tp, tp->state == TCP_CLOSE_WAIT ? TCP_LAST_ACK : TCP_FIN_WAIT1);
+        tcp_output(tp);
+        break;
+    case TCP_FIN_WAIT2:
+        tp->flags |= TCP_F_USER_CLOSED;
+        timer_mod(&tp->rtx_timer, clock_ms() + TCP_FIN_WAIT2_MS);
+        break;
+    default:
+        tp->flags |= TCP_F_USER_CLOSED;
+        break;
+    }
+
+    tcp_unlock(flags);
+    return 0;
+}
+
+/**
+ * @brief 获取 TCP 统计
+ */
+void tcp_get_stats(tcp_stats_t *stats) {
+    uint32_t flags = tcp_lock();
+    *stats = tcp_stats;
+    tcp_unlock(flags);
+}
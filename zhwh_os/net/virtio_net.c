@@ -0,0 +1,737 @@
+/**
+ * @file virtio_net.c
+ * @brief virtio-net 网卡驱动实现（传统 virtio-pci，split virtqueue）
+ *
+ * 发送：每个包一条描述符链，第一个描述符指向驱动自己的 virtio 头
+ * （按链头下标存放，不占 netbuf 的头部空间），后面每个 netbuf 段一个描述符，
+ * netbuf 由驱动持有到设备放进 used 环。
+ * 接收：每个描述符挂一个整块 netbuf（零拷贝，收到后换一个新的），
+ * MRG_RXBUF 下一个包可能跨多个缓冲区，合并成一个再交给协议栈。
+ * 通知和中断都按 EVENT_IDX 抑制：设备在 used 环尾部告诉驱动
+ * "avail 到哪里再通知我"，驱动在 avail 环尾部告诉设备"used 到哪里再中断"。
+ */
+
+#include "net.h"
+#include "virtio_net.h"
+#include "checksum.h"
+#include "timer.h"
+#include "time.h"
+#include "../include/printf.h"
+#include "../include/string.h"
+#include "../include/pci.h"
+#include "../include/pci_msi.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+extern void *dma_alloc_coherent(uint32_t size, uint32_t *dma_handle);
+
+static net_device_t virtio_dev;
+static virtio_net_priv_t virtio_priv;
+static ktimer_t virtio_poll_timer;      // 没有 MSI-X 时用定时器轮询
+
+#define vp_inb(reg)         inb(virtio_priv.io_base + (reg))
+#define vp_inw(reg)         inw(virtio_priv.io_base + (reg))
+#define vp_inl(reg)         inl(virtio_priv.io_base + (reg))
+#define vp_outb(reg, val)   outb(virtio_priv.io_base + (reg), (val))
+#define vp_outw(reg, val)   outw(virtio_priv.io_base + (reg), (val))
+#define vp_outl(reg, val)   outl(virtio_priv.io_base + (reg), (val))
+
+#define virtio_has(f)       (virtio_priv.features & (f))
+
+// 发送队列会被 xmit（普通上下文）和轮询回收同时访问，关中断保护
+static inline uint32_t virtio_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void virtio_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// ==================== virtqueue ====================
+
+/**
+ * @brief 分配并登记一个队列（传统接口：队列大小由设备决定，内存按页对齐）
+ */
+static int virtqueue_setup(virtqueue_t *vq, uint16_t index) {
+    vp_outw(VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t num = vp_inw(VIRTIO_PCI_QUEUE_NUM);
+    if (num == 0 || num > VIRTIO_QUEUE_MAX || (num & (num - 1))) {
+        printf("[virtio-net] queue %d: bad size %d\n", index, num);
+        return -1;
+    }
+    if (vp_inl(VIRTIO_PCI_QUEUE_PFN)) {
+        printf("[virtio-net] queue %d already in use\n", index);
+        return -1;
+    }
+
+    // 描述符表 + avail 环（含 used_event），对齐到页后是 used 环（含 avail_event）
+    uint32_t avail_off = num * sizeof(vring_desc_t);
+    uint32_t used_off = (avail_off + 6 + 2 * num + VIRTIO_PCI_VRING_ALIGN - 1) &
+                        ~(VIRTIO_PCI_VRING_ALIGN - 1);
+    uint32_t size = used_off + 6 + sizeof(vring_used_elem_t) * num;
+
+    // dma_alloc_coherent 只保证 64 字节对齐，多要一页自己对齐
+    uint32_t dma;
+    uint8_t *mem = dma_alloc_coherent(size + VIRTIO_PCI_VRING_ALIGN, &dma);
+    if (!mem) {
+        printf("[virtio-net] queue %d: out of DMA memory\n", index);
+        return -1;
+    }
+    uint32_t pad = ((dma + VIRTIO_PCI_VRING_ALIGN - 1) & ~(VIRTIO_PCI_VRING_ALIGN - 1)) - dma;
+    mem += pad;
+    dma += pad;
+    memset(mem, 0, size);
+
+    memset(vq, 0, sizeof(*vq));
+    vq->index = index;
+    vq->num = num;
+    vq->desc = (volatile vring_desc_t *)mem;
+    vq->avail = (volatile vring_avail_t *)(mem + avail_off);
+    vq->used = (volatile vring_used_t *)(mem + used_off);
+    vq->used_event = &vq->avail->ring[num];
+    vq->avail_event = (volatile uint16_t *)&vq->used->ring[num];
+
+    // 空闲描述符串成一条链，分配时顺着 next 取
+    for (uint16_t i = 0; i < num - 1; i++) {
+        vq->desc[i].next = i + 1;
+    }
+    vq->free_head = 0;
+    vq->num_free = num;
+
+    vp_outl(VIRTIO_PCI_QUEUE_PFN, dma >> 12);
+
+    if (virtio_priv.msix) {
+        vp_outw(VIRTIO_MSI_QUEUE_VECTOR, 0);
+        if (vp_inw(VIRTIO_MSI_QUEUE_VECTOR) == VIRTIO_MSI_NO_VECTOR) {
+            printf("[virtio-net] queue %d: MSI-X vector rejected\n", index);
+            return -1;
+        }
+    }
+
+    printf("[virtio-net] queue %d: %d entries, phys 0x%x\n", index, num, dma);
+    return 0;
+}
+
+/**
+ * @brief 把一条描述符链交给设备（只更新 avail 环，不通知）
+ */
+static void virtqueue_publish(virtqueue_t *vq, uint16_t head) {
+    vq->avail->ring[vq->avail_idx & (vq->num - 1)] = head;
+    // 描述符和 avail 环内容必须先于 avail->idx 对设备可见
+    asm volatile("sfence" ::: "memory");
+    vq->avail_idx++;
+    vq->avail->idx = vq->avail_idx;
+    vq->pending++;
+}
+
+/**
+ * @brief 通知设备处理新挂上的描述符
+ *
+ * EVENT_IDX 下设备在 avail_event 里写着"avail 走过这里再通知我"，
+ * 上次通知以来新增的区间没有跨过它就省掉这次 I/O 写（VM exit）。
+ */
+static void virtqueue_kick(virtqueue_t *vq) {
+    if (vq->avail_idx == vq->kicked_idx) {
+        return;
+    }
+
+    // avail->idx 必须先于读取 avail_event / used->flags
+    asm volatile("mfence" ::: "memory");
+    uint16_t old = vq->kicked_idx;
+    uint16_t new_idx = vq->avail_idx;
+    int need = virtio_has(VIRTIO_RING_F_EVENT_IDX)
+        ? vring_need_event(*vq->avail_event, new_idx, old)
+        : !(vq->used->flags & VRING_USED_F_NO_NOTIFY);
+
+    vq->kicked_idx = new_idx;
+    vq->pending = 0;
+    if (need) {
+        vp_outw(VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+        if (vq->index == VIRTIO_NET_TXQ) {
+            virtio_priv.tx_kicks++;
+        }
+    } else if (vq->index == VIRTIO_NET_TXQ) {
+        virtio_priv.tx_kicks_suppressed++;
+    }
+}
+
+/**
+ * @brief 关闭队列中断
+ *
+ * EVENT_IDX 下没有开关位，把 used_event 设成已经过去的位置，
+ * 设备要回绕一圈才会再碰到它。
+ */
+static void virtqueue_disable_cb(virtqueue_t *vq) {
+    if (virtio_has(VIRTIO_RING_F_EVENT_IDX)) {
+        *vq->used_event = vq->last_used_idx - 1;
+    } else {
+        vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+    }
+}
+
+/**
+ * @brief 要求设备在下一个 used 表项之后中断
+ * @return 1 表示打开之前已经有新的 used 表项，调用者应再处理一次
+ */
+static int virtqueue_enable_cb(virtqueue_t *vq) {
+    if (virtio_has(VIRTIO_RING_F_EVENT_IDX)) {
+        *vq->used_event = vq->last_used_idx;
+    } else {
+        vq->avail->flags = 0;
+    }
+    asm volatile("mfence" ::: "memory");
+    return vq->used->idx != vq->last_used_idx;
+}
+
+// ==================== 发送 ====================
+
+/**
+ * @brief 回收设备已发送完的描述符链并释放 netbuf。调用者已关中断。
+ */
+static int virtio_tx_clean_locked(void) {
+    virtqueue_t *vq = &virtio_priv.txq;
+    int cleaned = 0;
+
+    while (vq->last_used_idx != vq->used->idx) {
+        asm volatile("lfence" ::: "memory");
+        uint16_t head = (uint16_t)vq->used->ring[vq->last_used_idx & (vq->num - 1)].id;
+        vq->last_used_idx++;
+
+        // 整条链还回空闲链表
+        uint16_t last = head;
+        uint16_t n = 1;
+        while (vq->desc[last].flags & VRING_DESC_F_NEXT) {
+            last = vq->desc[last].next;
+            n++;
+        }
+        vq->desc[last].next = vq->free_head;
+        vq->free_head = head;
+        vq->num_free += n;
+
+        if (vq->bufs[head]) {
+            netbuf_free(vq->bufs[head]);
+            vq->bufs[head] = NULL;
+        }
+        cleaned++;
+    }
+    return cleaned;
+}
+
+static void virtio_tx_kick_locked(void) {
+    virtqueue_t *vq = &virtio_priv.txq;
+
+    virtqueue_kick(vq);
+    // 已提交的包全部发完时来一次中断，及时把 netbuf 还给缓冲池
+    if (virtio_has(VIRTIO_RING_F_EVENT_IDX)) {
+        *vq->used_event = vq->avail_idx - 1;
+    }
+}
+
+/**
+ * @brief 批量发送结束时由 net_tx_batch_end() 调用
+ */
+static void virtio_tx_flush(net_device_t *dev) {
+    uint32_t flags = virtio_lock();
+    virtio_tx_kick_locked();
+    virtio_unlock(flags);
+}
+
+/**
+ * @brief 填写发送方向的 virtio 头
+ *
+ * CSUM_PARTIAL 的包 L4 校验和字段里已经是伪头部和，设备从 csum_start
+ * 累加到包尾写回 csum_start + csum_offset；设备不管 IP 头校验和，这里补上。
+ */
+static void virtio_tx_hdr(virtio_net_hdr_t *hdr, netbuf_t *nb) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+
+    if (nb->ip_summed != NETBUF_CSUM_PARTIAL) {
+        return;
+    }
+    ip_hdr_t *ip = (ip_hdr_t *)nb->net_hdr;
+    ip->ip_sum = 0;
+    ip->ip_sum = ip_fast_csum(ip, ip->ip_verhlen & 0x0F);
+
+    hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    hdr->csum_start = (uint16_t)(nb->trans_hdr - nb->data);
+    hdr->csum_offset = nb->csum_offset;
+}
+
+/**
+ * @brief virtio-net netbuf 发送函数（零拷贝，分散/聚集）
+ *
+ * 链头描述符指向 tx_hdrs[head]，之后每个非空段一个描述符。
+ * 不在批量发送中就立即通知；批量发送中攒够 VIRTIO_NET_TX_BATCH 个包
+ * 或者描述符快用完时也通知一次。
+ */
+static int virtio_net_xmit(net_device_t *dev, netbuf_t *nb) {
+    virtqueue_t *vq = &virtio_priv.txq;
+    uint16_t nsegs = 0;
+    uint32_t total = 0;
+    for (netbuf_t *seg = nb; seg; seg = seg->frag) {
+        if (seg->len) {
+            nsegs++;
+            total += seg->len;
+        }
+    }
+
+    if (!nsegs || total > ETH_HDR_LEN + dev->mtu || nsegs + 1 > vq->num / 2) {
+        printf("[virtio-net] Invalid xmit length %d (%d segments)\n", total, nsegs);
+        netbuf_free(nb);
+        return -1;
+    }
+
+    uint32_t flags = virtio_lock();
+    if (vq->num_free < nsegs + 1) {
+        virtio_tx_clean_locked();
+    }
+    if (vq->num_free < nsegs + 1) {
+        // 队列满：先把攒着的包交给设备，nb 还给 qdisc 等回收后重新出队
+        virtio_tx_kick_locked();
+        virtio_priv.tx_busy++;
+        virtio_unlock(flags);
+        return NET_XMIT_BUSY;
+    }
+
+    uint16_t head = vq->free_head;
+    virtio_net_hdr_t *hdr = &virtio_priv.tx_hdrs[head];
+    virtio_tx_hdr(hdr, nb);
+
+    vq->desc[head].addr = virtio_priv.tx_hdrs_dma + head * sizeof(virtio_net_hdr_t);
+    vq->desc[head].addr_hi = 0;
+    vq->desc[head].len = virtio_priv.hdr_len;
+    vq->desc[head].flags = VRING_DESC_F_NEXT;
+
+    // 顺着空闲链往下取，next 字段已经连好了
+    uint16_t idx = head;
+    uint16_t left = nsegs;
+    for (netbuf_t *seg = nb; seg; seg = seg->frag) {
+        if (!seg->len) {
+            continue;
+        }
+        idx = vq->desc[idx].next;
+        vq->desc[idx].addr = netbuf_dma(seg);
+        vq->desc[idx].addr_hi = 0;
+        vq->desc[idx].len = seg->len;
+        vq->desc[idx].flags = --left ? VRING_DESC_F_NEXT : 0;
+    }
+    vq->free_head = vq->desc[idx].next;
+    vq->num_free -= nsegs + 1;
+    vq->bufs[head] = nb;
+
+    virtqueue_publish(vq, head);
+    virtio_priv.tx_packets++;
+
+    if (!net_tx_batching() || vq->pending >= VIRTIO_NET_TX_BATCH ||
+        vq->num_free < vq->num / 4) {
+        virtio_tx_kick_locked();
+    }
+    virtio_unlock(flags);
+    return 0;
+}
+
+// ==================== 接收 ====================
+
+/**
+ * @brief 把 netbuf 挂到接收描述符 id 上（RX 描述符和下标一一对应，不走空闲链）
+ */
+static void virtio_rx_post(uint16_t id, netbuf_t *nb) {
+    virtqueue_t *vq = &virtio_priv.rxq;
+
+    vq->bufs[id] = nb;
+    vq->desc[id].addr = nb->dma;
+    vq->desc[id].addr_hi = 0;
+    vq->desc[id].len = NETBUF_DATA_SIZE;
+    vq->desc[id].flags = VRING_DESC_F_WRITE;
+    virtqueue_publish(vq, id);
+}
+
+/**
+ * @brief 取出下一个已填充的接收缓冲区，槽位换上新 netbuf
+ * @param hdr 非 NULL 时这是包的第一个缓冲区：把开头的 virtio 头拷出来
+ *            （即使本包要丢弃，也得知道后面还有几个缓冲区）并从数据里去掉；
+ *            没协商 MRG_RXBUF 时头短两个字节，num_buffers 按 1 填
+ * @param queue 非 NULL 且整个包就在这一个缓冲区里时，换缓冲区之前先跑接收过滤，
+ *              结果（积压队列号或 NET_RX_FILTER_DROP）写到这里
+ * @return 填好数据的 netbuf；长度不对、被过滤或缓冲池耗尽时旧缓冲区留在环上，返回 NULL
+ */
+static netbuf_t *virtio_rx_take(virtio_net_hdr_t *hdr, int *queue) {
+    virtqueue_t *vq = &virtio_priv.rxq;
+
+    asm volatile("lfence" ::: "memory");
+    volatile vring_used_elem_t *e = &vq->used->ring[vq->last_used_idx & (vq->num - 1)];
+    uint16_t id = (uint16_t)e->id;
+    uint32_t len = e->len;
+    vq->last_used_idx++;
+
+    netbuf_t *nb = vq->bufs[id];
+    uint32_t hdr_len = virtio_priv.hdr_len;
+    uint32_t min_len = 0;
+    if (hdr) {
+        memcpy(hdr, nb->data, hdr_len);
+        if (hdr_len < sizeof(*hdr)) {
+            hdr->num_buffers = 1;
+        }
+        min_len = hdr_len + ETH_HDR_LEN;
+    }
+
+    if (hdr && queue && len >= min_len && len <= NETBUF_DATA_SIZE &&
+        !(virtio_has(VIRTIO_NET_F_MRG_RXBUF) && hdr->num_buffers > 1)) {
+        *queue = net_rx_filter(&virtio_dev, nb->data + hdr_len, len - hdr_len);
+        if (*queue == NET_RX_FILTER_DROP) {
+            virtio_rx_post(id, nb);
+            return NULL;
+        }
+    }
+
+    netbuf_t *fresh = NULL;
+    if (len < min_len || len > NETBUF_DATA_SIZE || !(fresh = netbuf_alloc(0))) {
+        virtio_rx_post(id, nb);
+        return NULL;
+    }
+    virtio_rx_post(id, fresh);
+    netbuf_put(nb, len);
+    if (hdr) {
+        netbuf_pull(nb, hdr_len);
+    }
+    return nb;
+}
+
+/**
+ * @brief 根据 virtio 头标记接收校验和
+ *
+ * DATA_VALID：设备已校验。NEEDS_CSUM：包来自同一宿主机、只带伪头部和，
+ * 在这里补全校验和后同样可以信任。
+ */
+static void virtio_rx_csum(const virtio_net_hdr_t *hdr, netbuf_t *nb) {
+    if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+        uint32_t start = hdr->csum_start;
+        if (start + hdr->csum_offset + 2 > nb->len) {
+            return;
+        }
+        uint16_t *field = (uint16_t *)(nb->data + start + hdr->csum_offset);
+        *field = csum_fold(csum_partial(nb->data + start, nb->len - start, 0));
+        nb->ip_summed = NETBUF_CSUM_UNNECESSARY;
+        virtio_priv.rx_csum_sw++;
+    } else if ((hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID) &&
+               (virtio_dev.features & NETIF_F_RXCSUM)) {
+        nb->ip_summed = NETBUF_CSUM_UNNECESSARY;
+    }
+}
+
+/**
+ * @brief 处理接收队列（NAPI poll 调用）
+ *
+ * 每个包的第一个缓冲区开头是 virtio 头，num_buffers 说明这个包
+ * 一共用了几个缓冲区；后续缓冲区挂到 frag 链上再合并成一个 netbuf。
+ * 合并不下（超过一个 netbuf）或中途缺缓冲区时整包丢弃。
+ * @return 处理的包数
+ */
+static int virtio_net_recv(net_device_t *dev, int budget) {
+    virtqueue_t *vq = &virtio_priv.rxq;
+    int work = 0;
+
+    while (work < budget && vq->last_used_idx != vq->used->idx) {
+        virtio_net_hdr_t hdr;
+        int queue = 0;
+        netbuf_t *nb = virtio_rx_take(&hdr, &queue);
+        work++;
+
+        uint16_t nbufs = 1;
+        if (virtio_has(VIRTIO_NET_F_MRG_RXBUF) && hdr.num_buffers > 1) {
+            nbufs = hdr.num_buffers;
+        }
+
+        // 设备先写完一个包的全部 used 表项再更新 used->idx，后续缓冲区一定已经在环上
+        for (uint16_t i = 1; i < nbufs && vq->last_used_idx != vq->used->idx; i++) {
+            netbuf_t *seg = virtio_rx_take(NULL, NULL);
+            if (nb && seg) {
+                netbuf_frag_append(nb, seg);
+            } else {
+                // 缺了其中一段：整包丢弃，剩下的缓冲区照样取出来
+                if (seg) {
+                    netbuf_free(seg);
+                }
+                if (nb) {
+                    netbuf_free(nb);
+                    nb = NULL;
+                }
+            }
+        }
+
+        if (nb && nb->frag) {
+            virtio_priv.rx_merged++;
+            if (netbuf_linearize(nb) < 0) {
+                netbuf_free(nb);
+                nb = NULL;
+            } else if ((queue = net_rx_filter(dev, nb->data, nb->len)) == NET_RX_FILTER_DROP) {
+                // 跨缓冲区的包只能合并后再过滤
+                netbuf_free(nb);
+                nb = NULL;
+            }
+        }
+
+        if (queue == NET_RX_FILTER_DROP) {
+            virtio_priv.rx_filtered++;
+            continue;
+        }
+        if (!nb) {
+            virtio_priv.rx_dropped++;
+            continue;
+        }
+
+        virtio_rx_csum(&hdr, nb);
+        nb->rx_queue = (uint8_t)queue;
+        net_rx_enqueue(dev, nb);
+        virtio_priv.rx_packets++;
+    }
+
+    if (work) {
+        virtqueue_kick(vq);
+    }
+    return work;
+}
+
+/**
+ * @brief NAPI 轮询：先回收发送队列，再最多收 budget 个包
+ *
+ * 收空后重新打开接收中断；打开前又来的包立即再排一次轮询。
+ */
+static int virtio_net_poll(net_device_t *dev, int budget) {
+    uint32_t flags = virtio_lock();
+    int cleaned = virtio_tx_clean_locked();
+    virtio_unlock(flags);
+    if (cleaned > 0) {
+        net_tx_wake(dev);
+    }
+
+    int work = virtio_net_recv(dev, budget);
+    if (work < budget) {
+        net_napi_complete(dev);
+        if (virtio_priv.msix && virtqueue_enable_cb(&virtio_priv.rxq)) {
+            virtqueue_disable_cb(&virtio_priv.rxq);
+            net_napi_schedule(dev);
+        }
+    }
+    return work;
+}
+
+/**
+ * @brief virtio-net 中断处理（MSI-X，两个队列共用一个向量）
+ */
+void virtio_net_isr(void) {
+    virtio_priv.intr_count++;
+    // 收包交给 net_rx_action() 按预算轮询，收空后再打开
+    virtqueue_disable_cb(&virtio_priv.rxq);
+    net_napi_schedule(&virtio_dev);
+}
+
+static void virtio_poll_timer_fn(ktimer_t *t) {
+    net_napi_schedule(&virtio_dev);
+    timer_mod(t, clock_ms() + VIRTIO_NET_POLL_MS);
+}
+
+// ==================== 初始化 ====================
+
+/**
+ * @brief 打开 MSI-X，失败时用定时器轮询
+ */
+static void virtio_net_setup_irq(pci_dev_t *pci_dev) {
+    static const uint8_t vectors[] = { VIRTIO_NET_MSIX_VECTOR };
+
+    if (pci_enable_msix(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, vectors, 1) == 0) {
+        virtio_priv.msix = 1;
+        // 配置变化（链路状态）不要中断
+        vp_outw(VIRTIO_MSI_CONFIG_VECTOR, VIRTIO_MSI_NO_VECTOR);
+        printf("[virtio-net] MSI-X vector 0x%02x\n", VIRTIO_NET_MSIX_VECTOR);
+    } else {
+        virtio_priv.msix = 0;
+        printf("[virtio-net] No MSI-X, polling every %d ms\n", VIRTIO_NET_POLL_MS);
+    }
+}
+
+/**
+ * @brief 初始化 virtio-net 设备
+ */
+static int virtio_net_init_dev(pci_dev_t *pci_dev, const char *dev_name) {
+    printf("[virtio-net] Initializing device %s\n", dev_name);
+
+    uint32_t bar0 = pci_read_config_dword(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, PCI_BAR0);
+    if (!(bar0 & 0x1)) {
+        printf("[virtio-net] BAR0 is not an I/O BAR (modern-only device?)\n");
+        return -1;
+    }
+    memset(&virtio_priv, 0, sizeof(virtio_priv));
+    virtio_priv.io_base = (uint16_t)(bar0 & ~0x3);
+    virtio_priv.irq = pci_read_config_byte(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, 0x3C);
+    printf("[virtio-net] I/O base = 0x%x\n", virtio_priv.io_base);
+
+    // I/O 空间 + 总线主控
+    uint16_t cmd = pci_read_config_word(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, PCI_COMMAND);
+    cmd |= (1 << 0) | (1 << 2);
+    pci_write_config_word(pci_dev->bus_id, pci_dev->dev_id, pci_dev->fn_id, PCI_COMMAND, cmd);
+
+    if (netbuf_pool_init() < 0) {
+        return -1;
+    }
+
+    // 1. 复位，然后 ACKNOWLEDGE -> DRIVER
+    vp_outb(VIRTIO_PCI_STATUS, 0);
+    vp_outb(VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    vp_outb(VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    // 2. 特性协商（传统接口没有 FEATURES_OK，写进去即生效）
+    uint32_t host = vp_inl(VIRTIO_PCI_HOST_FEATURES);
+    virtio_priv.features = host & VIRTIO_NET_FEATURES;
+    vp_outl(VIRTIO_PCI_GUEST_FEATURES, virtio_priv.features);
+    printf("[virtio-net] features: host=0x%08x guest=0x%08x\n", host, virtio_priv.features);
+    virtio_priv.hdr_len = virtio_has(VIRTIO_NET_F_MRG_RXBUF) ? sizeof(virtio_net_hdr_t)
+                                                              : VIRTIO_NET_HDR_LEGACY_LEN;
+
+    // 3. 中断：MSI-X 打开后设备配置空间的位置会变，必须先于读 MAC
+    virtio_net_setup_irq(pci_dev);
+
+    // 4. 队列
+    if (virtqueue_setup(&virtio_priv.rxq, VIRTIO_NET_RXQ) < 0 ||
+        virtqueue_setup(&virtio_priv.txq, VIRTIO_NET_TXQ) < 0) {
+        vp_outb(VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    virtio_priv.tx_hdrs = dma_alloc_coherent(sizeof(virtio_net_hdr_t) * virtio_priv.txq.num,
+                                             &virtio_priv.tx_hdrs_dma);
+    if (!virtio_priv.tx_hdrs) {
+        vp_outb(VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    // 5. MAC 地址
+    uint16_t cfg = VIRTIO_PCI_CONFIG(virtio_priv.msix);
+    if (virtio_has(VIRTIO_NET_F_MAC)) {
+        for (int i = 0; i < ETH_ALEN; i++) {
+            virtio_priv.mac_addr[i] = vp_inb(cfg + i);
+        }
+    } else {
+        static const uint8_t fallback_mac[ETH_ALEN] = { 0x52, 0x54, 0x00, 0x12, 0x34, 0x57 };
+        memcpy(virtio_priv.mac_addr, fallback_mac, ETH_ALEN);
+    }
+    printf("[virtio-net] MAC = %02x:%02x:%02x:%02x:%02x:%02x\n",
+           virtio_priv.mac_addr[0], virtio_priv.mac_addr[1], virtio_priv.mac_addr[2],
+           virtio_priv.mac_addr[3], virtio_priv.mac_addr[4], virtio_priv.mac_addr[5]);
+    if (virtio_has(VIRTIO_NET_F_STATUS)) {
+        uint16_t link = vp_inw(cfg + ETH_ALEN);
+        printf("[virtio-net] Link %s\n", (link & VIRTIO_NET_S_LINK_UP) ? "up" : "down");
+    }
+
+    // 6. 接收队列挂缓冲区：队列往往比 netbuf 池还大，只挂 VIRTIO_NET_RX_BUFS 个
+    uint16_t rx_bufs = virtio_priv.rxq.num < VIRTIO_NET_RX_BUFS
+        ? virtio_priv.rxq.num : VIRTIO_NET_RX_BUFS;
+    for (uint16_t i = 0; i < rx_bufs; i++) {
+        netbuf_t *nb = netbuf_alloc(0);
+        if (!nb) {
+            printf("[virtio-net] RX ring: only %d buffers posted\n", i);
+            break;
+        }
+        virtio_rx_post(i, nb);
+    }
+    if (!virtio_priv.msix) {
+        virtqueue_disable_cb(&virtio_priv.rxq);
+        virtqueue_disable_cb(&virtio_priv.txq);
+    }
+
+    // 7. 初始化网络设备结构并注册
+    memset(&virtio_dev, 0, sizeof(virtio_dev));
+    strcpy(virtio_dev.name, dev_name);
+    memcpy(virtio_dev.mac_addr, virtio_priv.mac_addr, ETH_ALEN);
+    virtio_dev.mtu = ETH_MTU;
+    virtio_dev.send = NULL;
+    virtio_dev.xmit = virtio_net_xmit;
+    virtio_dev.recv = NULL;
+    virtio_dev.poll = virtio_net_poll;
+    virtio_dev.tx_flush = virtio_tx_flush;
+    virtio_dev.features = NETIF_F_SG;
+    if (virtio_has(VIRTIO_NET_F_CSUM)) {
+        virtio_dev.features |= NETIF_F_IP_CSUM;
+    }
+    if (virtio_has(VIRTIO_NET_F_GUEST_CSUM)) {
+        virtio_dev.features |= NETIF_F_RXCSUM;
+    }
+    virtio_dev.ioctl = NULL;
+    virtio_dev.priv = &virtio_priv;
+    virtio_dev.pci_dev = pci_dev;
+
+    if (net_device_register(&virtio_dev) < 0) {
+        printf("[virtio-net] Failed to register device\n");
+        vp_outb(VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    // 8. DRIVER_OK 之后设备才开始处理队列
+    vp_outb(VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER |
+                               VIRTIO_STATUS_DRIVER_OK);
+    virtqueue_kick(&virtio_priv.rxq);
+
+    if (!virtio_priv.msix) {
+        timer_setup(&virtio_poll_timer, virtio_poll_timer_fn, NULL);
+        timer_mod(&virtio_poll_timer, clock_ms() + VIRTIO_NET_POLL_MS);
+    }
+
+    printf("[virtio-net] Device registered as %s\n", dev_name);
+    return 0;
+}
+
+/**
+ * @brief virtio-net 初始化（从 PCI 设备列表探测第一块 virtio-net）
+ */
+int virtio_net_init(const char *dev_name) {
+    printf("[virtio-net] virtio-net driver init\n");
+
+    if (virtio_dev.name[0]) {
+        printf("[virtio-net] Already initialized as %s\n", virtio_dev.name);
+        return -1;
+    }
+
+    pci_dev_t **devices = pci_get_devices();
+    for (unsigned i = 0; devices[i] != NULL; i++) {
+        pci_dev_t *dev = devices[i];
+        if (dev->header.vendor_id == VIRTIO_VENDOR_ID &&
+            dev->header.device_id == VIRTIO_NET_DEVICE_ID) {
+            printf("[virtio-net] Found device at %d:%d.%d\n",
+                   dev->bus_id, dev->dev_id, dev->fn_id);
+            return virtio_net_init_dev(dev, dev_name);
+        }
+    }
+
+    printf("[virtio-net] No virtio-net device found\n");
+    return -1;
+}
+
+/**
+ * @brief 打印队列状态和统计
+ */
+void virtio_net_dump(void) {
+    virtqueue_t *rx = &virtio_priv.rxq;
+    virtqueue_t *tx = &virtio_priv.txq;
+
+    if (!virtio_dev.name[0]) {
+        printf("[virtio-net] Not initialized\n");
+        return;
+    }
+    printf("\n=== virtio-net %s ===\n", virtio_dev.name);
+    printf("features 0x%08x, %u-byte header, %s\n", virtio_priv.features,
+           virtio_priv.hdr_len, virtio_priv.msix ? "MSI-X" : "polling");
+    printf("RX: avail %d used %d/%d, packets %u merged %u dropped %u filtered %u sw-csum %u\n",
+           rx->avail_idx, rx->last_used_idx, rx->used->idx,
+           virtio_priv.rx_packets, virtio_priv.rx_merged,
+           virtio_priv.rx_dropped, virtio_priv.rx_filtered, virtio_priv.rx_csum_sw);
+    printf("TX: avail %d used %d/%d free %d, packets %u busy %u\n",
+           tx->avail_idx, tx->last_used_idx, tx->used->idx, tx->num_free,
+           virtio_priv.tx_packets, virtio_priv.tx_busy);
+    printf("TX kicks %u, suppressed %u; interrupts %u\n",
+           virtio_priv.tx_kicks, virtio_priv.tx_kicks_suppressed, virtio_priv.intr_count);
+}
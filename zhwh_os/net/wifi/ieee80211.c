@@ -432,5 +432,12 @@ int wifi_rx_packet(net_device_t *dev, uint8_t *data, uint32_t len) {
     }
 
     // 否则假设是 802.3 以太网帧（经过转换）
-    return eth_input(dev, data, len);
+    netbuf_t *nb = netbuf_from(data, len, 0);
+    if (!nb) {
+        return -1;
+    }
+    nb->dev = dev;
+    int ret = eth_input(dev, nb);
+    netbuf_free(nb);
+    return ret;
 }
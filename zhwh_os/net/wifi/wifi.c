@@ -9,6 +9,8 @@
 
 #include "types.h"
 #include "net.h"
+#include "route.h"
+#include "softirq.h"
 #include "net/wifi/atheros.h"
 #include "net/wifi/reg.h"
 #include "net/wifi/hw.h"
@@ -47,6 +49,8 @@ static net_device_t atheros_dev = {0};
 static dma_channel_t *atheros_tx_channel = NULL;
 static dma_channel_t *atheros_rx_channel = NULL;
 
+static void atheros_rx_softirq(void);
+
 // ==================== 辅助函数 ====================
 
 /**
@@ -593,6 +597,8 @@ int atheros_init_dev(pci_dev_t *pci_dev) {
 int atheros_init(void) {
     // printf("[atheros] Atheros WiFi driver init\n");
 
+    open_softirq(WIFI_SOFTIRQ, atheros_rx_softirq);
+
     // 获取 PCI 设备列表
     pci_dev_t **devices = pci_get_devices();
 
@@ -639,9 +645,6 @@ int atheros_init(void) {
     memset(&atheros_dev, 0, sizeof(atheros_dev));
     strcpy(atheros_dev.name, "wlan0");
     memcpy(atheros_dev.mac_addr, atheros_priv.mac_addr, ETH_ALEN);
-    atheros_dev.ip_addr = 0xC0A85816;  // 192.168.88.22（你的 WiFi IP）
-    atheros_dev.netmask = 0xFFFFFF00; // 255.255.255.0
-    atheros_dev.gateway = 0xC0A858CB;  // 192.168.88.203（你的 DNS）
     atheros_dev.mtu = 1500;
     atheros_dev.priv = &atheros_priv;
     atheros_dev.send = atheros_send;
@@ -653,6 +656,12 @@ int atheros_init(void) {
         return -1;
     }
 
+    // 注册时拿到的是全局默认地址，换成 WiFi 网段（同时生成 wlan0 的直连和默认路由）
+    net_device_set_addr(&atheros_dev,
+                        0xC0A85816,    // 192.168.88.22（你的 WiFi IP）
+                        0xFFFFFF00,    // 255.255.255.0
+                        0xC0A858CB);   // 192.168.88.203（你的 DNS）
+
     // printf("[atheros] WiFi device registered successfully\n");
     // printf("[atheros]   Device: wlan0\n");
     // printf("[atheros]   MAC: ");
@@ -975,8 +984,29 @@ void wifi_show_stats(void) {
     // printf("\n");
 }
 
+/**
+ * @brief WIFI_SOFTIRQ：从 DMA RX 通道取出所有帧交给 802.11 层（开中断执行）
+ */
+static void atheros_rx_softirq(void) {
+    if (!atheros_priv.rx_channel) {
+        return;
+    }
+
+    uint8_t rx_buf[ATHEROS_RX_BUF_SIZE];
+    uint32_t rx_len;
+
+    while (atheros_dma_rx_avail(atheros_priv.rx_channel) > 0) {
+        if (atheros_dma_rx_recv(atheros_priv.rx_channel, rx_buf, &rx_len) > 0) {
+            wifi_input_80211(&atheros_dev, rx_buf, rx_len);
+        }
+    }
+}
+
 /**
  * @brief WiFi 中断处理函数
+ *
+ * Atheros 只在这里应答中断，收帧在 WIFI_SOFTIRQ 里做；
+ * Intel 固件启动阶段的命令响应仍在这里同步处理（固件握手依赖它）。
  */
 void atheros_interrupt_handler(void) {
     // 🔥🔥🔥 第一时间打印：证明中断处理函数被调用
@@ -1105,22 +1135,10 @@ void atheros_interrupt_handler(void) {
     }
 
     // Atheros 网卡的中断处理
-    // 处理接收中断
+    // 接收中断：取帧和 802.11 处理放到 WIFI_SOFTIRQ（atheros_rx_softirq）
     if (int_status & ATHEROS_INT_RX) {
         atheros_priv.rx_int_count++;
-
-        // 从 DMA RX 通道读取数据包
-        uint8_t rx_buf[ATHEROS_RX_BUF_SIZE];
-        uint32_t rx_len;
-
-        while (atheros_dma_rx_avail(atheros_priv.rx_channel) > 0) {
-            if (atheros_dma_rx_recv(atheros_priv.rx_channel, rx_buf, &rx_len) > 0) {
-                // printf("[atheros] RX interrupt: %d bytes\n", rx_len);
-
-                // 处理 802.11 帧
-                wifi_input_80211(&atheros_dev, rx_buf, rx_len);
-            }
-        }
+        raise_softirq(WIFI_SOFTIRQ);
     }
 
     // 处理发送完成中断
@@ -34,6 +34,16 @@
 #define MSI_CTRL_64BIT  (1 << 7)     // 64-bit Address Capable
 #define MSI_CTRL_MASK   (1 << 8)     // Per-Vector Masking Capable
 
+// MSI-X（capability 0x11）
+#define PCI_CAP_ID_MSIX         0x11
+#define MSIX_CAP_CTRL           0x02
+#define MSIX_CAP_TABLE          0x04  // Table Offset / BIR
+#define MSIX_CTRL_TABLE_SIZE    0x07FF
+#define MSIX_CTRL_FUNC_MASK     (1 << 14)
+#define MSIX_CTRL_ENABLE        (1 << 15)
+#define MSIX_ENTRY_SIZE         16
+#define MSIX_ENTRY_MASKED       (1 << 0)
+
 // MSI 地址（LAPIC）
 #define MSI_ADDRESS_BASE 0xFEE00000
 
@@ -251,6 +261,105 @@ void pci_disable_msi(unsigned bus, unsigned dev, unsigned func) {
     }
 }
 
+/**
+ * @brief 启用 PCI 设备的 MSI-X 中断
+ *
+ * MSI-X 表在某个内存 BAR 里（由 capability 的 Table Offset/BIR 指出），
+ * 每项 16 字节：地址低/高 32 位、数据、向量控制（bit 0 = 屏蔽）。
+ * 表项 i 投递到 apic_ids[i] 那个 CPU 的 vectors[i]，其余表项保持屏蔽。
+ *
+ * @param vectors 每个表项对应的中断向量
+ * @param apic_ids 每个表项的目标 LAPIC ID，NULL 表示全部投递给当前 CPU
+ * @param nvec 使用的表项数
+ * @return 成功返回 0，失败返回 -1（没有 MSI-X 或表项不够）
+ */
+int pci_enable_msix_affinity(unsigned bus, unsigned dev, unsigned func,
+                             const uint8_t *vectors, const uint8_t *apic_ids, int nvec) {
+    uint16_t status = pci_read_config_word(bus, dev, func, 0x06);
+    if (!(status & PCI_STATUS_CAP_LIST) || nvec <= 0) {
+        return -1;
+    }
+
+    uint8_t cap_ptr = pci_read_config_byte(bus, dev, func, 0x34) & 0xFC;
+    uint8_t msix_cap = 0;
+    while (cap_ptr != 0) {
+        if (pci_read_config_byte(bus, dev, func, cap_ptr) == PCI_CAP_ID_MSIX) {
+            msix_cap = cap_ptr;
+            break;
+        }
+        cap_ptr = pci_read_config_byte(bus, dev, func, cap_ptr + 1) & 0xFC;
+    }
+    if (msix_cap == 0) {
+        printf("[MSI-X] capability not found\n");
+        return -1;
+    }
+
+    uint16_t ctrl = pci_read_config_word(bus, dev, func, msix_cap + MSIX_CAP_CTRL);
+    int table_size = (ctrl & MSIX_CTRL_TABLE_SIZE) + 1;
+    if (nvec > table_size) {
+        printf("[MSI-X] need %d vectors, table has %d\n", nvec, table_size);
+        return -1;
+    }
+
+    uint32_t table = pci_read_config_dword(bus, dev, func, msix_cap + MSIX_CAP_TABLE);
+    uint32_t bir = table & 0x7;
+    uint32_t bar = pci_read_config_dword(bus, dev, func, 0x10 + bir * 4);
+    if (bar & 0x1) {
+        printf("[MSI-X] table BAR%d is not a memory BAR\n", bir);
+        return -1;
+    }
+    uint32_t table_phys = (bar & ~0xF) + (table & ~0x7);
+
+    // 表在设备寄存器里，必须不缓存
+    extern void *map_highmem_physical(uint32_t phys_addr, uint32_t size, uint32_t flags);
+    volatile uint32_t *entry = map_highmem_physical(table_phys, table_size * MSIX_ENTRY_SIZE, 0x18);
+    if (!entry) {
+        return -1;
+    }
+
+    // 编程期间整体屏蔽
+    ctrl |= MSIX_CTRL_ENABLE | MSIX_CTRL_FUNC_MASK;
+    pci_write_config_word(bus, dev, func, msix_cap + MSIX_CAP_CTRL, ctrl);
+
+    extern uint64_t get_apic_base_32bit(void);
+    extern uint8_t lapicid2(void);
+    uint32_t msg_base = (uint32_t)(get_apic_base_32bit() & 0xFFFFF000);
+    uint8_t self = lapicid2();
+
+    for (int i = 0; i < table_size; i++) {
+        volatile uint32_t *e = entry + i * (MSIX_ENTRY_SIZE / 4);
+        if (i < nvec) {
+            uint8_t dest = apic_ids ? apic_ids[i] : self;
+            e[0] = msg_base | ((uint32_t)dest << 12);   // 物理目的模式
+            e[1] = 0;
+            e[2] = vectors[i];          // Fixed delivery，边沿触发
+            e[3] = 0;                   // 取消屏蔽
+            printf("[MSI-X] entry %d -> vector 0x%02x on LAPIC %d\n", i, vectors[i], dest);
+        } else {
+            e[3] = MSIX_ENTRY_MASKED;
+        }
+    }
+
+    // 禁用 INTx，打开总线主控
+    uint16_t pci_cmd = pci_read_config_word(bus, dev, func, 0x04);
+    pci_cmd |= (1 << 2) | (1 << 10);
+    pci_write_config_word(bus, dev, func, 0x04, pci_cmd);
+
+    ctrl &= ~MSIX_CTRL_FUNC_MASK;
+    pci_write_config_word(bus, dev, func, msix_cap + MSIX_CAP_CTRL, ctrl);
+
+    ctrl = pci_read_config_word(bus, dev, func, msix_cap + MSIX_CAP_CTRL);
+    return (ctrl & MSIX_CTRL_ENABLE) ? 0 : -1;
+}
+
+/**
+ * @brief 启用 MSI-X，全部表项投递给当前 CPU
+ */
+int pci_enable_msix(unsigned bus, unsigned dev, unsigned func,
+                    const uint8_t *vectors, int nvec) {
+    return pci_enable_msix_affinity(bus, dev, func, vectors, NULL, nvec);
+}
+
 
 // #define CONFIG_ADDRESS 0xCF8
 // #define CONFIG_DATA    0xCFC
@@ -5,6 +5,8 @@
 #include "segment.h"  // 添加 segment.h 以获取 TSS 和段定义
 #include "x86/mmu.h"  // 添加段定义
 #include "lapic.h"    // 添加 logical_cpu_id
+#include "fpu.h"      // 任务切换时保存/恢复 FPU/SSE 状态
+#include "usermap.h"  // 任务切换时只给属主打开私有映射
 
 #ifndef U64_MAX
 #define U64_MAX 0xFFFFFFFFFFFFFFFFULL
@@ -412,6 +414,9 @@ void schedule(void) {
 
         // ⚠️⚠️⚠️ 调用 task_to_user_mode_with_task（汇编实现）
         // 这个函数会恢复 trapframe 并 iret 到用户态，不会返回！
+        fpu_switch(prev, next);
+    usermap_switch(prev, next);
+
         extern void task_to_user_mode_with_task_wrapper(struct task_t *task);
         task_to_user_mode_with_task_wrapper(next);
 
@@ -459,6 +464,9 @@ void schedule(void) {
         current_task[cpu_id] = next;
         current = next;  // 同步更新全局 current（汇编代码需要）
 
+        fpu_switch(prev, next);
+    usermap_switch(prev, next);
+
         /* 恢复中断并执行上下文切换 */
         __asm__ __volatile__("pushl %0; popfl" : : "r"(flags));
 
@@ -488,6 +496,9 @@ void schedule(void) {
     current_task[cpu_id] = next;
     current = next;  // 同步更新全局 current（汇编代码需要）
 
+    fpu_switch(prev, next);
+    usermap_switch(prev, next);
+
     /* 恢复中断并执行上下文切换 */
     __asm__ __volatile__("pushl %0; popfl" : : "r"(flags));
     switch_to(prev, next);
@@ -0,0 +1,183 @@
+/**
+ * @file softirq.c
+ * @brief 软中断：每 CPU 挂起位图，中断返回前或 ksoftirqd 中执行
+ *
+ * 没有固定 tick（见 timer.c），超出预算的软中断不能指望"下一个时钟中断"，
+ * 所以推迟时顺手装一个 1ms 的内核定时器：定时器到期本身就是一次硬中断，
+ * 返回前会接着处理剩下的挂起位。
+ */
+
+#include "softirq.h"
+#include "param.h"
+#include "lapic.h"
+#include "timer.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+typedef struct {
+    volatile uint32_t pending;      // 挂起位图（1 << nr）
+    uint8_t  hardirq;               // 硬中断嵌套深度
+    uint8_t  in_softirq;            // do_softirq 正在执行
+    uint8_t  wakeup;                // 有工作留给 ksoftirqd
+    ktimer_t kick;                  // 推迟后保证继续处理的定时器
+} softirq_cpu_t;
+
+static softirq_action_t softirq_vec[NR_SOFTIRQS];
+static softirq_cpu_t softirq_cpus[NCPU];
+
+static inline softirq_cpu_t *this_cpu(void) {
+    return &softirq_cpus[logical_cpu_id()];
+}
+
+static inline uint32_t softirq_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void softirq_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// 定时器回调只是为了产生一次中断，挂起位在 irq_exit 里处理
+static void softirq_kick(ktimer_t *t) {
+    (void)t;
+}
+
+/**
+ * @brief 初始化（内核定时器本身就是第一个软中断）
+ */
+void softirq_init(void) {
+    for (int cpu = 0; cpu < NCPU; cpu++) {
+        timer_setup(&softirq_cpus[cpu].kick, softirq_kick, NULL);
+    }
+    open_softirq(TIMER_SOFTIRQ, timer_run);
+}
+
+void open_softirq(int nr, softirq_action_t action) {
+    if (nr >= 0 && nr < NR_SOFTIRQS) {
+        softirq_vec[nr] = action;
+    }
+}
+
+// 调用者已关中断
+static void softirq_wakeup_locked(softirq_cpu_t *s) {
+    s->wakeup = 1;
+    if (!timer_pending(&s->kick)) {
+        timer_mod(&s->kick, clock_ms() + 1);
+    }
+}
+
+/**
+ * @brief 置挂起位；在硬中断 / 软中断里由 irq_exit 或当前 do_softirq 接着处理，
+ *        否则交给 ksoftirqd
+ */
+void raise_softirq(int nr) {
+    uint32_t flags = softirq_lock();
+    softirq_cpu_t *s = this_cpu();
+    s->pending |= 1u << nr;
+    if (!s->hardirq && !s->in_softirq) {
+        softirq_wakeup_locked(s);
+    }
+    softirq_unlock(flags);
+}
+
+/**
+ * @brief 进程上下文里马上处理挂起的软中断（类似 Linux 的 netif_rx_ni）
+ * @param eflags 处理完要回到的上下文的 EFLAGS，关着中断时不处理
+ *
+ * 进程上下文 raise_softirq 只交给 ksoftirqd 和 1ms 定时器，系统调用里产生的
+ * 接收工作（回环发送）要等到下一次中断才处理；系统调用返回前和回环发送后
+ * 调用这里，把这段延迟去掉。在硬中断 / 软中断里调用时什么也不做。
+ */
+void softirq_run_pending(uint32_t eflags) {
+    if (!(eflags & FL_IF)) {
+        return;
+    }
+    uint32_t flags = softirq_lock();
+    softirq_cpu_t *s = this_cpu();
+    int run = !s->hardirq && !s->in_softirq && s->pending;
+    softirq_unlock(flags);
+    if (run) {
+        do_softirq();
+    }
+}
+
+int in_interrupt(void) {
+    softirq_cpu_t *s = this_cpu();
+    return s->hardirq || s->in_softirq;
+}
+
+void irq_enter(void) {
+    this_cpu()->hardirq++;
+}
+
+/**
+ * @brief 硬中断返回前调用（已发 EOI、仍关中断）
+ *
+ * 嵌套在另一个硬中断或软中断里时直接返回，由外层处理；
+ * 被打断的代码关着中断时（异常打断临界区）也不处理。
+ */
+void irq_exit(uint32_t eflags) {
+    softirq_cpu_t *s = this_cpu();
+    s->hardirq--;
+    if (!s->hardirq && !s->in_softirq && s->pending && (eflags & FL_IF)) {
+        do_softirq();
+    }
+}
+
+/**
+ * @brief 依次执行挂起的软中断（开中断执行），受轮数和时间预算限制
+ */
+void do_softirq(void) {
+    uint32_t flags = softirq_lock();
+    softirq_cpu_t *s = this_cpu();
+
+    if (s->in_softirq || !s->pending) {
+        softirq_unlock(flags);
+        return;
+    }
+    s->in_softirq = 1;
+
+    uint32_t start = clock_ms();
+    int restart = SOFTIRQ_MAX_RESTART;
+    for (;;) {
+        uint32_t pending = s->pending;
+        s->pending = 0;
+
+        sti();
+        for (int nr = 0; pending; nr++, pending >>= 1) {
+            if ((pending & 1) && softirq_vec[nr]) {
+                softirq_vec[nr]();
+            }
+        }
+        cli();
+
+        if (!s->pending) {
+            break;
+        }
+        if (--restart == 0 || clock_ms() - start >= SOFTIRQ_MAX_MS) {
+            // 还有活但预算用完：先返回，让被打断的任务跑一会儿
+            softirq_wakeup_locked(s);
+            break;
+        }
+    }
+
+    s->in_softirq = 0;
+    softirq_unlock(flags);
+}
+
+/**
+ * @brief ksoftirqd：空闲循环每转一圈处理一批（仍受预算限制，之间让调度器插进来）
+ */
+void ksoftirqd_run(void) {
+    softirq_cpu_t *s = this_cpu();
+    if (!s->wakeup) {
+        return;
+    }
+    s->wakeup = 0;
+    do_softirq();
+}
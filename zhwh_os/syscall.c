@@ -10,6 +10,15 @@
 #include "net.h"
 #include "pci.h"
 #include "x86/io.h"  // 🔥 添加：引入 outl/inl 函数
+#include "time.h"
+#include "fs.h"
+#include "socket.h"
+#include "route.h"
+#include "capture.h"
+#include "bypass.h"
+#include "qdisc.h"
+#include "virtio_net.h"
+#include "fpu.h"
 
 // PCI 配置空间 I/O 端口
 #define CONFIG_ADDRESS 0xCF8
@@ -48,6 +57,42 @@
 #define SYS_GUI_FB_BLIT 71      // 位图传输到帧缓冲区
 #define SYS_GUI_INPUT_READ 72   // 读取输入设备事件
 #define SYS_USB_MOUSE_POLL 73   // 轮询 USB 鼠标事件
+#define SYS_CLOCK_MS 74         // 获取单调毫秒时钟
+#define SYS_GUI_WAIT 75         // 睡眠直到超时或有输入事件
+
+// BSD 套接字（见 socket.h；addr 为 struct sockaddr_in *，网络字节序）
+#define SYS_SOCKET 76           // socket(domain, type, protocol)
+#define SYS_BIND 77             // bind(fd, addr)
+#define SYS_CONNECT 78          // connect(fd, addr)
+#define SYS_LISTEN 79           // listen(fd, backlog)
+#define SYS_ACCEPT 80           // accept(fd, addr)
+#define SYS_SENDTO 81           // sendto(fd, buf, len, flags, addr)，addr 为 NULL 即 send
+#define SYS_RECVFROM 82         // recvfrom(fd, buf, len, flags, addr)，addr 为 NULL 即 recv
+
+// 路由和接口配置（见 route.h；地址都是主机字节序）
+#define SYS_ROUTE 83            // route(cmd, route_entry_t *)
+#define SYS_IFCONFIG_SET 84     // ifconfig_set(ifname, ip, netmask, gateway)
+#define SYS_NET_INIT_VIRTIO 85  // virtio_net_init(dev_name)
+
+// 网卡接收过滤（经典 BPF，见 bpf.h / net.h NET_FILTER_*）
+#define SYS_NET_FILTER 86       // net_filter(cmd, ifname, insns, len)
+
+// 抓包环（见 capture.h；SETUP 返回环的用户态地址）
+#define SYS_NET_CAPTURE 87      // net_capture(cmd, ifname, arg)
+
+// 发送排队规则（见 qdisc.h）
+#define SYS_NET_QDISC 88        // net_qdisc(cmd, qdisc_conf_t *)
+#define SYS_SETSOCKOPT 89       // setsockopt(fd, level, optname, optval, optlen)
+
+// 接口 MTU（巨型帧，上限见 net_device_t.max_mtu）
+#define SYS_NET_MTU 90          // net_mtu(ifname, mtu)
+
+// 内核旁路（见 bypass.h；返回 fd，关闭 fd 或进程退出时网卡交还协议栈）
+#define SYS_NET_BYPASS 91       // net_bypass(ifname)
+
+// 用户 ID（uid 0 才能建立抓包环、旁路网卡；fork 继承）
+#define SYS_GETUID 92           // getuid()
+#define SYS_SETUID 93           // setuid(uid)，降权后回不到 0
 
 // WiFi
 static uint8_t  *fw_buf      = NULL;
@@ -60,6 +105,20 @@ static int usb_mouse_x = 512;
 static int usb_mouse_y = 384;
 static uint8_t usb_mouse_buttons = 0;
 
+// SYS_GUI_WAIT 单次睡眠上限：USB 鼠标数据靠轮询获得，不会产生唤醒中断
+#define GUI_WAIT_MAX_MS 100
+
+// SYS_GUI_WAIT 的唤醒条件：键盘或 USB 鼠标有待读数据（关中断状态下调用）
+static int gui_input_pending(void) {
+    extern int keyboard_scancode_available(void);
+    extern int usb_mouse_get_count(void);
+    extern int usb_mouse_data_available(int mouse_index);
+
+    if (keyboard_scancode_available())
+        return 1;
+    return usb_mouse_get_count() > 0 && usb_mouse_data_available(0);
+}
+
 // 🔥 当前选择的网络设备名称（空字符串表示自动选择）
 // 🔥 改为非 static，以便网络模块可以访问
 char current_net_device[16] = {0};
@@ -144,6 +203,8 @@ void do_exit(int code) {
 
     // 1. 
     task->state = PS_TERMNAT;
+    files_exit(task);  // 关闭打开的文件和套接字
+    fpu_exit(task);    // 释放 FPU/SSE 状态区
 
     // 2. 
     // task->user_stack 
@@ -437,6 +498,8 @@ void syscall_dispatch(struct trapframe *tf) {
                 kbuf[copied] = '\0';
                 printf("[USER #%d] %s", write_count, kbuf);
                 tf->eax = copied;
+            } else if (fd_get(fd)) {
+                tf->eax = filp_write(fd_get(fd), user_buf, len);
             } else {
                 tf->eax = -1;
             }
@@ -570,12 +633,13 @@ void syscall_dispatch(struct trapframe *tf) {
             }
 
             //  VFS 
-            extern struct file *filp_open(const char *, int);
             struct file *file = filp_open(kpath, flags);
             if (file) {
-                //   fd
-                //  fd 
-                tf->eax = (int)file;
+                int fd = fd_install(file);
+                if (fd < 0) {
+                    filp_close(file);
+                }
+                tf->eax = fd;
             } else {
                 tf->eax = -1;
             }
@@ -583,13 +647,7 @@ void syscall_dispatch(struct trapframe *tf) {
         }
         case SYS_CLOSE: {
             // close(fd)
-            int fd = (int)arg1;
-            struct file *file = (struct file*)fd;
-
-            //  VFS 
-            extern int filp_close(struct file *);
-            int ret = filp_close(file);
-            tf->eax = ret;
+            tf->eax = fd_close((int)arg1);
             break;
         }
         case SYS_READ: {
@@ -597,10 +655,14 @@ void syscall_dispatch(struct trapframe *tf) {
             int fd = (int)arg1;
             char *user_buf = (char*)arg2;
             uint32_t len = arg3;
-            struct file *file = (struct file*)fd;
+            struct file *file = fd_get(fd);
+
+            // 套接字直接读进用户缓冲区（recv 语义，可能阻塞）
+            if (file && !file->f_inode) {
+                tf->eax = filp_read(file, user_buf, len);
+                break;
+            }
 
-            //  VFS 
-            extern int filp_read(struct file *, char *, uint32_t);
             char kbuf[512];
             uint32_t to_read = (len < 512) ? len : 512;
             int ret = filp_read(file, kbuf, to_read);
@@ -631,10 +693,8 @@ void syscall_dispatch(struct trapframe *tf) {
             int fd = (int)arg1;
             int offset = (int)arg2;
             int whence = (int)arg3;
-            struct file *file = (struct file*)fd;
+            struct file *file = fd_get(fd);
 
-            //  VFS 
-            extern int filp_lseek(struct file *, int64_t, int);
             int ret = filp_lseek(file, (int64_t)offset, whence);
             tf->eax = ret;
             break;
@@ -800,6 +860,13 @@ void syscall_dispatch(struct trapframe *tf) {
                        (dev->netmask >> 8) & 0xFF,
                        dev->netmask & 0xFF);
 
+                // 网关（默认路由）
+                printf("Gateway:    %d.%d.%d.%d\n",
+                       (dev->gateway >> 24) & 0xFF,
+                       (dev->gateway >> 16) & 0xFF,
+                       (dev->gateway >> 8) & 0xFF,
+                       dev->gateway & 0xFF);
+
                 // MTU
                 printf("MTU:        %d bytes\n", dev->mtu);
 
@@ -1898,6 +1965,103 @@ void syscall_dispatch(struct trapframe *tf) {
             tf->eax = 1;  // 有数据
             break;
         }
+        case SYS_CLOCK_MS: {
+            // 返回：eax = 启动以来的毫秒数
+            tf->eax = clock_ms();
+            break;
+        }
+        case SYS_GUI_WAIT: {
+            // 睡眠直到超时或有键盘/鼠标输入（LVGL 主循环用）
+            // 参数：ebx = 超时毫秒数（通常为 lv_timer_handler() 的返回值）
+            // 返回：eax = 1 有输入事件, 0 超时
+            uint32_t timeout = tf->ebx;
+            if (timeout > GUI_WAIT_MAX_MS) {
+                timeout = GUI_WAIT_MAX_MS;
+            }
+            tf->eax = clock_sleep_until(clock_ms() + timeout, gui_input_pending);
+            break;
+        }
+        case SYS_SOCKET:
+            tf->eax = sys_socket((int)arg1, (int)arg2, (int)arg3);
+            break;
+        case SYS_BIND:
+            tf->eax = sys_bind((int)arg1, (const struct sockaddr_in *)arg2);
+            break;
+        case SYS_CONNECT:
+            tf->eax = sys_connect((int)arg1, (const struct sockaddr_in *)arg2);
+            break;
+        case SYS_LISTEN:
+            tf->eax = sys_listen((int)arg1, (int)arg2);
+            break;
+        case SYS_ACCEPT:
+            tf->eax = sys_accept((int)arg1, (struct sockaddr_in *)arg2);
+            break;
+        case SYS_SENDTO:
+            // 参数：ebx = fd, ecx = buf, edx = len, esi = flags, edi = addr
+            tf->eax = sys_sendto((int)arg1, (const void *)arg2, arg3, (int)tf->esi,
+                                 (const struct sockaddr_in *)tf->edi);
+            break;
+        case SYS_RECVFROM:
+            // 参数：ebx = fd, ecx = buf, edx = len, esi = flags, edi = addr（输出）
+            tf->eax = sys_recvfrom((int)arg1, (void *)arg2, arg3, (int)tf->esi,
+                                   (struct sockaddr_in *)tf->edi);
+            break;
+        case SYS_ROUTE:
+            tf->eax = sys_route((int)arg1, (route_entry_t *)arg2);
+            break;
+        case SYS_IFCONFIG_SET:
+            // 参数：ebx = ifname, ecx = ip, edx = netmask, esi = gateway
+            tf->eax = sys_ifconfig_set((const char *)arg1, arg2, arg3, tf->esi);
+            break;
+        case SYS_NET_INIT_VIRTIO: {
+            // 参数：ebx = 设备名称（如 "eth2"）
+            char dev_name[16];
+            if (!arg1) {
+                tf->eax = -1;
+                break;
+            }
+            copy_from_user(dev_name, (const char *)arg1, sizeof(dev_name));
+            dev_name[sizeof(dev_name) - 1] = '\0';
+            tf->eax = virtio_net_init(dev_name);
+            break;
+        }
+        case SYS_NET_FILTER:
+            // 参数：ebx = cmd, ecx = ifname, edx = insns（struct sock_filter 数组）, esi = 指令数
+            tf->eax = sys_net_filter((int)arg1, (const char *)arg2, (const void *)arg3, tf->esi);
+            break;
+
+        case SYS_NET_CAPTURE:
+            // 参数：ebx = cmd, ecx = ifname, edx = arg（ENABLE 时为 CAPTURE_RX | CAPTURE_TX）
+            tf->eax = sys_net_capture((int)arg1, (const char *)arg2, arg3);
+            break;
+
+        case SYS_NET_QDISC:
+            // 参数：ebx = cmd, ecx = qdisc_conf_t *（SHOW 时可为 NULL）
+            tf->eax = sys_net_qdisc((int)arg1, (const qdisc_conf_t *)arg2);
+            break;
+
+        case SYS_SETSOCKOPT:
+            // 参数：ebx = fd, ecx = level, edx = optname, esi = optval, edi = optlen
+            tf->eax = sys_setsockopt((int)arg1, (int)arg2, (int)arg3,
+                                     (const void *)tf->esi, tf->edi);
+            break;
+
+        case SYS_NET_MTU:
+            // 参数：ebx = ifname, ecx = mtu
+            tf->eax = sys_net_mtu((const char *)arg1, arg2);
+            break;
+
+        case SYS_NET_BYPASS:
+            // 参数：ebx = ifname
+            tf->eax = sys_net_bypass((const char *)arg1);
+            break;
+        case SYS_GETUID:
+            tf->eax = sys_getuid();
+            break;
+        case SYS_SETUID:
+            // 参数：ebx = uid
+            tf->eax = sys_setuid(arg1);
+            break;
         default:
             //   printf ES 
             // printf("[syscall] unknown num=%d\n", num);
@@ -16,6 +16,8 @@
 #include "proc.h"
 #include "userboot.h"
 #include "printf.h"
+#include "fpu.h"
+#include "fs.h"
 /**
  * @brief The currently running taskess on each CPU
  */
@@ -461,6 +463,10 @@ void handle_idle_state(uint8_t cpu) {
         }
     }
 
+    // ksoftirqd：处理超出预算 / 从进程上下文置位的软中断
+    extern void ksoftirqd_run(void);
+    ksoftirqd_run();
+
     if (task_list[cpu] == NULL) __asm__ __volatile__("sti; hlt; cli");
 }
 
@@ -716,6 +722,8 @@ task_t* do_fork(void) {
     // ⚠️ intr_depth 字段已删除
     child->has_signal = false;
     child->idle_flags = 0;
+    fpu_fork(child);  // 子进程继承父进程的 FPU/SSE 寄存器
+    files_fork(child, parent);  // 子进程继承打开的文件和套接字
 
     // ⚠️⚠️⚠️ 关键修复：复制 user_stack 字段!
     // 子进程和父进程共享同一个用户虚拟地址空间(COW),所以 user_stack 值相同
@@ -1132,3 +1140,35 @@ void task_to_user_mode_with_task_wrapper(struct task_t *task) {
         __asm__ volatile("hlt");
     }
 }
+
+/**
+ * @brief 当前任务是否有特权（uid 0）
+ */
+int task_privileged(void) {
+    extern task_t *current_task[];
+    task_t *task = current_task[logical_cpu_id()];
+    return task && task->uid == 0;
+}
+
+/**
+ * @brief SYS_GETUID
+ */
+int sys_getuid(void) {
+    extern task_t *current_task[];
+    task_t *task = current_task[logical_cpu_id()];
+    return task ? (int)task->uid : -1;
+}
+
+/**
+ * @brief SYS_SETUID：特权任务可以换成任意 uid，普通任务只能设成自己的 uid
+ * @return 0 成功，-1 没有权限
+ */
+int sys_setuid(uint32_t uid) {
+    extern task_t *current_task[];
+    task_t *task = current_task[logical_cpu_id()];
+    if (!task || (task->uid != 0 && task->uid != uid)) {
+        return -1;
+    }
+    task->uid = uid;
+    return 0;
+}
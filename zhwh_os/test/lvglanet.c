@@ -20,6 +20,7 @@ extern int lvgl_display_init(void);
 // 网络函数声明
 extern int rtl8139_init_user(void);
 extern int e1000_init_user(const char *name);
+extern int virtio_net_init_user(const char *name);
 extern int wifi_init(void);
 extern int wifi_scan(void);
 extern int net_ping(const char *ip_str);
@@ -405,6 +406,8 @@ static void terminal_ready_callback(lv_event_t *e) {
                     ret = rtl8139_init_user();
                 } else if (strcmp(dev, "e1000") == 0) {
                     ret = e1000_init_user("eth1");
+                } else if (strcmp(dev, "virtio") == 0) {
+                    ret = virtio_net_init_user("eth2");
                 } else if (strcmp(dev, "wifi") == 0) {
                     ret = wifi_init();
                 }
@@ -984,20 +987,26 @@ void create_keyboard_ui(void) {
 
 /**
  * @brief 主循环 - LVGL自动处理输入
+ *
+ * lv_timer_handler() 返回距下一个定时器/动画到期的毫秒数，
+ * 用 gui_wait() 睡眠这段时间（有输入时提前唤醒），空闲时不再空转
  */
 void lvgl_main_loop(void) {
     LV_LOG("Entering main loop");
 
     uint32_t loop_count = 0;
+    uint32_t last_counter_ms = 0;
 
     while (1) {
-        lv_tick_inc(5);
-        lv_timer_handler();
+        uint32_t wait_ms = lv_timer_handler();
+        gui_wait(wait_ms);
 
         loop_count++;
 
-        // 每2次循环就在界面上更新计数
-        if (loop_count % 2 == 0) {
+        // 每秒在界面上更新一次计数（每次都更新会让屏幕永远是脏的）
+        uint32_t now = clock_ms();
+        if (now - last_counter_ms >= 1000) {
+            last_counter_ms = now;
             static lv_obj_t *counter_label = NULL;
             if (!counter_label) {
                 const char *msg1 = "[LOOP] About to create label\n";
@@ -203,7 +203,7 @@ void cmd_help(int argc, char **argv) {
     const char *msg7 = "  ping <IP> [iface] - Test ICMP ping response\n";
     const char *msg8 = "  wait <sec>    - Wait for network activity\n";
     const char *msg9 = "  wifi          - WiFi commands\n";
-    const char *msg10 = "  ifconfig      - Show network interface config\n";
+    const char *msg10 = "  ifconfig [<iface> mtu <n>] - Show interface config / set MTU\n";
     const char *msg11 = "  ifup <iface>   - Bring up interface\n";
     const char *msg12 = "  lspci         - List PCI devices\n";
     const char *msg13 = "  net <cmd>     - Network commands\n";
@@ -216,6 +216,9 @@ void cmd_help(int argc, char **argv) {
     const char *msg20 = "  msi_test      - Test MSI interrupt path\n";
     const char *msg21 = "  loopback_test - E1000 hardware loopback test (polling)\n";
     const char *msg22 = "  loopback_int  - E1000 hardware loopback test (INTERRUPT)\n";
+    const char *msg24 = "  pcap <iface> [n] [file|serial] - Capture frames to pcap\n";
+    const char *msg25 = "  tc show | tc <iface> fifo|prio [rate] [burst] - Set TX qdisc\n";
+    const char *msg26 = "  fwd <iface> [sec] [irq] - Kernel-bypass L2 forward (poll mode)\n";
     const char *msg23 = "  exit          - Exit shell\n\n";
 
     print_str(msg1);
@@ -240,6 +243,9 @@ void cmd_help(int argc, char **argv) {
     print_str(msg20);
     print_str(msg21);
     print_str(msg22);
+    print_str(msg24);
+    print_str(msg25);
+    print_str(msg26);
     print_str(msg23);
 }
 
@@ -389,6 +395,19 @@ void cmd_ping(int argc, char **argv) {
 
 // 网卡接口配置命令
 void cmd_ifconfig(int argc, char **argv) {
+    // ifconfig <iface> mtu <n>：修改 MTU（e1000 支持到 9000 的巨型帧）
+    if (argc >= 4 && strcmp(argv[2], "mtu") == 0) {
+        int ret = net_set_mtu(argv[1], (uint32_t)atoi(argv[3]));
+        if (ret == -19) {
+            print_str("ifconfig: no such interface\n");
+        } else if (ret < 0) {
+            print_str("ifconfig: MTU out of range for this interface\n");
+        } else {
+            print_str("MTU updated\n");
+        }
+        return;
+    }
+
     const char *msg1 = "\n=== Network Interface Configuration ===\n\n";
     print_str(msg1);
 
@@ -1122,6 +1141,255 @@ void cmd_arp(int argc, char **argv) {
     }
 }
 
+// ==================== pcap 抓包 ====================
+//
+// 从内核抓包环里取帧，写成 pcap 文件（ramfs）或者以十六进制打到串口：
+//   串口日志里提取：sed -n 's/^pcap: //p' serial.log | xxd -r -p > out.pcap
+
+#define PCAP_BUF_SIZE   4096
+#define PCAP_IDLE_MS    10000   // 这么久没有新帧就停止
+#define PCAP_HEX_LINE   32      // 串口每行字节数
+
+typedef struct {
+    int fd;                     // >= 0 写文件，< 0 打到串口
+    uint32_t len;
+    uint8_t buf[PCAP_BUF_SIZE];
+} pcap_out_t;
+
+static pcap_out_t pcap_out;
+
+static void pcap_flush(pcap_out_t *out) {
+    static const char hex[] = "0123456789abcdef";
+
+    if (out->fd >= 0) {
+        write(out->fd, (const char *)out->buf, out->len);
+    } else {
+        for (uint32_t i = 0; i < out->len; i += PCAP_HEX_LINE) {
+            char line[8 + PCAP_HEX_LINE * 2];
+            int n = 0;
+            const char *tag = "pcap: ";
+            while (*tag) line[n++] = *tag++;
+            for (uint32_t j = i; j < out->len && j < i + PCAP_HEX_LINE; j++) {
+                line[n++] = hex[out->buf[j] >> 4];
+                line[n++] = hex[out->buf[j] & 0xF];
+            }
+            line[n++] = '\n';
+            line[n] = '\0';
+            print_str(line);
+        }
+    }
+    out->len = 0;
+}
+
+static void pcap_put(pcap_out_t *out, const void *data, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        uint32_t n = PCAP_BUF_SIZE - out->len;
+        if (n > len) n = len;
+        memcpy(out->buf + out->len, p, n);
+        out->len += n;
+        p += n;
+        len -= n;
+        if (out->len == PCAP_BUF_SIZE) {
+            pcap_flush(out);
+        }
+    }
+}
+
+// 🔥 pcap 命令：pcap <iface> [count] [file|serial]
+void cmd_pcap(int argc, char **argv) {
+    if (argc < 2) {
+        print_str("\nUsage: pcap <iface> [count] [file|serial]\n");
+        print_str("  Capture RX and TX frames on <iface> (default 32 frames),\n");
+        print_str("  write pcap to a ramfs file (default /capture.pcap) or hex to serial.\n\n");
+        return;
+    }
+
+    const char *iface = argv[1];
+    int count = argc > 2 ? atoi(argv[2]) : 32;
+    const char *dest = argc > 3 ? argv[3] : "/capture.pcap";
+    if (count < 1) count = 1;
+
+    capture_ring_t *ring = net_capture_setup();
+    if (!ring || ring->magic != CAPTURE_RING_MAGIC) {
+        print_str("pcap: failed to set up capture ring\n");
+        return;
+    }
+
+    pcap_out.len = 0;
+    pcap_out.fd = -1;
+    if (strcmp(dest, "serial") != 0) {
+        pcap_out.fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC);
+        if (pcap_out.fd < 0) {
+            print_str("pcap: cannot open ");
+            print_str(dest);
+            print_str("\n");
+            return;
+        }
+    }
+
+    if (net_capture_enable(iface, CAPTURE_RX | CAPTURE_TX) != 0) {
+        print_str("pcap: no such interface: ");
+        print_str(iface);
+        print_str("\n");
+        if (pcap_out.fd >= 0) close(pcap_out.fd);
+        return;
+    }
+
+    // pcap 文件头：本机字节序，以太网链路层
+    uint32_t ghdr[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, 0, 1 };
+    ghdr[4] = ring->snaplen;
+    pcap_put(&pcap_out, ghdr, sizeof(ghdr));
+
+    printf("Capturing on %s (%d frames)...\n", iface, count);
+
+    uint32_t idx = 0;
+    int got = 0;
+    uint32_t last = clock_ms();
+    while (got < count && clock_ms() - last < PCAP_IDLE_MS) {
+        capture_frame_t *f = capture_frame(ring, idx);
+        if (f->status != CAPTURE_STATUS_USER) {
+            yield();
+            continue;
+        }
+
+        uint32_t rec[4] = { f->tv_sec, f->tv_usec, f->caplen, f->len };
+        pcap_put(&pcap_out, rec, sizeof(rec));
+        pcap_put(&pcap_out, f + 1, f->caplen);
+
+        f->status = CAPTURE_STATUS_KERNEL;
+        idx = (idx + 1) % ring->frame_nr;
+        got++;
+        last = clock_ms();
+    }
+
+    net_capture_enable(iface, 0);
+    pcap_flush(&pcap_out);
+    if (pcap_out.fd >= 0) {
+        close(pcap_out.fd);
+    }
+
+    printf("%d frames captured, %u dropped (ring full)\n", got, ring->drops);
+}
+
+// 🔥 tc 命令：tc show | tc <iface> fifo|prio [rate B/s] [burst] [limit]
+void cmd_tc(int argc, char **argv) {
+    if (argc < 2 || (strcmp(argv[1], "show") != 0 && argc < 3)) {
+        print_str("\nUsage: tc show\n");
+        print_str("       tc <iface> fifo|prio [rate] [burst] [limit]\n");
+        print_str("  rate in bytes/s (0 = unlimited), burst in bytes (0 = rate/10)\n\n");
+        return;
+    }
+    if (strcmp(argv[1], "show") == 0) {
+        net_qdisc_show();
+        return;
+    }
+
+    qdisc_conf_t conf;
+    memset(&conf, 0, sizeof(conf));
+    int n = strlen(argv[1]);
+    if (n > 15) n = 15;
+    memcpy(conf.ifname, argv[1], n);
+
+    if (strcmp(argv[2], "fifo") == 0) {
+        conf.kind = QDISC_FIFO;
+    } else if (strcmp(argv[2], "prio") == 0) {
+        conf.kind = QDISC_PRIO;
+    } else {
+        print_str("tc: kind must be fifo or prio\n");
+        return;
+    }
+    conf.rate = argc > 3 ? (uint32_t)atoi(argv[3]) : 0;
+    conf.burst = argc > 4 ? (uint32_t)atoi(argv[4]) : 0;
+    conf.limit = argc > 5 ? (uint32_t)atoi(argv[5]) : 0;
+
+    int ret = net_qdisc_set(&conf);
+    if (ret == -19) {
+        print_str("tc: no such interface\n");
+    } else if (ret < 0) {
+        print_str("tc: invalid parameters\n");
+    } else {
+        net_qdisc_show();
+    }
+}
+
+// ==================== 内核旁路转发 ====================
+
+#define FWD_BURST   32
+
+static pmd_t fwd_pmd;
+
+// 🔥 fwd 命令：fwd <iface> [seconds] [irq]
+// 旁路网卡，把收到的帧交换源/目的 MAC 后原样发回（零拷贝），结束时网卡交还协议栈；
+// 默认纯轮询，加 irq 则空闲时等接收中断
+void cmd_fwd(int argc, char **argv) {
+    if (argc < 2) {
+        print_str("\nUsage: fwd <iface> [seconds] [irq]\n");
+        print_str("  Take <iface> away from the kernel stack and bounce every frame\n");
+        print_str("  back with MACs swapped (default 10 s, busy polling).\n\n");
+        return;
+    }
+
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    int use_irq = argc > 3 && strcmp(argv[3], "irq") == 0;
+    if (seconds < 1) seconds = 1;
+
+    pmd_t *p = &fwd_pmd;
+    int ret = pmd_open(p, argv[1]);
+    if (ret < 0) {
+        if (ret == -1) {
+            print_str("fwd: permission denied\n");
+        } else if (ret == -19) {
+            print_str("fwd: no such interface\n");
+        } else if (ret == -95) {
+            print_str("fwd: driver does not support bypass\n");
+        } else if (ret == -16) {
+            print_str("fwd: bypass already in use\n");
+        } else {
+            printf("fwd: bypass failed (%d)\n", ret);
+        }
+        return;
+    }
+
+    printf("Forwarding on %s for %d s (%s), %u RX / %u TX descriptors...\n",
+           argv[1], seconds, use_irq ? "irq" : "poll", p->info->rx_desc_nr, p->info->tx_desc_nr);
+
+    pmd_pkt_t pkts[FWD_BURST];
+    uint32_t waits = 0;
+    uint32_t start = clock_ms();
+    uint32_t limit = (uint32_t)seconds * 1000;
+    while (clock_ms() - start < limit) {
+        int n = pmd_rx_burst(p, pkts, FWD_BURST);
+        if (n == 0) {
+            if (use_irq) {
+                pmd_wait(p);
+                waits++;
+            }
+            continue;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint8_t *eth = pkts[i].data;
+            uint8_t mac[6];
+            memcpy(mac, eth, 6);
+            memcpy(eth, eth + 6, 6);
+            memcpy(eth + 6, mac, 6);
+        }
+        int sent = pmd_tx_burst(p, pkts, n);
+        for (int i = sent; i < n; i++) {
+            pmd_buf_free(p, pkts[i].buf);
+        }
+    }
+    uint32_t elapsed = clock_ms() - start;
+
+    pmd_close(p);
+
+    uint32_t secs = elapsed / 1000;
+    printf("%u packets received, %u forwarded in %u ms (~%u pps)\n",
+           p->rx_packets, p->tx_packets, elapsed, secs ? p->tx_packets / secs : p->tx_packets);
+    printf("  %u RX dropped, %u TX ring full, %u waits\n", p->rx_dropped, p->tx_full, waits);
+}
+
 // 命令缓冲区
 char cmd_buffer[256];
 
@@ -1232,6 +1500,15 @@ int main(int argc, char **argv) {
         else if (strcmp(args[0], "loopback_int") == 0) {  // 🔥 新增：loopback_int 命令（中断）
             cmd_loopback_test_int(argc, args);
         }
+        else if (strcmp(args[0], "pcap") == 0) {  // 🔥 新增：pcap 抓包命令
+            cmd_pcap(argc, args);
+        }
+        else if (strcmp(args[0], "tc") == 0) {  // 🔥 新增：tc 排队规则命令
+            cmd_tc(argc, args);
+        }
+        else if (strcmp(args[0], "fwd") == 0) {  // 🔥 新增：fwd 内核旁路转发
+            cmd_fwd(argc, args);
+        }
         else if (strcmp(args[0], "exit") == 0 || strcmp(args[0], "quit") == 0) {
             const char *msg = "Exiting network shell...\n";
             print_str(msg);
@@ -0,0 +1,144 @@
+/**
+ * @file timer.c
+ * @brief 内核定时器
+ *
+ * LAPIC 周期定时器被屏蔽，没有固定的 tick，所以不用时间轮，
+ * 而是把定时器按到期时间排成有序链表，只让 LAPIC 单次定时器
+ * 在链表头到期时打断一次（见 clock_set_alarm）。
+ * 定时器的数量很少（每条 TCP 连接两三个），插入的 O(n) 不是问题。
+ */
+
+#include "timer.h"
+#include "time.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+static ktimer_t *timer_list = NULL;
+static volatile int timer_running = 0;
+
+static inline uint32_t timer_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void timer_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// 调用者已关中断
+static void timer_unlink(ktimer_t *t) {
+    ktimer_t **pp = &timer_list;
+
+    while (*pp && *pp != t) {
+        pp = &(*pp)->next;
+    }
+    if (*pp) {
+        *pp = t->next;
+    }
+    t->next = NULL;
+    t->pending = 0;
+}
+
+// 调用者已关中断；timer_run 执行期间由它在结束时统一重新装闹钟
+static void timer_rearm(void) {
+    if (timer_running) {
+        return;
+    }
+    if (timer_list) {
+        clock_set_alarm(timer_list->expires, 1);
+    } else {
+        clock_set_alarm(0, 0);
+    }
+}
+
+/**
+ * @brief 初始化定时器（不挂入链表）
+ */
+void timer_setup(ktimer_t *t, void (*func)(ktimer_t *t), void *data) {
+    t->expires = 0;
+    t->func = func;
+    t->data = data;
+    t->next = NULL;
+    t->pending = 0;
+}
+
+/**
+ * @brief 设置到期时间并挂入链表
+ */
+void timer_mod(ktimer_t *t, uint32_t expires) {
+    uint32_t flags = timer_lock();
+    ktimer_t *old_head = timer_list;
+
+    if (t->pending) {
+        timer_unlink(t);
+    }
+
+    t->expires = expires;
+    ktimer_t **pp = &timer_list;
+    while (*pp && (int32_t)((*pp)->expires - expires) <= 0) {
+        pp = &(*pp)->next;
+    }
+    t->next = *pp;
+    *pp = t;
+    t->pending = 1;
+
+    if (timer_list != old_head || timer_list == t) {
+        timer_rearm();
+    }
+    timer_unlock(flags);
+}
+
+/**
+ * @brief 取消定时器
+ * @return 1 取消前处于待触发状态，0 未挂入
+ */
+int timer_del(ktimer_t *t) {
+    uint32_t flags = timer_lock();
+    int was_pending = t->pending;
+
+    if (was_pending) {
+        int was_head = (timer_list == t);
+        timer_unlink(t);
+        if (was_head) {
+            timer_rearm();
+        }
+    }
+    timer_unlock(flags);
+    return was_pending;
+}
+
+/**
+ * @brief 执行已到期的定时器（时钟中断中、EOI 之后调用）
+ *
+ * 每个回调都在开中断状态下执行；嵌套进入（回调执行期间又来了时钟中断）
+ * 直接返回，由外层继续处理。
+ */
+void timer_run(void) {
+    uint32_t flags = timer_lock();
+
+    if (timer_running) {
+        timer_unlock(flags);
+        return;
+    }
+    timer_running = 1;
+
+    uint32_t now = clock_ms();
+    while (timer_list && (int32_t)(timer_list->expires - now) <= 0) {
+        ktimer_t *t = timer_list;
+        timer_list = t->next;
+        t->next = NULL;
+        t->pending = 0;
+
+        sti();
+        t->func(t);
+        cli();
+        now = clock_ms();
+    }
+
+    timer_running = 0;
+    timer_rearm();
+    timer_unlock(flags);
+}
@@ -96,6 +96,28 @@ int gui_read_input(input_event_t *event) {
     return ret;
 }
 
+int gui_wait(uint32_t timeout_ms) {
+    int ret;
+    __asm__ volatile(
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GUI_WAIT), "b"(timeout_ms)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+uint32_t clock_ms(void) {
+    uint32_t ret;
+    __asm__ volatile(
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_CLOCK_MS)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
 // 注意: strcmp, memcpy, memset 已经在 libuser.c 中定义，这里不再重复定义
 
 /**
@@ -281,6 +281,18 @@ int e1000_init_user(const char *dev_name) {
     return ret;
 }
 
+// 初始化 virtio-net 网卡（用户态包装）
+int virtio_net_init_user(const char *dev_name) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_NET_INIT_VIRTIO), "b"(dev_name)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
 // 🔥 UDP 发送系统调用
 int net_send_udp(const char *ip, int port, const char *data, int len) {
     int ret;
@@ -499,3 +511,480 @@ int e1000_loopback_test_interrupt(void) {
     return ret;
 }
 
+// ==================== BSD 套接字 ====================
+
+// "a.b.c.d" -> 网络字节序
+uint32_t inet_addr(const char *ip) {
+    uint32_t addr = 0;
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t part = 0;
+        int digits = 0;
+        while (*ip >= '0' && *ip <= '9' && digits < 3) {
+            part = part * 10 + (*ip++ - '0');
+            digits++;
+        }
+        if (digits == 0 || part > 255 || (i < 3 && *ip++ != '.')) {
+            return 0xFFFFFFFF;
+        }
+        addr = (addr << 8) | part;
+    }
+    return *ip ? 0xFFFFFFFF : htonl(addr);
+}
+
+int socket(int domain, int type, int protocol) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_SOCKET), "b"(domain), "c"(type), "d"(protocol)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int bind(int fd, const struct sockaddr_in *addr, socklen_t addrlen) {
+    int ret;
+    if (addrlen < sizeof(*addr)) {
+        return -22;  // EINVAL
+    }
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_BIND), "b"(fd), "c"(addr)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int connect(int fd, const struct sockaddr_in *addr, socklen_t addrlen) {
+    int ret;
+    if (addrlen < sizeof(*addr)) {
+        return -22;  // EINVAL
+    }
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_CONNECT), "b"(fd), "c"(addr)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int listen(int fd, int backlog) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_LISTEN), "b"(fd), "c"(backlog)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int accept(int fd, struct sockaddr_in *addr, socklen_t *addrlen) {
+    int ret;
+    if (addr && (!addrlen || *addrlen < sizeof(*addr))) {
+        return -22;  // EINVAL
+    }
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_ACCEPT), "b"(fd), "c"(addr)
+        : "memory", "cc"
+    );
+    if (ret >= 0 && addr) {
+        *addrlen = sizeof(*addr);
+    }
+    return ret;
+}
+
+int sendto(int fd, const void *buf, int len, int flags,
+           const struct sockaddr_in *addr, socklen_t addrlen) {
+    int ret;
+    if (addr && addrlen < sizeof(*addr)) {
+        return -22;  // EINVAL
+    }
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_SENDTO), "b"(fd), "c"(buf), "d"(len), "S"(flags), "D"(addr)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int recvfrom(int fd, void *buf, int len, int flags,
+             struct sockaddr_in *addr, socklen_t *addrlen) {
+    int ret;
+    if (addr && (!addrlen || *addrlen < sizeof(*addr))) {
+        return -22;  // EINVAL
+    }
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_RECVFROM), "b"(fd), "c"(buf), "d"(len), "S"(flags), "D"(addr)
+        : "memory", "cc"
+    );
+    if (ret >= 0 && addr) {
+        *addrlen = sizeof(*addr);
+    }
+    return ret;
+}
+
+int setsockopt(int fd, int level, int optname, const void *optval, socklen_t optlen) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_SETSOCKOPT), "b"(fd), "c"(level), "d"(optname), "S"(optval), "D"(optlen)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int send(int fd, const void *buf, int len, int flags) {
+    return sendto(fd, buf, len, flags, NULL, 0);
+}
+
+int recv(int fd, void *buf, int len, int flags) {
+    return recvfrom(fd, buf, len, flags, NULL, NULL);
+}
+
+// ==================== 路由表和接口配置 ====================
+
+static int route_call(int cmd, route_entry_t *entry) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_ROUTE), "b"(cmd), "c"(entry)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+static void route_fill(route_entry_t *e, uint32_t dst, int prefix_len,
+                       uint32_t gateway, const char *ifname, int metric) {
+    memset(e, 0, sizeof(*e));
+    e->dst = dst;
+    e->prefix_len = (uint32_t)prefix_len;
+    e->gateway = gateway;
+    e->metric = (uint32_t)metric;
+    for (int i = 0; ifname && ifname[i] && i < (int)sizeof(e->ifname) - 1; i++) {
+        e->ifname[i] = ifname[i];
+    }
+}
+
+int route_add(uint32_t dst, int prefix_len, uint32_t gateway, const char *ifname, int metric) {
+    route_entry_t e;
+    route_fill(&e, dst, prefix_len, gateway, ifname, metric);
+    return route_call(ROUTE_CMD_ADD, &e);
+}
+
+int route_del(uint32_t dst, int prefix_len, uint32_t gateway, const char *ifname) {
+    route_entry_t e;
+    route_fill(&e, dst, prefix_len, gateway, ifname, 0);
+    return route_call(ROUTE_CMD_DEL, &e);
+}
+
+int route_show(void) {
+    return route_call(ROUTE_CMD_SHOW, NULL);
+}
+
+int ifconfig_set(const char *ifname, uint32_t ip, uint32_t netmask, uint32_t gateway) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_IFCONFIG_SET), "b"(ifname), "c"(ip), "d"(netmask), "S"(gateway)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+// ==================== 网卡接收过滤 ====================
+
+static int net_filter_call(int cmd, const char *ifname, const struct sock_filter *insns, int len) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_NET_FILTER), "b"(cmd), "c"(ifname), "d"(insns), "S"(len)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int net_filter_attach(const char *ifname, const struct sock_filter *insns, int len) {
+    return net_filter_call(NET_FILTER_ATTACH, ifname, insns, len);
+}
+
+int net_filter_detach(const char *ifname) {
+    return net_filter_call(NET_FILTER_DETACH, ifname, NULL, 0);
+}
+
+int net_filter_show(void) {
+    return net_filter_call(NET_FILTER_SHOW, NULL, NULL, 0);
+}
+
+// ==================== 抓包环 ====================
+
+static int net_capture_call(int cmd, const char *ifname, uint32_t arg) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_NET_CAPTURE), "b"(cmd), "c"(ifname), "d"(arg)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+capture_ring_t *net_capture_setup(void) {
+    int ret = net_capture_call(NET_CAPTURE_SETUP, NULL, 0);
+    // 成功时返回的是用户态地址（高位为 1），错误码只有 -4095..-1
+    if (ret < 0 && ret >= -4095) {
+        return NULL;
+    }
+    return (capture_ring_t *)ret;
+}
+
+int net_capture_enable(const char *ifname, int dirs) {
+    return net_capture_call(NET_CAPTURE_ENABLE, ifname, (uint32_t)dirs);
+}
+
+int net_capture_show(void) {
+    return net_capture_call(NET_CAPTURE_SHOW, NULL, 0);
+}
+
+// ==================== 发送排队规则 ====================
+
+static int net_qdisc_call(int cmd, const qdisc_conf_t *conf) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_NET_QDISC), "b"(cmd), "c"(conf)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int net_qdisc_set(const qdisc_conf_t *conf) {
+    return net_qdisc_call(QDISC_CMD_SET, conf);
+}
+
+int net_qdisc_show(void) {
+    return net_qdisc_call(QDISC_CMD_SHOW, NULL);
+}
+
+// ==================== 接口 MTU ====================
+
+int net_set_mtu(const char *ifname, uint32_t mtu) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_NET_MTU), "b"(ifname), "c"(mtu)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int getuid(void) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GETUID)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+int setuid(uint32_t uid) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_SETUID), "b"(uid)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+// ==================== 内核旁路 / 轮询模式驱动 ====================
+
+#define PMD_RXD_DD      0x01
+#define PMD_RXD_EOP     0x02
+#define PMD_TXD_EOP     0x01
+#define PMD_TXD_IFCS    0x02
+#define PMD_TXD_RS      0x08
+#define PMD_TXD_DD      0x01
+
+int net_bypass(const char *ifname) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_NET_BYPASS), "b"(ifname)
+        : "memory", "cc"
+    );
+    return ret;
+}
+
+static inline uint32_t pmd_buf_dma(pmd_t *p, uint16_t buf) {
+    return p->info->dma_base + p->info->buf_offset + buf * p->info->buf_size;
+}
+
+int pmd_buf_alloc(pmd_t *p) {
+    if (p->free_nr == 0) {
+        return -1;
+    }
+    return p->free_buf[--p->free_nr];
+}
+
+void pmd_buf_free(pmd_t *p, uint16_t buf) {
+    p->free_buf[p->free_nr++] = buf;
+}
+
+/**
+ * 拿到网卡后每个 RX 描述符挂一个缓冲区（尾指针留一格，和内核驱动一样），
+ * 剩下的缓冲区给发送和调用者
+ */
+int pmd_open(pmd_t *p, const char *ifname) {
+    memset(p, 0, sizeof(*p));
+    p->fd = net_bypass(ifname);
+    if (p->fd < 0) {
+        return p->fd;
+    }
+
+    net_bypass_info_t *info = (net_bypass_info_t *)NET_BYPASS_VADDR;
+    if (info->magic != NET_BYPASS_MAGIC || info->rx_desc_nr > PMD_MAX_DESC ||
+        info->tx_desc_nr > PMD_MAX_DESC || info->buf_nr > PMD_MAX_BUF ||
+        info->buf_nr < info->rx_desc_nr + 1) {
+        close(p->fd);
+        p->fd = -1;
+        return -22;
+    }
+
+    uint8_t *base = (uint8_t *)NET_BYPASS_VADDR;
+    p->info = info;
+    p->rx_ring = (pmd_rx_desc_t *)(base + info->rx_ring_offset);
+    p->tx_ring = (pmd_tx_desc_t *)(base + info->tx_ring_offset);
+    p->rx_db = (volatile uint32_t *)(base + info->doorbell_offset + info->rx_doorbell);
+    p->tx_db = (volatile uint32_t *)(base + info->doorbell_offset + info->tx_doorbell);
+    p->rx_nr = (uint16_t)info->rx_desc_nr;
+    p->tx_nr = (uint16_t)info->tx_desc_nr;
+
+    for (int i = (int)info->buf_nr - 1; i >= 0; i--) {
+        pmd_buf_free(p, (uint16_t)i);
+    }
+    for (int i = 0; i < p->rx_nr; i++) {
+        uint16_t buf = (uint16_t)pmd_buf_alloc(p);
+        p->rx_buf[i] = buf;
+        p->rx_ring[i].buffer_addr = pmd_buf_dma(p, buf);
+        p->rx_ring[i].status = 0;
+    }
+    *p->rx_db = p->rx_nr - 1;
+    return 0;
+}
+
+/**
+ * 取走最多 n 个收到的帧，空出来的描述符换上新缓冲区后一次写门铃；
+ * 错误帧、跨描述符的长帧和换不到缓冲区的帧原地丢弃
+ */
+int pmd_rx_burst(pmd_t *p, pmd_pkt_t *pkts, int n) {
+    int got = 0;
+    int used = 0;
+
+    while (got < n) {
+        pmd_rx_desc_t *d = &p->rx_ring[p->rx_cur];
+        uint8_t status = d->status;
+        if (!(status & PMD_RXD_DD)) {
+            break;
+        }
+
+        int deliver = !p->rx_discard && (status & PMD_RXD_EOP) && !d->errors;
+        p->rx_discard = !(status & PMD_RXD_EOP);
+        if (deliver) {
+            int nb = pmd_buf_alloc(p);
+            if (nb < 0) {
+                deliver = 0;
+            } else {
+                uint16_t buf = p->rx_buf[p->rx_cur];
+                pkts[got].buf = buf;
+                pkts[got].len = d->length;
+                pkts[got].data = pmd_buf_data(p, buf);
+                got++;
+                p->rx_buf[p->rx_cur] = (uint16_t)nb;
+                d->buffer_addr = pmd_buf_dma(p, (uint16_t)nb);
+            }
+        }
+        if (!deliver && (status & PMD_RXD_EOP)) {
+            p->rx_dropped++;
+        }
+
+        d->status = 0;
+        p->rx_cur = (p->rx_cur + 1) % p->rx_nr;
+        used++;
+    }
+
+    if (used) {
+        *p->rx_db = (p->rx_cur + p->rx_nr - 1) % p->rx_nr;
+    }
+    p->rx_packets += got;
+    return got;
+}
+
+// 回收网卡已经发完的描述符和缓冲区
+static void pmd_tx_clean(pmd_t *p) {
+    while (p->tx_clean != p->tx_cur && (p->tx_ring[p->tx_clean].status & PMD_TXD_DD)) {
+        pmd_buf_free(p, p->tx_buf[p->tx_clean]);
+        p->tx_ring[p->tx_clean].status = 0;
+        p->tx_clean = (p->tx_clean + 1) % p->tx_nr;
+    }
+}
+
+int pmd_tx_burst(pmd_t *p, pmd_pkt_t *pkts, int n) {
+    int sent = 0;
+
+    pmd_tx_clean(p);
+    while (sent < n) {
+        uint16_t next = (p->tx_cur + 1) % p->tx_nr;
+        if (next == p->tx_clean) {
+            p->tx_full += n - sent;
+            break;
+        }
+        pmd_tx_desc_t *d = &p->tx_ring[p->tx_cur];
+        d->buffer_addr = pmd_buf_dma(p, pkts[sent].buf);
+        d->length = pkts[sent].len;
+        d->cmd = PMD_TXD_EOP | PMD_TXD_IFCS | PMD_TXD_RS;
+        d->status = 0;
+        p->tx_buf[p->tx_cur] = pkts[sent].buf;
+        p->tx_cur = next;
+        sent++;
+    }
+
+    if (sent) {
+        *p->tx_db = p->tx_cur;
+    }
+    p->tx_packets += sent;
+    return sent;
+}
+
+uint32_t pmd_wait(pmd_t *p) {
+    uint32_t n = 0;
+    if (read(p->fd, (char *)&n, sizeof(n)) != sizeof(n)) {
+        return 0;
+    }
+    return n;
+}
+
+void pmd_close(pmd_t *p) {
+    if (p->fd >= 0) {
+        close(p->fd);
+        p->fd = -1;
+    }
+}
@@ -49,6 +49,26 @@
 #define SYS_GUI_FB_BLIT 71      // 位图传输到帧缓冲区
 #define SYS_GUI_INPUT_READ 72   // 读取输入设备事件
 #define SYS_USB_MOUSE_POLL 73   // 轮询 USB 鼠标事件
+#define SYS_CLOCK_MS 74         // 获取单调毫秒时钟
+#define SYS_GUI_WAIT 75         // 睡眠直到超时或有输入事件
+#define SYS_SOCKET 76           // BSD 套接字
+#define SYS_BIND 77
+#define SYS_CONNECT 78
+#define SYS_LISTEN 79
+#define SYS_ACCEPT 80
+#define SYS_SENDTO 81
+#define SYS_RECVFROM 82
+#define SYS_ROUTE 83            // 路由表：添加 / 删除 / 显示
+#define SYS_IFCONFIG_SET 84     // 配置接口地址
+#define SYS_NET_INIT_VIRTIO 85  // 初始化 virtio-net 网卡
+#define SYS_NET_FILTER 86       // 网卡接收过滤（经典 BPF）
+#define SYS_NET_CAPTURE 87      // 抓包环
+#define SYS_NET_QDISC 88        // 发送排队规则
+#define SYS_SETSOCKOPT 89
+#define SYS_NET_MTU 90          // 接口 MTU（巨型帧）
+#define SYS_NET_BYPASS 91       // 内核旁路（用户态驱动网卡）
+#define SYS_GETUID 92
+#define SYS_SETUID 93           // 特权进程可换成任意 uid，普通进程只能设成自己的
 
 // WiFi 固件加载常量
 #define FW_CHUNK_SIZE   4096                // 每块大小（一页）
@@ -122,6 +142,7 @@ int lspci(void);  // 列出 PCI 设备
 // 🔥 网卡初始化系统调用
 int rtl8139_init_user(void);  // 初始化 RTL8139 网卡
 int e1000_init_user(const char *dev_name);  // 🔥 初始化 E1000 网卡（指定设备名称）
+int virtio_net_init_user(const char *dev_name);  // 初始化 virtio-net 网卡（指定设备名称）
 int net_send_udp(const char *ip, int port, const char *data, int len);  // 发送 UDP 包
 int net_set_device(const char *dev_name);  // 设置当前使用的网卡
 int net_poll_rx(void);  // 🔥 轮询RX（调试用）
@@ -177,6 +198,300 @@ typedef struct {
 int gui_get_fb_info(fb_info_t *info);           // 获取帧缓冲区信息
 int gui_fb_blit(int x, int y, int width, int height, const void *data);  // 位图传输
 int gui_read_input(input_event_t *event);      // 读取输入事件
+int gui_wait(uint32_t timeout_ms);             // 睡眠直到超时或有输入（1=有输入, 0=超时）
+uint32_t clock_ms(void);                       // 启动以来的毫秒数
+
+// 🔥 BSD 套接字（fd 可以直接 read/write/close；出错返回负的 errno）
+#define AF_INET         2
+#define SOCK_STREAM     1
+#define SOCK_DGRAM      2
+#define SOCK_NONBLOCK   04000       // socket() 的 type 按位或：非阻塞
+#define MSG_DONTWAIT    0x40        // 单次调用非阻塞
+#define INADDR_ANY      0
+#define IPPROTO_IP      0           // setsockopt level
+#define IP_TOS          1           // int，IP 头的 TOS（PRIO qdisc 按它分队列）
+#define IPTOS_LOWDELAY      0x10
+#define IPTOS_THROUGHPUT    0x08
+#define EAGAIN          11
+#define EINPROGRESS     115
+
+typedef uint32_t socklen_t;
+
+struct sockaddr_in {
+    uint16_t sin_family;    // AF_INET
+    uint16_t sin_port;      // 网络字节序
+    uint32_t sin_addr;      // 网络字节序
+    uint8_t  sin_zero[8];
+};
+
+static inline uint16_t htons(uint16_t x) {
+    return (uint16_t)((x << 8) | (x >> 8));
+}
+
+static inline uint32_t htonl(uint32_t x) {
+    return (x << 24) | ((x & 0xFF00) << 8) | ((x >> 8) & 0xFF00) | (x >> 24);
+}
+
+#define ntohs(x) htons(x)
+#define ntohl(x) htonl(x)
+
+uint32_t inet_addr(const char *ip);        // "a.b.c.d" -> 网络字节序，格式错误返回 0xFFFFFFFF
+int socket(int domain, int type, int protocol);
+int bind(int fd, const struct sockaddr_in *addr, socklen_t addrlen);
+int connect(int fd, const struct sockaddr_in *addr, socklen_t addrlen);
+int listen(int fd, int backlog);
+int accept(int fd, struct sockaddr_in *addr, socklen_t *addrlen);
+int send(int fd, const void *buf, int len, int flags);
+int recv(int fd, void *buf, int len, int flags);
+int sendto(int fd, const void *buf, int len, int flags,
+           const struct sockaddr_in *addr, socklen_t addrlen);
+int recvfrom(int fd, void *buf, int len, int flags,
+             struct sockaddr_in *addr, socklen_t *addrlen);
+int setsockopt(int fd, int level, int optname, const void *optval, socklen_t optlen);
+
+// 🔥 路由表和接口配置（地址为主机字节序；出错返回负的 errno）
+#define ROUTE_CMD_ADD   1
+#define ROUTE_CMD_DEL   2
+#define ROUTE_CMD_SHOW  3
+
+typedef struct {
+    uint32_t dst;           // 目的网络
+    uint32_t prefix_len;    // 0 即默认路由
+    uint32_t gateway;       // 0 表示直连
+    uint32_t metric;        // 同一前缀多条路由时取最小的
+    char     ifname[16];    // 空串表示按网关自动选择网卡
+} route_entry_t;
+
+int route_add(uint32_t dst, int prefix_len, uint32_t gateway, const char *ifname, int metric);
+int route_del(uint32_t dst, int prefix_len, uint32_t gateway, const char *ifname);
+int route_show(void);
+int ifconfig_set(const char *ifname, uint32_t ip, uint32_t netmask, uint32_t gateway);
+
+// 🔥 网卡接收过滤：经典 BPF（与 Linux SO_ATTACH_FILTER 的指令格式相同，tcpdump -dd 的输出可以直接用）
+// 程序返回 0 丢弃，BPF_RET_QUEUE(n) 放进接收队列 n（1 优先处理），其他值接收
+struct sock_filter {
+    uint16_t code;
+    uint8_t  jt;
+    uint8_t  jf;
+    uint32_t k;
+};
+
+#define BPF_LD      0x00
+#define BPF_LDX     0x01
+#define BPF_ST      0x02
+#define BPF_STX     0x03
+#define BPF_ALU     0x04
+#define BPF_JMP     0x05
+#define BPF_RET     0x06
+#define BPF_MISC    0x07
+#define BPF_W       0x00
+#define BPF_H       0x08
+#define BPF_B       0x10
+#define BPF_IMM     0x00
+#define BPF_ABS     0x20
+#define BPF_IND     0x40
+#define BPF_MEM     0x60
+#define BPF_LEN     0x80
+#define BPF_MSH     0xa0
+#define BPF_ADD     0x00
+#define BPF_SUB     0x10
+#define BPF_MUL     0x20
+#define BPF_DIV     0x30
+#define BPF_OR      0x40
+#define BPF_AND     0x50
+#define BPF_LSH     0x60
+#define BPF_RSH     0x70
+#define BPF_NEG     0x80
+#define BPF_MOD     0x90
+#define BPF_XOR     0xa0
+#define BPF_JA      0x00
+#define BPF_JEQ     0x10
+#define BPF_JGT     0x20
+#define BPF_JGE     0x30
+#define BPF_JSET    0x40
+#define BPF_K       0x00
+#define BPF_X       0x08
+#define BPF_A       0x10
+#define BPF_TAX     0x00
+#define BPF_TXA     0x80
+
+#define BPF_STMT(code, k)           { (uint16_t)(code), 0, 0, k }
+#define BPF_JUMP(code, k, jt, jf)   { (uint16_t)(code), jt, jf, k }
+#define BPF_RET_QUEUE(n)            (0x80000000u | ((n) & 0xFF))
+#define BPF_MAXINSNS                256
+
+#define NET_FILTER_ATTACH   1
+#define NET_FILTER_DETACH   2
+#define NET_FILTER_SHOW     3
+
+int net_filter_attach(const char *ifname, const struct sock_filter *insns, int len);
+int net_filter_detach(const char *ifname);
+int net_filter_show(void);
+
+// 抓包环（PACKET_MMAP 风格，布局见内核 capture.h）：
+// net_capture_setup() 把环映射进来（只有调用者能访问，再次 setup 的进程接管），
+// net_capture_enable() 打开设备的收/发抓包，
+// 之后内核把帧写进 status 为 CAPTURE_STATUS_KERNEL 的槽并置 USER，用户读完置回 KERNEL
+// 环头只读，用户只改各槽的 status；setup 和 enable 需要 uid 0（否则返回 -1）
+#define CAPTURE_FRAME_SIZE      2048
+#define CAPTURE_RING_MAGIC      0x50434150
+#define CAPTURE_STATUS_KERNEL   0
+#define CAPTURE_STATUS_USER     1
+#define CAPTURE_RX              0x01
+#define CAPTURE_TX              0x02
+
+typedef struct capture_ring {
+    uint32_t magic;
+    uint32_t frame_size;            // 帧槽大小
+    uint32_t frame_nr;              // 帧槽个数
+    uint32_t frame_offset;          // 第一个帧槽相对环起始的偏移
+    uint32_t snaplen;               // 每帧最多保存的字节数
+    volatile uint32_t packets;      // 写入环的帧数
+    volatile uint32_t drops;        // 环满丢掉的帧数
+} capture_ring_t;
+
+typedef struct capture_frame {
+    volatile uint32_t status;       // CAPTURE_STATUS_*
+    uint32_t len;                   // 帧原始长度
+    uint32_t caplen;                // 实际保存的长度，数据紧跟在帧头后面
+    uint32_t tv_sec;                // 时间戳（启动以来）
+    uint32_t tv_usec;
+    uint8_t  dir;                   // CAPTURE_RX / CAPTURE_TX
+    uint8_t  reserved[3];
+    char     ifname[16];
+} capture_frame_t;
+
+#define NET_CAPTURE_SETUP   1
+#define NET_CAPTURE_ENABLE  2
+#define NET_CAPTURE_SHOW    3
+
+static inline capture_frame_t *capture_frame(capture_ring_t *ring, uint32_t i) {
+    return (capture_frame_t *)((uint8_t *)ring + ring->frame_offset + i * ring->frame_size);
+}
+
+capture_ring_t *net_capture_setup(void);                // 建立（或复位）环，失败返回 NULL
+int net_capture_enable(const char *ifname, int dirs);   // dirs = CAPTURE_RX | CAPTURE_TX，0 关闭
+int net_capture_show(void);
+
+// 发送排队规则（布局见内核 qdisc.h）：每个设备一个 FIFO 或 3 队列 PRIO，可叠加令牌桶限速
+#define QDISC_FIFO          0
+#define QDISC_PRIO          1
+#define QDISC_CMD_SET       1
+#define QDISC_CMD_SHOW      2
+
+typedef struct {
+    char     ifname[16];
+    uint32_t kind;              // QDISC_FIFO / QDISC_PRIO
+    uint32_t limit;             // 每队列包数，0 取默认
+    uint32_t rate;              // 字节/秒，0 不限速
+    uint32_t burst;             // 字节，0 取 rate / 10
+} qdisc_conf_t;
+
+int net_qdisc_set(const qdisc_conf_t *conf);
+int net_qdisc_show(void);
+
+// 接口 MTU：68 ~ 网卡上限（e1000 支持 9000 的巨型帧），失败返回负的 errno
+#define ETH_MTU             1500
+#define ETH_JUMBO_MTU       9000
+int net_set_mtu(const char *ifname, uint32_t mtu);
+
+// 用户 ID：内核启动的进程是 uid 0，fork 继承；setuid 放弃特权后不能再拿回来
+int getuid(void);
+int setuid(uint32_t uid);                               // 成功 0，没有权限 -1
+
+// 内核旁路（布局见内核 bypass.h）：net_bypass() 把网卡的收发环、缓冲区和门铃寄存器
+// 映射到 NET_BYPASS_VADDR 并返回 fd，之后协议栈不再碰这块网卡；
+// read(fd) 等一次接收中断（返回 4 字节通知次数，1 秒没有中断为 0），
+// close(fd) 或进程退出时网卡交还协议栈。只有 uid 0 的进程可以用，
+// 映射只对调用者可见（fork 出来的子进程访问会缺页）
+#define NET_BYPASS_VADDR    0xB1000000
+#define NET_BYPASS_MAGIC    0x53505942
+
+typedef struct net_bypass_info {
+    uint32_t magic;
+    char     ifname[16];
+    uint8_t  mac[6];
+    uint16_t mtu;
+    uint32_t dma_base;              // 区域起始的物理地址（描述符里的缓冲区地址 = dma_base + 偏移）
+    uint32_t rx_ring_offset;        // 以下偏移都相对 NET_BYPASS_VADDR
+    uint32_t tx_ring_offset;
+    uint32_t rx_desc_nr;
+    uint32_t tx_desc_nr;
+    uint32_t buf_offset;
+    uint32_t buf_size;
+    uint32_t buf_nr;
+    uint32_t doorbell_offset;       // 门铃页（设备寄存器）
+    uint32_t rx_doorbell;           // RX 尾指针寄存器（相对门铃页）
+    uint32_t tx_doorbell;
+    volatile uint32_t irq_count;
+} net_bypass_info_t;
+
+int net_bypass(const char *ifname);     // 返回 fd，失败返回负的 errno
+
+// 轮询模式驱动（e1000 legacy 描述符）：缓冲区按编号管理，收到的包连同缓冲区交给调用者，
+// 调用者处理完要么原样交给 pmd_tx_burst（零拷贝转发），要么 pmd_buf_free
+#define PMD_MAX_DESC        256
+#define PMD_MAX_BUF         256
+
+typedef struct {
+    volatile uint32_t buffer_addr;
+    uint32_t padding;
+    volatile uint16_t length;
+    volatile uint16_t csum;
+    volatile uint8_t  status;       // RX：DD 0x01，EOP 0x02
+    volatile uint8_t  errors;
+    uint16_t special;
+} pmd_rx_desc_t;
+
+typedef struct {
+    volatile uint32_t buffer_addr;
+    uint32_t padding;
+    volatile uint16_t length;
+    uint8_t  cso;
+    volatile uint8_t  cmd;          // EOP 0x01，IFCS 0x02，RS 0x08
+    volatile uint8_t  status;       // DD 0x01
+    uint8_t  css;
+    uint16_t vlan;
+} pmd_tx_desc_t;
+
+typedef struct {
+    uint16_t buf;                   // 缓冲区编号
+    uint16_t len;
+    uint8_t *data;
+} pmd_pkt_t;
+
+typedef struct {
+    int fd;
+    net_bypass_info_t *info;
+    pmd_rx_desc_t *rx_ring;
+    pmd_tx_desc_t *tx_ring;
+    volatile uint32_t *rx_db;
+    volatile uint32_t *tx_db;
+    uint16_t rx_nr, tx_nr;
+    uint16_t rx_cur;                // 下一个要检查的 RX 描述符
+    uint16_t tx_cur;                // 下一个空闲 TX 描述符
+    uint16_t tx_clean;              // 下一个待回收的 TX 描述符
+    uint8_t  rx_discard;            // 跨描述符的长帧，丢到 EOP 为止
+    uint16_t rx_buf[PMD_MAX_DESC];  // 各描述符挂着的缓冲区
+    uint16_t tx_buf[PMD_MAX_DESC];
+    uint16_t free_buf[PMD_MAX_BUF]; // 空闲缓冲区栈
+    uint16_t free_nr;
+    uint32_t rx_packets, tx_packets;
+    uint32_t rx_dropped;            // 错误帧、长帧、缓冲区不够补环
+    uint32_t tx_full;               // TX 环满没发出去的包
+} pmd_t;
+
+static inline uint8_t *pmd_buf_data(pmd_t *p, uint16_t buf) {
+    return (uint8_t *)NET_BYPASS_VADDR + p->info->buf_offset + buf * p->info->buf_size;
+}
+
+int pmd_open(pmd_t *p, const char *ifname);     // 旁路网卡并填好 RX 环
+int pmd_rx_burst(pmd_t *p, pmd_pkt_t *pkts, int n);
+int pmd_tx_burst(pmd_t *p, pmd_pkt_t *pkts, int n);  // 返回发出的个数，没发出的仍归调用者
+int pmd_buf_alloc(pmd_t *p);                    // 没有空闲缓冲区返回 -1
+void pmd_buf_free(pmd_t *p, uint16_t buf);
+uint32_t pmd_wait(pmd_t *p);                    // 打开接收中断并等待，返回通知次数
+void pmd_close(pmd_t *p);
 
 // 字符串和内存工具函数
 int strlen(const char *s);
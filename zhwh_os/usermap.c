@@ -0,0 +1,97 @@
+/**
+ * @file usermap.c
+ * @brief 只对一个任务可见的用户态映射：切换任务时翻转 PTE_U
+ *
+ * 登记的映射很少（抓包环、旁路网卡各一个），切换时线性扫一遍；
+ * 只有属主换进 / 换出时才改页表，其他任务之间的切换不碰 TLB。
+ */
+
+#include "usermap.h"
+#include "task.h"
+#include "lapic.h"
+#include "page.h"
+#include "x86/io.h"
+#include "x86/mmu.h"
+
+extern uint32_t kernel_page_directory_phys;
+extern task_t *current_task[];
+
+static usermap_t *usermap_list = NULL;
+
+static inline uint32_t usermap_lock(void) {
+    uint32_t eflags = readeflags();
+    cli();
+    return eflags;
+}
+
+static inline void usermap_unlock(uint32_t eflags) {
+    if (eflags & FL_IF) {
+        sti();
+    }
+}
+
+// 打开 / 关闭一段映射的 PTE_U（调用者已关中断）
+static void usermap_set_user(const usermap_t *m, int user) {
+    uint32_t *pd = (uint32_t *)phys_to_virt(kernel_page_directory_phys);
+
+    for (uint32_t i = 0; i < m->pages; i++) {
+        uint32_t a = m->va + i * PAGE_SIZE;
+        uint32_t pde = pd[a >> 22];
+        if (!(pde & PTE_P)) {
+            continue;
+        }
+        uint32_t *pt = (uint32_t *)phys_to_virt(pde & ~0xFFF);
+        uint32_t *pte = &pt[(a >> 12) & 0x3FF];
+        if (!(*pte & PTE_P)) {
+            continue;
+        }
+        if (user) {
+            *pte |= PTE_U;
+        } else {
+            *pte &= ~PTE_U;
+        }
+        __asm__ volatile("invlpg (%0)" : : "r"(a) : "memory");
+    }
+}
+
+void usermap_add(usermap_t *m, uint32_t va, uint32_t pages, uint32_t owner) {
+    task_t *cur = current_task[logical_cpu_id()];
+
+    uint32_t flags = usermap_lock();
+    m->va = va;
+    m->pages = pages;
+    m->owner = owner;
+    m->next = usermap_list;
+    usermap_list = m;
+    usermap_set_user(m, cur && cur->pid == owner);
+    usermap_unlock(flags);
+}
+
+void usermap_del(usermap_t *m) {
+    uint32_t flags = usermap_lock();
+    for (usermap_t **pp = &usermap_list; *pp; pp = &(*pp)->next) {
+        if (*pp == m) {
+            *pp = m->next;
+            break;
+        }
+    }
+    usermap_set_user(m, 0);
+    m->next = NULL;
+    usermap_unlock(flags);
+}
+
+/**
+ * @brief 任务切换：换出的属主关掉 PTE_U，换进的属主打开
+ */
+void usermap_switch(task_t *prev, task_t *next) {
+    if (prev == next) {
+        return;
+    }
+    for (usermap_t *m = usermap_list; m; m = m->next) {
+        if (next && next->pid == m->owner) {
+            usermap_set_user(m, 1);
+        } else if (prev && prev->pid == m->owner) {
+            usermap_set_user(m, 0);
+        }
+    }
+}